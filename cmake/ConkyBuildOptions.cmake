@@ -267,6 +267,8 @@ option(BUILD_OPENSOUNDSYS "Build with Open Sound System support" true)
 
 option(BUILD_AUDACIOUS "Build audacious (music player) support" false)
 
+option(BUILD_MPRIS "Enable support for MPRIS2 media players (via D-Bus)" false)
+
 option(BUILD_MPD "Enable if you want MPD (music player) support" true)
 
 option(BUILD_MYSQL "Enable if you want MySQL support" false)
@@ -654,6 +654,15 @@ if(BUILD_X11)
       set(conky_libs ${conky_libs} ${X11_xcb_LIB})
       set(conky_includes ${conky_includes} ${X11_xcb_INCLUDE_PATH})
 
+      # Xlib-xcb lets Xlib requests be issued without waiting for replies
+      if(X11_X11_xcb_FOUND)
+        set(HAVE_XLIB_XCB true)
+        set(conky_libs ${conky_libs} ${X11_X11_xcb_LIB})
+        set(conky_includes ${conky_includes} ${X11_X11_xcb_INCLUDE_PATH})
+      else(X11_X11_xcb_FOUND)
+        set(HAVE_XLIB_XCB false)
+      endif(X11_X11_xcb_FOUND)
+
       if(X11_xcb_errors_FOUND)
         set(HAVE_XCB_ERRORS true)
         set(conky_includes ${conky_includes} ${X11_xcb_errors_INCLUDE_PATH})
@@ -663,6 +672,7 @@ if(BUILD_X11)
       endif(X11_xcb_errors_FOUND)
     else(X11_xcb_FOUND)
       set(HAVE_XCB false)
+      set(HAVE_XLIB_XCB false)
     endif(X11_xcb_FOUND)
   else(X11_FOUND)
     message(FATAL_ERROR "Unable to find X11 library")
@@ -787,6 +797,12 @@ if(BUILD_AUDACIOUS)
     ${DBUS_GLIB_INCLUDE_DIRS})
 endif(BUILD_AUDACIOUS)
 
+if(BUILD_MPRIS)
+  pkg_check_modules(DBUS REQUIRED dbus-1)
+  set(conky_libs ${conky_libs} ${DBUS_LINK_LIBRARIES})
+  set(conky_includes ${conky_includes} ${DBUS_INCLUDE_DIRS})
+endif(BUILD_MPRIS)
+
 if(BUILD_XMMS2)
   pkg_check_modules(XMMS2 REQUIRED xmms2-client>=0.6)
   set(conky_libs ${conky_libs} ${XMMS2_LINK_LIBRARIES})
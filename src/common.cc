@@ -36,7 +36,9 @@
 #include <pwd.h>
 #include <semaphore.h>
 #include <sys/ioctl.h>
+#include <sys/stat.h>
 #include <unistd.h>
+#include <algorithm>
 #include <cctype>
 #include <cerrno>
 #include <cstdio>
@@ -51,6 +53,7 @@
 #include "core.h"
 #include "data/fs.h"
 #include "data/misc.h"
+#include "data/network/net_accounting.h"
 #include "data/network/net_stat.h"
 #include "data/timeinfo.h"
 #include "data/top.h"
@@ -77,6 +80,14 @@
 
 #include "update-cb.hh"
 
+#ifdef HAVE_SYS_INOTIFY_H
+#include <sys/inotify.h>
+#ifdef __linux__
+#include <linux/magic.h>
+#include <sys/statfs.h>
+#endif /* __linux__ */
+#endif /* HAVE_SYS_INOTIFY_H */
+
 #ifdef BUILD_CURL
 #include "data/network/ccurl_thread.h"
 #endif /* BUILD_CURL */
@@ -238,6 +249,36 @@ FILE *open_file(const char *file, int *reported) {
   return fp;
 }
 
+ssize_t pread_file(int fd, std::vector<char> &buf, size_t initial_size) {
+  size_t len = 0;
+
+  if (buf.empty()) { buf.resize(std::max<size_t>(initial_size, 2)); }
+  for (;;) {
+    if (len + 1 >= buf.size()) { buf.resize(buf.size() * 2); }
+    ssize_t n = pread(fd, buf.data() + len, buf.size() - len - 1, len);
+    if (n < 0 && errno == EINTR) { continue; }
+    if (n < 0) { return -1; }
+    if (n == 0) { break; }
+    len += n;
+  }
+  buf[len] = '\0';
+  return len;
+}
+
+bool pread_ull(int fd, unsigned long long *value) {
+  char buf[32];
+  char *end;
+  ssize_t n;
+
+  do {
+    n = pread(fd, buf, sizeof(buf) - 1, 0);
+  } while (n < 0 && errno == EINTR);
+  if (n <= 0) { return false; }
+  buf[n] = '\0';
+  *value = strtoull(buf, &end, 10);
+  return end != buf;
+}
+
 std::filesystem::path get_cwd() {
   char *cwd;
   char buffer[1024];
@@ -456,6 +497,11 @@ void update_stuff() {
   /* if you registered a callback with conky::register_cb, this will run it */
   conky::run_all_callbacks();
 
+#ifdef BUILD_GUI
+  update_net_history();
+#endif /* BUILD_GUI */
+  update_net_accounting(time(nullptr));
+
 #if !defined(__linux__)
   /* XXX: move the following into the update_meminfo() functions? */
   if (no_buffers.get(*state)) {
@@ -704,57 +750,211 @@ void print_free_cached(struct text_object *obj, char *p,
                  p_max_size);
 }
 
+struct evaluate_data {
+  /* output of the first pass that `root` was parsed from */
+  std::string text;
+  struct text_object root;
+};
+
+void scan_evaluate_arg(struct text_object *obj, const char *arg) {
+  obj->sub = static_cast<text_object *>(malloc(sizeof(struct text_object)));
+  memset(obj->sub, 0, sizeof(struct text_object));
+  extract_variable_text_internal(obj->sub, arg != nullptr ? arg : "");
+  obj->data.opaque = new evaluate_data{};
+}
+
 void print_evaluate(struct text_object *obj, char *p, unsigned int p_max_size) {
+  auto *ed = static_cast<evaluate_data *>(obj->data.opaque);
   std::vector<char> buf(text_buffer_size.get(*state));
-  evaluate(obj->data.s, &buf[0], buf.size());
-  evaluate(&buf[0], p, p_max_size);
+
+  /* the argument is parsed once at startup; its output only needs parsing
+   * again when it differs from the previous update */
+  generate_text_internal(&buf[0], buf.size(), *obj->sub);
+  if (ed->root.next == nullptr || ed->text != &buf[0]) {
+    free_text_objects(&ed->root);
+    memset(&ed->root, 0, sizeof(struct text_object));
+    ed->text = &buf[0];
+    extract_variable_text_internal(&ed->root, ed->text.c_str());
+  }
+  generate_text_internal(p, p_max_size, ed->root);
+}
+
+void free_evaluate(struct text_object *obj) {
+  auto *ed = static_cast<evaluate_data *>(obj->data.opaque);
+  if (ed == nullptr) { return; }
+  free_text_objects(&ed->root);
+  delete ed;
+  obj->data.opaque = nullptr;
 }
 
 int if_empty_iftest(struct text_object *obj) {
-  std::vector<char> buf(max_user_text.get(*state));
-  int result = 1;
+  return generate_text_nonempty(*obj->sub) ? 0 : 1;
+}
 
-  generate_text_internal(&(buf[0]), max_user_text.get(*state), *obj->sub);
+struct existing_data {
+  std::string path;
+  /* text to look for, empty for the existence-only form */
+  std::string needle;
+  /* inotify watch on the parent directory, -1 when the result isn't cached */
+  int wd = -1;
+  /* cached iftest result, -1 when it has to be checked again */
+  int result = -1;
+};
 
-  if (strlen(&(buf[0])) != 0) { result = 0; }
-  return result;
-}
+static int check_contains(const char *f, const std::string &s) {
+  /* reused between checks; the file is read rather than mapped since it may
+   * be truncated while being scanned */
+  static std::vector<char> buf;
 
-static int check_contains(char *f, char *s) {
-  int ret = 0;
-  FILE *where = open_file(f, nullptr);
+  int fd = open(f, O_RDONLY | O_CLOEXEC);
+  if (fd == -1) {
+    LOG_DEBUG("could not open file '{}' for contains check", f);
+    return 0;
+  }
+  ssize_t len = pread_file(fd, buf);
+  close(fd);
+  if (len <= 0) { return 0; }
+
+  return memmem(buf.data(), len, s.data(), s.size()) != nullptr ? 1 : 0;
+}
+
+#ifdef HAVE_SYS_INOTIFY_H
+static std::vector<existing_data *> existing_watches;
+
+/* filesystems whose contents change without inotify events */
+#ifdef __linux__
+static bool existing_watchable(const char *dir) {
+  struct statfs sfs{};
+
+  if (statfs(dir, &sfs) != 0) { return false; }
+  switch (static_cast<unsigned long>(sfs.f_type)) {
+    case PROC_SUPER_MAGIC:
+    case SYSFS_MAGIC:
+    case DEBUGFS_MAGIC:
+    case TRACEFS_MAGIC:
+    case CGROUP_SUPER_MAGIC:
+    case CGROUP2_SUPER_MAGIC:
+    case SECURITYFS_MAGIC:
+    case NFS_SUPER_MAGIC:
+    case SMB_SUPER_MAGIC:
+    case 0xff534d42: /* cifs */
+    case 0xfe534d42: /* smb2 */
+    case 0x65735546: /* fuse */
+      return false;
+  }
+  return true;
+}
+#else
+/* libinotify can't tell those apart elsewhere, so such systems poll */
+static bool existing_watchable(const char *) { return false; }
+#endif /* __linux__ */
+
+static void existing_watch(existing_data *ed) {
+  struct stat st{};
+
+  if (ed->wd != -1) { return; }
+  /* changes to a symlink's target are reported in another directory */
+  if (lstat(ed->path.c_str(), &st) == 0 && S_ISLNK(st.st_mode)) { return; }
+
+  std::string dir = std::filesystem::path(ed->path).parent_path().string();
+  if (dir.empty()) { dir = "."; }
+  if (!existing_watchable(dir.c_str())) { return; }
+
+  /* only the contents form cares about writes, which would otherwise flood
+   * the queue for busy directories like /tmp; IN_MASK_ADD keeps the events
+   * of both forms when they share a directory */
+  uint32_t mask = IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO |
+                  IN_DELETE_SELF | IN_MOVE_SELF | IN_MASK_ADD;
+  if (!ed->needle.empty()) { mask |= IN_CLOSE_WRITE | IN_MODIFY; }
+  ed->wd = inotify_add_watch(inotify_fd, dir.c_str(), mask);
+  if (ed->wd != -1) { existing_watches.push_back(ed); }
+}
+
+static void existing_unwatch(existing_data *ed) {
+  int wd = ed->wd;
+
+  if (wd == -1) { return; }
+  std::erase(existing_watches, ed);
+  ed->wd = -1;
+  ed->result = -1;
+  /* the same directory watched by several objects shares one wd */
+  for (auto *other : existing_watches) {
+    if (other->wd == wd) { return; }
+  }
+  if (inotify_fd != -1) { inotify_rm_watch(inotify_fd, wd); }
+}
 
-  if (where != nullptr) {
-    char buf1[256];
+void existing_inotify_query(int wd, int mask) {
+  /* events were lost, so none of the cached results can be trusted */
+  bool overflow = (mask & IN_Q_OVERFLOW) != 0;
 
-    while (fgets(buf1, 256, where) != nullptr) {
-      if (strstr(buf1, s) != nullptr) {
-        ret = 1;
-        break;
-      }
+  for (auto *ed : existing_watches) {
+    if (overflow || ed->wd == wd) { ed->result = -1; }
+  }
+  if ((mask & (IN_IGNORED | IN_DELETE_SELF | IN_MOVE_SELF)) != 0) {
+    /* the directory is gone or elsewhere, so watch the path again */
+    std::erase_if(existing_watches, [wd](existing_data *ed) {
+      if (ed->wd != wd) { return false; }
+      ed->wd = -1;
+      return true;
+    });
+    if ((mask & IN_IGNORED) == 0 && inotify_fd != -1) {
+      inotify_rm_watch(inotify_fd, wd);
     }
-    fclose(where);
+  }
+}
+#endif /* HAVE_SYS_INOTIFY_H */
+
+void scan_existing_arg(struct text_object *obj, const char *arg) {
+  auto *ed = new existing_data;
+  const char *spc = strchr(arg, ' ');
+
+  if (spc != nullptr) {
+    ed->path.assign(arg, spc - arg);
+    ed->needle = spc + 1;
   } else {
-    LOG_DEBUG("could not open file '{}' for contains check", f);
+    ed->path = arg;
   }
-  return ret;
+  obj->data.opaque = ed;
 }
 
 int if_existing_iftest(struct text_object *obj) {
-  char *spc;
+  auto *ed = static_cast<existing_data *>(obj->data.opaque);
   int result = 0;
 
-  spc = strchr(obj->data.s, ' ');
-  if (spc != nullptr) { *spc = 0; }
-  if (access(obj->data.s, F_OK) == 0) {
-    if (spc == nullptr || (check_contains(obj->data.s, spc + 1) != 0)) {
+#ifdef HAVE_SYS_INOTIFY_H
+  if (inotify_fd == -1) {
+    /* auto reload was disabled, nobody reads the events anymore */
+    existing_unwatch(ed);
+  } else if (ed->wd != -1 && ed->result != -1) {
+    return ed->result;
+  } else {
+    /* watch before checking so a change in between isn't missed */
+    existing_watch(ed);
+  }
+#endif /* HAVE_SYS_INOTIFY_H */
+
+  if (access(ed->path.c_str(), F_OK) == 0) {
+    if (ed->needle.empty() ||
+        check_contains(ed->path.c_str(), ed->needle) != 0) {
       result = 1;
     }
   }
-  if (spc != nullptr) { *spc = ' '; }
+  if (ed->wd != -1) { ed->result = result; }
   return result;
 }
 
+void free_existing(struct text_object *obj) {
+  auto *ed = static_cast<existing_data *>(obj->data.opaque);
+
+  if (ed == nullptr) { return; }
+#ifdef HAVE_SYS_INOTIFY_H
+  existing_unwatch(ed);
+#endif /* HAVE_SYS_INOTIFY_H */
+  delete ed;
+  obj->data.opaque = nullptr;
+}
+
 int if_running_iftest(struct text_object *obj) {
   if (!is_process_running(obj->data.s)) { return 0; }
   return 1;
@@ -870,122 +1070,6 @@ void print_include(struct text_object *obj, char *p, unsigned int p_max_size) {
 }
 
 #ifdef BUILD_CURL
-namespace {
-constexpr char kGithubNotificationsUrl[] =
-    "https://api.github.com/notifications";
-}
-
-std::string github_notifications_url() { return kGithubNotificationsUrl; }
-
-std::string github_authorization_header(const std::string &token) {
-  return "Authorization: Bearer " + token;
-}
-
-#define NEW_TOKEN                       \
-  "https://github.com/settings/tokens/" \
-  "new?scopes=notifications&description=conky-query-github\n"
-static size_t read_github_data_cb(char *, size_t, size_t, char *);
-static size_t read_github_data_cb(char *data, size_t size, size_t nmemb,
-                                  char *p) {
-  char *ptr = data;
-  size_t sz = nmemb * size;
-  size_t z = 0;
-  static size_t x = 0;
-  static unsigned int skip = 0U;
-
-  for (; *ptr; ptr++, z++) {
-    if (z + 4 < sz) { /* Verifying up to *(ptr+4) */
-      if ('u' == *ptr && 'n' == *(ptr + 1) && 'r' == *(ptr + 2) &&
-          'e' == *(ptr + 3)) { /* "unread" */
-        ++x;
-        skip = 0U;
-      }
-      if ('m' == *ptr && 'e' == *(ptr + 1) && 's' == *(ptr + 2) &&
-          's' == *(ptr + 3) && z + 13 < sz) { /* "message": */
-        if ('B' == *(ptr + 10) && 'a' == *(ptr + 11) &&
-            'd' == *(ptr + 12)) { /* "Bad credentials" */
-          LOG_ERROR("github: bad credentials, generate a new token at {}",
-                    NEW_TOKEN);
-          snprintf(p, 80, "%s",
-                   "GitHub: Bad credentials, generate a new token.");
-          skip = 1U;
-          break;
-        }
-        if ('M' == *(ptr + 10) && 'i' == *(ptr + 11) &&
-            's' == *(ptr + 12)) { /* Missing the 'notifications' scope. */
-          LOG_ERROR(
-              "github: missing 'notifications' scope, generate a new token at "
-              "{}",
-              NEW_TOKEN);
-          snprintf(
-              p, 80, "%s",
-              "GitHub: Missing the notifications scope. Generate a new token.");
-          skip = 1U;
-          break;
-        }
-      }
-    }
-  }
-  if (0U == skip) { snprintf(p, 49, "%zu", x); }
-  return sz;
-}
-
-void print_github(struct text_object *obj, char *p, unsigned int p_max_size) {
-  (void)obj;
-  static char cached_result[256] = {""};
-  static unsigned int last_update = 1U;
-  CURL *curl = nullptr;
-  CURLcode res;
-  struct curl_slist *headers = nullptr;
-  std::string token = github_token.get(*state);
-
-  if (token.empty()) {
-    LOG_ERROR(
-        "${{github_notifications}} requires a token, generate one at {} and "
-        "add github_token='TOKEN' to conky.config",
-        NEW_TOKEN);
-    snprintf(p, p_max_size, "%s",
-             "GitHub notifications requires token, generate a new one.");
-    return;
-  }
-
-  if (1U != last_update) {
-    --last_update;
-    snprintf(p, p_max_size, "%s", cached_result);
-    return;
-  }
-
-  curl_global_init(CURL_GLOBAL_ALL);
-  if (nullptr == (curl = curl_easy_init())) { goto error; }
-  headers =
-      curl_slist_append(headers, github_authorization_header(token).c_str());
-  if (headers == nullptr) { goto error; }
-  curl_easy_setopt(curl, CURLOPT_URL, github_notifications_url().c_str());
-  curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
-#if defined(CURLOPT_ACCEPT_ENCODING)
-  curl_easy_setopt(curl, CURLOPT_ACCEPT_ENCODING, "gzip");
-#else  /* defined(CURLOPT_ACCEPT_ENCODING) */
-  curl_easy_setopt(curl, CURLOPT_ENCODING, "gzip");
-#endif /* defined(CURLOPT_ACCEPT_ENCODING) */
-  curl_easy_setopt(curl, CURLOPT_USERAGENT, "conky-github/1.0");
-  curl_easy_setopt(curl, CURLOPT_USE_SSL, (long)CURLUSESSL_ALL);
-  curl_easy_setopt(curl, CURLOPT_TIMEOUT, 20L);
-  curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, read_github_data_cb);
-  curl_easy_setopt(curl, CURLOPT_WRITEDATA, p);
-
-  res = curl_easy_perform(curl);
-  if (CURLE_OK != res) { goto error; }
-  snprintf(cached_result, 255, "%s", p);
-  last_update = 60U;
-
-error:
-  if (headers != nullptr) { curl_slist_free_all(headers); }
-  if (nullptr != curl) { curl_easy_cleanup(curl); }
-  curl_global_cleanup();
-
-  if (!isdigit(static_cast<unsigned char>(*p))) { last_update = 1U; }
-}
-
 void print_stock(struct text_object *obj, char *p, unsigned int p_max_size) {
   if (!obj->data.s) {
     p[0] = 0;
@@ -32,6 +32,7 @@
 #include <filesystem>
 #include <optional>
 #include <string>
+#include <vector>
 
 #include "content/text_object.h"
 #include "lua/setting.hh"
@@ -71,6 +72,13 @@ double get_realtime(void);
 std::filesystem::path to_real_path(const std::string &source);
 FILE *open_file(const char *file, int *reported);
 int open_fifo(const char *file, int *reported);
+/// Reads all of `fd` from its start into `buf` and NUL-terminates it. `buf`
+/// keeps its size between calls so polling a file doesn't allocate; it
+/// starts at `initial_size` and doubles whenever the file doesn't fit.
+/// Returns the number of bytes read, or -1 on error.
+ssize_t pread_file(int fd, std::vector<char> &buf, size_t initial_size = 4096);
+/// Reads the unsigned decimal at the start of `fd` into `value`.
+bool pread_ull(int fd, unsigned long long *value);
 
 /// Returns current working directory of conky.
 std::filesystem::path get_cwd();
@@ -167,10 +175,19 @@ void print_cached(struct text_object *, char *, unsigned int);
 void print_free_bufcache(struct text_object *, char *, unsigned int);
 void print_free_cached(struct text_object *, char *, unsigned int);
 
+void scan_evaluate_arg(struct text_object *, const char *);
 void print_evaluate(struct text_object *, char *, unsigned int);
+void free_evaluate(struct text_object *);
 
 int if_empty_iftest(struct text_object *);
+
+void scan_existing_arg(struct text_object *, const char *);
 int if_existing_iftest(struct text_object *);
+void free_existing(struct text_object *);
+#ifdef HAVE_SYS_INOTIFY_H
+/* invalidates cached ${if_existing} results watching `wd` */
+void existing_inotify_query(int wd, int mask);
+#endif /* HAVE_SYS_INOTIFY_H */
 int if_running_iftest(struct text_object *);
 
 #ifndef __OpenBSD__
@@ -201,11 +218,8 @@ void print_updates(struct text_object *, char *, unsigned int);
 int updatenr_iftest(struct text_object *);
 
 #ifdef BUILD_CURL
-void print_github(struct text_object *, char *, unsigned int);
 void print_stock(struct text_object *, char *, unsigned int);
 void free_stock(struct text_object *);
-std::string github_notifications_url();
-std::string github_authorization_header(const std::string &token);
 #endif /* BUILD_CURL */
 
 #endif /* _COMMON_H */
@@ -120,6 +120,7 @@
 #include "content/temphelper.h"
 #include "content/template.h"
 #include "data/network/mail.h"
+#include "data/network/net_accounting.h"
 #include "data/network/net_stat.h"
 #include "data/timeinfo.h"
 #include "data/top.h"
@@ -138,6 +139,8 @@
 #include "data/network/ccurl_thread.h"
 #endif /* BUILD_CURL */
 
+#include "cost-report.h"
+#include "lua/chunk-cache.hh"
 #include "lua/llua.h"
 #include "lua/lua-config.hh"
 #include "lua/setting.hh"
@@ -145,7 +148,13 @@
 
 /* check for OS and include appropriate headers */
 #if defined(__linux__)
+#include "data/hardware/cpufreq.h"
+#include "data/interrupts.h"
+#include "data/memtopo.h"
+#include "data/network/net_counters.h"
+#include "data/nfs.h"
 #include "data/os/linux.h"
+#include "data/zfs.h"
 #elif defined(__FreeBSD__) || defined(__FreeBSD_kernel__)
 #include "data/os/freebsd.h"
 #elif defined(__DragonFly__)
@@ -217,6 +226,9 @@ int top_cpu, top_mem, top_time;
 #ifdef BUILD_IOSTATS
 int top_io;
 #endif
+#ifdef __linux__
+int top_pss, top_pss_app, top_thread, top_app;
+#endif
 int top_running;
 
 /* Update interval */
@@ -438,21 +450,24 @@ static char *text_buffer;
 
 /* quite boring functions */
 
-static inline void for_each_line(char *b, int f(char *, int)) {
+/* f gets each line along with its first special and returns the first
+ * special of the next line */
+static inline void for_each_line(char *b,
+                                 special_node *f(char *, special_node *)) {
   char *ps, *pe;
-  int special_index = 0; /* specials index */
+  special_node *current = specials;
 
   if (b == nullptr) { return; }
   for (ps = b, pe = b; *pe != 0; pe++) {
     if (*pe == '\n') {
       *pe = '\0';
-      special_index = f(ps, special_index);
+      current = f(ps, current);
       *pe = '\n';
       ps = pe + 1;
     }
   }
 
-  if (ps < pe) { f(ps, special_index); }
+  if (ps < pe) { f(ps, current); }
 }
 
 static void convert_escapes(char *buf) {
@@ -675,6 +690,42 @@ void generate_text_internal(char *p, int p_max_size, struct text_object root) {
 #endif /* BUILD_ICONV */
 }
 
+bool generate_text_nonempty(struct text_object root) {
+  std::vector<char> buf(text_buffer_size.get(*state));
+  struct text_object *obj = root.next;
+
+  /* same walk as generate_text_internal(), but each object writes to the
+   * start of a scratch buffer and the walk ends with the first one that
+   * actually wrote something */
+  while (obj != nullptr) {
+    char *p = buf.data();
+    unsigned int p_max_size = buf.size();
+
+    p[0] = 0;
+    if (obj->callbacks.print != nullptr) {
+      (*obj->callbacks.print)(obj, p, p_max_size);
+    } else if (obj->callbacks.iftest != nullptr) {
+      if ((*obj->callbacks.iftest)(obj) == 0) {
+        if (obj->ifblock_next != nullptr) { obj = obj->ifblock_next; }
+      }
+    } else if (obj->callbacks.barval != nullptr) {
+      new_bar(obj, p, p_max_size, (*obj->callbacks.barval)(obj));
+    } else if (obj->callbacks.gaugeval != nullptr) {
+      new_gauge(obj, p, p_max_size, (*obj->callbacks.gaugeval)(obj));
+#ifdef BUILD_GUI
+    } else if (obj->callbacks.graphval != nullptr) {
+      new_graph(obj, p, p_max_size, (*obj->callbacks.graphval)(obj));
+#endif /* BUILD_GUI */
+    } else if (obj->callbacks.percentage != nullptr) {
+      percent_print(p, p_max_size, (*obj->callbacks.percentage)(obj));
+    }
+    if (p[0] != 0) { return true; }
+
+    obj = obj->next;
+  }
+  return false;
+}
+
 void evaluate(const char *text, char *p, int p_max_size) {
   struct text_object subroot{};
 
@@ -770,93 +821,77 @@ static void generate_text() {
 
 int get_string_width(const char *s) { return *s != 0 ? calc_text_width(s) : 0; }
 
-#ifdef BUILD_GUI
-int get_border_total() {
-  return dpi_scale(border_inner_margin.get(*state)) +
-         dpi_scale(border_outer_margin.get(*state)) +
-         dpi_scale(border_width.get(*state));
-}
+/* reused for every line to keep its allocations */
+static line_layout current_line;
 
-void remove_first_char(char *s) { memmove(s, s + 1, strlen(s)); }
+/* measures text[0, length) without copying it */
+static int get_run_width(char *text, size_t length) {
+  char c = text[length];
+  text[length] = '\0';
+  int width = get_string_width(text);
+  text[length] = c;
+  return width;
+}
 
-static int get_string_width_special(char *s, int special_index) {
-  char *p, *final;
-  special_node *current = specials;
-  int width = 0;
-  long i;
+void layout_line(char *s, special_node *first, line_layout &layout) {
+  bool graphical =
+      display_output() != nullptr && display_output()->graphical();
+  special_node *current = first;
+#ifdef BUILD_GUI
+  unsigned int orig_font = selected_font;
+#endif /* BUILD_GUI */
 
-  if (s == nullptr) { return 0; }
+  layout.segments.clear();
+  for (char *p = s;; p++) {
+    if (*p != SPECIAL_CHAR && *p != '\0') { continue; }
 
-  if (display_output() == nullptr || !display_output()->graphical()) {
-    return strlen(s);
-  }
-
-  p = strndup(s, text_buffer_size.get(*state));
-  final = p;
-
-  for (i = 0; i <= special_index; i++) { current = current->next; }
-
-  while (*p != 0) {
-    if (*p == SPECIAL_CHAR) {
-      /* shift everything over by 1 so that the special char
-       * doesn't mess up the size calculation */
-      remove_first_char(p);
-      /*for (i = 0; i < static_cast<long>(strlen(p)); i++) {
-        *(p + i) = *(p + i + 1);
-      }*/
-      if (current->type == text_node_t::GRAPH ||
-          current->type == text_node_t::GAUGE ||
-          current->type == text_node_t::BAR) {
-        width += current->width;
-      }
-      if (current->type == text_node_t::FONT) {
-        // put all following text until the next fontchange/stringend in
-        // influenced_by_font but do not include specials
-        char *influenced_by_font = strdup(p);
-        special_node *current_after_font = current;
-        // influenced_by_font gets special chars removed, so after this loop i
-        // counts the number of letters (not special chars) influenced by font
-        for (i = 0; influenced_by_font[i] != 0; i++) {
-          if (influenced_by_font[i] == SPECIAL_CHAR) {
-            // remove specials and stop at fontchange
-            current_after_font = current_after_font->next;
-            if (current_after_font->type == text_node_t::FONT) {
-              influenced_by_font[i] = 0;
-              break;
-            }
-            remove_first_char(&influenced_by_font[i]);
-          }
-        }
-        // add the length of influenced_by_font in the new font to width
-        int orig_font = selected_font;
-        selected_font = current->font_added;
-        width += calc_text_width(influenced_by_font);
-        selected_font = orig_font;
-        free(influenced_by_font);
-        // make sure the chars counted in the new font are not again counted
-        // in the old font
-        int specials_skipped = 0;
-        while (i > 0) {
-          if (p[specials_skipped] != SPECIAL_CHAR) {
-            remove_first_char(&p[specials_skipped]);
-            // i only counts non-special chars, so only decrement it for those
-            i--;
-          } else {
-            specials_skipped++;
-          }
-        }
-      }
-      current = current->next;
-    } else {
-      p++;
+    if (p > s) {
+      auto length = static_cast<size_t>(p - s);
+      layout.segments.push_back(
+          {s, length, nullptr, get_run_width(s, length)});
     }
+    if (*p == '\0') { break; }
+    s = p + 1;
+    /* more special chars than specials, e.g. from command output */
+    if (current == nullptr) { continue; }
+
+    int width = 0;
+    if (!graphical) {
+      /* text outputs count the special char itself */
+      width = 1;
+    } else if (current->type == text_node_t::BAR ||
+               current->type == text_node_t::GAUGE ||
+               current->type == text_node_t::GRAPH) {
+      width = current->width;
+#ifdef BUILD_GUI
+    } else if (current->type == text_node_t::FONT) {
+      selected_font = current->font_added;
+#endif /* BUILD_GUI */
+    }
+    layout.segments.push_back({nullptr, 0, current, width});
+    current = current->next;
   }
-  if (strlen(final) > 1) { width += calc_text_width(final); }
-  free(final);
-  return width;
+  layout.next_special = current;
+
+  layout.remaining.resize(layout.segments.size() + 1);
+  layout.remaining.back() = 0;
+  for (size_t i = layout.segments.size(); i > 0; i--) {
+    layout.remaining[i - 1] =
+        layout.remaining[i] + layout.segments[i - 1].width;
+  }
+#ifdef BUILD_GUI
+  selected_font = orig_font;
+#endif /* BUILD_GUI */
+}
+
+#ifdef BUILD_GUI
+int get_border_total() {
+  return dpi_scale(border_inner_margin.get(*state)) +
+         dpi_scale(border_outer_margin.get(*state)) +
+         dpi_scale(border_width.get(*state));
 }
 
-static int text_size_updater(char *s, int special_index);
+static special_node *text_size_updater(char *s, special_node *first);
 
 int last_font_height;
 void update_text_area() {
@@ -955,70 +990,59 @@ static draw_mode_t draw_mode; /* FG, BG or OUTLINE */
 #ifdef BUILD_GUI
 /*static*/ Colour current_color;
 
-static int text_size_updater(char *s, int special_index) {
+static special_node *text_size_updater(char *s, special_node *first) {
   int w = 0;
   /* extra line height contributed by tall bars/gauges/graphs, mirroring the
    * `cur_y_add` accumulator in draw_each_line_inner. Tracked separately from
    * last_font_height so that voffsets on the same line are not discarded. */
   int cur_y_add = 0;
-  char *p;
-  special_node *current = specials;
-
-  for (int i = 0; i < special_index; i++) { current = current->next; }
+  line_layout &layout = current_line;
 
   if (display_output() == nullptr || !display_output()->graphical()) {
-    return 0;
-  }
-  /* get string widths and skip specials */
-  p = s;
-  while (*p != 0) {
-    if (*p == SPECIAL_CHAR) {
-      *p = '\0';
-      w += get_string_width(s);
-      *p = SPECIAL_CHAR;
-
-      if (current->type == text_node_t::BAR ||
-          current->type == text_node_t::GAUGE ||
-          current->type == text_node_t::GRAPH) {
-        w += current->width;
-        if (current->height > cur_y_add && current->height > font_height()) {
-          cur_y_add = current->height;
-        }
-      } else if (current->type == text_node_t::OFFSET) {
-        if (current->arg > 0) { w += current->arg; }
-      } else if (current->type == text_node_t::VOFFSET) {
-        last_font_height += current->arg;
-      } else if (current->type == text_node_t::GOTO) {
-        if (current->arg > cur_x) { w = static_cast<int>(current->arg); }
-      } else if (current->type == text_node_t::TAB) {
-        int start = current->arg;
-        int step = current->width;
-
-        if ((step == 0) || step < 0) { step = 10; }
-        w += step - (cur_x - text_start.x() - start) % step;
-      } else if (current->type == text_node_t::FONT) {
-        selected_font = current->font_added;
-        if (font_height() > last_font_height) {
-          last_font_height = font_height();
-        }
+    return first;
+  }
+  layout_line(s, first, layout);
+
+  /* add up segment widths */
+  for (const line_segment &segment : layout.segments) {
+    special_node *current = segment.special;
+
+    if (current == nullptr) {
+      w += segment.width;
+    } else if (current->type == text_node_t::BAR ||
+               current->type == text_node_t::GAUGE ||
+               current->type == text_node_t::GRAPH) {
+      w += segment.width;
+      if (current->height > cur_y_add && current->height > font_height()) {
+        cur_y_add = current->height;
+      }
+    } else if (current->type == text_node_t::OFFSET) {
+      if (current->arg > 0) { w += current->arg; }
+    } else if (current->type == text_node_t::VOFFSET) {
+      last_font_height += current->arg;
+    } else if (current->type == text_node_t::GOTO) {
+      if (current->arg > cur_x) { w = static_cast<int>(current->arg); }
+    } else if (current->type == text_node_t::TAB) {
+      int start = current->arg;
+      int step = current->width;
+
+      if ((step == 0) || step < 0) { step = 10; }
+      w += step - (cur_x - text_start.x() - start) % step;
+    } else if (current->type == text_node_t::FONT) {
+      selected_font = current->font_added;
+      if (font_height() > last_font_height) {
+        last_font_height = font_height();
       }
-
-      special_index++;
-      current = current->next;
-      s = p + 1;
     }
-    p++;
   }
 
-  w += get_string_width(s);
-
   if (w > text_size.x()) { text_size.set_x(w); }
   int mw = dpi_scale(maximum_width.get(*state));
   if (mw > 0) { text_size.set_x(std::min(mw, text_size.x())); }
 
   text_size += conky::vec2i(0, last_font_height + cur_y_add);
   last_font_height = font_height();
-  return special_index;
+  return layout.next_special;
 }
 #endif /* BUILD_GUI */
 
@@ -1063,7 +1087,8 @@ static inline void draw_graph_bars(special_node *current,
   ++j;
 }
 
-static void draw_string(const char *s) {
+/* width_of_s may be passed in when the caller has already measured s */
+static void draw_string(const char *s, int known_width = -1) {
   int i;
   int i2;
   int pos;
@@ -1076,7 +1101,9 @@ static void draw_string(const char *s) {
   if (s[0] == '\0') { return; }
 
 #ifdef BUILD_GUI
-  width_of_s = get_string_width(s);
+  width_of_s = known_width >= 0 ? known_width : get_string_width(s);
+#else
+  (void)known_width;
 #endif /* BUILD_GUI */
   if (draw_mode == draw_mode_t::FG) {
     for (auto output : display_outputs())
@@ -1165,7 +1192,15 @@ static std::string formatSizeWithUnits(double size, int prec = 1) {
 }
 #endif /* BUILD_MATH && BUILD_GUI */
 
-int draw_each_line_inner(char *s, int special_index, int last_special_applied) {
+/* draws the text run of a segment, measured when the line was laid out */
+static void draw_segment(const line_segment &segment) {
+  char c = segment.text[segment.length];
+  segment.text[segment.length] = '\0';
+  draw_string(segment.text, segment.width);
+  segment.text[segment.length] = c;
+}
+
+static special_node *draw_each_line_inner(char *s, special_node *first) {
 #ifndef BUILD_GUI
   static int cur_x, cur_y; /* current x and y for drawing */
   (void)cur_y;
@@ -1175,8 +1210,16 @@ int draw_each_line_inner(char *s, int special_index, int last_special_applied) {
   int cur_y_add = 0;
   int mw = dpi_scale(maximum_width.get(*state));
 #endif /* BUILD_GUI */
-  char *p = s;
-  int orig_special_index = special_index;
+  line_layout &layout = current_line;
+  layout_line(s, first, layout);
+
+  /* text after the last special is drawn below tall bars and graphs */
+  size_t count = layout.segments.size();
+  const line_segment *trailing = nullptr;
+  if (count > 0 && layout.segments.back().special == nullptr) {
+    trailing = &layout.segments.back();
+    count--;
+  }
 
 #ifdef BUILD_GUI
   if (display_output() && display_output()->graphical()) {
@@ -1186,421 +1229,389 @@ int draw_each_line_inner(char *s, int special_index, int last_special_applied) {
   cur_x = text_start.x();
 #endif /* BUILD_GUI */
 
-  while (*p != 0) {
-    if (*p == SPECIAL_CHAR || last_special_applied > -1) {
+  for (size_t k = 0; k < count; k++) {
+    const line_segment &segment = layout.segments[k];
 #ifdef BUILD_GUI
-      int w = 0;
+    int w = 0;
 #endif /* BUILD_GUI */
 
-      /* draw string before special, unless we're dealing multiline
-       * specials */
-      if (last_special_applied > -1) {
-        special_index = last_special_applied;
-      } else {
-        *p = '\0';
-        draw_string(s);
-        *p = SPECIAL_CHAR;
-        s = p + 1;
-      }
-      /* draw special */
-      special_node *current = specials;
-      for (int i = 0; i < special_index; i++) { current = current->next; }
-      switch (current->type) {
-#ifdef BUILD_GUI
-        case text_node_t::HORIZONTAL_LINE:
-          if (display_output() && display_output()->graphical()) {
-            int h = current->height;
-            int mid = font_ascent() / 2;
-            int max_width = text_start.x() + text_size.x() - cur_x;
-
-            /* if no width was specified, current->width is set to 0 */
-            w = current->width;
-            if (w <= 0 || w > max_width) { w = max_width; }
+    if (segment.special == nullptr) {
+      draw_segment(segment);
+      continue;
+    }
 
-            if (display_output()) {
-              display_output()->set_line_style(h, true);
-              display_output()->draw_line(text_offset.x() + cur_x,
-                                          text_offset.y() + cur_y - mid / 2,
-                                          text_offset.x() + cur_x + w,
-                                          text_offset.y() + cur_y - mid / 2);
-            }
+    /* draw special */
+    special_node *current = segment.special;
+    switch (current->type) {
+#ifdef BUILD_GUI
+      case text_node_t::HORIZONTAL_LINE:
+        if (display_output() && display_output()->graphical()) {
+          int h = current->height;
+          int mid = font_ascent() / 2;
+          int max_width = text_start.x() + text_size.x() - cur_x;
+
+          /* if no width was specified, current->width is set to 0 */
+          w = current->width;
+          if (w <= 0 || w > max_width) { w = max_width; }
+
+          if (display_output()) {
+            display_output()->set_line_style(h, true);
+            display_output()->draw_line(text_offset.x() + cur_x,
+                                        text_offset.y() + cur_y - mid / 2,
+                                        text_offset.x() + cur_x + w,
+                                        text_offset.y() + cur_y - mid / 2);
           }
-          break;
-
-        case text_node_t::STIPPLED_HR:
-          if (display_output() && display_output()->graphical()) {
-            int h = current->height;
-            char tmp_s = current->arg;
-            int mid = font_ascent() / 2;
-            int max_width = text_start.x() + text_size.x() - cur_x - 1;
-            char ss[2] = {tmp_s, tmp_s};
-
-            /* if no width was specified, current->width is set to 0 */
-            w = current->width;
-            if (w <= 0 || w > max_width) { w = max_width; }
+        }
+        break;
 
-            if (display_output()) {
-              display_output()->set_line_style(h, false);
-              display_output()->set_dashes(ss);
-              display_output()->draw_line(text_offset.x() + cur_x,
-                                          text_offset.y() + cur_y - mid / 2,
-                                          text_offset.x() + cur_x + w,
-                                          text_offset.x() + cur_y - mid / 2);
-            }
+      case text_node_t::STIPPLED_HR:
+        if (display_output() && display_output()->graphical()) {
+          int h = current->height;
+          char tmp_s = current->arg;
+          int mid = font_ascent() / 2;
+          int max_width = text_start.x() + text_size.x() - cur_x - 1;
+          char ss[2] = {tmp_s, tmp_s};
+
+          /* if no width was specified, current->width is set to 0 */
+          w = current->width;
+          if (w <= 0 || w > max_width) { w = max_width; }
+
+          if (display_output()) {
+            display_output()->set_line_style(h, false);
+            display_output()->set_dashes(ss);
+            display_output()->draw_line(text_offset.x() + cur_x,
+                                        text_offset.y() + cur_y - mid / 2,
+                                        text_offset.x() + cur_x + w,
+                                        text_offset.x() + cur_y - mid / 2);
           }
-          break;
-
-        case text_node_t::BAR:
-          if (display_output() && display_output()->graphical()) {
-            int h, by;
-            double bar_usage, scale;
-            if (cur_x - text_start.x() > mw && mw > 0) { break; }
-            h = current->height;
-            bar_usage = current->arg;
-            scale = current->scale;
-            by = cur_y - (font_ascent() / 2) - 1;
-
-            if (h < font_h) { by -= h / 2 - 1; }
-            w = current->width;
-            if (w == 0) { w = text_start.x() + text_size.x() - cur_x - 1; }
-            if (w < 0) { w = 0; }
-
-            if (display_output()) {
-              display_output()->set_line_style(dpi_scale(1), true);
+        }
+        break;
 
-              display_output()->draw_rect(text_offset.x() + cur_x,
-                                          text_offset.y() + by, w, h);
-              display_output()->fill_rect(text_offset.x() + cur_x,
-                                          text_offset.y() + by,
-                                          w * bar_usage / scale, h);
-            }
-            if (h > cur_y_add && h > font_h) { cur_y_add = h; }
+      case text_node_t::BAR:
+        if (display_output() && display_output()->graphical()) {
+          int h, by;
+          double bar_usage, scale;
+          if (cur_x - text_start.x() > mw && mw > 0) { break; }
+          h = current->height;
+          bar_usage = current->arg;
+          scale = current->scale;
+          by = cur_y - (font_ascent() / 2) - 1;
+
+          if (h < font_h) { by -= h / 2 - 1; }
+          w = current->width;
+          if (w == 0) { w = text_start.x() + text_size.x() - cur_x - 1; }
+          if (w < 0) { w = 0; }
+
+          if (display_output()) {
+            display_output()->set_line_style(dpi_scale(1), true);
+
+            display_output()->draw_rect(text_offset.x() + cur_x,
+                                        text_offset.y() + by, w, h);
+            display_output()->fill_rect(text_offset.x() + cur_x,
+                                        text_offset.y() + by,
+                                        w * bar_usage / scale, h);
           }
-          break;
+          if (h > cur_y_add && h > font_h) { cur_y_add = h; }
+        }
+        break;
 
-        case text_node_t::GAUGE: /* new GAUGE  */
-          if (display_output() && display_output()->graphical()) {
-            int h, by = 0;
-            Colour last_colour = current_color;
+      case text_node_t::GAUGE: /* new GAUGE  */
+        if (display_output() && display_output()->graphical()) {
+          int h, by = 0;
+          Colour last_colour = current_color;
 #ifdef BUILD_MATH
-            float angle, px, py;
-            double usage, scale;
+          float angle, px, py;
+          double usage, scale;
 #endif /* BUILD_MATH */
 
-            if (cur_x - text_start.x() > mw && mw > 0) { break; }
+          if (cur_x - text_start.x() > mw && mw > 0) { break; }
 
-            h = current->height;
-            by = cur_y - (font_ascent() / 2) - 1;
+          h = current->height;
+          by = cur_y - (font_ascent() / 2) - 1;
 
-            if (h < font_h) { by -= h / 2 - 1; }
-            w = current->width;
-            if (w == 0) { w = text_start.x() + text_size.x() - cur_x - 1; }
-            if (w < 0) { w = 0; }
+          if (h < font_h) { by -= h / 2 - 1; }
+          w = current->width;
+          if (w == 0) { w = text_start.x() + text_size.x() - cur_x - 1; }
+          if (w < 0) { w = 0; }
 
-            if (display_output()) {
-              display_output()->set_line_style(1, true);
-              display_output()->draw_arc(text_offset.x() + cur_x,
-                                         text_offset.y() + by, w, h * 2, 0,
-                                         180 * 64);
-            }
+          if (display_output()) {
+            display_output()->set_line_style(1, true);
+            display_output()->draw_arc(text_offset.x() + cur_x,
+                                       text_offset.y() + by, w, h * 2, 0,
+                                       180 * 64);
+          }
 
 #ifdef BUILD_MATH
-            usage = current->arg;
-            scale = current->scale;
-            angle = M_PI * usage / scale;
-            px = static_cast<float>(cur_x + (w / 2.)) -
-                 static_cast<float>(w / 2.) * cos(angle);
-            py = static_cast<float>(by + (h)) -
-                 static_cast<float>(h) * sin(angle);
-
-            if (display_output()) {
-              display_output()->draw_line(
-                  text_offset.x() + cur_x + (w / 2.),
-                  text_offset.y() + by + (h),
-                  text_offset.x() + static_cast<int>(px),
-                  text_offset.y() + static_cast<int>(py));
-            }
+          usage = current->arg;
+          scale = current->scale;
+          angle = M_PI * usage / scale;
+          px = static_cast<float>(cur_x + (w / 2.)) -
+               static_cast<float>(w / 2.) * cos(angle);
+          py = static_cast<float>(by + (h)) -
+               static_cast<float>(h) * sin(angle);
+
+          if (display_output()) {
+            display_output()->draw_line(
+                text_offset.x() + cur_x + (w / 2.),
+                text_offset.y() + by + (h),
+                text_offset.x() + static_cast<int>(px),
+                text_offset.y() + static_cast<int>(py));
+          }
 
 #endif /* BUILD_MATH */
 
-            if (h > cur_y_add && h > font_h) { cur_y_add = h; }
+          if (h > cur_y_add && h > font_h) { cur_y_add = h; }
 
-            set_foreground_color(last_colour);
-          }
-          break;
-
-        case text_node_t::GRAPH:
-          if (display_output() && display_output()->graphical()) {
-            int h, by, i = 0, j = 0;
-            int colour_idx = 0;
-            Colour last_colour = current_color;
-            if (cur_x - text_start.x() > mw && mw > 0) { break; }
-            h = current->height;
-            by = cur_y - (font_ascent() / 2) - 1;
-
-            if (h < font_h) { by -= h / 2 - 1; }
-            w = current->width;
-            if (w == 0) {
-              w = text_start.x() + text_size.x() - cur_x - 1;
-              current->graph_width = std::max(w - 1, 0);
-              if (current->graph_width !=
-                  static_cast<int>(current->graph_data.size())) {
-                w = static_cast<int>(current->graph_data.size()) + 1;
-              }
+          set_foreground_color(last_colour);
+        }
+        break;
+
+      case text_node_t::GRAPH:
+        if (display_output() && display_output()->graphical()) {
+          int h, by, i = 0, j = 0;
+          int colour_idx = 0;
+          Colour last_colour = current_color;
+          if (cur_x - text_start.x() > mw && mw > 0) { break; }
+          h = current->height;
+          by = cur_y - (font_ascent() / 2) - 1;
+
+          if (h < font_h) { by -= h / 2 - 1; }
+          w = current->width;
+          if (w == 0) {
+            w = text_start.x() + text_size.x() - cur_x - 1;
+            current->graph_width = std::max(w - 1, 0);
+            if (current->graph_width !=
+                static_cast<int>(current->graph_data.size())) {
+              w = static_cast<int>(current->graph_data.size()) + 1;
             }
-            if (w < 0) { w = 0; }
-            if (draw_graph_borders.get(*state)) {
-              if (display_output()) {
-                display_output()->set_line_style(dpi_scale(1), true);
-                display_output()->draw_rect(text_offset.x() + cur_x,
-                                            text_offset.y() + by, w, h);
-              }
+          }
+          if (w < 0) { w = 0; }
+          if (draw_graph_borders.get(*state)) {
+            if (display_output()) {
+              display_output()->set_line_style(dpi_scale(1), true);
+              display_output()->draw_rect(text_offset.x() + cur_x,
+                                          text_offset.y() + by, w, h);
             }
-            if (display_output()) display_output()->set_line_style(1, true);
+          }
+          if (display_output()) display_output()->set_line_style(1, true);
 
-            /* in case we don't have a graph yet */
-            if (!current->graph_data.empty()) {
-              std::unique_ptr<Colour[]> tmpcolour;
+          /* in case we don't have a graph yet */
+          if (!current->graph_data.empty()) {
+            std::unique_ptr<Colour[]> tmpcolour;
 
-              if (current->colours_set) {
-                auto factory = create_gradient_factory(w, current->last_colour,
-                                                       current->first_colour);
-                tmpcolour = factory->create_gradient();
-                delete factory;
+            if (current->colours_set) {
+              auto factory = create_gradient_factory(w, current->last_colour,
+                                                     current->first_colour);
+              tmpcolour = factory->create_gradient();
+              delete factory;
+            }
+            colour_idx = 0;
+            if (current->invertx) {
+              for (i = 0; i <= w - 2; i++) {
+                draw_graph_bars(current, tmpcolour, text_offset, i, j, w,
+                                colour_idx, cur_x, by, h);
               }
-              colour_idx = 0;
-              if (current->invertx) {
-                for (i = 0; i <= w - 2; i++) {
-                  draw_graph_bars(current, tmpcolour, text_offset, i, j, w,
-                                  colour_idx, cur_x, by, h);
-                }
-              } else {
-                for (i = w - 2; i > -1; i--) {
-                  draw_graph_bars(current, tmpcolour, text_offset, i, j, w,
-                                  colour_idx, cur_x, by, h);
-                }
+            } else {
+              for (i = w - 2; i > -1; i--) {
+                draw_graph_bars(current, tmpcolour, text_offset, i, j, w,
+                                colour_idx, cur_x, by, h);
               }
             }
-            if (h > cur_y_add && h > font_h) { cur_y_add = h; }
-            if (show_graph_range.get(*state)) {
-              int tmp_x = cur_x;
-              int tmp_y = cur_y;
-              unsigned short int seconds = active_update_interval() * w;
-              char *tmp_day_str;
-              char *tmp_hour_str;
-              char *tmp_min_str;
-              char *tmp_sec_str;
-              char *tmp_str;
-              unsigned short int timeunits;
-              if (seconds != 0) {
-                timeunits = seconds / 86400;
-                seconds %= 86400;
-                if (timeunits <= 0 ||
-                    asprintf(&tmp_day_str, _("%dd"), timeunits) == -1) {
-                  tmp_day_str = strdup("");
-                }
-                timeunits = seconds / 3600;
-                seconds %= 3600;
-                if (timeunits <= 0 ||
-                    asprintf(&tmp_hour_str, _("%dh"), timeunits) == -1) {
-                  tmp_hour_str = strdup("");
-                }
-                timeunits = seconds / 60;
-                seconds %= 60;
-                if (timeunits <= 0 ||
-                    asprintf(&tmp_min_str, _("%dm"), timeunits) == -1) {
-                  tmp_min_str = strdup("");
-                }
-                if (seconds <= 0 ||
-                    asprintf(&tmp_sec_str, _("%ds"), seconds) == -1) {
-                  tmp_sec_str = strdup("");
-                }
-                if (asprintf(&tmp_str, "%s%s%s%s", tmp_day_str, tmp_hour_str,
-                             tmp_min_str, tmp_sec_str) == -1) {
-                  tmp_str = strdup("");
-                }
-                free(tmp_day_str);
-                free(tmp_hour_str);
-                free(tmp_min_str);
-                free(tmp_sec_str);
-              } else {
-                tmp_str = strdup(
-                    _("Range not possible"));  // should never happen, but
-                                               // better safe then sorry
+          }
+          if (h > cur_y_add && h > font_h) { cur_y_add = h; }
+          if (show_graph_range.get(*state)) {
+            int tmp_x = cur_x;
+            int tmp_y = cur_y;
+            unsigned short int seconds = active_update_interval() * w;
+            char *tmp_day_str;
+            char *tmp_hour_str;
+            char *tmp_min_str;
+            char *tmp_sec_str;
+            char *tmp_str;
+            unsigned short int timeunits;
+            if (seconds != 0) {
+              timeunits = seconds / 86400;
+              seconds %= 86400;
+              if (timeunits <= 0 ||
+                  asprintf(&tmp_day_str, _("%dd"), timeunits) == -1) {
+                tmp_day_str = strdup("");
               }
-              cur_x += (w / 2) - (font_ascent() * (strlen(tmp_str) / 2));
-              cur_y += font_h / 2;
-              draw_string(tmp_str);
-              free(tmp_str);
-              cur_x = tmp_x;
-              cur_y = tmp_y;
+              timeunits = seconds / 3600;
+              seconds %= 3600;
+              if (timeunits <= 0 ||
+                  asprintf(&tmp_hour_str, _("%dh"), timeunits) == -1) {
+                tmp_hour_str = strdup("");
+              }
+              timeunits = seconds / 60;
+              seconds %= 60;
+              if (timeunits <= 0 ||
+                  asprintf(&tmp_min_str, _("%dm"), timeunits) == -1) {
+                tmp_min_str = strdup("");
+              }
+              if (seconds <= 0 ||
+                  asprintf(&tmp_sec_str, _("%ds"), seconds) == -1) {
+                tmp_sec_str = strdup("");
+              }
+              if (asprintf(&tmp_str, "%s%s%s%s", tmp_day_str, tmp_hour_str,
+                           tmp_min_str, tmp_sec_str) == -1) {
+                tmp_str = strdup("");
+              }
+              free(tmp_day_str);
+              free(tmp_hour_str);
+              free(tmp_min_str);
+              free(tmp_sec_str);
+            } else {
+              tmp_str = strdup(
+                  _("Range not possible"));  // should never happen, but
+                                             // better safe then sorry
             }
+            cur_x += (w / 2) - (font_ascent() * (strlen(tmp_str) / 2));
+            cur_y += font_h / 2;
+            draw_string(tmp_str);
+            free(tmp_str);
+            cur_x = tmp_x;
+            cur_y = tmp_y;
+          }
 #ifdef BUILD_MATH
-            if (show_graph_scale.get(*state) && (current->show_scale == 1)) {
-              if (current->colours_set) {
-                // Set the foreground colour to the first colour, ensures the
-                // scale text is always drawn in the same colour
-                set_foreground_color(current->first_colour);
-              }
-              int tmp_x = cur_x;
-              int tmp_y = cur_y;
-              cur_x += font_ascent() / 2;
-              cur_y += font_h / 2;
-              std::string tmp_str = formatSizeWithUnits(
-                  current->scale_log != 0 ? std::pow(10.0, current->scale)
-                                          : current->scale);
-              draw_string(tmp_str.c_str());
-              cur_x = tmp_x;
-              cur_y = tmp_y;
+          if (show_graph_scale.get(*state) && (current->show_scale == 1)) {
+            if (current->colours_set) {
+              // Set the foreground colour to the first colour, ensures the
+              // scale text is always drawn in the same colour
+              set_foreground_color(current->first_colour);
             }
-#endif
-            set_foreground_color(last_colour);
+            int tmp_x = cur_x;
+            int tmp_y = cur_y;
+            cur_x += font_ascent() / 2;
+            cur_y += font_h / 2;
+            std::string tmp_str = formatSizeWithUnits(
+                current->scale_log != 0 ? std::pow(10.0, current->scale)
+                                        : current->scale);
+            draw_string(tmp_str.c_str());
+            cur_x = tmp_x;
+            cur_y = tmp_y;
           }
-          break;
+#endif
+          set_foreground_color(last_colour);
+        }
+        break;
 
-        case text_node_t::FONT:
-          if (display_output() && display_output()->graphical()) {
-            int old = font_ascent();
+      case text_node_t::FONT:
+        if (display_output() && display_output()->graphical()) {
+          int old = font_ascent();
 
-            cur_y -= font_ascent();
-            selected_font = current->font_added;
-            set_font();
-            if (cur_y + font_ascent() < cur_y + old) {
-              cur_y += old;
-            } else {
-              cur_y += font_ascent();
-            }
-            font_h = font_height();
+          cur_y -= font_ascent();
+          selected_font = current->font_added;
+          set_font();
+          if (cur_y + font_ascent() < cur_y + old) {
+            cur_y += old;
+          } else {
+            cur_y += font_ascent();
           }
-          break;
+          font_h = font_height();
+        }
+        break;
 #endif /* BUILD_GUI */
-        case text_node_t::FG:
-          if (draw_mode == draw_mode_t::FG) {
-            set_foreground_color(Colour::from_argb32(current->arg));
-          }
-          break;
+      case text_node_t::FG:
+        if (draw_mode == draw_mode_t::FG) {
+          set_foreground_color(Colour::from_argb32(current->arg));
+        }
+        break;
 
 #ifdef BUILD_GUI
-        case text_node_t::BG:
-          if (draw_mode == draw_mode_t::BG) {
-            set_foreground_color(Colour::from_argb32(current->arg));
-          }
-          break;
+      case text_node_t::BG:
+        if (draw_mode == draw_mode_t::BG) {
+          set_foreground_color(Colour::from_argb32(current->arg));
+        }
+        break;
 
-        case text_node_t::OUTLINE:
-          if (draw_mode == draw_mode_t::OUTLINE) {
-            set_foreground_color(Colour::from_argb32(current->arg));
-          }
-          break;
+      case text_node_t::OUTLINE:
+        if (draw_mode == draw_mode_t::OUTLINE) {
+          set_foreground_color(Colour::from_argb32(current->arg));
+        }
+        break;
 
-        case text_node_t::OFFSET:
-          w += current->arg;
-          break;
+      case text_node_t::OFFSET:
+        w += current->arg;
+        break;
 
-        case text_node_t::VOFFSET:
-          cur_y += current->arg;
-          break;
+      case text_node_t::VOFFSET:
+        cur_y += current->arg;
+        break;
 
-        case text_node_t::SAVE_COORDINATES:
+      case text_node_t::SAVE_COORDINATES:
 #ifdef BUILD_IMLIB2
-          saved_coordinates[static_cast<int>(current->arg)] =
-              std::array<int, 2>{cur_x - text_start.x(),
-                                 cur_y - text_start.y() - last_font_height};
+        saved_coordinates[static_cast<int>(current->arg)] =
+            std::array<int, 2>{cur_x - text_start.x(),
+                               cur_y - text_start.y() - last_font_height};
 #endif /* BUILD_IMLIB2 */
-          break;
+        break;
+
+      case text_node_t::TAB: {
+        int start = current->arg;
+        int step = current->width;
 
-        case text_node_t::TAB: {
-          int start = current->arg;
-          int step = current->width;
+        if ((step == 0) || step < 0) { step = 10; }
+        w = step - (cur_x - text_start.x() - start) % step;
+        break;
+      }
 
-          if ((step == 0) || step < 0) { step = 10; }
-          w = step - (cur_x - text_start.x() - start) % step;
-          break;
-        }
+      case text_node_t::ALIGNR: {
+        /* TODO: add back in "+ window.border_inner_margin" to the end of
+         * this line? */
+        int pos_x = text_start.x() + text_size.x() - layout.remaining[k + 1];
 
-        case text_node_t::ALIGNR: {
-          /* TODO: add back in "+ window.border_inner_margin" to the end of
-           * this line? */
-          int pos_x = text_start.x() + text_size.x() -
-                      get_string_width_special(s, special_index);
-
-          /* printf("pos_x %i text_start.x %i text_size.x %i cur_x %i "
-            "get_string_width(p) %i gap_x %i "
-            "current->arg %i window.border_inner_margin %i "
-            "window.border_width %i\n", pos_x, text_start.x, text_size.x,
-            cur_x, get_string_width_special(s), gap_x,
-            current->arg, window.border_inner_margin,
-            window.border_width); */
-          cur_x = pos_x - current->arg;
-          break;
-        }
+        cur_x = pos_x - current->arg;
+        break;
+      }
 
-        case text_node_t::ALIGNC: {
-          int pos_x = text_size.x() / 2 -
-                      get_string_width_special(s, special_index) / 2 -
-                      (cur_x - text_start.x());
-          /* int pos_x = text_start_x + text_size.x / 2 -
-            get_string_width_special(s) / 2; */
-
-          /* printf("pos_x %i text_start.x %i text_size.x %i cur_x %i "
-            "get_string_width(p) %i gap_x %i "
-            "current->arg %i\n", pos_x, text_start.x,
-            text_size.x, cur_x, get_string_width(s), gap_x,
-            current->arg); */
-          if (pos_x > current->arg) { w = pos_x - current->arg; }
-          break;
-        }
+      case text_node_t::ALIGNC: {
+        int pos_x = text_size.x() / 2 - layout.remaining[k + 1] / 2 -
+                    (cur_x - text_start.x());
+
+        if (pos_x > current->arg) { w = pos_x - current->arg; }
+        break;
+      }
 #endif /* BUILD_GUI */
-        case text_node_t::GOTO:
-          if (current->arg >= 0) {
+      case text_node_t::GOTO:
+        if (current->arg >= 0) {
 #ifdef BUILD_GUI
-            cur_x = static_cast<int>(current->arg);
-            // make sure shades are 1 pixel to the right of the text
-            if (draw_mode == draw_mode_t::BG) { cur_x++; }
+          cur_x = static_cast<int>(current->arg);
+          // make sure shades are 1 pixel to the right of the text
+          if (draw_mode == draw_mode_t::BG) { cur_x++; }
 #endif /* BUILD_GUI */
-            cur_x = static_cast<int>(current->arg);
-            for (auto output : display_outputs()) output->gotox(cur_x);
-          }
-          break;
-        default:
-          // do nothing; not a special node or support not enabled
-          break;
-      }
+          cur_x = static_cast<int>(current->arg);
+          for (auto output : display_outputs()) output->gotox(cur_x);
+        }
+        break;
+      default:
+        // do nothing; not a special node or support not enabled
+        break;
+    }
 
 #ifdef BUILD_GUI
-      cur_x += w;
+    cur_x += w;
 #endif /* BUILD_GUI */
-
-      if (special_index != last_special_applied) {
-        special_index++;
-      } else {
-        special_index = orig_special_index;
-        last_special_applied = -1;
-      }
-    }
-    p++;
   }
 
 #ifdef BUILD_GUI
   cur_y += cur_y_add;
 #endif /* BUILD_GUI */
-  draw_string(s);
+  if (trailing != nullptr) { draw_segment(*trailing); }
   for (auto output : display_outputs()) output->line_inner_done();
 #ifdef BUILD_GUI
   if (display_output() && display_output()->graphical()) {
     cur_y += font_descent();
   }
 #endif /* BUILD_GUI */
-  return special_index;
+  return layout.next_special;
 }
 
-static int draw_line(char *s, int special_index) {
+static special_node *draw_line(char *s, special_node *first) {
   if (display_output() && display_output()->draw_line_inner_required()) {
-    return draw_each_line_inner(s, special_index, -1);
+    return draw_each_line_inner(s, first);
   }
   draw_string(s);
-  UNUSED(special_index);
-  return 0;
+  return first;
 }
 
 static void draw_text() {
@@ -2032,42 +2043,38 @@ void main_loop() {
       inotify_config_wd =
           inotify_add_watch(inotify_fd, current_config.c_str(), IN_MODIFY);
     }
-    if (!disable_auto_reload.get(*state) && inotify_fd != -1 &&
-        inotify_config_wd != -1 && !current_config.empty()) {
-      int len = 0, idx = 0;
-      fd_set descriptors;
-      struct timeval time_to_wait;
-
-      FD_ZERO(&descriptors);
-      FD_SET(inotify_fd, &descriptors);
-
-      time_to_wait.tv_sec = time_to_wait.tv_usec = 0;
-
-      select(inotify_fd + 1, &descriptors, nullptr, NULL, &time_to_wait);
-      if (FD_ISSET(inotify_fd, &descriptors)) {
-        /* process inotify events */
-        len = read(inotify_fd, inotify_buff, INOTIFY_BUF_LEN - 1);
-        inotify_buff[len] = 0;
-        while (len > 0 && idx < len) {
+    if (!disable_auto_reload.get(*state) && inotify_fd != -1) {
+      bool reload = false, rewatch = false;
+      ssize_t len;
+
+      /* the fd is non-blocking, so drain everything queued since the last
+       * update; reloading is left until then so no event is dropped */
+      while ((len = read(inotify_fd, inotify_buff, INOTIFY_BUF_LEN - 1)) >
+             0) {
+        for (ssize_t idx = 0; idx < len;) {
           struct inotify_event *ev = (struct inotify_event *)&inotify_buff[idx];
           if (ev->wd == inotify_config_wd &&
               (ev->mask & IN_MODIFY || ev->mask & IN_IGNORED)) {
-            /* current_config should be reloaded */
-            LOG_INFO("'{}' modified, reloading", current_config);
-            reload_config();
-            if (ev->mask & IN_IGNORED) {
-              /* for some reason we get IN_IGNORED here
-               * sometimes, so we need to re-add the watch */
-              inotify_config_wd = inotify_add_watch(
-                  inotify_fd, current_config.c_str(), IN_MODIFY);
-            }
-            break;
+            reload = true;
+            /* for some reason we get IN_IGNORED here
+             * sometimes, so we need to re-add the watch */
+            if (ev->mask & IN_IGNORED) { rewatch = true; }
           } else {
             llua_inotify_query(ev->wd, ev->mask);
+            existing_inotify_query(ev->wd, ev->mask);
           }
           idx += INOTIFY_EVENT_SIZE + ev->len;
         }
       }
+      if (reload) {
+        /* current_config should be reloaded */
+        LOG_INFO("'{}' modified, reloading", current_config);
+        reload_config();
+        if (rewatch) {
+          inotify_config_wd = inotify_add_watch(
+              inotify_fd, current_config.c_str(), IN_MODIFY);
+        }
+      }
     } else if (disable_auto_reload.get(*state) && inotify_fd != -1) {
       inotify_rm_watch(inotify_fd, inotify_config_wd);
       close(inotify_fd);
@@ -2076,6 +2083,7 @@ void main_loop() {
 #endif /* HAVE_SYS_INOTIFY_H */
 
     llua_update_info(&info, active_update_interval());
+    llua_update_async();
   }
   clean_up();
 
@@ -2154,8 +2162,20 @@ void clean_up(void) {
   free_specials(specials);
 
   clear_net_stats();
+#ifdef BUILD_GUI
+  clear_net_history();
+#endif /* BUILD_GUI */
+  clear_net_accounting();
   clear_fs_stats();
   clear_diskio_stats();
+#if defined(__linux__)
+  clear_cpufreq();
+  clear_interrupts();
+  clear_memtopo();
+  clear_nfs_stats();
+  clear_net_counters();
+  clear_zfs();
+#endif /* __linux__ */
   free_and_zero(global_cpu);
 
   conky::cleanup_config_settings(*state);
@@ -2175,6 +2195,12 @@ static void set_default_configurations() {
   top_time = 0;
 #ifdef BUILD_IOSTATS
   top_io = 0;
+#endif
+#ifdef __linux__
+  top_pss = 0;
+  top_pss_app = 0;
+  top_thread = 0;
+  top_app = 0;
 #endif
   top_running = 0;
 #ifdef BUILD_XMMS2
@@ -2219,7 +2245,7 @@ void load_config_file() {
       l.loadstring(defconfig);
     } else {
 #endif
-      l.loadfile(current_config.c_str());
+      l.loadfile(current_config.c_str(), &conky::load_cached_chunk);
 #ifdef BUILD_BUILTIN_CONFIG
     }
 #endif
@@ -2300,7 +2326,7 @@ void set_current_config() {
 
 /* : means that character before that takes an argument */
 const char *getopt_string =
-    "vVqdDLSs:t:u:i:hc:p:"
+    "vVqdDLRSs:t:u:i:hc:p:"
 #if defined(__linux__) || defined(__FreeBSD__) ||        \
     defined(__FreeBSD_kernel__) || defined(__HAIKU__) || \
     defined(__NetBSD__) || defined(__OpenBSD__)
@@ -2329,6 +2355,7 @@ const struct option longopts[] = {{"help", 0, nullptr, 'h'},
                                   {"print-config", 0, nullptr, 'C'},
 #endif
                                   {"daemonize", 0, nullptr, 'd'},
+                                  {"cost-report", 0, nullptr, 'R'},
 #ifdef BUILD_X11
                                   {"alignment", 1, nullptr, 'a'},
                                   {"display", 1, nullptr, 'X'},
@@ -2486,6 +2513,12 @@ void initialisation(int argc, char **argv) {
   /* generate text and get initial size */
   extract_variable_text(global_text);
   free_and_zero(global_text);
+
+  if (conky::cost_report_requested) {
+    conky::print_cost_report(std::cout, &global_root_object,
+                             active_update_interval());
+    return;
+  }
   /* fork */
   if (fork_to_background.get(*state) && (first_pass != 0)) {
     int pid = fork();
@@ -41,6 +41,7 @@
 #include <csignal>
 #include <filesystem>
 #include <memory>
+#include <vector>
 
 #include "common.h" /* at least for struct dns_data */
 #include "content/colours.hh"
@@ -132,9 +133,24 @@ struct desktop_info {
   std::string name;
 };
 
+struct keyboard_info {
+  /* indicator bits as last reported by XKB */
+  unsigned int led_mask;
+  /* false if XKB is unavailable and LEDs must be queried on each print */
+  bool tracked;
+};
+
+struct active_window_info {
+  /* _NET_ACTIVE_WINDOW of the root window, None if unknown */
+  unsigned long window;
+  std::string title;
+};
+
 struct x11_info {
   struct monitor_info monitor;
   struct desktop_info desktop;
+  struct keyboard_info keyboard;
+  struct active_window_info active_window;
 };
 
 #endif /* BUILD_X11 */
@@ -244,6 +260,12 @@ struct information {
 #ifdef BUILD_IOSTATS
   struct process *io[10];
 #endif /* BUILD_IOSTATS */
+#ifdef __linux__
+  struct process *pss[10];
+  struct process *pss_app[10];
+  struct process *thread[10];
+  struct process *app[10];
+#endif /* __linux__ */
   struct process *first_process;
   unsigned long looped;
 
@@ -337,6 +359,9 @@ extern int top_cpu, top_mem, top_time;
 #ifdef BUILD_IOSTATS
 extern int top_io;
 #endif /* BUILD_IOSTATS */
+#ifdef __linux__
+extern int top_pss, top_pss_app, top_thread, top_app;
+#endif /* __linux__ */
 extern int top_running;
 
 /* struct that has all info to be shared between
@@ -397,9 +422,39 @@ void extract_object_args_to_sub(struct text_object *, const char *);
 
 void generate_text_internal(char *, int, struct text_object);
 
+/* reports whether generate_text_internal() would produce any output, without
+ * generating more than the first non-empty object */
+bool generate_text_nonempty(struct text_object);
+
 void update_text_area();
 void draw_stuff();
 
+struct special_node;
+
+/* A line of text_buffer split once at its special chars. Text runs point
+ * into the buffer and specials to their nodes, each with the width it takes
+ * up, measured in the font in effect at that point. The size updater and the
+ * drawing code walk the same segments, and alignment reads the width of the
+ * rest of the line from `remaining` instead of measuring it again. */
+struct line_segment {
+  char *text; /* nullptr for a special */
+  size_t length;
+  special_node *special;
+  int width;
+};
+
+struct line_layout {
+  std::vector<line_segment> segments;
+  /* remaining[i] is the width of segments[i] and everything after it */
+  std::vector<int> remaining;
+  /* first special of the following line */
+  special_node *next_special;
+};
+
+/* splits the line s, whose first special is `first`, into layout */
+void layout_line(char *s, special_node *first, line_layout &layout);
+void free_specials(special_node *&current);
+
 int percent_print(char *, int, unsigned);
 void human_readable(long long, char *, int);
 
@@ -113,6 +113,7 @@ struct graph {
   int minheight;    /* Clamp values below this threshold to this threshold */
   size_t data_hash; /* identifies the data source for slot reuse */
   std::vector<double> history; /* pre-allocated at scan time when width known */
+  graph_series *series;        /* history kept by the data source, if any */
 };
 
 struct stippled_hr {
@@ -427,8 +428,35 @@ done:
   if (g->width > 0) { g->history.resize(dpi_scale(g->width), 0.0); }
   return true;
 }
+
+void bind_graph_series(struct text_object *obj, graph_series *series) {
+  auto *g = static_cast<struct graph *>(obj->special_data);
+
+  if (g == nullptr) { return; }
+  g->series = series;
+  /* the series fills the node on every draw, nothing to pre-allocate */
+  g->history.clear();
+  if (g->width > 0) { series->reserve(dpi_scale(g->width)); }
+}
 #endif /* BUILD_GUI */
 
+void graph_series::push(double value) {
+  if (samples.empty()) { return; }
+  samples[head] = value;
+  head = (head + 1) % samples.size();
+  if (count < samples.size()) { count++; }
+}
+
+void graph_series::reserve(size_t capacity) {
+  if (capacity <= samples.size()) { return; }
+
+  std::vector<double> grown(capacity, 0.0);
+  /* unroll the ring oldest first, so the next write lands after them */
+  for (size_t i = 0; i < count; i++) { grown[i] = at(count - 1 - i); }
+  samples = std::move(grown);
+  head = count;
+}
+
 /*
  * Printing various special text objects
  */
@@ -537,10 +565,8 @@ void new_font(struct text_object *obj, char *p, unsigned int p_max_size) {
 /**
  * Adds value f to graph possibly truncating and scaling the graph
  **/
-static void graph_append(struct special_node *graph, double f, char showaslog) {
-  /* do nothing if we don't even have a graph yet */
-  if (graph->graph_data.empty()) { return; }
-
+static double graph_sample(struct special_node *graph, double f,
+                           char showaslog) {
   if (showaslog != 0) {
 #ifdef BUILD_MATH
     f = log10(f + 1);
@@ -548,12 +574,11 @@ static void graph_append(struct special_node *graph, double f, char showaslog) {
   }
 
   if ((graph->scaled == 0) && f > graph->scale) { f = graph->scale; }
+  return f;
+}
 
-  /* shift all the data by 1 */
-  for (int i = static_cast<int>(graph->graph_data.size()) - 1; i > 0; i--) {
-    graph->graph_data[i] = graph->graph_data[i - 1];
-  }
-  graph->graph_data[0] = f; /* add new data */
+static void graph_rescale(struct special_node *graph) {
+  if (graph->graph_data.empty()) { return; }
 
   if (graph->scaled != 0) {
     double *currentmax =
@@ -580,6 +605,36 @@ static void graph_append(struct special_node *graph, double f, char showaslog) {
   }
 }
 
+static void graph_append(struct special_node *graph, double f, char showaslog) {
+  /* do nothing if we don't even have a graph yet */
+  if (graph->graph_data.empty()) { return; }
+
+  f = graph_sample(graph, f, showaslog);
+
+  /* shift all the data by 1 */
+  for (int i = static_cast<int>(graph->graph_data.size()) - 1; i > 0; i--) {
+    graph->graph_data[i] = graph->graph_data[i - 1];
+  }
+  graph->graph_data[0] = f; /* add new data */
+
+  graph_rescale(graph);
+}
+
+/**
+ * Copies the newest samples of a shared series into graph, newest first
+ **/
+static void graph_fill(struct special_node *graph, const graph_series &series,
+                       char showaslog) {
+  size_t n = std::min(series.size(), graph->graph_data.size());
+
+  for (size_t i = 0; i < n; i++) {
+    graph->graph_data[i] = graph_sample(graph, series.at(i), showaslog);
+  }
+  std::fill(graph->graph_data.begin() + n, graph->graph_data.end(), 0.0);
+
+  graph_rescale(graph);
+}
+
 void new_graph_in_shell(struct special_node *s, char *buf, int buf_max_size) {
   // Split config string on comma to avoid the hassle of dealing with the
   // idiosyncrasies of multi-byte unicode on different platforms.
@@ -663,7 +718,13 @@ void new_graph(struct text_object *obj, char *buf, int buf_max_size,
   if ((g->invertflag & SF_INVERTY) != 0) { s->inverty = 1; }
   if (g->speedgraph) { s->speedgraph = TRUE; }
 
-  graph_append(s, val, g->flags);
+  if (g->series != nullptr) {
+    /* width-filling graphs learn their width while drawing */
+    g->series->reserve(s->graph_data.size());
+    graph_fill(s, *g->series, g->flags);
+  } else {
+    graph_append(s, val, g->flags);
+  }
 
   if (out_to_stdout.get(*state)) { new_graph_in_shell(s, buf, buf_max_size); }
 }
@@ -96,6 +96,25 @@ struct special_node {
   struct special_node *next;
 };
 
+/* Ring of samples owned by a data source rather than by a graph, so that any
+ * number of graphs can draw the same series and it outlives the special nodes
+ * they're drawn into. Capacity grows to fit the widest graph. */
+class graph_series {
+  std::vector<double> samples;
+  size_t head = 0; /* index the next sample is written to */
+  size_t count = 0;
+
+ public:
+  void push(double value);
+  /* makes room for at least `capacity` samples, keeping the newest ones */
+  void reserve(size_t capacity);
+  size_t size() const { return count; }
+  /* `age` 0 is the newest sample */
+  double at(size_t age) const {
+    return samples[(head + samples.size() - 1 - age) % samples.size()];
+  }
+};
+
 /* direct access to the registered specials (FIXME: bad encapsulation) */
 extern struct special_node *specials;
 extern int special_count;
@@ -112,6 +131,8 @@ std::pair<char *, size_t> scan_command(const char *);
 void scan_font(struct text_object *, const char *);
 bool scan_graph(struct text_object *, const char *, double, char,
                 graph_data_key key = graph_parent_obj_key);
+/* makes a scanned graph draw `series` instead of keeping its own history */
+void bind_graph_series(struct text_object *, graph_series *);
 void scan_tab(struct text_object *, const char *);
 void scan_hr(struct text_object *, const char *);
 void scan_stippled_hr(struct text_object *, const char *);
@@ -92,6 +92,13 @@ class legacy_cb : public conky::callback<void *, int (*)()> {
  public:
   legacy_cb(uint32_t period, int (*fn)())
       : Base(period, true, Base::Tuple(fn)) {}
+
+#ifdef __linux__
+  // most update functions read a file in /proc or /sys
+  conky::cost_class cost() const override {
+    return conky::cost_class::file_open;
+  }
+#endif /* __linux__ */
 };
 
 typedef conky::callback_handle<legacy_cb> legacy_cb_handle;
@@ -37,6 +37,7 @@
 #include "content/colours.hh"
 #include "content/combine.h"
 #include "content/text_object.h"
+#include "cost-report.h"
 #include "data/entropy.h"
 #include "data/exec.h"
 #include "data/hardware/bsdapm.h"
@@ -72,6 +73,7 @@
 #include "data/audio/mixer.h"
 #include "data/network/mail.h"
 #include "data/network/mboxscan.h"
+#include "data/network/net_accounting.h"
 #include "data/network/net_stat.h"
 #include "logging.h"
 #include "lua/llua.h"
@@ -97,6 +99,7 @@
 #include "data/users.h"
 #ifdef BUILD_CURL
 #include "data/network/ccurl_thread.h"
+#include "data/network/github.h"
 #endif /* BUILD_CURL */
 #ifdef BUILD_RSS
 #include "data/network/rss.h"
@@ -107,6 +110,9 @@
 #ifdef BUILD_CMUS
 #include "data/audio/cmus.h"
 #endif /* BUILD_CMUS */
+#ifdef BUILD_MPRIS
+#include "data/audio/mpris.h"
+#endif /* BUILD_MPRIS */
 #ifdef BUILD_JOURNAL
 #include "data/os/journal.h"
 #endif /* BUILD_JOURNAL */
@@ -119,7 +125,13 @@
 
 /* check for OS and include appropriate headers */
 #if defined(__linux__)
+#include "data/hardware/cpufreq.h"
+#include "data/interrupts.h"
+#include "data/memtopo.h"
+#include "data/network/net_counters.h"
+#include "data/nfs.h"
 #include "data/os/linux.h"
+#include "data/zfs.h"
 #elif defined(__FreeBSD__) || defined(__FreeBSD_kernel__)
 #include "data/os/freebsd.h"
 #elif defined(__DragonFly__)
@@ -478,6 +490,38 @@ struct text_object *construct_text_object(char *s, const char *arg, long line,
     obj->data.i = strtol(&arg[0], nullptr, 10);
   }
   obj->callbacks.print = &print_cpugovernor;
+  END OBJ(cpuidle, &update_cpufreq) scan_cpuidle_arg(obj, arg);
+  obj->callbacks.print = &print_cpuidle;
+  obj->callbacks.percentage = &cpuidle_percentage;
+  obj->callbacks.free = &free_cpuidle;
+  END OBJ(cpu_type, &update_cpufreq) scan_cpu_type_arg(obj, arg);
+  obj->callbacks.print = &print_cpu_type;
+#ifdef BUILD_GUI
+  END OBJ(cpufreqgraph, &update_cpufreq) scan_cpufreqgraph_arg(obj, arg);
+  obj->callbacks.graphval = &cpufreqgraphval;
+#endif /* BUILD_GUI */
+  END OBJ(irq_top, &update_interrupts) scan_irq_top_arg(obj, arg);
+  END OBJ_ARG(irq, &update_interrupts, "irq needs an interrupt as argument")
+      scan_irq_arg(obj, arg);
+  obj->callbacks.print = &print_irq;
+  obj->callbacks.free = &free_irq;
+  END OBJ_ARG(softirq, &update_softirqs,
+              "softirq needs a softirq name as argument")
+      scan_irq_arg(obj, arg);
+  obj->callbacks.print = &print_softirq;
+  obj->callbacks.free = &free_irq;
+#ifdef BUILD_GUI
+  END OBJ_ARG(irqgraph, &update_interrupts,
+              "irqgraph needs an interrupt as argument")
+      scan_irqgraph_arg(obj, arg);
+  obj->callbacks.graphval = &irqgraphval;
+  obj->callbacks.free = &free_irq;
+  END OBJ_ARG(softirqgraph, &update_softirqs,
+              "softirqgraph needs a softirq name as argument")
+      scan_irqgraph_arg(obj, arg);
+  obj->callbacks.graphval = &softirqgraphval;
+  obj->callbacks.free = &free_irq;
+#endif /* BUILD_GUI */
 #endif /* __linux__ */
   END OBJ_ARG(read_tcp, nullptr,
               "read_tcp: Needs \"(host) port\" as argument(s)")
@@ -856,16 +900,16 @@ struct text_object *construct_text_object(char *s, const char *arg, long line,
   obj->callbacks.print = &print_downspeedf;
 #ifdef BUILD_GUI
   END OBJ(downspeedgraph, &update_net_stats)
-      parse_net_stat_graph_arg(obj, arg, free_at_crash);
+      parse_net_stat_downgraph_arg(obj, arg, free_at_crash);
   obj->callbacks.graphval = &downspeedgraphval;
 #endif /* BUILD_GUI */
   END OBJ(else, nullptr) obj_be_ifblock_else(ifblock_opaque, obj);
   obj->callbacks.iftest = &gen_false_iftest;
   END OBJ(endif, nullptr) obj_be_ifblock_endif(ifblock_opaque, obj);
   obj->callbacks.print = &gen_print_nothing;
-  END OBJ(eval, nullptr) obj->data.s = STRNDUP_ARG;
+  END OBJ(eval, nullptr) scan_evaluate_arg(obj, arg);
   obj->callbacks.print = &print_evaluate;
-  obj->callbacks.free = &gen_free_opaque;
+  obj->callbacks.free = &free_evaluate;
 #if defined(BUILD_IMLIB2) && defined(BUILD_GUI)
   END OBJ(image, nullptr) obj->data.s = STRNDUP_ARG;
   obj->callbacks.print = &print_image_callback;
@@ -903,7 +947,9 @@ struct text_object *construct_text_object(char *s, const char *arg, long line,
   obj->callbacks.free = &gen_free_opaque;
 
 #ifdef __x86_64__
-  END OBJ(freq2, 0) obj->callbacks.print = &print_freq2;
+  END OBJ(freq2, 0) scan_freq2_arg(obj, arg);
+  obj->callbacks.print = &print_freq2;
+  obj->callbacks.free = &free_freq2;
 #endif /* __x86_64__ */
   END OBJ(startcase, 0) obj->data.s = STRNDUP_ARG;
   obj->callbacks.print = &print_startcase;
@@ -993,6 +1039,10 @@ struct text_object *construct_text_object(char *s, const char *arg, long line,
   obj->callbacks.graphval = &execbarval;
   obj->callbacks.free = &free_exec;
 #endif /* BUILD_GUI */
+  END OBJ_IF_ARG(if_exec_stale, nullptr, "if_exec_stale needs a command")
+      scan_exec_stale_arg(obj, arg);
+  obj->callbacks.iftest = &check_exec_stale;
+  obj->callbacks.free = &free_exec;
   END OBJ_ARG(texeci, nullptr, "texeci needs arguments: <interval> <command>")
       scan_exec_arg(obj, arg, exec_flag::interval);
   obj->parse = false;
@@ -1030,6 +1080,18 @@ struct text_object *construct_text_object(char *s, const char *arg, long line,
   END OBJ(nameserver, &update_dns_data) parse_nameserver_arg(obj, arg);
   obj->callbacks.print = &print_nameserver;
   obj->callbacks.free = &free_dns_data;
+  END OBJ(net_total_hour, &update_net_stats)
+      parse_net_total_arg(obj, arg, NET_PERIOD_HOUR);
+  obj->callbacks.print = &print_net_total;
+  obj->callbacks.free = &free_net_total;
+  END OBJ(net_total_today, &update_net_stats)
+      parse_net_total_arg(obj, arg, NET_PERIOD_DAY);
+  obj->callbacks.print = &print_net_total;
+  obj->callbacks.free = &free_net_total;
+  END OBJ(net_total_month, &update_net_stats)
+      parse_net_total_arg(obj, arg, NET_PERIOD_MONTH);
+  obj->callbacks.print = &print_net_total;
+  obj->callbacks.free = &free_net_total;
   END OBJ(offset, nullptr) obj->data.l =
       arg != nullptr ? strtol(arg, nullptr, 10) : 1;
   obj->callbacks.print = &new_offset;
@@ -1121,9 +1183,9 @@ struct text_object *construct_text_object(char *s, const char *arg, long line,
   extract_variable_text_internal(obj->sub, arg);
   obj->callbacks.iftest = &check_if_match;
   END OBJ_IF_ARG(if_existing, nullptr, "if_existing needs an argument or two")
-      obj->data.s = STRNDUP_ARG;
+      scan_existing_arg(obj, arg);
   obj->callbacks.iftest = &if_existing_iftest;
-  obj->callbacks.free = &gen_free_opaque;
+  obj->callbacks.free = &free_existing;
 #if defined(__linux__) || defined(__FreeBSD__)
   END OBJ_IF_ARG(if_mounted, 0, "if_mounted needs an argument") obj->data.s =
       STRNDUP_ARG;
@@ -1263,6 +1325,114 @@ struct text_object *construct_text_object(char *s, const char *arg, long line,
       scan_graph(obj, arg, 1, FALSE, "memwithbuffers");
   obj->callbacks.graphval = &mem_with_buffers_barval;
 #endif /* BUILD_GUI*/
+#if defined(__linux__)
+  END OBJ(node_mem, &update_memtopo) scan_node_arg(obj, arg, 0);
+  obj->callbacks.print = &print_node_mem;
+  END OBJ(node_memfree, &update_memtopo) scan_node_arg(obj, arg, 0);
+  obj->callbacks.print = &print_node_memfree;
+  END OBJ(node_memmax, &update_memtopo) scan_node_arg(obj, arg, 0);
+  obj->callbacks.print = &print_node_memmax;
+  END OBJ(node_memperc, &update_memtopo) scan_node_arg(obj, arg, 0);
+  obj->callbacks.percentage = &node_mem_percentage;
+  END OBJ(node_membar, &update_memtopo)
+      scan_bar(obj, scan_node_arg(obj, arg, 0), 1);
+  obj->callbacks.barval = &node_mem_barval;
+#ifdef BUILD_GUI
+  END OBJ(node_memgraph, &update_memtopo) arg = scan_node_arg(obj, arg, 0);
+  scan_graph(obj, arg, 1, FALSE, fmt::format("node_mem:{}", obj->data.i));
+  obj->callbacks.graphval = &node_mem_barval;
+#endif /* BUILD_GUI */
+  END OBJ(hugepages_used, &update_memtopo) scan_node_arg(obj, arg, -1);
+  obj->callbacks.print = &print_hugepages_used;
+  END OBJ(hugepages_total, &update_memtopo) scan_node_arg(obj, arg, -1);
+  obj->callbacks.print = &print_hugepages_total;
+  END OBJ(hugepages_perc, &update_memtopo) scan_node_arg(obj, arg, -1);
+  obj->callbacks.percentage = &hugepages_percentage;
+  END OBJ(zram_orig, &update_memtopo) obj->data.s = STRNDUP_ARG;
+  obj->callbacks.print = &print_zram_orig;
+  obj->callbacks.free = &gen_free_opaque;
+  END OBJ(zram_compr, &update_memtopo) obj->data.s = STRNDUP_ARG;
+  obj->callbacks.print = &print_zram_compr;
+  obj->callbacks.free = &gen_free_opaque;
+  END OBJ(zram_used, &update_memtopo) obj->data.s = STRNDUP_ARG;
+  obj->callbacks.print = &print_zram_used;
+  obj->callbacks.free = &gen_free_opaque;
+  END OBJ(zram_ratio, &update_memtopo) obj->data.s = STRNDUP_ARG;
+  obj->callbacks.print = &print_zram_ratio;
+  obj->callbacks.free = &gen_free_opaque;
+  END OBJ(zswap, &update_memtopo) obj->callbacks.print = &print_zswap;
+  END OBJ(zswapped, &update_memtopo) obj->callbacks.print = &print_zswapped;
+  END OBJ(zswap_ratio, &update_memtopo)
+      obj->callbacks.print = &print_zswap_ratio;
+  END OBJ_ARG(nfs_ops, &update_nfs_stats, "nfs_ops needs a mount point")
+      scan_nfs_arg(obj, arg);
+  obj->callbacks.print = &print_nfs_ops;
+  obj->callbacks.free = &free_nfs;
+  END OBJ_ARG(nfs_rtt, &update_nfs_stats, "nfs_rtt needs a mount point")
+      scan_nfs_arg(obj, arg);
+  obj->callbacks.print = &print_nfs_rtt;
+  obj->callbacks.free = &free_nfs;
+  END OBJ_ARG(nfs_exec, &update_nfs_stats, "nfs_exec needs a mount point")
+      scan_nfs_arg(obj, arg);
+  obj->callbacks.print = &print_nfs_exec;
+  obj->callbacks.free = &free_nfs;
+  END OBJ_ARG(nfs_retrans, &update_nfs_stats,
+              "nfs_retrans needs a mount point") scan_nfs_arg(obj, arg);
+  obj->callbacks.print = &print_nfs_retrans;
+  obj->callbacks.free = &free_nfs;
+  END OBJ_ARG(nfs_backlog, &update_nfs_stats,
+              "nfs_backlog needs a mount point") scan_nfs_arg(obj, arg);
+  obj->callbacks.print = &print_nfs_backlog;
+  obj->callbacks.free = &free_nfs;
+  END OBJ_IF_ARG(if_nfs_unhealthy, &update_nfs_stats,
+                 "if_nfs_unhealthy needs a mount point")
+      scan_if_nfs_unhealthy_arg(obj, arg);
+  obj->callbacks.iftest = &check_nfs_unhealthy;
+  obj->callbacks.free = &free_nfs;
+  END OBJ_ARG(net_counter, &update_net_counters,
+              "net_counter needs a counter like Tcp:RetransSegs")
+      scan_net_counter_arg(obj, arg);
+  obj->callbacks.print = &print_net_counter;
+  obj->callbacks.free = &free_net_counter;
+#ifdef BUILD_GUI
+  END OBJ_ARG(net_countergraph, &update_net_counters,
+              "net_countergraph needs a counter like Tcp:RetransSegs")
+      scan_net_countergraph_arg(obj, arg);
+  obj->callbacks.graphval = &net_countergraphval;
+  obj->callbacks.free = &free_net_counter;
+#endif /* BUILD_GUI */
+  END OBJ(tcp_retrans_perc, &update_net_counters)
+      obj->callbacks.percentage = &tcp_retrans_perc;
+  END OBJ(conntrack, &update_net_counters)
+      obj->callbacks.print = &print_conntrack;
+  END OBJ(conntrack_max, &update_net_counters)
+      obj->callbacks.print = &print_conntrack_max;
+  END OBJ(conntrack_perc, &update_net_counters)
+      obj->callbacks.percentage = &conntrack_percentage;
+  END OBJ(conntrack_bar, &update_net_counters) scan_bar(obj, arg, 1);
+  obj->callbacks.barval = &conntrack_barval;
+  END OBJ(zfs_arc_size, &update_zfs) obj->callbacks.print = &print_zfs_arc_size;
+  END OBJ(zfs_arc_max, &update_zfs) obj->callbacks.print = &print_zfs_arc_max;
+  END OBJ(zfs_arc_hits, &update_zfs) obj->callbacks.print = &print_zfs_arc_hits;
+  END OBJ(zfs_arc_misses, &update_zfs)
+      obj->callbacks.print = &print_zfs_arc_misses;
+  END OBJ(zfs_arc_hit_ratio, &update_zfs)
+      obj->callbacks.percentage = &zfs_arc_hit_ratio;
+  END OBJ(zfs_arc_bar, &update_zfs) scan_bar(obj, arg, 1);
+  obj->callbacks.barval = &zfs_arc_barval;
+  END OBJ_ARG(zfs_arc_stat, &update_zfs, "zfs_arc_stat needs a kstat name")
+      obj->data.s = STRNDUP_ARG;
+  obj->callbacks.print = &print_zfs_arc_stat;
+  obj->callbacks.free = &gen_free_opaque;
+  END OBJ_ARG(zfs_pool_read, &update_zfs, "zfs_pool_read needs a pool name")
+      obj->data.s = STRNDUP_ARG;
+  obj->callbacks.print = &print_zfs_pool_read;
+  obj->callbacks.free = &gen_free_opaque;
+  END OBJ_ARG(zfs_pool_write, &update_zfs, "zfs_pool_write needs a pool name")
+      obj->data.s = STRNDUP_ARG;
+  obj->callbacks.print = &print_zfs_pool_write;
+  obj->callbacks.free = &gen_free_opaque;
+#endif /* __linux__ */
 #ifdef HAVE_SOUNDCARD_H
   END OBJ(mixer, 0) parse_mixer_arg(obj, arg);
   obj->callbacks.percentage = &mixer_percentage;
@@ -1285,6 +1455,8 @@ struct text_object *construct_text_object(char *s, const char *arg, long line,
   END OBJ(desktop, nullptr) obj->callbacks.print = &print_desktop;
   END OBJ(desktop_number, nullptr) obj->callbacks.print = &print_desktop_number;
   END OBJ(desktop_name, nullptr) obj->callbacks.print = &print_desktop_name;
+  END OBJ(active_window_title, nullptr) obj->callbacks.print =
+      &print_active_window_title;
 #endif /* BUILD_GUI */
   END OBJ_ARG(format_time, nullptr, "format_time needs a pid as argument")
       obj->sub = static_cast<text_object *>(malloc(sizeof(struct text_object)));
@@ -1548,7 +1720,7 @@ struct text_object *construct_text_object(char *s, const char *arg, long line,
   obj->callbacks.print = &print_upspeedf;
 #ifdef BUILD_GUI
   END OBJ(upspeedgraph, &update_net_stats)
-      parse_net_stat_graph_arg(obj, arg, free_at_crash);
+      parse_net_stat_upgraph_arg(obj, arg, free_at_crash);
   obj->callbacks.graphval = &upspeedgraphval;
 #endif
   END OBJ(uptime_short, &update_uptime) obj->callbacks.print =
@@ -1718,6 +1890,41 @@ struct text_object *construct_text_object(char *s, const char *arg, long line,
   obj->callbacks.barval = &cmus_progress;
   END OBJ(cmus_percent, 0) obj->callbacks.percentage = &cmus_percent;
 #endif /* BUILD_CMUS */
+#ifdef BUILD_MPRIS
+  END OBJ(mpris_player, 0) obj->data.s = STRNDUP_ARG;
+  obj->callbacks.print = &print_mpris_player;
+  obj->callbacks.free = &gen_free_opaque;
+  END OBJ(mpris_status, 0) obj->data.s = STRNDUP_ARG;
+  obj->callbacks.print = &print_mpris_status;
+  obj->callbacks.free = &gen_free_opaque;
+  END OBJ(mpris_title, 0) obj->data.s = STRNDUP_ARG;
+  obj->callbacks.print = &print_mpris_title;
+  obj->callbacks.free = &gen_free_opaque;
+  END OBJ(mpris_artist, 0) obj->data.s = STRNDUP_ARG;
+  obj->callbacks.print = &print_mpris_artist;
+  obj->callbacks.free = &gen_free_opaque;
+  END OBJ(mpris_album, 0) obj->data.s = STRNDUP_ARG;
+  obj->callbacks.print = &print_mpris_album;
+  obj->callbacks.free = &gen_free_opaque;
+  END OBJ(mpris_url, 0) obj->data.s = STRNDUP_ARG;
+  obj->callbacks.print = &print_mpris_url;
+  obj->callbacks.free = &gen_free_opaque;
+  END OBJ(mpris_position, 0) obj->data.s = STRNDUP_ARG;
+  obj->callbacks.print = &print_mpris_position;
+  obj->callbacks.free = &gen_free_opaque;
+  END OBJ(mpris_length, 0) obj->data.s = STRNDUP_ARG;
+  obj->callbacks.print = &print_mpris_length;
+  obj->callbacks.free = &gen_free_opaque;
+  END OBJ(mpris_volume, 0) obj->data.s = STRNDUP_ARG;
+  obj->callbacks.print = &print_mpris_volume;
+  obj->callbacks.free = &gen_free_opaque;
+  END OBJ(mpris_percent, 0) obj->data.s = STRNDUP_ARG;
+  obj->callbacks.percentage = &mpris_percent;
+  obj->callbacks.free = &gen_free_opaque;
+  END OBJ(mpris_bar, 0) scan_mpris_bar(obj, arg);
+  obj->callbacks.barval = &mpris_barval;
+  obj->callbacks.free = &gen_free_opaque;
+#endif /* BUILD_MPRIS */
 #ifdef BUILD_XMMS2
   END OBJ(xmms2_artist, &update_xmms2) obj->callbacks.print =
       &print_xmms2_artist;
@@ -2257,6 +2464,7 @@ int extract_variable_text_internal(struct text_object *retval,
 
         try {
           obj = construct_text_object(buf, arg, line, &ifblock_opaque, orig_p);
+          conky::note_text_object(obj, buf, arg);
         } catch (std::exception &e) {
           const char *cmd = nullptr;
           if (auto *ce =
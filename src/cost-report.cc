@@ -0,0 +1,315 @@
+/*
+ *
+ * Conky, a system monitor, based on torsmo
+ *
+ * Any original torsmo code is licensed under the BSD license
+ *
+ * All code written since the fork of torsmo is licensed under the GPL
+ *
+ * Please see COPYING for details
+ *
+ * Copyright (c) 2005-2024 Brenden Matthews, Philip Kovacs, et. al.
+ *	(see AUTHORS)
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "cost-report.h"
+
+#include <cxxabi.h>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <typeinfo>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+
+#include "config.h"
+#include "conky.h"
+#include "content/text_object.h"
+#include "logging.h"
+#include "lua/llua.h"
+
+namespace conky {
+bool cost_report_requested = false;
+
+namespace {
+/* variables doing their work in every print rather than in a callback */
+const struct {
+  const char *name;
+  cost_class cls;
+} print_costs[] = {
+    {"cat", cost_class::file_open},
+    {"catp", cost_class::file_open},
+    {"catp", cost_class::reparse},
+    {"eval", cost_class::reparse},
+    {"execp", cost_class::reparse},
+    {"execpi", cost_class::reparse},
+    {"head", cost_class::file_open},
+    {"if_existing", cost_class::file_open},
+    {"lines", cost_class::file_open},
+    {"lowercase", cost_class::reparse},
+    {"lua", cost_class::lua_call},
+    {"lua_bar", cost_class::lua_call},
+    {"lua_gauge", cost_class::lua_call},
+    {"lua_graph", cost_class::lua_call},
+    {"lua_parse", cost_class::lua_call},
+    {"lua_parse", cost_class::reparse},
+    {"startcase", cost_class::reparse},
+    {"tail", cost_class::file_open},
+    {"uppercase", cost_class::reparse},
+    {"words", cost_class::file_open},
+};
+
+/* variables registering their callback when printed rather than when parsed,
+ * matched by prefix; printing them does nothing but that and copying the
+ * callback's last result */
+const char *const registered_on_print[] = {
+    "audacious_", "cmus_", "curl", "github_notifications", "imap_",
+    "moc_",       "mpd_",  "mpris_", "pop3_",              "rss",
+};
+
+bool registers_on_print(const std::string &name) {
+  for (const char *prefix : registered_on_print) {
+    if (name.compare(0, strlen(prefix), prefix) == 0) { return true; }
+  }
+  return false;
+}
+
+/* how many times a syscall one occurrence of each class is roughly worth */
+double weight(cost_class cls) {
+  switch (cls) {
+    case cost_class::fork:
+      return 100;
+    case cost_class::network:
+      return 50;
+    case cost_class::reparse:
+      return 10;
+    case cost_class::lua_call:
+      return 5;
+    case cost_class::file_open:
+      return 3;
+    case cost_class::syscall:
+      break;
+  }
+  return 1;
+}
+
+struct noted_object {
+  std::string name;
+  std::string source;
+  /* callbacks that were first registered by this object */
+  std::vector<const priv::callback_base *> callbacks;
+};
+std::unordered_map<const text_object *, noted_object> noted;
+std::unordered_set<const priv::callback_base *> known_callbacks;
+
+/* unqualified class name, e.g. "exec_cb" */
+std::string callback_type(const priv::callback_base &cb) {
+  int status = 0;
+  char *demangled =
+      abi::__cxa_demangle(typeid(cb).name(), nullptr, nullptr, &status);
+  std::string name = status == 0 ? demangled : typeid(cb).name();
+  free(demangled);
+
+  auto args = name.find('<');
+  if (args != std::string::npos) { name.erase(args); }
+  auto scope = name.rfind("::");
+  if (scope != std::string::npos) { name.erase(0, scope + 2); }
+  return name;
+}
+
+std::string shorten(const std::string &s, size_t max) {
+  return s.size() <= max ? s : s.substr(0, max - 3) + "...";
+}
+}  // namespace
+
+double cost_entry::score() const { return weight(cls) * runs_per_update; }
+
+const char *cost_class_name(cost_class cls) {
+  switch (cls) {
+    case cost_class::fork:
+      return "fork";
+    case cost_class::network:
+      return "network";
+    case cost_class::reparse:
+      return "re-parse";
+    case cost_class::lua_call:
+      return "Lua call";
+    case cost_class::file_open:
+      return "file open";
+    case cost_class::syscall:
+      break;
+  }
+  return "syscall";
+}
+
+void note_text_object(struct text_object *obj, const char *name,
+                      const char *arg) {
+  if (!cost_report_requested || obj == nullptr) { return; }
+
+  noted_object &n = noted[obj];
+  n.name = name;
+  n.source = std::string("${") + name;
+  if (arg != nullptr) { n.source += std::string(" ") + arg; }
+  n.source = shorten(n.source, 60) + "}";
+  n.callbacks.clear();
+  if (registers_on_print(n.name)) {
+    char scratch[DEFAULT_TEXT_BUFFER_SIZE];
+    if (obj->callbacks.print != nullptr) {
+      obj->callbacks.print(obj, scratch, sizeof(scratch));
+    } else if (obj->callbacks.barval != nullptr) {
+      obj->callbacks.barval(obj);
+    } else if (obj->callbacks.percentage != nullptr) {
+      obj->callbacks.percentage(obj);
+    }
+  }
+  for_each_callback([&n](const priv::callback_base &cb) {
+    if (known_callbacks.insert(&cb).second) { n.callbacks.push_back(&cb); }
+  });
+}
+
+std::vector<cost_entry> estimate_costs(struct text_object *root) {
+  std::map<std::pair<cost_class, std::string>, cost_entry> entries;
+  auto add = [&entries](cost_class cls, const std::string &source, long line,
+                        double runs) {
+    cost_entry &e = entries[{cls, source}];
+    if (e.count++ == 0) {
+      e.cls = cls;
+      e.source = source;
+      e.line = line;
+    }
+    e.runs_per_update += runs;
+  };
+
+  /* objects using each callback, the first one being the one that
+   * registered it */
+  std::unordered_map<const priv::callback_base *,
+                     std::vector<std::pair<std::string, long>>>
+      owners;
+  auto own = [&owners](const priv::callback_base *cb, const std::string &source,
+                       long line) {
+    auto &list = owners[cb];
+    for (const auto &o : list) {
+      if (o.first == source) { return; }
+    }
+    list.emplace_back(source, line);
+  };
+
+  std::function<void(struct text_object *)> walk =
+      [&](struct text_object *obj) {
+        for (; obj != nullptr; obj = obj->next) {
+          auto n = noted.find(obj);
+          if (n != noted.end()) {
+            const noted_object &info = n->second;
+            for (const auto &pc : print_costs) {
+              if (info.name == pc.name) {
+                add(pc.cls, info.source, obj->line, 1);
+              }
+            }
+            for (const auto *cb : info.callbacks) {
+              own(cb, info.source, obj->line);
+            }
+            if (obj->cb_handle != nullptr) {
+              own(&**obj->cb_handle, info.source, obj->line);
+            }
+            if (obj->exec_handle != nullptr) {
+              own(&**obj->exec_handle, info.source, obj->line);
+            }
+          }
+          if (obj->sub != nullptr) { walk(obj->sub->next); }
+        }
+      };
+  walk(root->next);
+
+  for_each_callback([&](const priv::callback_base &cb) {
+    std::string source = callback_type(cb);
+    long line = -1;
+    auto o = owners.find(&cb);
+    if (o != owners.end() && !o->second.empty()) {
+      const auto &list = o->second;
+      line = list.front().second;
+      source += " for " + list.front().first;
+      for (size_t i = 1; i < list.size() && i < 3; ++i) {
+        source += ", " + list[i].first;
+      }
+      if (list.size() > 3) {
+        source += fmt::format(" and {} more", list.size() - 3);
+      }
+    }
+    add(cb.cost(), source, line, 1.0 / std::max(cb.get_period(), 1u));
+  });
+
+#ifdef BUILD_GUI
+  for (const auto &hook : llua_draw_hooks()) {
+    add(cost_class::lua_call, "lua draw hook " + hook, -1, 1);
+  }
+#endif /* BUILD_GUI */
+
+  std::vector<cost_entry> result;
+  result.reserve(entries.size());
+  for (auto &e : entries) { result.push_back(std::move(e.second)); }
+  std::stable_sort(result.begin(), result.end(),
+                   [](const cost_entry &a, const cost_entry &b) {
+                     return a.score() > b.score();
+                   });
+  return result;
+}
+
+void print_cost_report(std::ostream &out, struct text_object *root,
+                       double update_interval) {
+  auto entries = estimate_costs(root);
+  double per_second = update_interval > 0 ? 1 / update_interval : 0;
+
+  out << fmt::format(
+      "Estimated cost of {} at an update interval of {}s\n"
+      "Scores are relative, one fork is taken to cost as much as 100 "
+      "syscalls,\n"
+      "a network request 50, a re-parse 10, a Lua call 5 and a file open "
+      "3.\n\n",
+      current_config.string(), update_interval);
+  out << fmt::format("{:>9} {:>9} {:>9}  {:<10} {:>5}  {}\n", "score",
+                     "runs/s", "runs/upd", "class", "line", "source");
+
+  std::map<cost_class, double> totals;
+  for (const auto &e : entries) {
+    std::string source = e.source;
+    if (e.count > 1) { source += fmt::format(" (x{})", e.count); }
+    out << fmt::format("{:>9.1f} {:>9.2f} {:>9.2f}  {:<10} {:>5}  {}\n",
+                       e.score(), e.runs_per_update * per_second,
+                       e.runs_per_update, cost_class_name(e.cls),
+                       e.line >= 0 ? std::to_string(e.line + 1) : "-", source);
+    totals[e.cls] += e.runs_per_update;
+  }
+
+  std::vector<std::pair<cost_class, double>> ranked(totals.begin(),
+                                                    totals.end());
+  std::stable_sort(ranked.begin(), ranked.end(),
+                   [](const auto &a, const auto &b) {
+                     return weight(a.first) > weight(b.first);
+                   });
+  out << "\nPer second:";
+  const char *sep = " ";
+  for (const auto &t : ranked) {
+    out << fmt::format("{}{:.2f} {}", sep, t.second * per_second,
+                       cost_class_name(t.first));
+    sep = ", ";
+  }
+  out << (ranked.empty() ? " nothing\n" : "\n");
+}
+}  // namespace conky
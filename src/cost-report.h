@@ -0,0 +1,79 @@
+/*
+ *
+ * Conky, a system monitor, based on torsmo
+ *
+ * Any original torsmo code is licensed under the BSD license
+ *
+ * All code written since the fork of torsmo is licensed under the GPL
+ *
+ * Please see COPYING for details
+ *
+ * Copyright (c) 2005-2024 Brenden Matthews, Philip Kovacs, et. al.
+ *	(see AUTHORS)
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef _COST_REPORT_H
+#define _COST_REPORT_H
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "update-cb.hh"
+
+struct text_object;
+
+namespace conky {
+/* set by --cost-report: the config is parsed, the estimate printed and conky
+ * exits before any output is started */
+extern bool cost_report_requested;
+
+/* one line of the estimate, objects doing the same work are added up */
+struct cost_entry {
+  cost_class cls = cost_class::syscall;
+  std::string source;     /* ${variable argument}, or the callback behind it */
+  long line = -1;         /* text line of the first object, -1 for none */
+  unsigned int count = 0; /* objects or callbacks adding up to this entry */
+  double runs_per_update = 0;
+
+  /* relative cost per update, the estimate is ranked by it */
+  double score() const;
+};
+
+const char *cost_class_name(cost_class cls);
+
+/**
+ * Remembers which variable obj was parsed from and which callbacks were
+ * registered while parsing it. Variables that only register their callback
+ * when printed are printed once here to have it registered. Does nothing
+ * unless cost_report_requested.
+ */
+void note_text_object(struct text_object *obj, const char *name,
+                      const char *arg);
+
+/**
+ * Estimates the costs of the objects in the list at root, including the ones
+ * nested in them, of all callbacks someone holds a handle to, and of the Lua
+ * draw hooks. Most expensive first.
+ */
+std::vector<cost_entry> estimate_costs(struct text_object *root);
+
+void print_cost_report(std::ostream &out, struct text_object *root,
+                       double update_interval);
+}  // namespace conky
+
+#endif /* _COST_REPORT_H */
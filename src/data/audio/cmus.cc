@@ -60,6 +60,8 @@ class cmus_cb : public conky::callback<cmus_result> {
 
  public:
   explicit cmus_cb(uint32_t period) : Base(period, false, Tuple()) {}
+
+  conky::cost_class cost() const override { return conky::cost_class::fork; }
 };
 
 void cmus_cb::work() {
@@ -58,6 +58,8 @@ class moc_cb : public conky::callback<moc_result> {
 
  public:
   explicit moc_cb(uint32_t period) : Base(period, false, Tuple()) {}
+
+  conky::cost_class cost() const override { return conky::cost_class::fork; }
 };
 
 void moc_cb::work() {
@@ -148,6 +148,10 @@ class mpd_cb : public conky::callback<mpd_result> {
   ~mpd_cb() override {
     if (conn != nullptr) { mpd_closeConnection(conn); }
   }
+
+  conky::cost_class cost() const override {
+    return conky::cost_class::network;
+  }
 };
 
 void mpd_cb::work() {
@@ -0,0 +1,599 @@
+/*
+ *
+ * Conky, a system monitor, based on torsmo
+ *
+ * Please see COPYING for details
+ *
+ * Copyright (c) 2005-2024 Brenden Matthews, Philip Kovacs, et. al.
+ *	(see AUTHORS)
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "mpris.h"
+
+#include <dbus/dbus.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include <mutex>
+
+#include "../../common.h"
+#include "../../conky.h"
+#include "../../content/specials.h"
+#include "../../content/text_object.h"
+#include "../../logging.h"
+#include "../../update-cb.hh"
+
+#define MPRIS_PATH "/org/mpris/MediaPlayer2"
+#define MPRIS_PLAYER_IFACE "org.mpris.MediaPlayer2.Player"
+#define DBUS_PROPERTIES_IFACE "org.freedesktop.DBus.Properties"
+/* replies come from the player, so don't let a stuck one hold us for long */
+#define MPRIS_CALL_TIMEOUT 500
+
+namespace {
+const char *const match_rules[] = {
+    "type='signal',interface='" DBUS_PROPERTIES_IFACE
+    "',member='PropertiesChanged',path='" MPRIS_PATH
+    "',arg0='" MPRIS_PLAYER_IFACE "'",
+    "type='signal',interface='" MPRIS_PLAYER_IFACE
+    "',member='Seeked',path='" MPRIS_PATH "'",
+    "type='signal',sender='org.freedesktop.DBus',interface='"
+    "org.freedesktop.DBus',member='NameOwnerChanged',"
+    "arg0namespace='org.mpris.MediaPlayer2'",
+};
+
+bool is_player_name(const char *name) {
+  return strncmp(name, MPRIS_BUS_PREFIX, strlen(MPRIS_BUS_PREFIX)) == 0;
+}
+
+bool iter_string(DBusMessageIter *it, std::string &out) {
+  int type = dbus_message_iter_get_arg_type(it);
+  const char *s = nullptr;
+
+  if (type != DBUS_TYPE_STRING && type != DBUS_TYPE_OBJECT_PATH) {
+    return false;
+  }
+  dbus_message_iter_get_basic(it, &s);
+  out = s != nullptr ? s : "";
+  return true;
+}
+
+/* xesam:artist is a list of strings, joined for display */
+bool iter_string_list(DBusMessageIter *it, std::string &out) {
+  DBusMessageIter list;
+  std::string item;
+
+  if (iter_string(it, out)) { return true; }
+  if (dbus_message_iter_get_arg_type(it) != DBUS_TYPE_ARRAY) { return false; }
+  out.clear();
+  dbus_message_iter_recurse(it, &list);
+  while (iter_string(&list, item)) {
+    if (!out.empty()) { out += ", "; }
+    out += item;
+    dbus_message_iter_next(&list);
+  }
+  return true;
+}
+
+/* players disagree on the integer type of mpris:length, accept them all */
+bool iter_int64(DBusMessageIter *it, int64_t &out) {
+  switch (dbus_message_iter_get_arg_type(it)) {
+    case DBUS_TYPE_INT64: {
+      dbus_int64_t v;
+      dbus_message_iter_get_basic(it, &v);
+      out = v;
+      return true;
+    }
+    case DBUS_TYPE_UINT64: {
+      dbus_uint64_t v;
+      dbus_message_iter_get_basic(it, &v);
+      out = static_cast<int64_t>(v);
+      return true;
+    }
+    case DBUS_TYPE_INT32: {
+      dbus_int32_t v;
+      dbus_message_iter_get_basic(it, &v);
+      out = v;
+      return true;
+    }
+    case DBUS_TYPE_UINT32: {
+      dbus_uint32_t v;
+      dbus_message_iter_get_basic(it, &v);
+      out = v;
+      return true;
+    }
+    case DBUS_TYPE_DOUBLE: {
+      double v;
+      dbus_message_iter_get_basic(it, &v);
+      out = static_cast<int64_t>(v);
+      return true;
+    }
+    default:
+      return false;
+  }
+}
+
+bool iter_double(DBusMessageIter *it, double &out) {
+  int64_t i;
+
+  if (dbus_message_iter_get_arg_type(it) == DBUS_TYPE_DOUBLE) {
+    dbus_message_iter_get_basic(it, &out);
+    return true;
+  }
+  if (iter_int64(it, i)) {
+    out = static_cast<double>(i);
+    return true;
+  }
+  return false;
+}
+
+/* calls fn(key, value) for every entry of the a{sv} at it */
+template <typename Fn>
+void for_each_property(DBusMessageIter *it, Fn fn) {
+  DBusMessageIter dict, entry, variant;
+  std::string key;
+
+  if (dbus_message_iter_get_arg_type(it) != DBUS_TYPE_ARRAY) { return; }
+  dbus_message_iter_recurse(it, &dict);
+  while (dbus_message_iter_get_arg_type(&dict) == DBUS_TYPE_DICT_ENTRY) {
+    dbus_message_iter_recurse(&dict, &entry);
+    if (iter_string(&entry, key) && dbus_message_iter_next(&entry) &&
+        dbus_message_iter_get_arg_type(&entry) == DBUS_TYPE_VARIANT) {
+      dbus_message_iter_recurse(&entry, &variant);
+      fn(key, &variant);
+    }
+    dbus_message_iter_next(&dict);
+  }
+}
+
+void apply_metadata(mpris_player &player, DBusMessageIter *dict, double now) {
+  mpris_player track;
+
+  for_each_property(dict, [&track](const std::string &key,
+                                   DBusMessageIter *value) {
+    if (key == "mpris:trackid") {
+      iter_string(value, track.trackid);
+    } else if (key == "mpris:length") {
+      iter_int64(value, track.length);
+    } else if (key == "xesam:title") {
+      iter_string(value, track.title);
+    } else if (key == "xesam:artist") {
+      iter_string_list(value, track.artist);
+    } else if (key == "xesam:album") {
+      iter_string(value, track.album);
+    } else if (key == "xesam:url") {
+      iter_string(value, track.url);
+    }
+  });
+
+  /* players also resend Metadata for e.g. cover art updates, only a new
+   * track starts over from the beginning */
+  if (track.trackid != player.trackid || track.url != player.url ||
+      track.title != player.title) {
+    player.position = 0;
+    player.position_time = now;
+  }
+  player.trackid = track.trackid;
+  player.length = track.length;
+  player.title = track.title;
+  player.artist = track.artist;
+  player.album = track.album;
+  player.url = track.url;
+}
+
+/* fixes the extrapolated position before anything it depends on changes */
+void rebase_position(mpris_player &player, double now) {
+  player.position = player.position_at(now);
+  player.position_time = now;
+}
+}  // namespace
+
+int64_t mpris_player::position_at(double now) const {
+  int64_t pos = position;
+
+  if (status == "Playing" && now > position_time) {
+    pos += static_cast<int64_t>(rate * (now - position_time) * 1000000.0);
+  }
+  if (length > 0 && pos > length) { pos = length; }
+  return std::max<int64_t>(pos, 0);
+}
+
+void mpris_apply_properties(mpris_player &player, DBusMessageIter *dict,
+                            double now) {
+  for_each_property(dict, [&player, now](const std::string &key,
+                                         DBusMessageIter *value) {
+    if (key == "PlaybackStatus") {
+      rebase_position(player, now);
+      iter_string(value, player.status);
+    } else if (key == "Rate") {
+      rebase_position(player, now);
+      iter_double(value, player.rate);
+    } else if (key == "Volume") {
+      iter_double(value, player.volume);
+    } else if (key == "Position") {
+      if (iter_int64(value, player.position)) { player.position_time = now; }
+    } else if (key == "Metadata") {
+      apply_metadata(player, value, now);
+    }
+  });
+}
+
+const mpris_player *mpris_select_player(
+    const std::vector<mpris_player> &players, const char *name) {
+  if (name != nullptr && *name != 0) {
+    size_t len = strlen(name);
+
+    for (const auto &player : players) {
+      const char *suffix = player.bus_name.c_str() + strlen(MPRIS_BUS_PREFIX);
+      /* also match instance names like vlc.instance1234 */
+      if (strncmp(suffix, name, len) == 0 &&
+          (suffix[len] == 0 || suffix[len] == '.')) {
+        return &player;
+      }
+    }
+    return nullptr;
+  }
+  for (const auto &player : players) {
+    if (player.status == "Playing") { return &player; }
+  }
+  return players.empty() ? nullptr : &players.front();
+}
+
+mpris_client::~mpris_client() { disconnect(); }
+
+bool mpris_client::connected() const {
+  return connection != nullptr && dbus_connection_get_is_connected(connection);
+}
+
+void mpris_client::disconnect() {
+  if (connection == nullptr) { return; }
+  dbus_connection_close(connection);
+  dbus_connection_unref(connection);
+  connection = nullptr;
+  players.clear();
+}
+
+bool mpris_client::connect(double now) {
+  DBusError err;
+  DBusMessage *reply;
+  DBusMessageIter it, names;
+  std::string name;
+
+  disconnect();
+  dbus_error_init(&err);
+  connection = dbus_bus_get_private(DBUS_BUS_SESSION, &err);
+  if (connection == nullptr) {
+    LOG_DEBUG("mpris: can't connect to the session bus: {}",
+              dbus_error_is_set(&err) ? err.message : "unknown error");
+    dbus_error_free(&err);
+    return false;
+  }
+  dbus_connection_set_exit_on_disconnect(connection, FALSE);
+
+  for (const char *rule : match_rules) {
+    dbus_bus_add_match(connection, rule, &err);
+    if (dbus_error_is_set(&err)) {
+      LOG_WARNING("mpris: can't add match rule: {}", err.message);
+      dbus_error_free(&err);
+      disconnect();
+      return false;
+    }
+  }
+
+  /* signals are matched from now on, so nothing is missed between the
+   * initial snapshot below and the first dispatch() */
+  reply = call("org.freedesktop.DBus", "/org/freedesktop/DBus",
+               "org.freedesktop.DBus", "ListNames");
+  if (reply == nullptr) {
+    disconnect();
+    return false;
+  }
+  if (dbus_message_iter_init(reply, &it) &&
+      dbus_message_iter_get_arg_type(&it) == DBUS_TYPE_ARRAY) {
+    dbus_message_iter_recurse(&it, &names);
+    while (iter_string(&names, name)) {
+      if (is_player_name(name.c_str())) { add_player(name, "", now); }
+      dbus_message_iter_next(&names);
+    }
+  }
+  dbus_message_unref(reply);
+  return true;
+}
+
+DBusMessage *mpris_client::call(const char *dest, const char *path,
+                                const char *iface, const char *method,
+                                const char *arg1, const char *arg2) {
+  DBusError err;
+  DBusMessage *msg, *reply;
+
+  msg = dbus_message_new_method_call(dest, path, iface, method);
+  if (msg == nullptr) { return nullptr; }
+  if (arg2 != nullptr) {
+    dbus_message_append_args(msg, DBUS_TYPE_STRING, &arg1, DBUS_TYPE_STRING,
+                             &arg2, DBUS_TYPE_INVALID);
+  } else if (arg1 != nullptr) {
+    dbus_message_append_args(msg, DBUS_TYPE_STRING, &arg1,
+                             DBUS_TYPE_INVALID);
+  }
+
+  dbus_error_init(&err);
+  reply = dbus_connection_send_with_reply_and_block(connection, msg,
+                                                    MPRIS_CALL_TIMEOUT, &err);
+  dbus_message_unref(msg);
+  if (reply == nullptr) {
+    LOG_DEBUG("mpris: {} on {} failed: {}", method, dest,
+              dbus_error_is_set(&err) ? err.message : "no reply");
+    dbus_error_free(&err);
+  }
+  return reply;
+}
+
+void mpris_client::add_player(const std::string &bus_name,
+                              const std::string &owner, double now) {
+  mpris_player *player = nullptr;
+
+  for (auto &p : players) {
+    if (p.bus_name == bus_name) { player = &p; }
+  }
+  if (player == nullptr) {
+    players.emplace_back();
+    player = &players.back();
+    player->bus_name = bus_name;
+  }
+  player->owner = owner;
+
+  if (player->owner.empty()) {
+    DBusMessage *reply =
+        call("org.freedesktop.DBus", "/org/freedesktop/DBus",
+             "org.freedesktop.DBus", "GetNameOwner", bus_name.c_str());
+    const char *unique = nullptr;
+
+    if (reply != nullptr) {
+      if (dbus_message_get_args(reply, nullptr, DBUS_TYPE_STRING, &unique,
+                                DBUS_TYPE_INVALID)) {
+        player->owner = unique;
+      }
+      dbus_message_unref(reply);
+    }
+  }
+  fetch_properties(*player, now);
+}
+
+void mpris_client::fetch_properties(mpris_player &player, double now) {
+  DBusMessageIter it;
+  DBusMessage *reply =
+      call(player.bus_name.c_str(), MPRIS_PATH, DBUS_PROPERTIES_IFACE,
+           "GetAll", MPRIS_PLAYER_IFACE);
+
+  if (reply == nullptr) { return; }
+  if (dbus_message_iter_init(reply, &it)) {
+    mpris_apply_properties(player, &it, now);
+  }
+  dbus_message_unref(reply);
+}
+
+mpris_player *mpris_client::find_by_owner(const char *owner) {
+  if (owner == nullptr) { return nullptr; }
+  for (auto &p : players) {
+    if (p.owner == owner) { return &p; }
+  }
+  return nullptr;
+}
+
+void mpris_client::handle_message(DBusMessage *msg, double now) {
+  DBusMessageIter it;
+
+  if (dbus_message_is_signal(msg, DBUS_PROPERTIES_IFACE,
+                             "PropertiesChanged")) {
+    mpris_player *player = find_by_owner(dbus_message_get_sender(msg));
+    std::string iface;
+
+    if (player == nullptr || !dbus_message_iter_init(msg, &it) ||
+        !iter_string(&it, iface) || iface != MPRIS_PLAYER_IFACE ||
+        !dbus_message_iter_next(&it)) {
+      return;
+    }
+    mpris_apply_properties(*player, &it, now);
+    /* invalidated properties carry no value, fetch them again */
+    if (dbus_message_iter_next(&it) &&
+        dbus_message_iter_get_arg_type(&it) == DBUS_TYPE_ARRAY) {
+      DBusMessageIter invalidated;
+      dbus_message_iter_recurse(&it, &invalidated);
+      if (dbus_message_iter_get_arg_type(&invalidated) == DBUS_TYPE_STRING) {
+        fetch_properties(*player, now);
+      }
+    }
+  } else if (dbus_message_is_signal(msg, MPRIS_PLAYER_IFACE, "Seeked")) {
+    mpris_player *player = find_by_owner(dbus_message_get_sender(msg));
+
+    if (player != nullptr && dbus_message_iter_init(msg, &it) &&
+        iter_int64(&it, player->position)) {
+      player->position_time = now;
+    }
+  } else if (dbus_message_is_signal(msg, "org.freedesktop.DBus",
+                                    "NameOwnerChanged")) {
+    const char *name, *old_owner, *new_owner;
+
+    if (!dbus_message_get_args(msg, nullptr, DBUS_TYPE_STRING, &name,
+                               DBUS_TYPE_STRING, &old_owner, DBUS_TYPE_STRING,
+                               &new_owner, DBUS_TYPE_INVALID) ||
+        !is_player_name(name)) {
+      return;
+    }
+    if (*new_owner == 0) {
+      players.erase(std::remove_if(players.begin(), players.end(),
+                                   [name](const mpris_player &p) {
+                                     return p.bus_name == name;
+                                   }),
+                    players.end());
+    } else {
+      add_player(name, new_owner, now);
+    }
+  }
+}
+
+bool mpris_client::dispatch(double now) {
+  DBusMessage *msg;
+  bool handled, any = false;
+
+  if (connection == nullptr) { return false; }
+  do {
+    handled = false;
+    if (!dbus_connection_read_write(connection, 0)) { break; }
+    while ((msg = dbus_connection_pop_message(connection)) != nullptr) {
+      handle_message(msg, now);
+      dbus_message_unref(msg);
+      handled = any = true;
+    }
+  } while (handled);
+  return any;
+}
+
+namespace {
+/* replaced rather than modified, so printing only takes a reference */
+struct mpris_result {
+  std::shared_ptr<const std::vector<mpris_player>> players =
+      std::make_shared<const std::vector<mpris_player>>();
+};
+
+class mpris_cb : public conky::callback<mpris_result> {
+  typedef conky::callback<mpris_result> Base;
+
+  mpris_client client;
+
+ protected:
+  virtual void work();
+
+ public:
+  explicit mpris_cb(uint32_t period) : Base(period, false, Tuple()) {}
+};
+
+void mpris_cb::work() {
+  double now = get_time();
+  bool changed = false;
+
+  if (!client.connected()) {
+    /* publishes the empty list of a lost connection too */
+    changed = true;
+    client.connect(now);
+  }
+  /* positions are extrapolated while printing, only signals change state */
+  changed = client.dispatch(now) || changed;
+  if (!changed) { return; }
+
+  auto players =
+      std::make_shared<const std::vector<mpris_player>>(client.get_players());
+  std::lock_guard<std::mutex> lock(result_mutex);
+  result.players = std::move(players);
+}
+
+std::shared_ptr<const std::vector<mpris_player>> get_players() {
+  uint32_t period = std::max(
+      lround(music_player_interval.get(*state) / active_update_interval()), 1l);
+  return conky::register_cb<mpris_cb>(period)->get_result_copy().players;
+}
+
+/* calls fn(player) with the object's player, if there is one */
+template <typename Fn>
+void with_player(struct text_object *obj, Fn fn) {
+  const auto players = get_players();
+  const mpris_player *player = mpris_select_player(*players, obj->data.s);
+
+  if (player != nullptr) { fn(*player); }
+}
+}  // namespace
+
+void scan_mpris_bar(struct text_object *obj, const char *arg) {
+  /* bar sizes start with a digit, player names don't */
+  if (arg != nullptr && *arg != 0 && isdigit(*arg) == 0) {
+    size_t len = strcspn(arg, " \t");
+    obj->data.s = strndup(arg, len);
+    arg += len;
+    arg += strspn(arg, " \t");
+  }
+  scan_bar(obj, arg, 1);
+}
+
+void print_mpris_player(struct text_object *obj, char *p,
+                        unsigned int p_max_size) {
+  with_player(obj, [p, p_max_size](const mpris_player &player) {
+    snprintf(p, p_max_size, "%s",
+             player.bus_name.c_str() + strlen(MPRIS_BUS_PREFIX));
+  });
+}
+
+void print_mpris_status(struct text_object *obj, char *p,
+                        unsigned int p_max_size) {
+  snprintf(p, p_max_size, "%s", "Not running");
+  with_player(obj, [p, p_max_size](const mpris_player &player) {
+    snprintf(p, p_max_size, "%s", player.status.c_str());
+  });
+}
+
+#define MPRIS_PRINT_GENERATOR(type)                                  \
+  void print_mpris_##type(struct text_object *obj, char *p,          \
+                          unsigned int p_max_size) {                 \
+    with_player(obj, [p, p_max_size](const mpris_player &player) {   \
+      snprintf(p, p_max_size, "%s", player.type.c_str());            \
+    });                                                              \
+  }
+
+MPRIS_PRINT_GENERATOR(title)
+MPRIS_PRINT_GENERATOR(artist)
+MPRIS_PRINT_GENERATOR(album)
+MPRIS_PRINT_GENERATOR(url)
+
+void print_mpris_position(struct text_object *obj, char *p,
+                          unsigned int p_max_size) {
+  with_player(obj, [p, p_max_size](const mpris_player &player) {
+    format_seconds_short(p, p_max_size,
+                         player.position_at(get_time()) / 1000000);
+  });
+}
+
+void print_mpris_length(struct text_object *obj, char *p,
+                        unsigned int p_max_size) {
+  with_player(obj, [p, p_max_size](const mpris_player &player) {
+    format_seconds_short(p, p_max_size, player.length / 1000000);
+  });
+}
+
+void print_mpris_volume(struct text_object *obj, char *p,
+                        unsigned int p_max_size) {
+  with_player(obj, [p, p_max_size](const mpris_player &player) {
+    snprintf(p, p_max_size, "%d",
+             static_cast<int>(std::lround(player.volume * 100)));
+  });
+}
+
+double mpris_barval(struct text_object *obj) {
+  double val = 0;
+
+  with_player(obj, [&val](const mpris_player &player) {
+    if (player.length > 0) {
+      val = static_cast<double>(player.position_at(get_time())) /
+            player.length;
+    }
+  });
+  return val;
+}
+
+uint8_t mpris_percent(struct text_object *obj) {
+  return static_cast<uint8_t>(std::lround(mpris_barval(obj) * 100.0));
+}
@@ -0,0 +1,116 @@
+/*
+ *
+ * Conky, a system monitor, based on torsmo
+ *
+ * Please see COPYING for details
+ *
+ * Copyright (c) 2005-2024 Brenden Matthews, Philip Kovacs, et. al.
+ *	(see AUTHORS)
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef MPRIS_H_
+#define MPRIS_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct DBusConnection;
+struct DBusMessage;
+struct DBusMessageIter;
+
+struct text_object;
+
+#define MPRIS_BUS_PREFIX "org.mpris.MediaPlayer2."
+
+struct mpris_player {
+  std::string bus_name; /* e.g. org.mpris.MediaPlayer2.vlc */
+  std::string owner;    /* unique name the player's signals come from */
+  std::string status;   /* Playing, Paused or Stopped */
+  std::string trackid;
+  std::string title;
+  std::string artist;
+  std::string album;
+  std::string url;
+  int64_t length = 0;       /* in microseconds */
+  int64_t position = 0;     /* in microseconds, as of position_time */
+  double position_time = 0; /* get_time() stamp */
+  double rate = 1.0;
+  double volume = 0;
+
+  /* position at `now`, advanced locally by Rate while playing */
+  int64_t position_at(double now) const;
+};
+
+/* A private session bus connection following all MPRIS2 players. The
+ * properties of each player are fetched once when it appears; afterwards
+ * only PropertiesChanged, Seeked and NameOwnerChanged signals are
+ * processed, so a steady state costs no remote calls at all. */
+class mpris_client {
+ public:
+  mpris_client() = default;
+  mpris_client(const mpris_client &) = delete;
+  mpris_client &operator=(const mpris_client &) = delete;
+  ~mpris_client();
+
+  bool connect(double now);
+  bool connected() const;
+  /* handles queued signals without blocking, true if there were any */
+  bool dispatch(double now);
+
+  const std::vector<mpris_player> &get_players() const { return players; }
+
+ private:
+  DBusConnection *connection = nullptr;
+  std::vector<mpris_player> players;
+
+  void disconnect();
+  DBusMessage *call(const char *dest, const char *path, const char *iface,
+                    const char *method, const char *arg1 = nullptr,
+                    const char *arg2 = nullptr);
+  void add_player(const std::string &bus_name, const std::string &owner,
+                  double now);
+  void fetch_properties(mpris_player &player, double now);
+  void handle_message(DBusMessage *msg, double now);
+  mpris_player *find_by_owner(const char *owner);
+};
+
+/* applies an a{sv} dictionary of org.mpris.MediaPlayer2.Player properties */
+void mpris_apply_properties(mpris_player &player, DBusMessageIter *dict,
+                            double now);
+
+/* the player a ${mpris_*} object refers to: the one named by `name` (the bus
+ * name without MPRIS_BUS_PREFIX), or else the first playing one */
+const mpris_player *mpris_select_player(const std::vector<mpris_player> &,
+                                        const char *name);
+
+/* ${mpris_bar (player) (height),(width)} */
+void scan_mpris_bar(struct text_object *, const char *);
+
+void print_mpris_player(struct text_object *, char *, unsigned int);
+void print_mpris_status(struct text_object *, char *, unsigned int);
+void print_mpris_title(struct text_object *, char *, unsigned int);
+void print_mpris_artist(struct text_object *, char *, unsigned int);
+void print_mpris_album(struct text_object *, char *, unsigned int);
+void print_mpris_url(struct text_object *, char *, unsigned int);
+void print_mpris_position(struct text_object *, char *, unsigned int);
+void print_mpris_length(struct text_object *, char *, unsigned int);
+void print_mpris_volume(struct text_object *, char *, unsigned int);
+uint8_t mpris_percent(struct text_object *);
+double mpris_barval(struct text_object *);
+
+#endif /* MPRIS_H_ */
@@ -29,14 +29,20 @@
 
 #include "exec.h"
 #include <fcntl.h>
+#include <poll.h>
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <unistd.h>
+#include <algorithm>
 #include <cerrno>
+#include <climits>
 #include <cmath>
+#include <csignal>
 #include <cstdio>
+#include <limits>
 #include <mutex>
 #include <string>
+#include "../common.h"
 #include "../conky.h"
 #include "../content/specials.h"
 #include "../content/text_object.h"
@@ -51,6 +57,11 @@ struct exec_data {
   exec_data() = default;
 };
 
+/* 0 picks the larger of the command's interval and exec_timeout_default */
+static conky::range_config_setting<double> exec_timeout(
+    "exec_timeout", 0.0, std::numeric_limits<double>::infinity(), 0.0, true);
+static const double exec_timeout_default = 30.0;
+
 static const int cmd_len = 256;
 static char cmd[cmd_len];
 
@@ -110,9 +121,14 @@ static FILE *pid_popen(const char *command, const char *mode, pid_t *child) {
     return nullptr;
   }
   if (*child > 0) {
+    // also done by the child; whichever runs first avoids racing a kill()
+    setpgid(*child, *child);
     close(childend);
-    waitpid(*child, nullptr, 0);
   } else {
+    // put the command and anything it spawns into its own process group so
+    // the whole lot can be killed when it times out
+    setpgid(0, 0);
+
     // don't read from both stdin and pipe or write to both stdout and pipe
     if (childend == ends[0]) {
       close(0);
@@ -146,6 +162,62 @@ static FILE *pid_popen(const char *command, const char *mode, pid_t *child) {
   return fdopen(parentend, mode);
 }
 
+exec_status run_command(const char *command, double timeout,
+                        std::string &output) {
+  pid_t childpid;
+  std::shared_ptr<FILE> fp;
+  exec_status status = exec_status::ok;
+  double deadline = get_time() + timeout;
+  char b[0x1000];
+
+  if (FILE *t = pid_popen(command, "r", &childpid)) {
+    fp.reset(t, fclose);
+  } else {
+    return exec_status::failed;
+  }
+
+  struct pollfd pfd = {fileno(fp.get()), POLLIN, 0};
+  for (;;) {
+    int wait_ms = -1;
+    if (timeout > 0) {
+      double left = deadline - get_time();
+      if (left <= 0) {
+        status = exec_status::timed_out;
+        break;
+      }
+      wait_ms = static_cast<int>(std::min(std::ceil(left * 1000), 60000.0));
+    }
+
+    int ready = poll(&pfd, 1, wait_ms);
+    if (ready == 0 || (ready < 0 && errno == EINTR)) { continue; }
+    if (ready < 0) {
+      status = exec_status::failed;
+      break;
+    }
+
+    ssize_t length = read(pfd.fd, b, sizeof b);
+    if (length > 0) {
+      output.append(b, length);
+    } else if (length == 0) {
+      break;
+    } else if (errno != EINTR && errno != EAGAIN) {
+      status = exec_status::failed;
+      break;
+    }
+  }
+
+  if (status == exec_status::timed_out) {
+    LOG_WARNING("command '{}' didn't finish within {}s, killing it", command,
+                timeout);
+    kill(-childpid, SIGKILL);
+  }
+  fp.reset();
+  waitpid(childpid, nullptr, 0);
+
+  if (!output.empty() && output.back() == '\n') { output.pop_back(); }
+  return status;
+}
+
 /**
  * Executes a command and stores the result
  *
@@ -156,28 +228,33 @@ static FILE *pid_popen(const char *command, const char *mode, pid_t *child) {
  * and store it somewhere, such as obj->exec_handle. To retrieve the
  * results, use the stored callback to call get_result_copy(), which
  * returns a std::string.
+ *
+ * Callbacks never block the update loop, so until a run finishes the output
+ * of the previous one is shown. A run that fails or times out leaves that
+ * output in place and marks the callback stale.
  */
 void exec_cb::work() {
-  pid_t childpid;
   std::string buf;
-  std::shared_ptr<FILE> fp;
-  char b[0x1000];
 
-  if (FILE *t = pid_popen(std::get<0>(tuple).c_str(), "r", &childpid)) {
-    fp.reset(t, fclose);
-  } else {
+  if (run_command(std::get<0>(tuple).c_str(), timeout, buf) !=
+      exec_status::ok) {
+    stale = true;
     return;
   }
 
-  while ((feof(fp.get()) == 0) && (ferror(fp.get()) == 0)) {
-    int length = fread(b, 1, sizeof b, fp.get());
-    buf.append(b, length);
+  {
+    std::lock_guard<std::mutex> l(result_mutex);
+    result = std::move(buf);
   }
+  stale = false;
+}
 
-  if (*buf.rbegin() == '\n') { buf.resize(buf.size() - 1); }
-
-  std::lock_guard<std::mutex> l(result_mutex);
-  result = buf;
+/* The same command may be used with different intervals, and with them
+ * different automatic timeouts; give it the most generous one. */
+void exec_cb::merge(callback_base &&other) {
+  auto &o = dynamic_cast<exec_cb &>(other);
+  if (o.timeout > timeout) { timeout = o.timeout.load(); }
+  Base::merge(std::move(other));
 }
 
 // remove backspaced chars, example: "dog^H^H^Hcat" becomes "cat"
@@ -329,26 +406,60 @@ void scan_exec_arg(struct text_object *obj, const char *arg, exec_flag flags) {
   free_and_zero(orig_cmd);
 }
 
+static void register_exec_cb(struct text_object *obj, uint32_t period) {
+  auto *ed = static_cast<struct exec_data *>(obj->data.opaque);
+
+  if ((ed != nullptr) && (ed->cmd != nullptr) && (ed->cmd[0] != 0)) {
+    double timeout = exec_timeout.get(*state);
+    if (timeout <= 0) {
+      timeout = std::max(
+          {static_cast<double>(ed->interval), active_update_interval(),
+           exec_timeout_default});
+    }
+    obj->exec_handle = new conky::callback_handle<exec_cb>(
+        conky::register_cb<exec_cb>(period, false, ed->cmd, timeout));
+  } else {
+    LOG_DEBUG("unable to register execi callback");
+  }
+}
+
 /**
  * Register an exec_cb object using the command that we have parsed.
  *
  * For non-interval variants, ed->interval is 0 which yields period=1.
- * Note that we depend on obj->thread, so be sure to run this function
- * *after* setting obj->thread.
+ * Every variant runs in the background now, so obj->thread only tells
+ * texeci apart from execi for documentation purposes.
  *
  * @param[out] obj stores the callback handle
  */
 void register_exec(struct text_object *obj) {
   auto *ed = static_cast<struct exec_data *>(obj->data.opaque);
 
-  if ((ed != nullptr) && (ed->cmd != nullptr) && (ed->cmd[0] != 0)) {
-    uint32_t period =
-        std::max(lround(ed->interval / active_update_interval()), 1l);
-    obj->exec_handle = new conky::callback_handle<exec_cb>(
-        conky::register_cb<exec_cb>(period, !obj->thread, ed->cmd));
-  } else {
-    LOG_DEBUG("unable to register execi callback");
+  if (ed != nullptr) {
+    register_exec_cb(
+        obj, std::max(lround(ed->interval / active_update_interval()), 1l));
+  }
+}
+
+/**
+ * Parses the command of an ${if_exec_stale} object. It shares the callback
+ * of the exec object running the same command; the longest possible period
+ * means it won't make that command run any more often.
+ */
+void scan_exec_stale_arg(struct text_object *obj, const char *arg) {
+  scan_exec_arg(obj, arg);
+  register_exec_cb(obj, UINT32_MAX);
+}
+
+/**
+ * @return true if the last run of the command failed or timed out, so that
+ * exec objects using it are showing older output
+ */
+int check_exec_stale(struct text_object *obj) {
+  if (obj->exec_handle != nullptr) {
+    return static_cast<int>((*obj->exec_handle)->is_stale());
   }
+  return 0;
 }
 
 /**
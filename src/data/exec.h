@@ -30,6 +30,9 @@
 #ifndef _EXEC_H
 #define _EXEC_H
 
+#include <atomic>
+#include <string>
+
 #include "../update-cb.hh"
 
 /**
@@ -46,18 +49,43 @@
  * with the smallest period/interval is the one that is stored. So the execi
  * command will in fact run on every update interval, rather than every
  * ten seconds as one would expect.
+ *
+ * A command that doesn't finish within its timeout has its process group
+ * killed. The result of the last successful run is kept and the callback is
+ * marked stale until the command completes again.
  */
 class exec_cb : public conky::callback<std::string, std::string> {
   typedef conky::callback<std::string, std::string> Base;
 
+  std::atomic<double> timeout;
+  std::atomic<bool> stale;
+
  protected:
   virtual void work();
+  virtual void merge(callback_base &&);
 
  public:
-  exec_cb(uint32_t period, bool wait, const std::string &cmd)
-      : Base(period, wait, Base::Tuple(cmd)) {}
+  exec_cb(uint32_t period, bool wait, const std::string &cmd, double timeout_)
+      : Base(period, wait, Base::Tuple(cmd)),
+        timeout(timeout_),
+        stale(false) {}
+
+  bool is_stale() const { return stale; }
+
+  conky::cost_class cost() const override { return conky::cost_class::fork; }
 };
 
+enum class exec_status { ok, failed, timed_out };
+
+/**
+ * Runs command through /bin/sh and collects its standard output, minus a
+ * trailing newline, in output. If timeout (in seconds) is positive and
+ * elapses first, the command's process group is killed and whatever was read
+ * until then is left in output.
+ */
+exec_status run_command(const char *command, double timeout,
+                        std::string &output);
+
 /**
  * Flags used to identify the different types of exec commands during
  * parsing by scan_exec_arg(). These can be used individually or combined.
@@ -86,6 +114,8 @@ void scan_exec_arg(struct text_object *, const char *,
                    exec_flag = exec_flag::none);
 void register_exec(struct text_object *);
 void print_exec(struct text_object *, char *, unsigned int);
+void scan_exec_stale_arg(struct text_object *, const char *);
+int check_exec_stale(struct text_object *);
 double execbarval(struct text_object *);
 void free_exec(struct text_object *);
 double get_barnum(const char *buf);
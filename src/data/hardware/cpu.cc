@@ -27,12 +27,14 @@
  *
  */
 
+#include <fcntl.h>
 #include <inttypes.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
 #include <unistd.h>
+#include "../../common.h"
 #include "../../conky.h"
 #include "../../content/text_object.h"
 #include "../../logging.h"
@@ -50,11 +52,10 @@
 #define AmD 0x68747541
 #define InteL 0x756e6547
 
-#if defined(__FreeBSD__)
-#define TICKZ 100L
-#else
-#define TICKZ sysconf(_SC_CLK_TCK)
-#endif /* __FreeBSD__ */
+/* architectural MSRs read through /dev/cpu/N/msr */
+#define MSR_IA32_TSC 0x10
+#define MSR_IA32_MPERF 0xe7
+#define MSR_IA32_APERF 0xe8
 
 uint8_t has_tsc_reg(void) {
   uint_fast16_t vend = 0;
@@ -112,26 +113,124 @@ seeya:
           static_cast<uintmax_t>(ticklo));
 }
 
-void get_cpu_clock_speed(char *str1, unsigned int p_max_size) {
-  uintmax_t x = 0;
-  uintmax_t z = 0;
-  struct timespec tc = {0L, 0L};
+/* ${freq2} never sleeps: every update takes one TSC (and, with a cpu
+ * argument and a readable msr device, APERF/MPERF) sample next to a
+ * monotonic timestamp, and the frequency is the delta between the current
+ * and the previous sample. The first update after startup prints nothing. */
+struct freq2_sample {
+  uintmax_t tsc;
+  uintmax_t aperf;
+  uintmax_t mperf;
+  double time;
+};
+
+struct freq2_data {
+  int cpu;    /* counted from 0, -1 for the plain TSC rate */
+  int msr_fd; /* -1 when /dev/cpu/N/msr is not readable */
+  double tick;
+  bool have_sample;
+  struct freq2_sample last;
+  uintmax_t mhz;
+};
+
+static bool read_msr(int fd, off_t reg, uintmax_t *val) {
+  uint64_t v = 0;
+
+  if (pread(fd, &v, sizeof(v), reg) != sizeof(v)) { return false; }
+  *val = v;
+  return true;
+}
+
+static bool take_freq2_sample(struct freq2_data *fd,
+                              struct freq2_sample *sample) {
+  if (fd->msr_fd != -1) {
+    if (read_msr(fd->msr_fd, MSR_IA32_APERF, &sample->aperf) &&
+        read_msr(fd->msr_fd, MSR_IA32_MPERF, &sample->mperf) &&
+        read_msr(fd->msr_fd, MSR_IA32_TSC, &sample->tsc)) {
+      sample->time = get_time();
+      return true;
+    }
+    LOG_WARNING("reading msr of cpu {} failed, falling back to rdtsc",
+                fd->cpu + 1);
+    close(fd->msr_fd);
+    fd->msr_fd = -1;
+    fd->have_sample = false;
+  }
+  sample->tsc = rdtsc();
+  sample->time = get_time();
+  sample->aperf = sample->mperf = 0;
+  return true;
+}
+
+static void update_freq2(struct freq2_data *fd) {
+  struct freq2_sample now {};
+  double dt;
+
+  /* sample at most once per update, however often the object is printed */
+  if (fd->have_sample && fd->tick == current_update_time) { return; }
+  fd->tick = current_update_time;
+
+  if (!take_freq2_sample(fd, &now)) { return; }
 
-  tc.tv_nsec = TICKZ * 1000000L;
+  dt = now.time - fd->last.time;
+  if (fd->have_sample && dt > 0 && now.tsc > fd->last.tsc) {
+    double hz = static_cast<double>(now.tsc - fd->last.tsc) / dt;
 
-  x = rdtsc();
-  if (-1 == (nanosleep(&tc, NULL))) {
-    LOG_ERROR("nanosleep failed during cpu clock measurement");
-    return;
+    if (fd->msr_fd != -1 && now.mperf > fd->last.mperf) {
+      hz = hz * static_cast<double>(now.aperf - fd->last.aperf) /
+           static_cast<double>(now.mperf - fd->last.mperf);
+    }
+    fd->mhz = static_cast<uintmax_t>(hz / 1000000.0);
   }
-  z = rdtsc();
+  fd->last = now;
+  fd->have_sample = true;
+}
 
-  snprintf(str1, p_max_size, "%ju MHz", ((z - x) / 100000U));
+void scan_freq2_arg(struct text_object *obj, const char *arg) {
+  auto *fd = static_cast<struct freq2_data *>(calloc(1, sizeof(freq2_data)));
+
+  fd->cpu = -1;
+  fd->msr_fd = -1;
+
+  if (arg != nullptr) {
+    int cpu = strtol(arg, nullptr, 10);
+
+    if (cpu < 1) {
+      LOG_WARNING("invalid CPU number '{}' for freq2, using the TSC rate",
+                  arg);
+    } else {
+      fd->cpu = cpu - 1;
+#ifdef __linux__
+      char path[64];
+
+      snprintf(path, sizeof(path), "/dev/cpu/%d/msr", fd->cpu);
+      fd->msr_fd = open(path, O_RDONLY | O_CLOEXEC);
+      if (fd->msr_fd == -1) {
+        LOG_DEBUG("{} is not readable, freq2 falls back to the TSC rate",
+                  path);
+      }
+#endif /* __linux__ */
+    }
+  }
+  obj->data.opaque = fd;
 }
 
 void print_freq2(struct text_object *obj, char *p, unsigned int p_max_size) {
-  (void)obj;
-  get_cpu_clock_speed(p, p_max_size);
+  auto *fd = static_cast<struct freq2_data *>(obj->data.opaque);
+
+  if (fd == nullptr) { return; }
+
+  update_freq2(fd);
+  if (fd->mhz == 0) { return; }
+  snprintf(p, p_max_size, "%ju MHz", fd->mhz);
+}
+
+void free_freq2(struct text_object *obj) {
+  auto *fd = static_cast<struct freq2_data *>(obj->data.opaque);
+
+  if (fd == nullptr) { return; }
+  if (fd->msr_fd != -1) { close(fd->msr_fd); }
+  free_and_zero(obj->data.opaque);
 }
 
 #else
@@ -32,9 +32,10 @@
 
 #ifdef __x86_64__
 uintmax_t rdtsc(void);
-void get_cpu_clock_speed(char *, unsigned int);
 uint8_t has_tsc_reg(void);
+void scan_freq2_arg(struct text_object *, const char *);
 void print_freq2(struct text_object *, char *, unsigned int);
+void free_freq2(struct text_object *);
 #endif /* __x86_64__ */
 
 #endif /* _CPU_H */
@@ -0,0 +1,402 @@
+/*
+ *
+ * Conky, a system monitor, based on torsmo
+ *
+ * Any original torsmo code is licensed under the BSD license
+ *
+ * All code written since the fork of torsmo is licensed under the GPL
+ *
+ * Please see COPYING for details
+ *
+ * Copyright (c) 2005-2024 Brenden Matthews, Philip Kovacs, et. al.
+ *	(see AUTHORS)
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "cpufreq.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "../../common.h"
+#include "../../conky.h"
+#include "../../content/specials.h"
+#include "../../content/text_object.h"
+#include "../../logging.h"
+
+namespace {
+struct idle_state {
+  std::string name;
+  int fd = -1;
+  unsigned long long time = 0; /* usec spent in the state since boot */
+  double residency = 0;        /* percent of the last interval */
+};
+
+struct cpu_core {
+  bool present = false;
+  std::string dir;
+  int freq_fd = -1;
+  unsigned long long khz = 0;
+  /* opened while there are ${cpuidle} objects */
+  bool idle_open = false;
+  std::vector<idle_state> idle;
+  double idle_residency = 0;
+  std::string type;
+#ifdef BUILD_GUI
+  bool graphed = false;
+  graph_series history; /* MHz */
+#endif /* BUILD_GUI */
+};
+
+/* indexed by cpu number; the vector isn't resized once discovered since
+ * graphs point into it */
+std::vector<cpu_core> cores;
+bool discovered = false;
+bool have_sample = false;
+double last_sample = 0;
+double last_tick = -1;
+/* number of ${cpuidle} objects; idle states aren't read without them */
+unsigned int cpuidle_users = 0;
+
+struct cpuidle_data {
+  unsigned int cpu;
+  std::string state;
+};
+}  // namespace
+
+static std::string read_first_line(const std::string &path) {
+  char buf[256];
+  std::string line;
+
+  FILE *f = fopen(path.c_str(), "re");
+  if (f == nullptr) { return line; }
+  if (fgets(buf, sizeof(buf), f) != nullptr) {
+    line = buf;
+    while (!line.empty() && isspace(static_cast<unsigned char>(line.back()))) {
+      line.pop_back();
+    }
+  }
+  fclose(f);
+  return line;
+}
+
+/* parses a cpu list like "0-7,16" */
+static std::vector<unsigned int> parse_cpu_list(const std::string &list) {
+  std::vector<unsigned int> cpus;
+  const char *p = list.c_str();
+
+  while (*p != '\0') {
+    char *end;
+    unsigned long first = strtoul(p, &end, 10);
+    unsigned long last = first;
+
+    if (end == p) { break; }
+    p = end;
+    if (*p == '-') {
+      last = strtoul(p + 1, &end, 10);
+      p = end;
+    }
+    for (unsigned long cpu = first; cpu <= last && cpu < 4096; cpu++) {
+      cpus.push_back(cpu);
+    }
+    if (*p == ',') { p++; }
+  }
+  return cpus;
+}
+
+static void discover_core(cpu_core &core, const std::string &dir) {
+  core.present = true;
+  core.dir = dir;
+  core.freq_fd =
+      open((dir + "/cpufreq/scaling_cur_freq").c_str(), O_RDONLY | O_CLOEXEC);
+}
+
+static void open_idle_states(cpu_core &core) {
+  core.idle_open = true;
+  for (unsigned int i = 0;; i++) {
+    std::string state = core.dir + "/cpuidle/state" + std::to_string(i);
+    int fd = open((state + "/time").c_str(), O_RDONLY | O_CLOEXEC);
+
+    if (fd == -1) { break; }
+    idle_state s;
+    s.name = read_first_line(state + "/name");
+    s.fd = fd;
+    core.idle.push_back(std::move(s));
+  }
+}
+
+static void close_idle_states(cpu_core &core) {
+  for (auto &s : core.idle) { close(s.fd); }
+  core.idle.clear();
+  core.idle_residency = 0;
+  core.idle_open = false;
+}
+
+/* Intel hybrid parts list their cores under separate PMUs; elsewhere (e.g.
+ * big.LITTLE) cores only differ in cpu_capacity. */
+static void discover_core_types(const std::string &sysfs_root,
+                                const std::string &cpu_dir) {
+  bool hybrid = false;
+  const std::pair<const char *, const char *> pmus[] = {{"cpu_core", "P"},
+                                                        {"cpu_atom", "E"}};
+
+  for (const auto &[pmu, type] : pmus) {
+    std::string list =
+        read_first_line(sysfs_root + "/devices/" + pmu + "/cpus");
+    for (unsigned int cpu : parse_cpu_list(list)) {
+      if (cpu < cores.size()) {
+        cores[cpu].type = type;
+        hybrid = true;
+      }
+    }
+  }
+  if (hybrid) { return; }
+
+  std::vector<long> capacity(cores.size(), -1);
+  long max_capacity = -1, min_capacity = -1;
+  for (size_t cpu = 0; cpu < cores.size(); cpu++) {
+    if (!cores[cpu].present) { continue; }
+    std::string value = read_first_line(cpu_dir + "/cpu" +
+                                        std::to_string(cpu) + "/cpu_capacity");
+    if (value.empty()) { continue; }
+    capacity[cpu] = strtol(value.c_str(), nullptr, 10);
+    max_capacity = std::max(max_capacity, capacity[cpu]);
+    if (min_capacity == -1 || capacity[cpu] < min_capacity) {
+      min_capacity = capacity[cpu];
+    }
+  }
+  if (min_capacity == max_capacity) { return; }
+  for (size_t cpu = 0; cpu < cores.size(); cpu++) {
+    if (capacity[cpu] != -1) {
+      cores[cpu].type = capacity[cpu] == max_capacity ? "P" : "E";
+    }
+  }
+}
+
+unsigned int init_cpufreq(const std::string &sysfs_root) {
+  std::string cpu_dir = sysfs_root + "/devices/system/cpu";
+  std::vector<unsigned int> found;
+  unsigned int highest = 0;
+
+  clear_cpufreq();
+  discovered = true;
+
+  DIR *dir = opendir(cpu_dir.c_str());
+  if (dir == nullptr) {
+    LOG_DEBUG("can't open {}: {}", cpu_dir, strerror(errno));
+    return 0;
+  }
+  while (struct dirent *entry = readdir(dir)) {
+    unsigned int cpu;
+    int n = 0;
+
+    if (sscanf(entry->d_name, "cpu%u%n", &cpu, &n) == 1 &&
+        entry->d_name[n] == '\0' && cpu < 4096) {
+      found.push_back(cpu);
+      highest = std::max(highest, cpu);
+    }
+  }
+  closedir(dir);
+  if (found.empty()) { return 0; }
+
+  cores.resize(highest + 1);
+  for (unsigned int cpu : found) {
+    discover_core(cores[cpu], cpu_dir + "/cpu" + std::to_string(cpu));
+  }
+  discover_core_types(sysfs_root, cpu_dir);
+  return found.size();
+}
+
+void clear_cpufreq(void) {
+  for (auto &core : cores) {
+    if (core.freq_fd != -1) { close(core.freq_fd); }
+    close_idle_states(core);
+  }
+  cores.clear();
+  discovered = false;
+  have_sample = false;
+  last_tick = -1;
+}
+
+void sample_cpufreq(double now) {
+  double dt = have_sample ? now - last_sample : 0;
+
+  if (!discovered) { init_cpufreq(); }
+
+  for (auto &core : cores) {
+    unsigned long long value;
+
+    if (!core.present) { continue; }
+    if (core.freq_fd != -1 && pread_ull(core.freq_fd, &value)) {
+      core.khz = value;
+    }
+#ifdef BUILD_GUI
+    if (core.graphed) {
+      core.history.push(static_cast<double>(core.khz) / 1000.0);
+    }
+#endif /* BUILD_GUI */
+
+    if ((cpuidle_users > 0) != core.idle_open) {
+      if (core.idle_open) {
+        close_idle_states(core);
+      } else {
+        open_idle_states(core);
+      }
+      /* the first reading of a state is its total since boot */
+      for (auto &s : core.idle) { pread_ull(s.fd, &s.time); }
+      continue;
+    }
+
+    double idle = 0;
+    for (auto &s : core.idle) {
+      if (!pread_ull(s.fd, &value)) { continue; }
+      if (dt > 0 && value >= s.time) {
+        /* usec over seconds, as a percentage */
+        s.residency = std::min(static_cast<double>(value - s.time) / 1e4 / dt,
+                               100.0);
+      }
+      s.time = value;
+      idle += s.residency;
+    }
+    core.idle_residency = std::min(idle, 100.0);
+  }
+  last_sample = now;
+  have_sample = true;
+}
+
+int update_cpufreq(void) {
+  if (last_tick == current_update_time) { return 0; }
+  last_tick = current_update_time;
+  sample_cpufreq(get_time());
+  return 0;
+}
+
+static const cpu_core *get_core(unsigned int cpu) {
+  if (!discovered) { update_cpufreq(); }
+  if (cpu >= cores.size() || !cores[cpu].present) { return nullptr; }
+  return &cores[cpu];
+}
+
+bool cpufreq_khz(unsigned int cpu, unsigned long long *khz) {
+  const cpu_core *core = get_core(cpu);
+
+  if (core == nullptr || core->freq_fd == -1) { return false; }
+  *khz = core->khz;
+  return true;
+}
+
+double cpuidle_residency(unsigned int cpu, const std::string &state) {
+  const cpu_core *core = get_core(cpu);
+
+  if (core == nullptr) { return 0; }
+  if (state.empty()) { return core->idle_residency; }
+  for (const auto &s : core->idle) {
+    if (strcasecmp(s.name.c_str(), state.c_str()) == 0) { return s.residency; }
+  }
+  return 0;
+}
+
+std::string cpu_core_type(unsigned int cpu) {
+  const cpu_core *core = get_core(cpu);
+
+  return core != nullptr ? core->type : std::string();
+}
+
+/* cpus are counted from 1 in arguments, like ${freq} */
+static unsigned int scan_cpu_number(const char *arg, const char **rest) {
+  unsigned int cpu = 1;
+  int n = 0;
+
+  if (arg != nullptr && sscanf(arg, "%u %n", &cpu, &n) >= 1 && cpu > 0) {
+    if (rest != nullptr) { *rest = arg + n; }
+    return cpu - 1;
+  }
+  LOG_WARNING("invalid CPU number '{}', falling back to CPU 1",
+              arg ? arg : "(null)");
+  if (rest != nullptr) { *rest = arg; }
+  return 0;
+}
+
+void scan_cpuidle_arg(struct text_object *obj, const char *arg) {
+  auto *cd = new cpuidle_data;
+  const char *state = nullptr;
+
+  cd->cpu = scan_cpu_number(arg, &state);
+  if (state != nullptr) {
+    cd->state = state;
+    while (!cd->state.empty() &&
+           isspace(static_cast<unsigned char>(cd->state.back()))) {
+      cd->state.pop_back();
+    }
+  }
+  obj->data.opaque = cd;
+  cpuidle_users++;
+}
+
+uint8_t cpuidle_percentage(struct text_object *obj) {
+  auto *cd = static_cast<cpuidle_data *>(obj->data.opaque);
+
+  if (cd == nullptr) { return 0; }
+  return round_to_positive_int(cpuidle_residency(cd->cpu, cd->state));
+}
+
+void print_cpuidle(struct text_object *obj, char *p, unsigned int p_max_size) {
+  percent_print(p, p_max_size, cpuidle_percentage(obj));
+}
+
+void free_cpuidle(struct text_object *obj) {
+  if (obj->data.opaque == nullptr) { return; }
+  delete static_cast<cpuidle_data *>(obj->data.opaque);
+  obj->data.opaque = nullptr;
+  if (cpuidle_users > 0) { cpuidle_users--; }
+}
+
+void scan_cpu_type_arg(struct text_object *obj, const char *arg) {
+  obj->data.i = scan_cpu_number(arg, nullptr);
+}
+
+void print_cpu_type(struct text_object *obj, char *p, unsigned int p_max_size) {
+  snprintf(p, p_max_size, "%s", cpu_core_type(obj->data.i).c_str());
+}
+
+#ifdef BUILD_GUI
+void scan_cpufreqgraph_arg(struct text_object *obj, const char *arg) {
+  const char *rest = nullptr;
+  unsigned int cpu = scan_cpu_number(arg, &rest);
+
+  obj->data.i = cpu;
+  scan_graph(obj, rest, 0, FALSE, fmt::format("cpufreq:{}", cpu));
+  if (!discovered) { update_cpufreq(); }
+  if (cpu < cores.size() && cores[cpu].present) {
+    cores[cpu].graphed = true;
+    bind_graph_series(obj, &cores[cpu].history);
+  }
+}
+
+double cpufreqgraphval(struct text_object *obj) {
+  unsigned long long khz = 0;
+
+  cpufreq_khz(obj->data.i, &khz);
+  return static_cast<double>(khz) / 1000.0;
+}
+#endif /* BUILD_GUI */
@@ -0,0 +1,71 @@
+/*
+ *
+ * Conky, a system monitor, based on torsmo
+ *
+ * Any original torsmo code is licensed under the BSD license
+ *
+ * All code written since the fork of torsmo is licensed under the GPL
+ *
+ * Please see COPYING for details
+ *
+ * Copyright (c) 2005-2024 Brenden Matthews, Philip Kovacs, et. al.
+ *	(see AUTHORS)
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef _CPUFREQ_H
+#define _CPUFREQ_H
+
+#include "config.h"
+
+#include <cstdint>
+#include <string>
+
+struct text_object;
+
+/* Per-core frequency, cpuidle residency and core type from sysfs. The files
+ * that change are opened once when the cpus are discovered and re-read with
+ * pread() on every update; everything else is read once. Idle states are
+ * only opened while there are ${cpuidle} objects. */
+
+/* discovers the cpus below sysfs_root, returns how many were found */
+unsigned int init_cpufreq(const std::string &sysfs_root = "/sys");
+void clear_cpufreq(void);
+/* samples all cpus, at most once per update */
+int update_cpufreq(void);
+/* samples all cpus as of `now` (seconds, monotonic) */
+void sample_cpufreq(double now);
+
+/* cpus are counted from 0 */
+bool cpufreq_khz(unsigned int cpu, unsigned long long *khz);
+/* percentage of the last interval spent in the named idle state, or in any
+ * of them if `state` is empty */
+double cpuidle_residency(unsigned int cpu, const std::string &state);
+/* "P" or "E" on hybrid systems, empty otherwise */
+std::string cpu_core_type(unsigned int cpu);
+
+void scan_cpuidle_arg(struct text_object *, const char *);
+void print_cpuidle(struct text_object *, char *, unsigned int);
+uint8_t cpuidle_percentage(struct text_object *);
+void free_cpuidle(struct text_object *);
+void scan_cpu_type_arg(struct text_object *, const char *);
+void print_cpu_type(struct text_object *, char *, unsigned int);
+#ifdef BUILD_GUI
+void scan_cpufreqgraph_arg(struct text_object *, const char *);
+double cpufreqgraphval(struct text_object *);
+#endif /* BUILD_GUI */
+
+#endif /* _CPUFREQ_H */
@@ -0,0 +1,435 @@
+/*
+ *
+ * Conky, a system monitor, based on torsmo
+ *
+ * Any original torsmo code is licensed under the BSD license
+ *
+ * All code written since the fork of torsmo is licensed under the GPL
+ *
+ * Please see COPYING for details
+ *
+ * Copyright (c) 2005-2024 Brenden Matthews, Philip Kovacs, et. al.
+ *	(see AUTHORS)
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "interrupts.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+
+#include "../common.h"
+#include "../conky.h"
+#include "../content/specials.h"
+#include "../content/text_object.h"
+#include "../logging.h"
+#include "../prioqueue.h"
+#include "top.h"
+
+namespace {
+struct irq_row {
+  std::string label; /* "24", "NMI", "NET_RX", ... */
+  std::string name;  /* the device or description */
+  double rate = 0;   /* per second, all cpus */
+};
+
+struct irq_table {
+  explicit irq_table(const char *file_) : file(file_) {}
+
+  const char *file;
+  std::string path;
+  int fd = -1;
+  std::vector<char> buf;
+
+  std::vector<unsigned int> cpus; /* cpu number of each column */
+  std::vector<irq_row> rows;
+  std::vector<unsigned long long> counts; /* rows x columns */
+  std::vector<double> rates;              /* rows x columns, per second */
+  std::unordered_map<std::string, size_t> index;
+
+  /* scratch space for the next sample, swapped in afterwards */
+  std::vector<irq_row> next_rows;
+  std::vector<unsigned long long> next_counts;
+
+  std::vector<const irq_row *> top;
+  bool have_sample = false;
+  double last_sample = 0;
+  double last_tick = -1;
+};
+
+irq_table interrupts("interrupts");
+irq_table softirqs("softirqs");
+
+struct irq_data {
+  std::string label;
+  unsigned int cpu;
+};
+}  // namespace
+
+static inline const char *skip_blanks(const char *p, const char *end) {
+  while (p < end && (*p == ' ' || *p == '\t')) { p++; }
+  return p;
+}
+
+static const char *next_line(const char *p, const char *end) {
+  p = static_cast<const char *>(memchr(p, '\n', end - p));
+  return p != nullptr ? p + 1 : end;
+}
+
+/* parses up to `columns` counters into out; rows like ERR and MIS only have
+ * one, the rest are left at zero */
+static const char *parse_counts(const char *p, const char *end,
+                                unsigned long long *out, size_t columns) {
+  for (size_t col = 0; col < columns; col++) {
+    const char *start = skip_blanks(p, end);
+    unsigned long long value = 0;
+
+    p = start;
+    while (p < end && *p >= '0' && *p <= '9') {
+      value = value * 10 + (*p - '0');
+      p++;
+    }
+    if (p == start) {
+      std::fill(out + col, out + columns, 0);
+      return start;
+    }
+    out[col] = value;
+  }
+  return p;
+}
+
+/* "IR-PCI-MSI 524288-edge      nvme0q0" -> "nvme0q0": the kernel separates
+ * the action names from the chip and trigger columns by at least two
+ * spaces */
+static std::string irq_name(const char *p, const char *end) {
+  while (end > p && isspace(static_cast<unsigned char>(end[-1]))) { end--; }
+  p = skip_blanks(p, end);
+  for (const char *q = end - 1; q > p; q--) {
+    if (q[0] == ' ' && q[-1] == ' ') {
+      p = q + 1;
+      break;
+    }
+  }
+  return std::string(p, end);
+}
+
+static int compare_rate(void *va, void *vb) {
+  auto *a = static_cast<const irq_row *>(va),
+       *b = static_cast<const irq_row *>(vb);
+
+  if (b->rate > a->rate) { return 1; }
+  if (a->rate > b->rate) { return -1; }
+  return 0;
+}
+
+static void find_top(irq_table &t) {
+  prio_queue_t queue = init_prio_queue();
+
+  pq_set_compare(queue, &compare_rate);
+  pq_set_max_size(queue, MAX_SP);
+  for (auto &row : t.rows) {
+    if (row.rate > 0) { insert_prio_elem(queue, &row); }
+  }
+  t.top.clear();
+  while (void *row = pop_prio_elem(queue)) {
+    t.top.push_back(static_cast<const irq_row *>(row));
+  }
+  free_prio_queue(queue);
+}
+
+static void sample_table(irq_table &t, const std::string &proc_root,
+                         double now) {
+  std::string path = proc_root + "/" + t.file;
+
+  if (t.path != path) {
+    if (t.fd != -1) { close(t.fd); }
+    t.path = path;
+    t.fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    t.have_sample = false;
+    if (t.fd == -1) {
+      LOG_DEBUG("can't open {}: {}", path, strerror(errno));
+    }
+  }
+  if (t.fd == -1) { return; }
+
+  ssize_t len = pread_file(t.fd, t.buf, 16384);
+  if (len <= 0) { return; }
+  const char *p = t.buf.data(), *end = p + len;
+
+  /* the header names the online cpus: "CPU0 CPU1 CPU3 ..." */
+  std::vector<unsigned int> cpus;
+  const char *eol = next_line(p, end);
+  for (p = skip_blanks(p, eol); p < eol; p = skip_blanks(p, eol)) {
+    unsigned int cpu;
+    int n = 0;
+
+    if (sscanf(p, "CPU%u%n", &cpu, &n) != 1) { break; }
+    cpus.push_back(cpu);
+    p += n;
+  }
+  size_t columns = cpus.size();
+  if (columns == 0) { return; }
+  if (cpus != t.cpus) {
+    /* cpus came or went, the old counters don't line up anymore */
+    t.cpus = cpus;
+    t.have_sample = false;
+  }
+
+  double dt = t.have_sample ? now - t.last_sample : 0;
+  bool relabeled = false;
+  size_t n_rows = 0;
+
+  t.next_counts.clear();
+  t.rates.clear();
+  for (p = eol; p < end; p = eol) {
+    eol = next_line(p, end);
+    const char *label = skip_blanks(p, eol);
+    const char *colon =
+        static_cast<const char *>(memchr(label, ':', eol - label));
+    if (colon == nullptr) { continue; }
+
+    if (t.next_rows.size() <= n_rows) { t.next_rows.emplace_back(); }
+    irq_row &row = t.next_rows[n_rows];
+    row.label.assign(label, colon);
+    t.next_counts.resize((n_rows + 1) * columns);
+    unsigned long long *counts = &t.next_counts[n_rows * columns];
+    const char *rest = parse_counts(colon + 1, eol, counts, columns);
+    row.name = &t == &softirqs ? row.label : irq_name(rest, eol);
+    if (row.name.empty()) { row.name = row.label; }
+
+    /* rows almost always keep their position between samples */
+    size_t prev = n_rows;
+    if (prev >= t.rows.size() || t.rows[prev].label != row.label) {
+      relabeled = true;
+      auto it = t.index.find(row.label);
+      prev = it != t.index.end() ? it->second : SIZE_MAX;
+    }
+    row.rate = 0;
+    t.rates.resize((n_rows + 1) * columns);
+    double *rates = &t.rates[n_rows * columns];
+    for (size_t col = 0; col < columns; col++) {
+      rates[col] = 0;
+      if (dt > 0 && prev != SIZE_MAX) {
+        unsigned long long before = t.counts[prev * columns + col];
+        if (counts[col] >= before) {
+          rates[col] = static_cast<double>(counts[col] - before) / dt;
+        }
+      }
+      row.rate += rates[col];
+    }
+    n_rows++;
+  }
+  if (n_rows != t.rows.size()) { relabeled = true; }
+
+  t.next_rows.resize(n_rows);
+  t.rows.swap(t.next_rows);
+  t.counts.swap(t.next_counts);
+  if (relabeled || t.index.size() != n_rows) {
+    t.index.clear();
+    for (size_t r = 0; r < n_rows; r++) { t.index[t.rows[r].label] = r; }
+  }
+  if (&t == &interrupts) { find_top(t); }
+  t.last_sample = now;
+  t.have_sample = true;
+}
+
+static void reset_table(irq_table &t) {
+  if (t.fd != -1) { close(t.fd); }
+  t.fd = -1;
+  t.path.clear();
+  t.buf = std::vector<char>();
+  t.cpus.clear();
+  t.rows.clear();
+  t.counts.clear();
+  t.rates.clear();
+  t.index.clear();
+  t.next_rows.clear();
+  t.next_counts.clear();
+  t.rates.clear();
+  t.top.clear();
+  t.have_sample = false;
+  t.last_tick = -1;
+}
+
+static int update_table(irq_table &t) {
+  if (t.last_tick == current_update_time) { return 0; }
+  t.last_tick = current_update_time;
+  sample_table(t, "/proc", get_time());
+  return 0;
+}
+
+int update_interrupts(void) { return update_table(interrupts); }
+
+int update_softirqs(void) { return update_table(softirqs); }
+
+void sample_irqs(const std::string &proc_root, double now) {
+  sample_table(interrupts, proc_root, now);
+  sample_table(softirqs, proc_root, now);
+}
+
+void clear_interrupts(void) {
+  reset_table(interrupts);
+  reset_table(softirqs);
+}
+
+static double table_rate(const irq_table &t, const std::string &label,
+                         unsigned int cpu) {
+  auto it = t.index.find(label);
+
+  if (it == t.index.end()) { return 0; }
+  if (cpu == 0) { return t.rows[it->second].rate; }
+  for (size_t col = 0; col < t.cpus.size(); col++) {
+    if (t.cpus[col] == cpu - 1) {
+      return t.rates[it->second * t.cpus.size() + col];
+    }
+  }
+  return 0;
+}
+
+double irq_rate(const std::string &irq, unsigned int cpu) {
+  return table_rate(interrupts, irq, cpu);
+}
+
+double softirq_rate(const std::string &name, unsigned int cpu) {
+  return table_rate(softirqs, name, cpu);
+}
+
+bool irq_top_entry(unsigned int n, std::string *irq, std::string *name,
+                   double *rate) {
+  if (n >= interrupts.top.size()) { return false; }
+  const irq_row *row = interrupts.top[n];
+  if (irq != nullptr) { *irq = row->label; }
+  if (name != nullptr) { *name = row->name; }
+  if (rate != nullptr) { *rate = row->rate; }
+  return true;
+}
+
+static void print_irq_top_name(struct text_object *obj, char *p,
+                               unsigned int p_max_size) {
+  std::string name;
+
+  if (irq_top_entry(obj->data.i, nullptr, &name, nullptr)) {
+    snprintf(p, p_max_size, "%s", name.c_str());
+  }
+}
+
+static void print_irq_top_irq(struct text_object *obj, char *p,
+                              unsigned int p_max_size) {
+  std::string irq;
+
+  if (irq_top_entry(obj->data.i, &irq, nullptr, nullptr)) {
+    snprintf(p, p_max_size, "%s", irq.c_str());
+  }
+}
+
+static void print_irq_top_rate(struct text_object *obj, char *p,
+                               unsigned int p_max_size) {
+  double rate;
+
+  if (irq_top_entry(obj->data.i, nullptr, nullptr, &rate)) {
+    snprintf(p, p_max_size, "%.0f", rate);
+  }
+}
+
+void scan_irq_top_arg(struct text_object *obj, const char *arg) {
+  char buf[64];
+  int n;
+
+  obj->data.i = 0;
+  obj->callbacks.print = &print_irq_top_name;
+  if (arg == nullptr || sscanf(arg, "%63s %i", buf, &n) != 2) {
+    LOG_ERROR("irq_top needs a type and a number");
+    return;
+  }
+  if (strcmp(buf, "rate") == EQUAL) {
+    obj->callbacks.print = &print_irq_top_rate;
+  } else if (strcmp(buf, "irq") == EQUAL) {
+    obj->callbacks.print = &print_irq_top_irq;
+  } else if (strcmp(buf, "name") != EQUAL) {
+    LOG_ERROR("invalid type arg for irq_top, must be one of: name, irq, rate");
+  }
+  if (n < 1 || n > MAX_SP) {
+    LOG_ERROR("invalid num arg for irq_top, must be between 1 and {}",
+              MAX_SP);
+    n = 1;
+  }
+  obj->data.i = n - 1;
+}
+
+/* "NET_RX cpu2 ..." -> the label and cpu, returns what's left */
+static const char *scan_irq_label(struct text_object *obj, const char *arg) {
+  auto *id = new irq_data;
+  char buf[64];
+  int n = 0;
+
+  id->cpu = 0;
+  obj->data.opaque = id;
+  if (arg == nullptr || sscanf(arg, "%63s %n", buf, &n) < 1) {
+    LOG_ERROR("irq and softirq need an interrupt as argument");
+    return nullptr;
+  }
+  id->label = buf;
+  arg += n;
+  if (sscanf(arg, "cpu%u %n", &id->cpu, &n) >= 1) { arg += n; }
+  return arg;
+}
+
+void scan_irq_arg(struct text_object *obj, const char *arg) {
+  scan_irq_label(obj, arg);
+}
+
+void print_irq(struct text_object *obj, char *p, unsigned int p_max_size) {
+  auto *id = static_cast<irq_data *>(obj->data.opaque);
+
+  snprintf(p, p_max_size, "%.0f", irq_rate(id->label, id->cpu));
+}
+
+void print_softirq(struct text_object *obj, char *p, unsigned int p_max_size) {
+  auto *id = static_cast<irq_data *>(obj->data.opaque);
+
+  snprintf(p, p_max_size, "%.0f", softirq_rate(id->label, id->cpu));
+}
+
+void free_irq(struct text_object *obj) {
+  delete static_cast<irq_data *>(obj->data.opaque);
+  obj->data.opaque = nullptr;
+}
+
+#ifdef BUILD_GUI
+void scan_irqgraph_arg(struct text_object *obj, const char *arg) {
+  scan_graph(obj, scan_irq_label(obj, arg), 0, FALSE);
+}
+
+double irqgraphval(struct text_object *obj) {
+  auto *id = static_cast<irq_data *>(obj->data.opaque);
+
+  return irq_rate(id->label, id->cpu);
+}
+
+double softirqgraphval(struct text_object *obj) {
+  auto *id = static_cast<irq_data *>(obj->data.opaque);
+
+  return softirq_rate(id->label, id->cpu);
+}
+#endif /* BUILD_GUI */
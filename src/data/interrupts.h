@@ -0,0 +1,67 @@
+/*
+ *
+ * Conky, a system monitor, based on torsmo
+ *
+ * Any original torsmo code is licensed under the BSD license
+ *
+ * All code written since the fork of torsmo is licensed under the GPL
+ *
+ * Please see COPYING for details
+ *
+ * Copyright (c) 2005-2024 Brenden Matthews, Philip Kovacs, et. al.
+ *	(see AUTHORS)
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef _INTERRUPTS_H
+#define _INTERRUPTS_H
+
+#include "config.h"
+
+#include <string>
+
+struct text_object;
+
+/* Interrupt and softirq rates from /proc/interrupts and /proc/softirqs. Both
+ * files are read into buffers kept between updates and every row's counters
+ * are parsed straight into one flat array per file. */
+
+int update_interrupts(void);
+int update_softirqs(void);
+/* samples both files below proc_root as of `now` (seconds, monotonic) */
+void sample_irqs(const std::string &proc_root, double now);
+void clear_interrupts(void);
+
+/* per second over the last update; cpu counts from 1 like $cpu, with 0
+ * meaning all cpus */
+double irq_rate(const std::string &irq, unsigned int cpu);
+double softirq_rate(const std::string &name, unsigned int cpu);
+/* the n-th (from 0) busiest interrupt of the last update */
+bool irq_top_entry(unsigned int n, std::string *irq, std::string *name,
+                   double *rate);
+
+void scan_irq_top_arg(struct text_object *, const char *);
+void scan_irq_arg(struct text_object *, const char *);
+void print_irq(struct text_object *, char *, unsigned int);
+void print_softirq(struct text_object *, char *, unsigned int);
+void free_irq(struct text_object *);
+#ifdef BUILD_GUI
+void scan_irqgraph_arg(struct text_object *, const char *);
+double irqgraphval(struct text_object *);
+double softirqgraphval(struct text_object *);
+#endif /* BUILD_GUI */
+
+#endif /* _INTERRUPTS_H */
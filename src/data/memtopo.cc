@@ -0,0 +1,441 @@
+/*
+ *
+ * Conky, a system monitor, based on torsmo
+ *
+ * Any original torsmo code is licensed under the BSD license
+ *
+ * All code written since the fork of torsmo is licensed under the GPL
+ *
+ * Please see COPYING for details
+ *
+ * Copyright (c) 2005-2024 Brenden Matthews, Philip Kovacs, et. al.
+ *	(see AUTHORS)
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "memtopo.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string_view>
+#include <vector>
+
+#include "../common.h"
+#include "../conky.h"
+#include "../content/text_object.h"
+#include "../logging.h"
+
+namespace {
+/* node meminfo is around 1.5k, /proc/meminfo a little less */
+constexpr size_t read_buffer_size = 8192;
+
+struct node_info {
+  unsigned int id;
+  int fd = -1;
+  /* kB */
+  unsigned long long total = 0, free = 0, used = 0;
+  /* pages */
+  unsigned long long hugepages_total = 0, hugepages_free = 0;
+};
+
+struct zram_device {
+  std::string name;
+  int fd = -1;
+  /* bytes */
+  unsigned long long orig = 0, compr = 0, used = 0;
+};
+
+struct meminfo_field {
+  std::string_view key;
+  unsigned long long *value;
+};
+
+std::vector<node_info> nodes;
+std::vector<zram_device> zram_devices;
+int meminfo_fd = -1;
+/* kB, from /proc/meminfo */
+unsigned long long zswap_pool = 0, zswap_stored = 0;
+bool have_zswap = false;
+/* pages */
+unsigned long long hugepages_total = 0, hugepages_free = 0;
+bool discovered = false;
+double last_tick = -1;
+/* shared by every file read */
+std::vector<char> read_buffer;
+}  // namespace
+
+/* parses "Key:   value kB" lines, optionally prefixed by "Node N ", into the
+ * fields given; returns how many were found */
+static unsigned int parse_meminfo(const char *p, meminfo_field *fields,
+                                  size_t count) {
+  unsigned int found = 0;
+
+  while (*p != '\0') {
+    const char *eol = strchr(p, '\n');
+    if (eol == nullptr) { eol = p + strlen(p); }
+    if (strncmp(p, "Node ", 5) == 0) {
+      p += 5;
+      while (p < eol && *p != ' ') { p++; }
+      while (p < eol && *p == ' ') { p++; }
+    }
+    const char *colon = static_cast<const char *>(memchr(p, ':', eol - p));
+    if (colon != nullptr) {
+      std::string_view key(p, colon - p);
+      for (size_t i = 0; i < count; i++) {
+        if (fields[i].key == key) {
+          *fields[i].value = strtoull(colon + 1, nullptr, 10);
+          found++;
+          break;
+        }
+      }
+    }
+    p = *eol != '\0' ? eol + 1 : eol;
+  }
+  return found;
+}
+
+static void sample_node(node_info &node) {
+  unsigned long long file_pages = 0, shmem = 0, sreclaimable = 0;
+  meminfo_field fields[] = {
+      {"MemTotal", &node.total},
+      {"MemFree", &node.free},
+      {"FilePages", &file_pages},
+      {"Shmem", &shmem},
+      {"SReclaimable", &sreclaimable},
+      {"HugePages_Total", &node.hugepages_total},
+      {"HugePages_Free", &node.hugepages_free},
+  };
+
+  if (pread_file(node.fd, read_buffer, read_buffer_size) <= 0) { return; }
+  node.total = node.free = 0;
+  node.hugepages_total = node.hugepages_free = 0;
+  parse_meminfo(read_buffer.data(), fields,
+                sizeof(fields) / sizeof(fields[0]));
+
+  /* the same notion of used as $mem, nodes have no MemAvailable though */
+  node.used = node.total - std::min(node.total, node.free);
+  if (no_buffers.get(*state)) {
+    unsigned long long reclaimable =
+        file_pages - std::min(file_pages, shmem) + sreclaimable;
+    node.used -= std::min(node.used, reclaimable);
+  }
+}
+
+static void sample_zram(zram_device &dev) {
+  if (pread_file(dev.fd, read_buffer, read_buffer_size) <= 0) { return; }
+  /* orig_data_size compr_data_size mem_used_total ... */
+  if (sscanf(read_buffer.data(), "%llu %llu %llu", &dev.orig, &dev.compr,
+             &dev.used) != 3) {
+    dev.orig = dev.compr = dev.used = 0;
+  }
+}
+
+static void sample_proc_meminfo() {
+  meminfo_field fields[] = {
+      {"Zswap", &zswap_pool},
+      {"Zswapped", &zswap_stored},
+      {"HugePages_Total", &hugepages_total},
+      {"HugePages_Free", &hugepages_free},
+  };
+
+  if (pread_file(meminfo_fd, read_buffer, read_buffer_size) <= 0) { return; }
+  zswap_pool = zswap_stored = 0;
+  hugepages_total = hugepages_free = 0;
+  parse_meminfo(read_buffer.data(), fields,
+                sizeof(fields) / sizeof(fields[0]));
+  /* Zswap and Zswapped are only there with CONFIG_ZSWAP */
+  have_zswap = strstr(read_buffer.data(), "\nZswap:") != nullptr;
+}
+
+unsigned int init_memtopo(const std::string &sysfs_root,
+                          const std::string &proc_root) {
+  std::string node_dir = sysfs_root + "/devices/system/node";
+
+  clear_memtopo();
+  discovered = true;
+
+  if (DIR *dir = opendir(node_dir.c_str())) {
+    while (struct dirent *entry = readdir(dir)) {
+      unsigned int id;
+      int n = 0;
+
+      if (sscanf(entry->d_name, "node%u%n", &id, &n) != 1 ||
+          entry->d_name[n] != '\0') {
+        continue;
+      }
+      std::string path = node_dir + "/" + entry->d_name + "/meminfo";
+      node_info node;
+      node.id = id;
+      node.fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+      if (node.fd != -1) { nodes.push_back(node); }
+    }
+    closedir(dir);
+    std::sort(nodes.begin(), nodes.end(),
+              [](const node_info &a, const node_info &b) {
+                return a.id < b.id;
+              });
+  }
+
+  std::string block_dir = sysfs_root + "/block";
+  if (DIR *dir = opendir(block_dir.c_str())) {
+    while (struct dirent *entry = readdir(dir)) {
+      if (strncmp(entry->d_name, "zram", 4) != 0) { continue; }
+      std::string path = block_dir + "/" + entry->d_name + "/mm_stat";
+      zram_device dev;
+      dev.name = entry->d_name;
+      dev.fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+      if (dev.fd != -1) { zram_devices.push_back(std::move(dev)); }
+    }
+    closedir(dir);
+    std::sort(zram_devices.begin(), zram_devices.end(),
+              [](const zram_device &a, const zram_device &b) {
+                return a.name < b.name;
+              });
+  }
+
+  meminfo_fd = open((proc_root + "/meminfo").c_str(), O_RDONLY | O_CLOEXEC);
+  if (meminfo_fd == -1) {
+    LOG_DEBUG("can't open {}/meminfo: {}", proc_root, strerror(errno));
+  }
+  return nodes.size();
+}
+
+void clear_memtopo(void) {
+  for (auto &node : nodes) { close(node.fd); }
+  for (auto &dev : zram_devices) { close(dev.fd); }
+  if (meminfo_fd != -1) { close(meminfo_fd); }
+  nodes.clear();
+  zram_devices.clear();
+  meminfo_fd = -1;
+  zswap_pool = zswap_stored = 0;
+  have_zswap = false;
+  hugepages_total = hugepages_free = 0;
+  discovered = false;
+  last_tick = -1;
+}
+
+void sample_memtopo(void) {
+  if (!discovered) { init_memtopo(); }
+  for (auto &node : nodes) { sample_node(node); }
+  for (auto &dev : zram_devices) { sample_zram(dev); }
+  if (meminfo_fd != -1) { sample_proc_meminfo(); }
+}
+
+int update_memtopo(void) {
+  if (last_tick == current_update_time) { return 0; }
+  last_tick = current_update_time;
+  sample_memtopo();
+  return 0;
+}
+
+static const node_info *find_node(int node) {
+  for (const auto &n : nodes) {
+    if (static_cast<int>(n.id) == node) { return &n; }
+  }
+  return nullptr;
+}
+
+bool node_meminfo(int node, unsigned long long *total,
+                  unsigned long long *free, unsigned long long *used) {
+  const node_info *n = find_node(node);
+
+  if (n == nullptr) { return false; }
+  if (total != nullptr) { *total = n->total; }
+  if (free != nullptr) { *free = n->free; }
+  if (used != nullptr) { *used = n->used; }
+  return true;
+}
+
+bool hugepages_info(int node, unsigned long long *total,
+                    unsigned long long *free) {
+  if (node < 0) {
+    if (meminfo_fd == -1) { return false; }
+    *total = hugepages_total;
+    *free = hugepages_free;
+    return true;
+  }
+  const node_info *n = find_node(node);
+  if (n == nullptr) { return false; }
+  *total = n->hugepages_total;
+  *free = n->hugepages_free;
+  return true;
+}
+
+bool zram_info(const std::string &dev, unsigned long long *orig,
+               unsigned long long *compr, unsigned long long *used) {
+  bool found = false;
+
+  *orig = *compr = *used = 0;
+  for (const auto &d : zram_devices) {
+    if (!dev.empty() && d.name != dev) { continue; }
+    *orig += d.orig;
+    *compr += d.compr;
+    *used += d.used;
+    found = true;
+  }
+  return found;
+}
+
+bool zswap_info(unsigned long long *pool, unsigned long long *stored) {
+  *pool = zswap_pool;
+  *stored = zswap_stored;
+  return have_zswap;
+}
+
+static void print_ratio(char *p, unsigned int p_max_size,
+                        unsigned long long orig, unsigned long long compr) {
+  if (compr == 0) {
+    snprintf(p, p_max_size, "%s", "-");
+  } else {
+    snprintf(p, p_max_size, "%.2f", static_cast<double>(orig) / compr);
+  }
+}
+
+const char *scan_node_arg(struct text_object *obj, const char *arg,
+                          int fallback) {
+  obj->data.i = fallback;
+  if (arg == nullptr) { return arg; }
+
+  /* only a plain number, "10,100" is a bar size */
+  const char *p = arg;
+  while (*p == ' ') { p++; }
+  const char *digits = p;
+  while (*p >= '0' && *p <= '9') { p++; }
+  if (p == digits || (*p != '\0' && *p != ' ')) { return arg; }
+  obj->data.i = strtol(digits, nullptr, 10);
+  while (*p == ' ') { p++; }
+  return p;
+}
+
+void print_node_mem(struct text_object *obj, char *p,
+                    unsigned int p_max_size) {
+  unsigned long long used;
+
+  if (node_meminfo(obj->data.i, nullptr, nullptr, &used)) {
+    human_readable(used * 1024, p, p_max_size);
+  }
+}
+
+void print_node_memfree(struct text_object *obj, char *p,
+                        unsigned int p_max_size) {
+  unsigned long long free;
+
+  if (node_meminfo(obj->data.i, nullptr, &free, nullptr)) {
+    human_readable(free * 1024, p, p_max_size);
+  }
+}
+
+void print_node_memmax(struct text_object *obj, char *p,
+                       unsigned int p_max_size) {
+  unsigned long long total;
+
+  if (node_meminfo(obj->data.i, &total, nullptr, nullptr)) {
+    human_readable(total * 1024, p, p_max_size);
+  }
+}
+
+double node_mem_barval(struct text_object *obj) {
+  unsigned long long total, used;
+
+  if (!node_meminfo(obj->data.i, &total, nullptr, &used) || total == 0) {
+    return 0;
+  }
+  return static_cast<double>(used) / total;
+}
+
+uint8_t node_mem_percentage(struct text_object *obj) {
+  return round_to_positive_int(node_mem_barval(obj) * 100);
+}
+
+void print_hugepages_used(struct text_object *obj, char *p,
+                          unsigned int p_max_size) {
+  unsigned long long total, free;
+
+  if (hugepages_info(obj->data.i, &total, &free)) {
+    snprintf(p, p_max_size, "%llu", total - std::min(total, free));
+  }
+}
+
+void print_hugepages_total(struct text_object *obj, char *p,
+                           unsigned int p_max_size) {
+  unsigned long long total, free;
+
+  if (hugepages_info(obj->data.i, &total, &free)) {
+    snprintf(p, p_max_size, "%llu", total);
+  }
+}
+
+uint8_t hugepages_percentage(struct text_object *obj) {
+  unsigned long long total, free;
+
+  if (!hugepages_info(obj->data.i, &total, &free) || total == 0) { return 0; }
+  return round_to_positive_int(100.0 * (total - std::min(total, free)) /
+                               total);
+}
+
+#define PRINT_ZRAM_GENERATOR(name)                                        \
+  void print_zram_##name(struct text_object *obj, char *p,                \
+                         unsigned int p_max_size) {                       \
+    unsigned long long orig, compr, used;                                 \
+                                                                          \
+    if (zram_info(obj->data.s ? obj->data.s : "", &orig, &compr, &used)) { \
+      human_readable(name, p, p_max_size);                                \
+    }                                                                     \
+  }
+
+PRINT_ZRAM_GENERATOR(orig)
+PRINT_ZRAM_GENERATOR(compr)
+PRINT_ZRAM_GENERATOR(used)
+
+void print_zram_ratio(struct text_object *obj, char *p,
+                      unsigned int p_max_size) {
+  unsigned long long orig, compr, used;
+
+  if (zram_info(obj->data.s ? obj->data.s : "", &orig, &compr, &used)) {
+    print_ratio(p, p_max_size, orig, compr);
+  }
+}
+
+void print_zswap(struct text_object *obj, char *p, unsigned int p_max_size) {
+  unsigned long long pool, stored;
+
+  (void)obj;
+  if (zswap_info(&pool, &stored)) { human_readable(pool * 1024, p, p_max_size); }
+}
+
+void print_zswapped(struct text_object *obj, char *p,
+                    unsigned int p_max_size) {
+  unsigned long long pool, stored;
+
+  (void)obj;
+  if (zswap_info(&pool, &stored)) {
+    human_readable(stored * 1024, p, p_max_size);
+  }
+}
+
+void print_zswap_ratio(struct text_object *obj, char *p,
+                       unsigned int p_max_size) {
+  unsigned long long pool, stored;
+
+  (void)obj;
+  if (zswap_info(&pool, &stored)) { print_ratio(p, p_max_size, stored, pool); }
+}
@@ -0,0 +1,85 @@
+/*
+ *
+ * Conky, a system monitor, based on torsmo
+ *
+ * Any original torsmo code is licensed under the BSD license
+ *
+ * All code written since the fork of torsmo is licensed under the GPL
+ *
+ * Please see COPYING for details
+ *
+ * Copyright (c) 2005-2024 Brenden Matthews, Philip Kovacs, et. al.
+ *	(see AUTHORS)
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef _MEMTOPO_H
+#define _MEMTOPO_H
+
+#include "config.h"
+
+#include <cstdint>
+#include <string>
+
+struct text_object;
+
+/* Per-NUMA-node memory, zram and zswap compression and hugepage pools. The
+ * nodes and zram devices are discovered once; their files stay open and are
+ * re-read with pread() into a fixed buffer on every update. */
+
+/* discovers nodes and zram devices, returns how many nodes were found */
+unsigned int init_memtopo(const std::string &sysfs_root = "/sys",
+                          const std::string &proc_root = "/proc");
+void clear_memtopo(void);
+/* samples everything, at most once per update */
+int update_memtopo(void);
+void sample_memtopo(void);
+
+/* all in kB; node -1 means the whole system where that makes sense */
+bool node_meminfo(int node, unsigned long long *total,
+                  unsigned long long *free, unsigned long long *used);
+/* in pages */
+bool hugepages_info(int node, unsigned long long *total,
+                    unsigned long long *free);
+/* in bytes; an empty device sums up all zram devices */
+bool zram_info(const std::string &dev, unsigned long long *orig,
+               unsigned long long *compr, unsigned long long *used);
+/* in kB, compressed pool size and the size of what it holds */
+bool zswap_info(unsigned long long *pool, unsigned long long *stored);
+
+/* reads a leading node number into obj->data.i, `fallback` if there is none;
+ * returns the rest of the arguments */
+const char *scan_node_arg(struct text_object *, const char *, int fallback);
+void print_node_mem(struct text_object *, char *, unsigned int);
+void print_node_memfree(struct text_object *, char *, unsigned int);
+void print_node_memmax(struct text_object *, char *, unsigned int);
+uint8_t node_mem_percentage(struct text_object *);
+double node_mem_barval(struct text_object *);
+
+void print_hugepages_used(struct text_object *, char *, unsigned int);
+void print_hugepages_total(struct text_object *, char *, unsigned int);
+uint8_t hugepages_percentage(struct text_object *);
+
+void print_zram_orig(struct text_object *, char *, unsigned int);
+void print_zram_compr(struct text_object *, char *, unsigned int);
+void print_zram_used(struct text_object *, char *, unsigned int);
+void print_zram_ratio(struct text_object *, char *, unsigned int);
+
+void print_zswap(struct text_object *, char *, unsigned int);
+void print_zswapped(struct text_object *, char *, unsigned int);
+void print_zswap_ratio(struct text_object *, char *, unsigned int);
+
+#endif /* _MEMTOPO_H */
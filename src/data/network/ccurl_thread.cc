@@ -23,6 +23,11 @@
  */
 
 #include "ccurl_thread.h"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <strings.h>
+#include <algorithm>
+#include <cctype>
 #include <cmath>
 #include <mutex>
 #include "../../conky.h"
@@ -50,15 +55,25 @@ size_t curl_internal::parse_header_cb(void *ptr, size_t size, size_t nmemb,
   const char *value = static_cast<const char *>(ptr);
   size_t realsize = size * nmemb;
 
-  if (realsize > 0 &&
-      (value[realsize - 1] == '\r' || value[realsize - 1] == 0)) {
+  // strip the line terminator, which curl passes on as "\r\n"
+  while (realsize > 0 &&
+         (value[realsize - 1] == '\r' || value[realsize - 1] == '\n' ||
+          value[realsize - 1] == 0)) {
     --realsize;
   }
 
-  if (strncmp(value, "Last-Modified: ", 15) == EQUAL) {
+  // header names are case-insensitive, and all lowercase over HTTP/2
+  if (strncasecmp(value, "Last-Modified: ", 15) == EQUAL) {
     obj->last_modified = std::string(value + 15, realsize - 15);
-  } else if (strncmp(value, "ETag: ", 6) == EQUAL) {
+  } else if (strncasecmp(value, "ETag: ", 6) == EQUAL) {
     obj->etag = std::string(value + 6, realsize - 6);
+  } else if (const char *colon = static_cast<const char *>(
+                 memchr(value, ':', realsize))) {
+    std::string name(value, colon - value);
+    size_t start = colon + 1 - value;
+    while (start < realsize && value[start] == ' ') { ++start; }
+    std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+    obj->process_header(name, std::string(value + start, realsize - start));
   }
 
   return size * nmemb;
@@ -108,8 +123,9 @@ curl_internal::curl_internal(const std::string &url) : curl(curl_easy_init()) {
 }
 
 /* fetch our datums */
-void curl_internal::do_work() {
+long curl_internal::do_work() {
   CURLcode res;
+  long http_status_code = 0;
   struct headers_ {
     struct curl_slist *h;
 
@@ -119,22 +135,27 @@ void curl_internal::do_work() {
 
   data.clear();
 
-  if (!last_modified.empty()) {
+  // a 304 need not repeat the validators, so keep them for the next request
+  const std::string sent_last_modified = std::move(last_modified);
+  const std::string sent_etag = std::move(etag);
+  last_modified.clear();
+  etag.clear();
+
+  if (!sent_last_modified.empty()) {
     headers.h = curl_slist_append(
-        headers.h, ("If-Modified-Since: " + last_modified).c_str());
-    last_modified.clear();
+        headers.h, ("If-Modified-Since: " + sent_last_modified).c_str());
   }
-  if (!etag.empty()) {
+  if (!sent_etag.empty()) {
     headers.h =
-        curl_slist_append(headers.h, ("If-None-Match: " + etag).c_str());
-    etag.clear();
+        curl_slist_append(headers.h, ("If-None-Match: " + sent_etag).c_str());
+  }
+  for (const auto &header : request_headers) {
+    headers.h = curl_slist_append(headers.h, header.c_str());
   }
   curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers.h);
 
   res = curl_easy_perform(curl);
   if (res == CURLE_OK) {
-    long http_status_code;
-
     if (curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_status_code) ==
         CURLE_OK) {
       switch (http_status_code) {
@@ -142,6 +163,8 @@ void curl_internal::do_work() {
           process_data();
           break;
         case 304:
+          if (last_modified.empty()) { last_modified = sent_last_modified; }
+          if (etag.empty()) { etag = sent_etag; }
           break;
         default:
           LOG_ERROR("curl: no data from server, got HTTP status {}",
@@ -154,6 +177,7 @@ void curl_internal::do_work() {
   } else {
     LOG_ERROR("curl request failed: {}", curl_easy_strerror(res));
   }
+  return http_status_code;
 }
 }  // namespace priv
 
@@ -182,6 +206,39 @@ struct curl_data {
   float interval;
 };
 
+bool curl_url_is_loopback(const std::string &url) {
+  size_t start;
+  if (url.compare(0, 7, "http://") == 0) {
+    start = 7;
+  } else if (url.compare(0, 8, "https://") == 0) {
+    start = 8;
+  } else {
+    return false;
+  }
+
+  std::string authority =
+      url.substr(start, url.find_first_of("/?#", start) - start);
+  if (authority.find('@') != std::string::npos) { return false; }
+
+  std::string host;
+  if (!authority.empty() && authority[0] == '[') {
+    host = authority.substr(1, authority.find(']') - 1);
+  } else {
+    host = authority.substr(0, authority.find(':'));
+  }
+  std::transform(host.begin(), host.end(), host.begin(), ::tolower);
+
+  struct in_addr addr4{};
+  struct in6_addr addr6{};
+  if (inet_pton(AF_INET, host.c_str(), &addr4) == 1) {
+    return (ntohl(addr4.s_addr) >> 24) == 127;
+  }
+  if (inet_pton(AF_INET6, host.c_str(), &addr6) == 1) {
+    return IN6_IS_ADDR_LOOPBACK(&addr6) != 0;
+  }
+  return host == "localhost";
+}
+
 /* prints result data to text buffer, used by $curl */
 void ccurl_process_info(char *p, int p_max_size, const std::string &uri,
                         int interval) {
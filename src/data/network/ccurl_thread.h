@@ -27,6 +27,9 @@
 
 #include <curl/curl.h>
 
+#include <string>
+#include <vector>
+
 #include "../../logging.h"
 #include "../../update-cb.hh"
 
@@ -37,18 +40,25 @@ class curl_internal {
   std::string last_modified;
   std::string etag;
   std::string data;
+  // sent with every request, e.g. "Authorization: Bearer ..."
+  std::vector<std::string> request_headers;
   CURL *curl;
 
   static size_t parse_header_cb(void *ptr, size_t size, size_t nmemb,
                                 void *data);
   static size_t write_cb(void *ptr, size_t size, size_t nmemb, void *data);
 
-  void do_work();
+  // returns the HTTP status, or 0 if the request itself failed
+  long do_work();
 
   // called by do_work() after downloading data from the uri
   // it should populate the result variable
   virtual void process_data() = 0;
 
+  // called for response headers other than Last-Modified and ETag, with the
+  // name lowercased
+  virtual void process_header(const std::string &, const std::string &) {}
+
   explicit curl_internal(const std::string &url);
   virtual ~curl_internal() {
     if (curl) curl_easy_cleanup(curl);
@@ -75,8 +85,16 @@ class curl_callback : public conky::callback<Result, std::string, Keys...>,
  public:
   curl_callback(uint32_t period, const typename Base1::Tuple &tuple)
       : Base1(period, false, tuple), Base2(std::get<0>(tuple)) {}
+
+  conky::cost_class cost() const override {
+    return conky::cost_class::network;
+  }
 };
 
+/* true for an http(s) URL without userinfo whose host is a loopback
+ * address or localhost */
+bool curl_url_is_loopback(const std::string &url);
+
 /* $curl exports begin */
 
 /* runs instance of $curl */
@@ -0,0 +1,428 @@
+/*
+ *
+ * Conky, a system monitor, based on torsmo
+ *
+ * Any original torsmo code is licensed under the BSD license
+ *
+ * All code written since the fork of torsmo is licensed under the GPL
+ *
+ * Please see COPYING for details
+ *
+ * Copyright (c) 2005-2024 Brenden Matthews, Philip Kovacs, et. al.
+ *	(see AUTHORS)
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "github.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+
+#include "../../common.h"
+#include "../../conky.h"
+#include "../../content/text_object.h"
+#include "../../logging.h"
+#include "ccurl_thread.h"
+
+conky::simple_config_setting<std::string> github_notifications_url(
+    "github_notifications_url", "https://api.github.com/notifications", false);
+
+namespace {
+/* poll interval until the server sends X-Poll-Interval, in seconds */
+constexpr double kDefaultPollInterval = 60;
+/* longest wait between attempts after repeated failures, in seconds */
+constexpr double kMaxBackoff = 3600;
+}  // namespace
+
+#define NEW_TOKEN                       \
+  "https://github.com/settings/tokens/" \
+  "new?scopes=notifications&description=conky-query-github\n"
+
+bool github_url_allowed(const std::string &url) {
+  return url.compare(0, 8, "https://") == 0 || curl_url_is_loopback(url);
+}
+
+std::string github_authorization_header(const std::string &token) {
+  return "Authorization: Bearer " + token;
+}
+
+namespace {
+/* A strict reader for the JSON grammar (RFC 8259). Values are validated
+ * and skipped unless the caller asks for them through the member and
+ * element callbacks, so nothing but the wanted fields is ever stored. */
+class json_reader {
+  const char *cur;
+  const char *const end;
+  int depth = 0;
+
+  static constexpr int max_depth = 64;
+
+  void skip_ws() {
+    while (cur < end &&
+           (*cur == ' ' || *cur == '\t' || *cur == '\n' || *cur == '\r')) {
+      ++cur;
+    }
+  }
+
+  bool literal(const char *word) {
+    size_t len = strlen(word);
+    if (static_cast<size_t>(end - cur) < len || strncmp(cur, word, len) != 0) {
+      return false;
+    }
+    cur += len;
+    return true;
+  }
+
+  bool digits() {
+    const char *start = cur;
+    while (cur < end && isdigit(static_cast<unsigned char>(*cur))) { ++cur; }
+    return cur > start;
+  }
+
+  bool number() {
+    if (cur < end && *cur == '-') { ++cur; }
+    if (cur < end && *cur == '0') {
+      ++cur;
+    } else if (!digits()) {
+      return false;
+    }
+    if (cur < end && *cur == '.') {
+      ++cur;
+      if (!digits()) { return false; }
+    }
+    if (cur < end && (*cur == 'e' || *cur == 'E')) {
+      ++cur;
+      if (cur < end && (*cur == '+' || *cur == '-')) { ++cur; }
+      if (!digits()) { return false; }
+    }
+    return true;
+  }
+
+  bool hex4(unsigned int *cp) {
+    if (end - cur < 4) { return false; }
+    *cp = 0;
+    for (int i = 0; i < 4; ++i, ++cur) {
+      char c = *cur;
+      unsigned int v;
+      if (c >= '0' && c <= '9') {
+        v = c - '0';
+      } else if (c >= 'a' && c <= 'f') {
+        v = c - 'a' + 10;
+      } else if (c >= 'A' && c <= 'F') {
+        v = c - 'A' + 10;
+      } else {
+        return false;
+      }
+      *cp = *cp << 4 | v;
+    }
+    return true;
+  }
+
+  static void append_utf8(std::string *out, unsigned int cp) {
+    if (cp < 0x80) {
+      out->push_back(cp);
+    } else if (cp < 0x800) {
+      out->push_back(0xc0 | cp >> 6);
+      out->push_back(0x80 | (cp & 0x3f));
+    } else if (cp < 0x10000) {
+      out->push_back(0xe0 | cp >> 12);
+      out->push_back(0x80 | (cp >> 6 & 0x3f));
+      out->push_back(0x80 | (cp & 0x3f));
+    } else {
+      out->push_back(0xf0 | cp >> 18);
+      out->push_back(0x80 | (cp >> 12 & 0x3f));
+      out->push_back(0x80 | (cp >> 6 & 0x3f));
+      out->push_back(0x80 | (cp & 0x3f));
+    }
+  }
+
+ public:
+  explicit json_reader(const std::string &json)
+      : cur(json.data()), end(json.data() + json.size()) {}
+
+  char peek() {
+    skip_ws();
+    return cur < end ? *cur : 0;
+  }
+
+  bool at_end() {
+    skip_ws();
+    return cur == end;
+  }
+
+  bool string(std::string *out) {
+    if (peek() != '"') { return false; }
+    ++cur;
+    while (cur < end && *cur != '"') {
+      char c = *cur++;
+      if (static_cast<unsigned char>(c) < 0x20) { return false; }
+      if (c == '\\') {
+        if (cur == end) { return false; }
+        switch (*cur++) {
+          case '"':
+          case '\\':
+          case '/':
+            c = cur[-1];
+            break;
+          case 'b':
+            c = '\b';
+            break;
+          case 'f':
+            c = '\f';
+            break;
+          case 'n':
+            c = '\n';
+            break;
+          case 'r':
+            c = '\r';
+            break;
+          case 't':
+            c = '\t';
+            break;
+          case 'u': {
+            unsigned int cp, low;
+            if (!hex4(&cp)) { return false; }
+            if (cp >= 0xd800 && cp < 0xdc00) {
+              if (!literal("\\u") || !hex4(&low) || low < 0xdc00 ||
+                  low > 0xdfff) {
+                return false;
+              }
+              cp = 0x10000 + ((cp - 0xd800) << 10) + (low - 0xdc00);
+            }
+            if (out != nullptr) { append_utf8(out, cp); }
+            continue;
+          }
+          default:
+            return false;
+        }
+      }
+      if (out != nullptr) { out->push_back(c); }
+    }
+    if (cur == end) { return false; }
+    ++cur;
+    return true;
+  }
+
+  /* parses any value, storing a boolean in b and a string in s if given */
+  bool value(bool *b = nullptr, std::string *s = nullptr) {
+    switch (peek()) {
+      case '{':
+        return object([this](const std::string &) { return value(); });
+      case '[':
+        return array([this]() { return value(); });
+      case '"':
+        return string(s);
+      case 't':
+        if (!literal("true")) { return false; }
+        if (b != nullptr) { *b = true; }
+        return true;
+      case 'f':
+        if (!literal("false")) { return false; }
+        if (b != nullptr) { *b = false; }
+        return true;
+      case 'n':
+        return literal("null");
+      default:
+        return number();
+    }
+  }
+
+  /* member(key) must consume the value of each member */
+  template <typename Member>
+  bool object(Member member) {
+    if (peek() != '{' || ++depth > max_depth) { return false; }
+    ++cur;
+    if (peek() == '}') {
+      ++cur;
+      --depth;
+      return true;
+    }
+    for (;;) {
+      std::string key;
+      if (!string(&key) || peek() != ':') { return false; }
+      ++cur;
+      if (!member(key)) { return false; }
+      char c = peek();
+      if (c != ',' && c != '}') { return false; }
+      ++cur;
+      if (c == '}') { break; }
+    }
+    --depth;
+    return true;
+  }
+
+  /* element() must consume each element */
+  template <typename Element>
+  bool array(Element element) {
+    if (peek() != '[' || ++depth > max_depth) { return false; }
+    ++cur;
+    if (peek() == ']') {
+      ++cur;
+      --depth;
+      return true;
+    }
+    for (;;) {
+      if (!element()) { return false; }
+      char c = peek();
+      if (c != ',' && c != ']') { return false; }
+      ++cur;
+      if (c == ']') { break; }
+    }
+    --depth;
+    return true;
+  }
+};
+}  // namespace
+
+bool github_parse_notifications(const std::string &json, size_t *unread,
+                                std::string *message) {
+  json_reader reader(json);
+  bool ok;
+
+  *unread = 0;
+  message->clear();
+  if (reader.peek() == '[') {
+    ok = reader.array([&]() {
+      bool is_unread = false;
+      if (reader.peek() != '{') { return reader.value(); }
+      if (!reader.object([&](const std::string &key) {
+            return reader.value(key == "unread" ? &is_unread : nullptr);
+          })) {
+        return false;
+      }
+      if (is_unread) { ++*unread; }
+      return true;
+    });
+  } else {
+    ok = reader.object([&](const std::string &key) {
+      return reader.value(nullptr, key == "message" ? message : nullptr);
+    });
+  }
+  return ok && reader.at_end();
+}
+
+namespace {
+/* Polls the notifications endpoint no more often than the server asks for
+ * with X-Poll-Interval. Conditional requests answered with 304 don't count
+ * against the rate limit. Failures back off exponentially up to an hour,
+ * keeping the last known count on display. */
+class github_cb : public curl_callback<std::string, std::string> {
+  typedef curl_callback<std::string, std::string> Base;
+
+  double next_poll = 0;
+  double poll_interval = kDefaultPollInterval;
+  unsigned int failures = 0;
+
+  void report_error(long status) {
+    size_t unread;
+    std::string message;
+
+    if (status == 0 || !github_parse_notifications(data, &unread, &message) ||
+        message.empty()) {
+      return;
+    }
+    if (status == 401 || message.find("scope") != std::string::npos) {
+      LOG_ERROR("github: {}, generate a new token at {}", message, NEW_TOKEN);
+      std::lock_guard<std::mutex> lock(result_mutex);
+      result = "GitHub: " + message + ", generate a new token.";
+    } else {
+      LOG_ERROR("github: {}", message);
+    }
+  }
+
+ protected:
+  void work() override {
+    if (get_time() < next_poll) { return; }
+
+    long status = do_work();
+    double wait = poll_interval;
+    if (status == 200 || status == 304) {
+      failures = 0;
+    } else {
+      report_error(status);
+      wait = std::min(std::ldexp(poll_interval, std::min(failures, 16U)),
+                      kMaxBackoff);
+      ++failures;
+    }
+    next_poll = get_time() + wait;
+  }
+
+  void process_data() override {
+    size_t unread;
+    std::string message;
+
+    if (!github_parse_notifications(data, &unread, &message)) {
+      LOG_ERROR("github: malformed reply from {}", get<0>());
+      return;
+    }
+    std::lock_guard<std::mutex> lock(result_mutex);
+    result = message.empty() ? std::to_string(unread) : "GitHub: " + message;
+  }
+
+  void process_header(const std::string &name,
+                      const std::string &value) override {
+    if (name == "x-poll-interval") {
+      double interval = strtod(value.c_str(), nullptr);
+      if (interval > 0) { poll_interval = interval; }
+    }
+  }
+
+ public:
+  github_cb(uint32_t period, const std::string &url, const std::string &token)
+      : Base(period, Tuple(url, token)) {
+    request_headers.push_back(github_authorization_header(token));
+    request_headers.push_back("Accept: application/vnd.github+json");
+    curl_easy_setopt(curl, CURLOPT_USERAGENT, "conky-github/1.0");
+  }
+};
+}  // namespace
+
+void print_github(struct text_object *obj, char *p, unsigned int p_max_size) {
+  (void)obj;
+  std::string token = github_token.get(*state);
+
+  if (token.empty()) {
+    LOG_ERROR(
+        "${{github_notifications}} requires a token, generate one at {} and "
+        "add github_token='TOKEN' to conky.config",
+        NEW_TOKEN);
+    snprintf(p, p_max_size, "%s",
+             "GitHub notifications requires token, generate a new one.");
+    return;
+  }
+
+  std::string url = github_notifications_url.get(*state);
+  if (!github_url_allowed(url)) {
+    LOG_ERROR(
+        "github_notifications_url '{}' isn't https, refusing to send the "
+        "token to it",
+        url);
+    snprintf(p, p_max_size, "%s",
+             "GitHub notifications URL must use https.");
+    return;
+  }
+
+  /* github_cb decides when to actually poll, so wake it about once a
+   * second */
+  uint32_t period = std::max(lround(1 / active_update_interval()), 1l);
+  auto cb = conky::register_cb<github_cb>(period, url, token);
+
+  snprintf(p, p_max_size, "%s", cb->get_result_copy().c_str());
+}
@@ -0,0 +1,60 @@
+/*
+ *
+ * Conky, a system monitor, based on torsmo
+ *
+ * Any original torsmo code is licensed under the BSD license
+ *
+ * All code written since the fork of torsmo is licensed under the GPL
+ *
+ * Please see COPYING for details
+ *
+ * Copyright (c) 2005-2024 Brenden Matthews, Philip Kovacs, et. al.
+ *	(see AUTHORS)
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef _GITHUB_H
+#define _GITHUB_H
+
+#include <cstddef>
+#include <string>
+
+#include "../../lua/setting.hh"
+
+struct text_object;
+
+/* endpoint the token is sent to */
+extern conky::simple_config_setting<std::string> github_notifications_url;
+
+/* true for https URLs, and for plain http ones only on a loopback host */
+bool github_url_allowed(const std::string &url);
+std::string github_authorization_header(const std::string &token);
+
+/**
+ * @brief Parses a reply of the notifications endpoint: an array of threads
+ *        on success, or an object carrying a "message" on error.
+ *
+ * @param json response body.
+ * @param unread set to the number of threads marked unread.
+ * @param message set to the error message, empty if there is none.
+ * @return `false` if `json` is not a valid JSON document.
+ */
+bool github_parse_notifications(const std::string &json, size_t *unread,
+                                std::string *message);
+
+void print_github(struct text_object *, char *, unsigned int);
+
+#endif /* _GITHUB_H */
@@ -22,30 +22,63 @@
  *
  */
 
+#include "irc.h"
 #include <libircclient.h>
 #include <pthread.h>
 #include <stdlib.h>
 #include <string.h>
+#include <algorithm>
+#include <atomic>
 #include "../../conky.h"
 #include "../../content/text_object.h"
 #include "../../logging.h"
 
-struct ll_text {
-  char *text;
-  struct ll_text *next;
+struct ctx {
+  char *chan;
+  int max_msg_lines;
+  irc_backlog *messages;
 };
 
 struct obj_irc {
   pthread_t *thread;
-  irc_session_t *session;
+  /* published by the client thread once the backlog is set up */
+  std::atomic<irc_session_t *> session{nullptr};
   char *arg;
+  struct ctx *ctxptr;
 };
 
-struct ctx {
-  char *chan;
-  int max_msg_lines;
-  struct ll_text *messages;
-};
+irc_backlog::irc_backlog(size_t capacity)
+    : lines(capacity > 0 ? capacity : 1) {}
+
+void irc_backlog::push(const char *nick, const char *text) {
+  std::lock_guard<std::mutex> lock(mutex);
+  auto &slot = lines[head % lines.size()];
+
+  snprintf(slot.data(), slot.size(), "%s: %s", nick, text);
+  head++;
+  if (count < lines.size()) { count++; }
+}
+
+size_t irc_backlog::render(char *p, unsigned int p_max_size, bool consume) {
+  std::lock_guard<std::mutex> lock(mutex);
+  size_t written = 0;
+  size_t len = 0;
+
+  if (p_max_size == 0) { return 0; }
+  for (size_t i = head - count; i != head && len + 1 < p_max_size; i++) {
+    const auto &slot = lines[i % lines.size()];
+    size_t n = strnlen(slot.data(), slot.size());
+
+    if (written > 0) { p[len++] = '\n'; }
+    n = std::min(n, static_cast<size_t>(p_max_size) - len - 1);
+    memcpy(p + len, slot.data(), n);
+    len += n;
+    written++;
+  }
+  p[len] = 0;
+  if (consume) { count = 0; }
+  return written;
+}
 
 void ev_connected(irc_session_t *session, const char *, const char *,
                   const char **, unsigned int) {
@@ -55,50 +88,13 @@ void ev_connected(irc_session_t *session, const char *, const char *,
   }
 }
 
-void addmessage(struct ctx *ctxptr, char *nick, const char *text) {
-  struct ll_text *lastmsg = ctxptr->messages;
-  struct ll_text *newmsg = (struct ll_text *)malloc(sizeof(struct ll_text));
-  newmsg->text = (char *)malloc(strlen(nick) + strlen(text) + 4);  // 4 = ": \n"
-  snprintf(newmsg->text, strlen(nick) + strlen(text) + 4, "%s: %s\n", nick,
-           text);
-  newmsg->next = nullptr;
-  int msgcnt = 1;
-  if (!lastmsg) {
-    ctxptr->messages = newmsg;
-  } else {
-    msgcnt++;
-    while (lastmsg->next) {
-      lastmsg = lastmsg->next;
-      msgcnt++;
-      if (msgcnt < 0) {
-        LOG_WARNING("irc: too many messages, discarding the last one");
-        free(newmsg->text);
-        free(newmsg);
-        return;
-      }
-    }
-    lastmsg->next = newmsg;
-  }
-  if (ctxptr->max_msg_lines > 0) {
-    newmsg = ctxptr->messages;
-    msgcnt -= ctxptr->max_msg_lines;
-    while ((msgcnt > 0) && (ctxptr->messages)) {
-      msgcnt--;
-      newmsg = ctxptr->messages->next;
-      free(ctxptr->messages->text);
-      free(ctxptr->messages);
-      ctxptr->messages = newmsg;
-    }
-  }
-}
-
 void ev_talkinchan(irc_session_t *session, const char *, const char *origin,
                    const char **params, unsigned int) {
   char nickname[64];
   struct ctx *ctxptr = (struct ctx *)irc_get_ctx(session);
 
   irc_target_get_nick(origin, nickname, sizeof(nickname));
-  addmessage(ctxptr, nickname, params[1]);
+  ctxptr->messages->push(nickname, params[1]);
 }
 
 void ev_num(irc_session_t *session, unsigned int event, const char *,
@@ -127,7 +123,7 @@ void ev_num(irc_session_t *session, unsigned int event, const char *,
 
 void *ircclient(void *ptr) {
   struct obj_irc *ircobj = (struct obj_irc *)ptr;
-  struct ctx *ctxptr = (struct ctx *)malloc(sizeof(struct ctx));
+  struct ctx *ctxptr = ircobj->ctxptr;
   irc_callbacks_t callbacks;
   char *server;
   char *strport;
@@ -138,16 +134,21 @@ void *ircclient(void *ptr) {
   callbacks.event_connect = ev_connected;
   callbacks.event_channel = ev_talkinchan;
   callbacks.event_numeric = ev_num;
-  ircobj->session = irc_create_session(&callbacks);
+  irc_session_t *session = irc_create_session(&callbacks);
   server = strtok(ircobj->arg, " ");
   ctxptr->chan = strtok(nullptr, " ");
   if (!ctxptr->chan) { LOG_ERROR("irc: {}", IRCSYNTAX); }
   str_max_msg_lines = strtok(nullptr, " ");
   if (str_max_msg_lines) {
     ctxptr->max_msg_lines = strtol(str_max_msg_lines, nullptr, 10);
+    if (ctxptr->max_msg_lines < 0) { ctxptr->max_msg_lines = 0; }
   }
-  ctxptr->messages = nullptr;
-  irc_set_ctx(ircobj->session, ctxptr);
+  ctxptr->messages = new irc_backlog(ctxptr->max_msg_lines > 0
+                                         ? ctxptr->max_msg_lines
+                                         : IRC_DEFAULT_BACKLOG);
+  /* the backlog must exist before print_irc() can see the session */
+  irc_set_ctx(session, ctxptr);
+  ircobj->session = session;
   server = strtok(server, ":");
   strport = strtok(nullptr, ":");
   if (strport) {
@@ -156,82 +157,61 @@ void *ircclient(void *ptr) {
   } else {
     port = IRCPORT;
   }
-  int err = irc_connect(ircobj->session, server, port, IRCSERVERPASS, IRCNICK,
+  int err = irc_connect(session, server, port, IRCSERVERPASS, IRCNICK,
                         IRCUSER, IRCREAL);
-  if (err != 0) { err = irc_errno(ircobj->session); }
+  if (err != 0) { err = irc_errno(session); }
 #ifdef BUILD_IPV6
   if (err == LIBIRC_ERR_RESOLV) {
-    err = irc_connect6(ircobj->session, server, port, IRCSERVERPASS, IRCNICK,
-                       IRCUSER, IRCREAL);
-    if (err != 0) { err = irc_errno(ircobj->session); }
+    err = irc_connect6(session, server, port, IRCSERVERPASS, IRCNICK, IRCUSER,
+                       IRCREAL);
+    if (err != 0) { err = irc_errno(session); }
   }
 #endif /* BUILD_IPV6 */
   if (err != 0) { LOG_ERROR("irc: {}", irc_strerror(err)); }
-  if (irc_run(ircobj->session) != 0) {
-    int ircerror = irc_errno(ircobj->session);
-    if (irc_is_connected(ircobj->session)) {
+  if (irc_run(session) != 0) {
+    int ircerror = irc_errno(session);
+    if (irc_is_connected(session)) {
       LOG_ERROR("irc: {}", irc_strerror(ircerror));
     } else {
       LOG_WARNING("irc: disconnected");
     }
   }
-  free(ircobj->arg);
-  free(ctxptr);
   return nullptr;
 }
 
 void parse_irc_args(struct text_object *obj, const char *arg) {
-  struct obj_irc *opaque = (struct obj_irc *)malloc(sizeof(struct obj_irc));
+  struct obj_irc *opaque = new obj_irc;
   opaque->thread = (pthread_t *)malloc(sizeof(pthread_t));
   srand(time(nullptr));
-  opaque->session = nullptr;
   opaque->arg = strdup(arg);
+  opaque->ctxptr = (struct ctx *)calloc(1, sizeof(struct ctx));
   pthread_create(opaque->thread, nullptr, ircclient, opaque);
   obj->data.opaque = opaque;
 }
 
 void print_irc(struct text_object *obj, char *p, unsigned int p_max_size) {
   struct obj_irc *ircobj = (struct obj_irc *)obj->data.opaque;
-  struct ctx *ctxptr;
-  struct ll_text *nextmsg, *curmsg;
-
-  if (!ircobj->session) return;
-  if (!irc_is_connected(ircobj->session)) return;
-  ctxptr = (struct ctx *)irc_get_ctx(ircobj->session);
-  curmsg = ctxptr->messages;
-  while (curmsg) {
-    nextmsg = curmsg->next;
-    strncat(p, curmsg->text, p_max_size - strlen(p) - 1);
-    if (!ctxptr->max_msg_lines) {
-      free(curmsg->text);
-      free(curmsg);
-    }
-    curmsg = nextmsg;
-  }
-  if (p[0] != 0) { p[strlen(p) - 1] = 0; }
-  if (!ctxptr->max_msg_lines) { ctxptr->messages = nullptr; }
+  struct ctx *ctxptr = ircobj->ctxptr;
+  irc_session_t *session = ircobj->session;
+
+  if (!session) return;
+  if (!irc_is_connected(session)) return;
+  /* without max_msg_lines every message is shown once */
+  ctxptr->messages->render(p, p_max_size, ctxptr->max_msg_lines == 0);
 }
 
 void free_irc(struct text_object *obj) {
   struct obj_irc *ircobj = (struct obj_irc *)obj->data.opaque;
-  struct ctx *ctxptr;
-  struct ll_text *nextmsg, *curmsg = nullptr;
-
-  if (ircobj->session) {
-    if (irc_is_connected(ircobj->session)) {
-      ctxptr = (struct ctx *)irc_get_ctx(ircobj->session);
-      curmsg = ctxptr->messages;
-      irc_disconnect(ircobj->session);
-    }
-    pthread_join(*(ircobj->thread), nullptr);
-    irc_destroy_session(ircobj->session);
-  }
+  irc_session_t *session = ircobj->session;
+
+  /* closing the socket makes irc_run() return in the client thread */
+  if (session) { irc_disconnect(session); }
+  pthread_join(*(ircobj->thread), nullptr);
+  if (session) { irc_destroy_session(session); }
+  delete ircobj->ctxptr->messages;
+  free(ircobj->ctxptr);
+  free(ircobj->arg);
   free(ircobj->thread);
-  free(obj->data.opaque);
-  while (curmsg) {
-    nextmsg = curmsg->next;
-    free(curmsg->text);
-    free(curmsg);
-    curmsg = nextmsg;
-  }
+  delete ircobj;
+  obj->data.opaque = nullptr;
 }
@@ -25,6 +25,36 @@
 #ifndef IRC_H_
 #define IRC_H_
 
+#include <array>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+/* nick (up to 63 chars) + ": " + an RFC 1459 message body (510 chars) */
+#define IRC_LINE_SIZE 576
+/* lines kept between two updates when max_msg_lines is not given */
+#define IRC_DEFAULT_BACKLOG 64
+
+/* Fixed-capacity history of preformatted "nick: text" lines. The
+ * libircclient thread is the only producer, print_irc() the only consumer.
+ * Appending never allocates and overwrites the oldest line once full;
+ * rendering copies the held lines out in order in a single pass. */
+class irc_backlog {
+ public:
+  explicit irc_backlog(size_t capacity);
+
+  void push(const char *nick, const char *text);
+  /* writes the held lines to p separated by newlines, dropping them
+   * afterwards if consume is set; returns the number of lines written */
+  size_t render(char *p, unsigned int p_max_size, bool consume);
+
+ private:
+  std::mutex mutex;
+  std::vector<std::array<char, IRC_LINE_SIZE>> lines;
+  size_t head = 0;  /* total number of lines ever pushed */
+  size_t count = 0; /* lines currently held, at most lines.size() */
+};
+
 void parse_irc_args(struct text_object *, const char *);
 void print_irc(struct text_object *, char *, unsigned int);
 void free_irc(struct text_object *);
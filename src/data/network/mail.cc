@@ -164,6 +164,10 @@ class mail_cb
   ~mail_cb() override {
     if (ai != nullptr) { freeaddrinfo(ai); }
   }
+
+  conky::cost_class cost() const override {
+    return conky::cost_class::network;
+  }
 };
 
 struct mail_param_ex : public mail_cb::Tuple {
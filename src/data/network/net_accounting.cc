@@ -0,0 +1,295 @@
+/*
+ *
+ * Conky, a system monitor, based on torsmo
+ *
+ * Any original torsmo code is licensed under the BSD license
+ *
+ * All code written since the fork of torsmo is licensed under the GPL
+ *
+ * Please see COPYING for details
+ *
+ * Copyright (c) 2005-2024 Brenden Matthews, Philip Kovacs, et. al.
+ *	(see AUTHORS)
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "net_accounting.h"
+
+#include <unistd.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <map>
+#include <system_error>
+
+#include "../../common.h"
+#include "config.h"
+#include "../../conky.h"
+#include "../../content/text_object.h"
+#include "../../logging.h"
+#include "net_stat.h"
+
+static conky::simple_config_setting<std::string> net_accounting_file(
+    "net_accounting_file", std::string(), true);
+
+/* how many buckets of each period are kept, i.e. two days of hours, two
+ * months of days and two years of months */
+static const size_t net_period_keep[NET_PERIODS] = {48, 62, 24};
+static const char net_period_tag[] = "hdm";
+
+struct net_bucket {
+  time_t start;
+  unsigned long long rx, tx;
+};
+
+struct net_account {
+  std::deque<net_bucket> buckets[NET_PERIODS];
+  /* net_stat totals at the previous update */
+  long long last_recv = 0, last_trans = 0;
+  bool primed = false;
+};
+
+struct net_total_data {
+  std::string dev;
+  net_period period;
+  bool rx, tx;
+};
+
+static std::map<std::string, net_account> accounts;
+/* number of ${net_total_*} objects; nothing is accounted without them */
+static int account_users = 0;
+static bool accounts_loaded = false;
+static bool accounts_dirty = false;
+/* start of the hour, day and month containing the current update, only
+ * moved on by update_net_accounting() */
+static time_t period_start[NET_PERIODS];
+static time_t next_hour = 0;
+
+static void compute_period_starts(time_t now) {
+  struct tm tm{};
+
+  localtime_r(&now, &tm);
+  tm.tm_min = tm.tm_sec = 0;
+  tm.tm_isdst = -1;
+  period_start[NET_PERIOD_HOUR] = mktime(&tm);
+
+  struct tm next = tm;
+  next.tm_hour++;
+  next.tm_isdst = -1;
+  next_hour = mktime(&next);
+
+  tm.tm_hour = 0;
+  tm.tm_isdst = -1;
+  period_start[NET_PERIOD_DAY] = mktime(&tm);
+
+  tm.tm_mday = 1;
+  tm.tm_isdst = -1;
+  period_start[NET_PERIOD_MONTH] = mktime(&tm);
+}
+
+static std::string net_accounting_path() {
+  std::string path = net_accounting_file.get(*state);
+  if (!path.empty()) { return to_real_path(path).string(); }
+
+  const char *xdg = getenv("XDG_STATE_HOME");
+  if (xdg != nullptr && *xdg != '\0') {
+    return std::string(xdg) + "/conky/net_accounting";
+  }
+  return to_real_path("~/.local/state/conky/net_accounting").string();
+}
+
+bool load_net_accounting(const std::string &path) {
+  FILE *fp = fopen(path.c_str(), "re");
+  if (fp == nullptr) { return false; }
+
+  char line[256];
+  char dev[64];
+  char tag;
+  long long start;
+  unsigned long long rx, tx;
+
+  while (fgets(line, sizeof(line), fp) != nullptr) {
+    if (line[0] == '#') { continue; }
+    if (sscanf(line, "%63s %c %lld %llu %llu", dev, &tag, &start, &rx, &tx) !=
+        5) {
+      continue;
+    }
+    const char *p = strchr(net_period_tag, tag);
+    if (p == nullptr || tag == '\0') { continue; }
+    auto &buckets = accounts[dev].buckets[p - net_period_tag];
+    buckets.push_back(net_bucket{static_cast<time_t>(start), rx, tx});
+    if (buckets.size() > net_period_keep[p - net_period_tag]) {
+      buckets.pop_front();
+    }
+  }
+  fclose(fp);
+  return true;
+}
+
+bool save_net_accounting(const std::string &path) {
+  std::error_code ec;
+  std::filesystem::create_directories(std::filesystem::path(path).parent_path(),
+                                      ec);
+
+  /* write a sibling file and rename it over, so a crash can't leave a
+   * truncated state file behind */
+  std::string tmp = path + ".tmp";
+  FILE *fp = fopen(tmp.c_str(), "we");
+  if (fp == nullptr) {
+    LOG_WARNING("can't write net accounting to '{}': {}", tmp,
+                strerror(errno));
+    return false;
+  }
+  fprintf(fp, "# conky net accounting: dev period start rx tx\n");
+  for (const auto &[dev, account] : accounts) {
+    for (int p = 0; p < NET_PERIODS; p++) {
+      for (const auto &b : account.buckets[p]) {
+        fprintf(fp, "%s %c %lld %llu %llu\n", dev.c_str(), net_period_tag[p],
+                static_cast<long long>(b.start), b.rx, b.tx);
+      }
+    }
+  }
+  if (fclose(fp) != 0 || rename(tmp.c_str(), path.c_str()) != 0) {
+    LOG_WARNING("can't write net accounting to '{}': {}", path,
+                strerror(errno));
+    unlink(tmp.c_str());
+    return false;
+  }
+  accounts_dirty = false;
+  return true;
+}
+
+static void add_to_bucket(std::deque<net_bucket> &buckets, net_period period,
+                          unsigned long long rx, unsigned long long tx) {
+  if (buckets.empty() || buckets.back().start != period_start[period]) {
+    buckets.push_back(net_bucket{period_start[period], 0, 0});
+    if (buckets.size() > net_period_keep[period]) { buckets.pop_front(); }
+  }
+  buckets.back().rx += rx;
+  buckets.back().tx += tx;
+}
+
+void update_net_accounting(time_t now) {
+  if (account_users == 0) { return; }
+
+  if (now >= next_hour || now < period_start[NET_PERIOD_HOUR]) {
+    /* persist once an hour, in case conky doesn't get to exit cleanly */
+    if (accounts_dirty) { save_net_accounting(net_accounting_path()); }
+    compute_period_starts(now);
+  }
+
+  for (int i = 0; i < MAX_NET_INTERFACES; i++) {
+    struct net_stat &ns = netstats[i];
+
+    /* the first read of an interface yields its total since boot */
+    if (ns.dev == nullptr || ns.last_read_recv < 0 || ns.last_read_trans < 0) {
+      continue;
+    }
+
+    net_account &account = accounts[ns.dev];
+    if (!account.primed || ns.recv < account.last_recv ||
+        ns.trans < account.last_trans) {
+      /* first update, or the totals were reset: count from here on */
+      account.last_recv = ns.recv;
+      account.last_trans = ns.trans;
+      account.primed = true;
+      continue;
+    }
+
+    unsigned long long rx = ns.recv - account.last_recv;
+    unsigned long long tx = ns.trans - account.last_trans;
+    account.last_recv = ns.recv;
+    account.last_trans = ns.trans;
+    if (rx == 0 && tx == 0) { continue; }
+
+    for (int p = 0; p < NET_PERIODS; p++) {
+      add_to_bucket(account.buckets[p], static_cast<net_period>(p), rx, tx);
+    }
+    accounts_dirty = true;
+  }
+}
+
+void clear_net_accounting() {
+  if (accounts_dirty) { save_net_accounting(net_accounting_path()); }
+  accounts.clear();
+  accounts_loaded = false;
+  accounts_dirty = false;
+  account_users = 0;
+  next_hour = 0;
+  memset(period_start, 0, sizeof(period_start));
+}
+
+unsigned long long net_accounting_total(const std::string &dev,
+                                        net_period period, bool rx, bool tx) {
+  auto it = accounts.find(dev);
+  if (it == accounts.end()) { return 0; }
+
+  const auto &buckets = it->second.buckets[period];
+  if (buckets.empty() || buckets.back().start != period_start[period]) {
+    return 0;
+  }
+  return (rx ? buckets.back().rx : 0) + (tx ? buckets.back().tx : 0);
+}
+
+/**
+ * parses '(net) (rx|tx)'; without a direction both are summed
+ **/
+void parse_net_total_arg(struct text_object *obj, const char *arg,
+                         net_period period) {
+  auto *nt = new net_total_data{DEFAULTNETDEV, period, true, true};
+  char dev[64], dir[8];
+
+  if (arg != nullptr) {
+    int n = sscanf(arg, "%63s %7s", dev, dir);
+    if (n >= 1) { nt->dev = dev; }
+    if (n == 2) {
+      if (strcmp(dir, "rx") == 0) {
+        nt->tx = false;
+      } else if (strcmp(dir, "tx") == 0) {
+        nt->rx = false;
+      } else {
+        LOG_WARNING("net_total: unknown direction '{}', use rx or tx", dir);
+      }
+    }
+  }
+  obj->data.opaque = nt;
+  /* make sure the interface is read even if nothing else shows it */
+  get_net_stat(nt->dev.c_str(), obj, nullptr);
+
+  if (!accounts_loaded) {
+    load_net_accounting(net_accounting_path());
+    accounts_loaded = true;
+  }
+  account_users++;
+}
+
+void print_net_total(struct text_object *obj, char *p,
+                     unsigned int p_max_size) {
+  auto *nt = static_cast<net_total_data *>(obj->data.opaque);
+
+  if (nt == nullptr) { return; }
+  human_readable(net_accounting_total(nt->dev, nt->period, nt->rx, nt->tx), p,
+                 p_max_size);
+}
+
+void free_net_total(struct text_object *obj) {
+  delete static_cast<net_total_data *>(obj->data.opaque);
+  obj->data.opaque = nullptr;
+  if (account_users > 0) { account_users--; }
+}
@@ -0,0 +1,61 @@
+/*
+ *
+ * Conky, a system monitor, based on torsmo
+ *
+ * Any original torsmo code is licensed under the BSD license
+ *
+ * All code written since the fork of torsmo is licensed under the GPL
+ *
+ * Please see COPYING for details
+ *
+ * Copyright (c) 2005-2024 Brenden Matthews, Philip Kovacs, et. al.
+ *	(see AUTHORS)
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef _NET_ACCOUNTING_H
+#define _NET_ACCOUNTING_H
+
+#include <ctime>
+#include <string>
+
+struct text_object;
+
+enum net_period {
+  NET_PERIOD_HOUR,
+  NET_PERIOD_DAY,
+  NET_PERIOD_MONTH,
+  NET_PERIODS
+};
+
+void parse_net_total_arg(struct text_object *, const char *, net_period);
+void print_net_total(struct text_object *, char *, unsigned int);
+void free_net_total(struct text_object *);
+
+/* integrates the traffic counted since the previous update into the
+ * per-interface buckets; called once per update after all callbacks ran */
+void update_net_accounting(time_t now);
+/* saves the buckets and forgets them, e.g. before a config reload */
+void clear_net_accounting(void);
+
+bool load_net_accounting(const std::string &path);
+bool save_net_accounting(const std::string &path);
+/* bytes counted for `dev` in the current period as of the last update, rx +
+ * tx when both are requested */
+unsigned long long net_accounting_total(const std::string &dev,
+                                        net_period period, bool rx, bool tx);
+
+#endif /* _NET_ACCOUNTING_H */
@@ -0,0 +1,371 @@
+/*
+ *
+ * Conky, a system monitor, based on torsmo
+ *
+ * Any original torsmo code is licensed under the BSD license
+ *
+ * All code written since the fork of torsmo is licensed under the GPL
+ *
+ * Please see COPYING for details
+ *
+ * Copyright (c) 2005-2024 Brenden Matthews, Philip Kovacs, et. al.
+ *	(see AUTHORS)
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "net_counters.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string_view>
+#include <vector>
+
+#include "../../common.h"
+#include "../../conky.h"
+#include "../../content/specials.h"
+#include "../../content/text_object.h"
+#include "../../logging.h"
+
+namespace {
+struct counter_group {
+  std::string name;   /* "Tcp", "TcpExt", ... */
+  std::string header; /* the header line as last seen */
+  std::vector<std::string> fields;
+  std::vector<long long> values, previous;
+  bool have_previous = false;
+};
+
+struct counter_file {
+  explicit counter_file(const char *file_) : file(file_) {}
+
+  const char *file;
+  int fd = -1;
+  std::vector<char> buf;
+};
+
+struct net_counter_data {
+  std::string group;
+  std::string field;
+  bool total = false;
+  /* indices into groups, valid as long as the layout generation matches */
+  unsigned int generation = 0;
+  size_t group_index = 0;
+  size_t field_index = 0;
+};
+
+counter_file snmp("net/snmp");
+counter_file netstat("net/netstat");
+int conntrack_count_fd = -1, conntrack_max_fd = -1;
+std::string opened_root;
+
+/* the groups of both files in the order they appear */
+std::vector<counter_group> groups;
+/* bumped whenever a group or field moves */
+unsigned int layout_generation = 1;
+
+unsigned long long conntrack_count = 0, conntrack_max = 0;
+bool have_conntrack = false;
+double last_sample = 0;
+double interval = 0;
+double last_tick = -1;
+}  // namespace
+
+static std::string_view next_line(const char *&p, const char *end) {
+  const char *eol = static_cast<const char *>(memchr(p, '\n', end - p));
+  if (eol == nullptr) { eol = end; }
+  std::string_view line(p, eol - p);
+  p = eol < end ? eol + 1 : end;
+  return line;
+}
+
+static counter_group &find_group(std::string_view name, size_t &hint) {
+  if (hint < groups.size() && groups[hint].name == name) {
+    return groups[hint++];
+  }
+  for (hint = 0; hint < groups.size(); hint++) {
+    if (groups[hint].name == name) { return groups[hint++]; }
+  }
+  groups.emplace_back();
+  groups.back().name = name;
+  layout_generation++;
+  hint = groups.size();
+  return groups.back();
+}
+
+/* "Tcp: RtoAlgorithm RtoMin ..." followed by "Tcp: 1 200 ..." */
+static void parse_counter_file(counter_file &f, size_t &hint) {
+  ssize_t len = pread_file(f.fd, f.buf, 8192);
+  if (len <= 0) { return; }
+
+  const char *p = f.buf.data(), *end = p + len;
+  while (p < end) {
+    std::string_view header = next_line(p, end);
+    std::string_view values = next_line(p, end);
+    size_t colon = header.find(':');
+
+    if (colon == std::string_view::npos ||
+        values.substr(0, colon + 1) != header.substr(0, colon + 1)) {
+      continue;
+    }
+    counter_group &g = find_group(header.substr(0, colon), hint);
+    header.remove_prefix(colon + 1);
+    if (g.header != header) {
+      g.header = header;
+      g.fields.clear();
+      for (size_t pos = 0; pos < header.size();) {
+        size_t start = header.find_first_not_of(' ', pos);
+        if (start == std::string_view::npos) { break; }
+        size_t stop = header.find(' ', start);
+        if (stop == std::string_view::npos) { stop = header.size(); }
+        g.fields.emplace_back(header.substr(start, stop - start));
+        pos = stop;
+      }
+      g.values.clear();
+      layout_generation++;
+    }
+
+    g.have_previous = g.values.size() == g.fields.size();
+    g.previous.swap(g.values);
+    g.values.assign(g.fields.size(), 0);
+    /* the value line ends in a newline or the terminating NUL */
+    const char *v = values.data() + colon + 1;
+    for (auto &value : g.values) {
+      char *next;
+      value = strtoll(v, &next, 10);
+      if (next == v) { break; }
+      v = next;
+    }
+  }
+}
+
+static void open_counter_files(const std::string &proc_root) {
+  clear_net_counters();
+  opened_root = proc_root;
+  for (counter_file *f : {&snmp, &netstat}) {
+    std::string path = proc_root + "/" + f->file;
+    f->fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (f->fd == -1) {
+      LOG_DEBUG("can't open {}: {}", path, strerror(errno));
+    }
+  }
+  /* only there with nf_conntrack loaded */
+  conntrack_count_fd =
+      open((proc_root + "/sys/net/netfilter/nf_conntrack_count").c_str(),
+           O_RDONLY | O_CLOEXEC);
+  conntrack_max_fd =
+      open((proc_root + "/sys/net/netfilter/nf_conntrack_max").c_str(),
+           O_RDONLY | O_CLOEXEC);
+}
+
+void sample_net_counters(const std::string &proc_root, double now) {
+  size_t hint = 0;
+
+  if (opened_root != proc_root) { open_counter_files(proc_root); }
+  parse_counter_file(snmp, hint);
+  parse_counter_file(netstat, hint);
+
+  have_conntrack = conntrack_count_fd != -1 && conntrack_max_fd != -1 &&
+                   pread_ull(conntrack_count_fd, &conntrack_count) &&
+                   pread_ull(conntrack_max_fd, &conntrack_max);
+
+  interval = last_sample > 0 ? now - last_sample : 0;
+  last_sample = now;
+}
+
+int update_net_counters(void) {
+  if (last_tick == current_update_time) { return 0; }
+  last_tick = current_update_time;
+  sample_net_counters("/proc", get_time());
+  return 0;
+}
+
+void clear_net_counters(void) {
+  for (counter_file *f : {&snmp, &netstat}) {
+    if (f->fd != -1) { close(f->fd); }
+    f->fd = -1;
+    f->buf = std::vector<char>();
+  }
+  if (conntrack_count_fd != -1) { close(conntrack_count_fd); }
+  if (conntrack_max_fd != -1) { close(conntrack_max_fd); }
+  conntrack_count_fd = conntrack_max_fd = -1;
+  opened_root.clear();
+  groups.clear();
+  layout_generation++;
+  have_conntrack = false;
+  last_sample = 0;
+  interval = 0;
+  last_tick = -1;
+}
+
+static bool resolve_counter(net_counter_data &nd) {
+  if (nd.generation == layout_generation) {
+    return nd.group_index < groups.size();
+  }
+  nd.generation = layout_generation;
+  nd.group_index = groups.size();
+  for (size_t g = 0; g < groups.size(); g++) {
+    if (groups[g].name != nd.group) { continue; }
+    for (size_t f = 0; f < groups[g].fields.size(); f++) {
+      if (groups[g].fields[f] == nd.field) {
+        nd.group_index = g;
+        nd.field_index = f;
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+static bool counter_value(net_counter_data &nd, long long *value,
+                          double *rate) {
+  if (!resolve_counter(nd)) { return false; }
+  const counter_group &g = groups[nd.group_index];
+
+  if (value != nullptr) { *value = g.values[nd.field_index]; }
+  if (rate != nullptr) {
+    *rate = 0;
+    if (g.have_previous && interval > 0) {
+      long long delta = g.values[nd.field_index] - g.previous[nd.field_index];
+      *rate = delta > 0 ? delta / interval : 0;
+    }
+  }
+  return true;
+}
+
+bool net_counter(const std::string &group, const std::string &field,
+                 long long *value, double *rate) {
+  net_counter_data nd;
+
+  nd.group = group;
+  nd.field = field;
+  return counter_value(nd, value, rate);
+}
+
+double tcp_retrans_percentage(void) {
+  static net_counter_data retrans{"Tcp", "RetransSegs"},
+      out{"Tcp", "OutSegs"};
+  double retrans_rate, out_rate;
+
+  if (!counter_value(retrans, nullptr, &retrans_rate) ||
+      !counter_value(out, nullptr, &out_rate) || out_rate <= 0) {
+    return 0;
+  }
+  return std::min(100.0, retrans_rate * 100 / out_rate);
+}
+
+bool conntrack_usage(unsigned long long *count, unsigned long long *max) {
+  *count = conntrack_count;
+  *max = conntrack_max;
+  return have_conntrack;
+}
+
+void scan_net_counter_arg(struct text_object *obj, const char *arg) {
+  auto *nd = new net_counter_data;
+  char group[64], field[64], mode[16];
+
+  obj->data.opaque = nd;
+  int n = sscanf(arg, " %63[^: ]:%63s %15s", group, field, mode);
+  if (n < 2) {
+    LOG_ERROR("net_counter needs a counter like Tcp:RetransSegs");
+    return;
+  }
+  nd->group = group;
+  nd->field = field;
+  nd->total = n == 3 && strcmp(mode, "total") == EQUAL;
+}
+
+void print_net_counter(struct text_object *obj, char *p,
+                       unsigned int p_max_size) {
+  auto *nd = static_cast<net_counter_data *>(obj->data.opaque);
+  long long value;
+  double rate;
+
+  if (!counter_value(*nd, &value, &rate)) { return; }
+  if (nd->total) {
+    snprintf(p, p_max_size, "%lld", value);
+  } else {
+    snprintf(p, p_max_size, "%.1f", rate);
+  }
+}
+
+void free_net_counter(struct text_object *obj) {
+  delete static_cast<net_counter_data *>(obj->data.opaque);
+  obj->data.opaque = nullptr;
+}
+
+uint8_t tcp_retrans_perc(struct text_object *obj) {
+  (void)obj;
+  return round_to_positive_int(tcp_retrans_percentage());
+}
+
+void print_conntrack(struct text_object *obj, char *p,
+                     unsigned int p_max_size) {
+  unsigned long long count, max;
+
+  (void)obj;
+  if (conntrack_usage(&count, &max)) { snprintf(p, p_max_size, "%llu", count); }
+}
+
+void print_conntrack_max(struct text_object *obj, char *p,
+                         unsigned int p_max_size) {
+  unsigned long long count, max;
+
+  (void)obj;
+  if (conntrack_usage(&count, &max)) { snprintf(p, p_max_size, "%llu", max); }
+}
+
+double conntrack_barval(struct text_object *obj) {
+  unsigned long long count, max;
+
+  (void)obj;
+  if (!conntrack_usage(&count, &max) || max == 0) { return 0; }
+  return std::min(1.0, static_cast<double>(count) / max);
+}
+
+uint8_t conntrack_percentage(struct text_object *obj) {
+  return round_to_positive_int(conntrack_barval(obj) * 100);
+}
+
+#ifdef BUILD_GUI
+void scan_net_countergraph_arg(struct text_object *obj, const char *arg) {
+  char counter[128];
+  int n = 0;
+
+  scan_net_counter_arg(obj, arg);
+  /* the graph arguments follow the counter, "total" isn't one of them */
+  static_cast<net_counter_data *>(obj->data.opaque)->total = false;
+  if (sscanf(arg, " %127s %n", counter, &n) >= 1) { arg += n; }
+  if (strncmp(arg, "total", 5) == 0 && (arg[5] == ' ' || arg[5] == '\0')) {
+    static_cast<net_counter_data *>(obj->data.opaque)->total = true;
+    arg += 5;
+  }
+  scan_graph(obj, arg, 0, FALSE);
+}
+
+double net_countergraphval(struct text_object *obj) {
+  auto *nd = static_cast<net_counter_data *>(obj->data.opaque);
+  long long value;
+  double rate;
+
+  if (!counter_value(*nd, &value, &rate)) { return 0; }
+  return nd->total ? static_cast<double>(value) : rate;
+}
+#endif /* BUILD_GUI */
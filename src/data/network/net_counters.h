@@ -0,0 +1,71 @@
+/*
+ *
+ * Conky, a system monitor, based on torsmo
+ *
+ * Any original torsmo code is licensed under the BSD license
+ *
+ * All code written since the fork of torsmo is licensed under the GPL
+ *
+ * Please see COPYING for details
+ *
+ * Copyright (c) 2005-2024 Brenden Matthews, Philip Kovacs, et. al.
+ *	(see AUTHORS)
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef _NET_COUNTERS_H
+#define _NET_COUNTERS_H
+
+#include "config.h"
+
+#include <cstdint>
+#include <string>
+
+struct text_object;
+
+/* Protocol counters from /proc/net/snmp and /proc/net/netstat, plus the
+ * conntrack table fill. Both counter files come as pairs of header and value
+ * lines per group; a header is only split into fields again when it
+ * changes. */
+
+int update_net_counters(void);
+/* samples the files below proc_root as of `now` (seconds, monotonic) */
+void sample_net_counters(const std::string &proc_root, double now);
+void clear_net_counters(void);
+
+/* the value of e.g. Tcp:RetransSegs and its change per second over the
+ * last update */
+bool net_counter(const std::string &group, const std::string &field,
+                 long long *value, double *rate);
+/* percentage of the TCP segments sent during the last update that were
+ * retransmissions */
+double tcp_retrans_percentage(void);
+bool conntrack_usage(unsigned long long *count, unsigned long long *max);
+
+void scan_net_counter_arg(struct text_object *, const char *);
+void print_net_counter(struct text_object *, char *, unsigned int);
+void free_net_counter(struct text_object *);
+uint8_t tcp_retrans_perc(struct text_object *);
+void print_conntrack(struct text_object *, char *, unsigned int);
+void print_conntrack_max(struct text_object *, char *, unsigned int);
+uint8_t conntrack_percentage(struct text_object *);
+double conntrack_barval(struct text_object *);
+#ifdef BUILD_GUI
+void scan_net_countergraph_arg(struct text_object *, const char *);
+double net_countergraphval(struct text_object *);
+#endif /* BUILD_GUI */
+
+#endif /* _NET_COUNTERS_H */
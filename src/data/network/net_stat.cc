@@ -34,6 +34,8 @@
 #include <unistd.h>
 #include <cerrno>
 #include <cstring>
+#include <map>
+#include <string>
 #include "../../conky.h"
 #include "../../content/specials.h"
 #include "../../content/text_object.h"
@@ -379,6 +381,57 @@ void parse_net_stat_graph_arg(struct text_object *obj, const char *arg,
   obj->data.opaque = get_net_stat(DEFAULTNETDEV, obj, free_at_crash);
 }
 
+/* rate history per interface, shared by every graph of that interface */
+struct net_history {
+  graph_series recv, trans;
+};
+static std::map<std::string, net_history> net_histories;
+
+static void bind_net_history(struct text_object *obj, bool up) {
+  auto *ns = static_cast<struct net_stat *>(obj->data.opaque);
+
+  if (ns == nullptr || ns->dev == nullptr) { return; }
+  net_history &h = net_histories[ns->dev];
+  bind_graph_series(obj, up ? &h.trans : &h.recv);
+}
+
+void parse_net_stat_downgraph_arg(struct text_object *obj, const char *arg,
+                                  void *free_at_crash) {
+  parse_net_stat_graph_arg(obj, arg, free_at_crash);
+  bind_net_history(obj, false);
+}
+
+void parse_net_stat_upgraph_arg(struct text_object *obj, const char *arg,
+                                void *free_at_crash) {
+  parse_net_stat_graph_arg(obj, arg, free_at_crash);
+  bind_net_history(obj, true);
+}
+
+/**
+ * Appends the speeds of this update to the history of every interface that
+ * is graphed. Called once per update, after all callbacks ran.
+ **/
+void update_net_history() {
+  for (auto &[dev, h] : net_histories) {
+    struct net_stat *ns = nullptr;
+
+    for (auto &candidate : netstats) {
+      if (candidate.dev != nullptr && dev == candidate.dev) {
+        ns = &candidate;
+        break;
+      }
+    }
+    if (ns == nullptr && foo_netstats.dev != nullptr &&
+        dev == foo_netstats.dev) {
+      ns = &foo_netstats;
+    }
+    h.recv.push(ns != nullptr ? ns->recv_speed : 0);
+    h.trans.push(ns != nullptr ? ns->trans_speed : 0);
+  }
+}
+
+void clear_net_history() { net_histories.clear(); }
+
 /**
  * returns the download speed in B/s for the interface referenced by obj
  *
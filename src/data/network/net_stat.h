@@ -104,8 +104,12 @@ void print_v6addrs(struct text_object *, char *, unsigned int);
 #endif /* __linux__ */
 #ifdef BUILD_GUI
 void parse_net_stat_graph_arg(struct text_object *, const char *, void *);
+void parse_net_stat_downgraph_arg(struct text_object *, const char *, void *);
+void parse_net_stat_upgraph_arg(struct text_object *, const char *, void *);
 double downspeedgraphval(struct text_object *);
 double upspeedgraphval(struct text_object *);
+void update_net_history(void);
+void clear_net_history(void);
 #endif /* BUILD_GUI */
 #ifdef BUILD_WLAN
 void print_wireless_essid(struct text_object *, char *, unsigned int);
@@ -0,0 +1,440 @@
+/*
+ *
+ * Conky, a system monitor, based on torsmo
+ *
+ * Any original torsmo code is licensed under the BSD license
+ *
+ * All code written since the fork of torsmo is licensed under the GPL
+ *
+ * Please see COPYING for details
+ *
+ * Copyright (c) 2005-2024 Brenden Matthews, Philip Kovacs, et. al.
+ *	(see AUTHORS)
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "nfs.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string_view>
+#include <vector>
+
+#include "../common.h"
+#include "../conky.h"
+#include "../content/text_object.h"
+#include "../logging.h"
+
+namespace {
+struct op_counters {
+  unsigned long long ops = 0;
+  unsigned long long transmissions = 0;
+  unsigned long long timeouts = 0;
+  unsigned long long rtt = 0;  /* ms */
+  unsigned long long exec = 0; /* ms */
+};
+
+struct nfs_op {
+  std::string name;
+  op_counters total;
+  op_counters delta;
+};
+
+struct xprt_counters {
+  unsigned long long sends = 0;
+  unsigned long long recvs = 0;
+  unsigned long long backlog = 0; /* summed up on every send */
+};
+
+struct nfs_mount {
+  std::string mount;
+  std::vector<nfs_op> ops;
+  xprt_counters total, delta, next;
+  bool have_sample = false;
+  bool seen = false;
+};
+
+struct nfs_data {
+  std::string mount;
+  std::string op;
+  double threshold;
+};
+
+const char *const slow_ops[] = {"READ", "WRITE", "GETATTR"};
+
+std::string stats_path;
+int stats_fd = -1;
+std::vector<char> buf;
+std::vector<nfs_mount> mounts;
+double last_sample = 0;
+double interval = 0;
+double last_tick = -1;
+}  // namespace
+
+static inline unsigned long long counter_delta(unsigned long long now,
+                                               unsigned long long before) {
+  return now >= before ? now - before : 0;
+}
+
+static nfs_mount &find_mount(std::string_view mount) {
+  for (auto &m : mounts) {
+    if (m.mount == mount) { return m; }
+  }
+  mounts.emplace_back();
+  mounts.back().mount = mount;
+  return mounts.back();
+}
+
+/* "xprt:	tcp 875 1 1 0 0 85 85 0 85 0 2 0 0", where udp lacks the connection
+ * fields that tcp and rdma have */
+static void parse_xprt(nfs_mount &m, const char *p) {
+  unsigned long long fields[10] = {};
+  char proto[16];
+  int n = 0;
+
+  if (sscanf(p, "%15s%n", proto, &n) != 1) { return; }
+  p += n;
+  for (auto &field : fields) {
+    char *end;
+    field = strtoull(p, &end, 10);
+    if (end == p) { break; }
+    p = end;
+  }
+  if (strcmp(proto, "udp") == 0) {
+    m.next.sends += fields[2];
+    m.next.recvs += fields[3];
+    m.next.backlog += fields[6];
+  } else {
+    m.next.sends += fields[5];
+    m.next.recvs += fields[6];
+    m.next.backlog += fields[9];
+  }
+}
+
+/* "READ: 1203 1203 0 165572 155223088 39 2386 2476 0": operations,
+ * transmissions, major timeouts, bytes sent and received, then cumulative
+ * queue, rtt and execute times */
+static void parse_op(nfs_mount &m, size_t &hint, std::string_view name,
+                     const char *p) {
+  unsigned long long fields[8] = {};
+
+  for (auto &field : fields) {
+    char *end;
+    field = strtoull(p, &end, 10);
+    if (end == p) { return; }
+    p = end;
+  }
+
+  /* the ops are listed in the same order every time */
+  if (hint >= m.ops.size() || m.ops[hint].name != name) {
+    hint = 0;
+    while (hint < m.ops.size() && m.ops[hint].name != name) { hint++; }
+    if (hint == m.ops.size()) {
+      m.ops.emplace_back();
+      m.ops.back().name = name;
+    }
+  }
+  nfs_op &op = m.ops[hint++];
+  op_counters now;
+  now.ops = fields[0];
+  now.transmissions = fields[1];
+  now.timeouts = fields[2];
+  now.rtt = fields[6];
+  now.exec = fields[7];
+  op.delta = op_counters();
+  if (m.have_sample) {
+    op.delta.ops = counter_delta(now.ops, op.total.ops);
+    op.delta.transmissions =
+        counter_delta(now.transmissions, op.total.transmissions);
+    op.delta.timeouts = counter_delta(now.timeouts, op.total.timeouts);
+    op.delta.rtt = counter_delta(now.rtt, op.total.rtt);
+    op.delta.exec = counter_delta(now.exec, op.total.exec);
+  }
+  op.total = now;
+}
+
+static void finish_mount(nfs_mount *m) {
+  if (m == nullptr) { return; }
+  m->delta = xprt_counters();
+  if (m->have_sample) {
+    m->delta.sends = counter_delta(m->next.sends, m->total.sends);
+    m->delta.recvs = counter_delta(m->next.recvs, m->total.recvs);
+    m->delta.backlog = counter_delta(m->next.backlog, m->total.backlog);
+  }
+  m->total = m->next;
+  m->have_sample = true;
+}
+
+void sample_nfs_stats(const std::string &path, double now) {
+  if (stats_path != path) {
+    clear_nfs_stats();
+    stats_path = path;
+    stats_fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (stats_fd == -1) {
+      LOG_DEBUG("can't open {}: {}", path, strerror(errno));
+    }
+  }
+  if (stats_fd == -1) { return; }
+
+  ssize_t len = pread_file(stats_fd, buf, 65536);
+  if (len < 0) { return; }
+
+  for (auto &m : mounts) { m.seen = false; }
+
+  nfs_mount *current = nullptr;
+  bool in_ops = false;
+  size_t hint = 0;
+  /* lines are terminated in place so they can be handed to strtoull() */
+  if (static_cast<size_t>(len) == buf.size()) { buf.push_back('\0'); }
+  buf[len] = '\0';
+  char *p = buf.data(), *end = p + len;
+  while (p < end) {
+    char *eol = static_cast<char *>(memchr(p, '\n', end - p));
+    if (eol == nullptr) { eol = end; }
+    *eol = '\0';
+    std::string_view line(p, eol - p);
+    p = eol + 1;
+
+    /* "device srv:/export mounted on /mnt with fstype nfs4 statvers=1.1" */
+    if (line.substr(0, 7) == "device ") {
+      finish_mount(current);
+      current = nullptr;
+      in_ops = false;
+      size_t on = line.find(" mounted on ");
+      size_t with = line.rfind(" with fstype ");
+      if (on == std::string_view::npos || with == std::string_view::npos ||
+          with < on) {
+        continue;
+      }
+      std::string_view fstype = line.substr(with + 13);
+      if (fstype.substr(0, 3) != "nfs") { continue; }
+      current = &find_mount(line.substr(on + 12, with - on - 12));
+      current->seen = true;
+      current->next = xprt_counters();
+      hint = 0;
+      continue;
+    }
+    if (current == nullptr) { continue; }
+
+    size_t start = line.find_first_not_of(" \t");
+    if (start == std::string_view::npos) { continue; }
+    line.remove_prefix(start);
+    if (line == "per-op statistics") {
+      in_ops = true;
+      continue;
+    }
+    size_t colon = line.find(':');
+    if (colon == std::string_view::npos) { continue; }
+    const char *rest = line.data() + colon + 1;
+    if (in_ops) {
+      parse_op(*current, hint, line.substr(0, colon), rest);
+    } else if (line.substr(0, colon) == "xprt") {
+      parse_xprt(*current, rest);
+    }
+  }
+  finish_mount(current);
+
+  for (auto it = mounts.begin(); it != mounts.end();) {
+    if (it->seen) {
+      ++it;
+    } else {
+      it = mounts.erase(it);
+    }
+  }
+  interval = last_sample > 0 ? now - last_sample : 0;
+  last_sample = now;
+}
+
+int update_nfs_stats(void) {
+  if (last_tick == current_update_time) { return 0; }
+  last_tick = current_update_time;
+  sample_nfs_stats("/proc/self/mountstats", get_time());
+  return 0;
+}
+
+void clear_nfs_stats(void) {
+  if (stats_fd != -1) { close(stats_fd); }
+  stats_fd = -1;
+  stats_path.clear();
+  buf = std::vector<char>();
+  mounts.clear();
+  last_sample = 0;
+  interval = 0;
+  last_tick = -1;
+}
+
+static const nfs_mount *get_mount(const std::string &mount) {
+  for (const auto &m : mounts) {
+    if (m.mount == mount) { return &m; }
+  }
+  return nullptr;
+}
+
+bool get_nfs_op_stats(const std::string &mount, const std::string &op,
+                      nfs_op_stats *stats) {
+  const nfs_mount *m = get_mount(mount);
+  op_counters sum;
+  bool found = op.empty();
+
+  *stats = nfs_op_stats();
+  if (m == nullptr) { return false; }
+  for (const auto &o : m->ops) {
+    if (!op.empty() && strcasecmp(o.name.c_str(), op.c_str()) != 0) {
+      continue;
+    }
+    sum.ops += o.delta.ops;
+    sum.transmissions += o.delta.transmissions;
+    sum.rtt += o.delta.rtt;
+    sum.exec += o.delta.exec;
+    found = true;
+  }
+  if (sum.ops > 0) {
+    stats->rtt = static_cast<double>(sum.rtt) / sum.ops;
+    stats->exec = static_cast<double>(sum.exec) / sum.ops;
+  }
+  if (interval > 0) {
+    stats->ops = sum.ops / interval;
+    stats->retrans = counter_delta(sum.transmissions, sum.ops) / interval;
+  }
+  return found;
+}
+
+bool get_nfs_backlog(const std::string &mount, double *backlog) {
+  const nfs_mount *m = get_mount(mount);
+
+  *backlog = 0;
+  if (m == nullptr) { return false; }
+  if (m->delta.sends > 0) {
+    *backlog = static_cast<double>(m->delta.backlog) / m->delta.sends;
+  }
+  return true;
+}
+
+bool nfs_unhealthy(const std::string &mount, double threshold_ms) {
+  const nfs_mount *m = get_mount(mount);
+
+  if (m == nullptr) { return false; }
+  if (m->delta.sends > 0 && m->delta.recvs == 0) { return true; }
+  for (const auto &o : m->ops) {
+    if (o.delta.timeouts > 0 || o.delta.transmissions > o.delta.ops) {
+      return true;
+    }
+    for (const char *slow : slow_ops) {
+      if (o.name == slow && o.delta.ops > 0 &&
+          static_cast<double>(o.delta.exec) / o.delta.ops > threshold_ms) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+void scan_nfs_arg(struct text_object *obj, const char *arg) {
+  auto *nd = new nfs_data;
+  char mount[256], op[32];
+
+  nd->threshold = 0;
+  obj->data.opaque = nd;
+  switch (sscanf(arg, "%255s %31s", mount, op)) {
+    case 2:
+      nd->op = op;
+      /* fall through */
+    case 1:
+      nd->mount = mount;
+      break;
+    default:
+      LOG_ERROR("nfs objects need a mount point as argument");
+  }
+}
+
+static const nfs_data *get_nfs_data(struct text_object *obj) {
+  return static_cast<const nfs_data *>(obj->data.opaque);
+}
+
+void print_nfs_ops(struct text_object *obj, char *p, unsigned int p_max_size) {
+  const nfs_data *nd = get_nfs_data(obj);
+  nfs_op_stats stats;
+
+  if (get_nfs_op_stats(nd->mount, nd->op, &stats)) {
+    snprintf(p, p_max_size, "%.1f", stats.ops);
+  }
+}
+
+void print_nfs_rtt(struct text_object *obj, char *p, unsigned int p_max_size) {
+  const nfs_data *nd = get_nfs_data(obj);
+  nfs_op_stats stats;
+
+  if (get_nfs_op_stats(nd->mount, nd->op, &stats)) {
+    snprintf(p, p_max_size, "%.1f", stats.rtt);
+  }
+}
+
+void print_nfs_exec(struct text_object *obj, char *p,
+                    unsigned int p_max_size) {
+  const nfs_data *nd = get_nfs_data(obj);
+  nfs_op_stats stats;
+
+  if (get_nfs_op_stats(nd->mount, nd->op, &stats)) {
+    snprintf(p, p_max_size, "%.1f", stats.exec);
+  }
+}
+
+void print_nfs_retrans(struct text_object *obj, char *p,
+                       unsigned int p_max_size) {
+  const nfs_data *nd = get_nfs_data(obj);
+  nfs_op_stats stats;
+
+  if (get_nfs_op_stats(nd->mount, nd->op, &stats)) {
+    snprintf(p, p_max_size, "%.1f", stats.retrans);
+  }
+}
+
+void print_nfs_backlog(struct text_object *obj, char *p,
+                       unsigned int p_max_size) {
+  double backlog;
+
+  if (get_nfs_backlog(get_nfs_data(obj)->mount, &backlog)) {
+    snprintf(p, p_max_size, "%.2f", backlog);
+  }
+}
+
+void scan_if_nfs_unhealthy_arg(struct text_object *obj, const char *arg) {
+  auto *nd = new nfs_data;
+  char mount[256];
+
+  nd->threshold = 1000;
+  obj->data.opaque = nd;
+  if (sscanf(arg, "%255s %lf", mount, &nd->threshold) >= 1) {
+    nd->mount = mount;
+  } else {
+    LOG_ERROR("if_nfs_unhealthy needs a mount point as argument");
+  }
+}
+
+int check_nfs_unhealthy(struct text_object *obj) {
+  const nfs_data *nd = get_nfs_data(obj);
+
+  return static_cast<int>(nfs_unhealthy(nd->mount, nd->threshold));
+}
+
+void free_nfs(struct text_object *obj) {
+  delete static_cast<nfs_data *>(obj->data.opaque);
+  obj->data.opaque = nullptr;
+}
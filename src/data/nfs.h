@@ -0,0 +1,71 @@
+/*
+ *
+ * Conky, a system monitor, based on torsmo
+ *
+ * Any original torsmo code is licensed under the BSD license
+ *
+ * All code written since the fork of torsmo is licensed under the GPL
+ *
+ * Please see COPYING for details
+ *
+ * Copyright (c) 2005-2024 Brenden Matthews, Philip Kovacs, et. al.
+ *	(see AUTHORS)
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef _NFS_H
+#define _NFS_H
+
+#include <string>
+
+struct text_object;
+
+/* NFS client statistics from /proc/self/mountstats. Nothing here touches the
+ * mounts themselves, so a hung server can't block an update. */
+
+struct nfs_op_stats {
+  double ops;     /* per second */
+  double rtt;     /* average round trip time, ms */
+  double exec;    /* average time from queueing to completion, ms */
+  double retrans; /* retransmissions per second */
+};
+
+int update_nfs_stats(void);
+/* parses `path` as of `now` (seconds, monotonic) */
+void sample_nfs_stats(const std::string &path, double now);
+void clear_nfs_stats(void);
+
+/* stats of the last update for `op` (e.g. READ, GETATTR) on the NFS mount at
+ * `mount`, or all its ops together if `op` is empty */
+bool get_nfs_op_stats(const std::string &mount, const std::string &op,
+                      nfs_op_stats *stats);
+/* average length of the transport's backlog queue over the last update */
+bool get_nfs_backlog(const std::string &mount, double *backlog);
+/* retransmissions, READ/WRITE/GETATTR slower than threshold_ms on average
+ * or requests sent without any replies during the last update */
+bool nfs_unhealthy(const std::string &mount, double threshold_ms);
+
+void scan_nfs_arg(struct text_object *, const char *);
+void print_nfs_ops(struct text_object *, char *, unsigned int);
+void print_nfs_rtt(struct text_object *, char *, unsigned int);
+void print_nfs_exec(struct text_object *, char *, unsigned int);
+void print_nfs_retrans(struct text_object *, char *, unsigned int);
+void print_nfs_backlog(struct text_object *, char *, unsigned int);
+void scan_if_nfs_unhealthy_arg(struct text_object *, const char *);
+int check_nfs_unhealthy(struct text_object *);
+void free_nfs(struct text_object *);
+
+#endif /* _NFS_H */
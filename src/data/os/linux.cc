@@ -37,6 +37,7 @@
 #include "../../conky.h"
 #include "../../content/temphelper.h"
 #include "../../logging.h"
+#include "../hardware/cpufreq.h"
 #include "../hardware/diskio.h"
 #include "../network/net_stat.h"
 #include "../proc.h"
@@ -115,6 +116,12 @@ char interfaces_arr[MAX_NET_INTERFACES][iface_len] = {""};
 
 static conky::simple_config_setting<bool> top_cpu_separate("top_cpu_separate",
                                                            false, true);
+/* how many of the busiest processes top_thread breaks down into threads */
+static conky::range_config_setting<unsigned int> top_thread_processes(
+    "top_thread_processes", 1, MAX_SP, 3, true);
+/* milliseconds per update that top_pss may spend reading smaps_rollup */
+static conky::range_config_setting<double> top_pss_budget("top_pss_budget", 0,
+                                                          1000, 5, true);
 
 /* This flag tells the linux routines to use the /proc system where possible,
  * even if other api's are available, e.g. sysinfo() or getloadavg().
@@ -1585,21 +1592,14 @@ char get_freq(char *p_client_buffer, size_t client_buffer_size,
   }
 
   if (!prefer_proc) {
-    char current_freq_file[128];
-
-    snprintf(current_freq_file, 127, "%s/cpu%d/%s", CPUFREQ_PREFIX, cpu - 1,
-             CPUFREQ_POSTFIX);
-    f = fopen(current_freq_file, "r");
-    if (f) {
-      /* if there's a cpufreq /sys node, read the current frequency from
-       * this node and divide by 1000 to get Mhz. */
-      if (fgets(s, sizeof(s), f)) {
-        s[strlen(s) - 1] = '\0';
-        freq = strtod(s, nullptr);
-      }
-      fclose(f);
+    unsigned long long khz;
+
+    /* if there's a cpufreq /sys node, use its current frequency and divide
+     * by 1000 to get Mhz. */
+    update_cpufreq();
+    if (cpufreq_khz(cpu - 1, &khz)) {
       snprintf(p_client_buffer, client_buffer_size, p_format,
-               (freq / 1000) / divisor);
+               (static_cast<double>(khz) / 1000) / divisor);
       return 1;
     }
   }
@@ -3118,11 +3118,12 @@ static void process_parse_stat(struct process *process) {
     strncpy(procname, cmdline_procname, strlen(cmdline_procname) + 1);
 
   rc = sscanf(rparen + 1,
-              "%3s %*s %*s %*s %*s %*s %*s %*s %*s %*s %*s %lu "
+              "%3s %d %*s %d %*s %*s %*s %*s %*s %*s %*s %lu "
               "%lu %*s %*s %*s %d %*s %*s %*s %llu %llu",
-              state, &process->user_time, &process->kernel_time, &nice_val,
-              &process->vsize, &process->rss);
-  if (rc < 6) {
+              state, &process->ppid, &process->session, &process->user_time,
+              &process->kernel_time, &nice_val, &process->vsize,
+              &process->rss);
+  if (rc < 8) {
     LOG_ERROR("scanning data for {} failed, got only {} fields", procname, rc);
     return;
   }
@@ -3225,6 +3226,134 @@ static void process_parse_io(struct process *process) {
 }
 #endif /* BUILD_IOSTATS */
 
+#define PROCFS_TEMPLATE_SMAPS_ROLLUP "/proc/%d/smaps_rollup"
+/* smaps_rollup walks every mapping of the process in the kernel, so unlike
+ * stat it is far too expensive to read for every process on every update. */
+static void process_parse_smaps_rollup(struct process *process) {
+  char filename[BUFFER_LEN], buf[4096];
+  unsigned long long pss = 0, private_clean = 0, private_dirty = 0;
+  size_t len = 0;
+  ssize_t rc;
+  int fd;
+
+  process->pss_time = get_time();
+
+  snprintf(filename, sizeof(filename), PROCFS_TEMPLATE_SMAPS_ROLLUP,
+           process->pid);
+  fd = open(filename, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    /* other users' processes, or a kernel older than 4.14 */
+    process->pss = process->rss;
+    process->uss = 0;
+    return;
+  }
+  while (len < sizeof(buf) - 1 &&
+         (rc = read(fd, buf + len, sizeof(buf) - 1 - len)) > 0) {
+    len += rc;
+  }
+  close(fd);
+  buf[len] = 0;
+
+  for (char *line = buf; line != nullptr && *line != 0;) {
+    char *next = strchr(line, '\n');
+    if (next != nullptr) { *next++ = 0; }
+    sscanf(line, "Pss: %llu", &pss);
+    sscanf(line, "Private_Clean: %llu", &private_clean);
+    sscanf(line, "Private_Dirty: %llu", &private_dirty);
+    line = next;
+  }
+
+  process->pss = pss * 1024;
+  process->uss = (private_clean + private_dirty) * 1024;
+}
+
+#define PROCFS_TEMPLATE_CGROUP "/proc/%d/cgroup"
+/* Prefers the unified (v2) hierarchy line "0::/path"; on a v1-only system
+ * the first hierarchy listed is used instead. */
+static void process_parse_cgroup(struct process *process) {
+  char filename[BUFFER_LEN], buf[BUFFER_LEN];
+  const char *path = nullptr;
+  ssize_t rc;
+  int fd;
+
+  snprintf(filename, sizeof(filename), PROCFS_TEMPLATE_CGROUP, process->pid);
+  fd = open(filename, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) return;
+  rc = read(fd, buf, sizeof(buf) - 1);
+  close(fd);
+  if (rc <= 0) return;
+  buf[rc] = 0;
+
+  for (char *line = buf; line != nullptr && *line != 0;) {
+    char *next = strchr(line, '\n');
+    if (next != nullptr) *next++ = 0;
+    char *colon = strchr(line, ':');
+    colon = colon ? strchr(colon + 1, ':') : nullptr;
+    if (colon != nullptr && (path == nullptr || strncmp(line, "0::", 3) == 0))
+      path = colon + 1;
+    line = next;
+  }
+  if (path != nullptr)
+    process->cgroup = strndup(path, text_buffer_size.get(*state));
+}
+
+/* a process moving to another cgroup keeps its old group until it exits */
+void update_process_cgroups(void) {
+  for (struct process *p = first_process; p; p = p->next) {
+    if (p->cgroup == nullptr && p->time_stamp == g_time)
+      process_parse_cgroup(p);
+  }
+}
+
+/* The RSS leaders are the only processes that can make it into top_pss, so
+ * they are refreshed first, stalest first. Whatever budget is left goes to a
+ * rotating slice of the remaining processes, resuming where the previous
+ * update stopped, so that a process whose RSS overstates its share still has
+ * its PSS catch up eventually. At least one process is sampled per update. */
+void update_process_pss(void) {
+  static pid_t cursor = 0;
+  std::vector<struct process *> procs;
+
+  for (struct process *p = first_process; p; p = p->next) {
+    if (p->time_stamp == g_time) procs.push_back(p);
+  }
+  if (procs.empty()) return;
+
+  const auto leaders =
+      procs.begin() + std::min(procs.size(), static_cast<size_t>(2 * MAX_SP));
+  std::partial_sort(procs.begin(), leaders, procs.end(),
+                    [](const process *a, const process *b) {
+                      return a->rss > b->rss;
+                    });
+  std::sort(procs.begin(), leaders, [](const process *a, const process *b) {
+    return a->pss_time < b->pss_time;
+  });
+  std::sort(leaders, procs.end(), [](const process *a, const process *b) {
+    return a->pid < b->pid;
+  });
+
+  const double deadline = get_time() + top_pss_budget.get(*state) / 1000;
+  bool sampled = false;
+  auto within_budget = [&]() { return !sampled || get_time() < deadline; };
+
+  for (auto it = procs.begin(); it != leaders; ++it) {
+    if (!within_budget()) return;
+    process_parse_smaps_rollup(*it);
+    sampled = true;
+  }
+
+  auto it = std::upper_bound(
+      leaders, procs.end(), cursor,
+      [](pid_t pid, const process *p) { return pid < p->pid; });
+  for (auto left = procs.end() - leaders; left > 0; --left, ++it) {
+    if (it == procs.end()) it = leaders;
+    if (!within_budget()) return;
+    process_parse_smaps_rollup(*it);
+    cursor = (*it)->pid;
+    sampled = true;
+  }
+}
+
 /******************************************
  * Get process structure for process pid  *
  ******************************************/
@@ -3272,6 +3401,147 @@ static void update_process_table(void) {
   closedir(dir);
 }
 
+/******************************************
+ * Update thread table					  *
+ ******************************************/
+
+#define PROCFS_TEMPLATE_TASK "/proc/%d/task"
+#define PROCFS_TEMPLATE_TASK_STAT "/proc/%d/task/%d/stat"
+
+struct process *first_thread = nullptr;
+
+/* per-thread state, keyed by tid; entries are struct process so that the
+ * top printing and sorting machinery works on them unchanged */
+static std::unordered_map<pid_t, struct process> thread_table;
+
+static void free_thread(struct process &thread) {
+  free_and_zero(thread.name);
+  free_and_zero(thread.basename);
+}
+
+void free_all_threads(void) {
+  for (auto &[tid, thread] : thread_table) free_thread(thread);
+  thread_table.clear();
+  first_thread = nullptr;
+}
+
+static void thread_parse_stat(const struct process *owner, pid_t tid,
+                              unsigned long long total) {
+  char line[BUFFER_LEN] = {0}, filename[BUFFER_LEN], comm[BUFFER_LEN];
+  unsigned long user_time, kernel_time;
+  char *lparen, *rparen;
+  int fd, rc;
+
+  snprintf(filename, sizeof(filename), PROCFS_TEMPLATE_TASK_STAT, owner->pid,
+           tid);
+  fd = open(filename, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) return; /* the thread has exited */
+  rc = read(fd, line, BUFFER_LEN - 1);
+  close(fd);
+  if (rc <= 0) return;
+
+  lparen = strchr(line, '(');
+  rparen = strrchr(line, ')');
+  if (!lparen || !rparen || rparen < lparen) return;
+  rc = MIN((unsigned)(rparen - lparen - 1), sizeof(comm) - 1);
+  strncpy(comm, lparen + 1, rc);
+  comm[rc] = '\0';
+
+  if (sscanf(rparen + 1,
+             "%*s %*s %*s %*s %*s %*s %*s %*s %*s %*s %*s %lu %lu",
+             &user_time, &kernel_time) < 2) {
+    return;
+  }
+
+  auto [it, inserted] = thread_table.try_emplace(tid);
+  struct process &thread = it->second;
+  if (inserted) {
+    memset(&thread, 0, sizeof(thread));
+    thread.pid = tid;
+    thread.previous_user_time = user_time;
+    thread.previous_kernel_time = kernel_time;
+  }
+
+  /* comm can be changed at any time with prctl(PR_SET_NAME) */
+  if (thread.basename == nullptr || strcmp(thread.basename, comm) != 0) {
+    std::string name = std::string(owner->basename ? owner->basename : "") +
+                       "/" + comm;
+    free_and_zero(thread.name);
+    free_and_zero(thread.basename);
+    thread.name = strndup(name.c_str(), text_buffer_size.get(*state));
+    thread.basename = strndup(comm, text_buffer_size.get(*state));
+  }
+
+  if (thread.previous_user_time > user_time)
+    thread.previous_user_time = user_time;
+  if (thread.previous_kernel_time > kernel_time)
+    thread.previous_kernel_time = kernel_time;
+
+  thread.user_time = user_time - thread.previous_user_time;
+  thread.kernel_time = kernel_time - thread.previous_kernel_time;
+  thread.previous_user_time = user_time;
+  thread.previous_kernel_time = kernel_time;
+  thread.total_cpu_time = user_time + kernel_time;
+
+  float mul = 100.0;
+  if (top_cpu_separate.get(*state)) mul *= info.cpu_count;
+  thread.amount =
+      total ? mul * (thread.user_time + thread.kernel_time) / (float)total : 0;
+
+  /* threads share their process' address space and credentials */
+  thread.uid = owner->uid;
+  thread.rss = owner->rss;
+  thread.vsize = owner->vsize;
+  thread.time_stamp = g_time;
+}
+
+/* Only the threads of the busiest few processes are read, keeping the cost
+ * at O(threads of hot processes) rather than O(all threads on the system).
+ * Threads of processes that cool down are dropped and start from zero
+ * again if their process becomes busy later. */
+void update_top_threads(unsigned long long total) {
+  std::vector<struct process *> hot;
+
+  for (struct process *p = first_process; p; p = p->next) {
+    if (p->time_stamp == g_time) hot.push_back(p);
+  }
+  const size_t n =
+      std::min<size_t>(hot.size(), top_thread_processes.get(*state));
+  const auto end = hot.begin() + n;
+  std::partial_sort(hot.begin(), end, hot.end(),
+                    [](const process *a, const process *b) {
+                      return a->amount > b->amount;
+                    });
+
+  for (auto it = hot.begin(); it != end; ++it) {
+    char dirname[BUFFER_LEN];
+    DIR *dir;
+    struct dirent *entry;
+
+    snprintf(dirname, sizeof(dirname), PROCFS_TEMPLATE_TASK, (*it)->pid);
+    if (!(dir = opendir(dirname))) continue;
+    while ((entry = readdir(dir))) {
+      pid_t tid;
+
+      if (sscanf(entry->d_name, "%d", &tid) > 0)
+        thread_parse_stat(*it, tid, total);
+    }
+    closedir(dir);
+  }
+
+  first_thread = nullptr;
+  for (auto it = thread_table.begin(); it != thread_table.end();) {
+    if (it->second.time_stamp != g_time) {
+      free_thread(it->second);
+      it = thread_table.erase(it);
+      continue;
+    }
+    it->second.next = first_thread;
+    first_thread = &it->second;
+    ++it;
+  }
+}
+
 void get_top_info(void) {
   unsigned long long total = 0;
 
@@ -3281,6 +3551,8 @@ void get_top_info(void) {
 #ifdef BUILD_IOSTATS
   calc_io_each(); /* percentage of I/O for each task */
 #endif            /* BUILD_IOSTATS */
+  if (top_pss || top_pss_app) update_process_pss();
+  if (top_thread) update_top_threads(total);
 }
 
 /******************************************
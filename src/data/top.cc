@@ -31,6 +31,11 @@
 #include "top.h"
 
 #include <cstring>
+#ifdef __linux__
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#endif /* __linux__ */
 
 #include "../logging.h"
 #include "../prioqueue.h"
@@ -49,6 +54,13 @@ struct proc_hash_entry {
 };
 static struct proc_hash_entry proc_hash_table[HTABSIZE];
 
+#ifdef __linux__
+/* one synthetic process per basename, rebuilt every update for top_pss_app */
+static std::vector<struct process> pss_apps;
+/* one synthetic process per application, rebuilt every update for top_app */
+static std::vector<struct process> apps;
+#endif /* __linux__ */
+
 static void hash_process(struct process *p) {
   struct proc_hash_entry *phe;
   static char first_run = 1;
@@ -112,6 +124,15 @@ void free_all_processes() {
 #ifdef BUILD_IOSTATS
   std::memset(info.io, 0, sizeof(info.io));
 #endif
+#ifdef __linux__
+  std::memset(info.pss, 0, sizeof(info.pss));
+  std::memset(info.pss_app, 0, sizeof(info.pss_app));
+  std::memset(info.thread, 0, sizeof(info.thread));
+  std::memset(info.app, 0, sizeof(info.app));
+  pss_apps.clear();
+  apps.clear();
+  free_all_threads();
+#endif /* __linux__ */
 
   struct process *next = nullptr, *pr = first_process;
 
@@ -119,6 +140,9 @@ void free_all_processes() {
     next = pr->next;
     free_and_zero(pr->name);
     free_and_zero(pr->basename);
+#ifdef __linux__
+    free_and_zero(pr->cgroup);
+#endif /* __linux__ */
     free(pr);
     pr = next;
   }
@@ -166,6 +190,7 @@ static struct process *new_process(pid_t pid) {
   first_process = p;
 
   p->pid = pid;
+  p->ppid = 0;
   p->name = nullptr;
   p->basename = nullptr;
   p->amount = 0;
@@ -185,6 +210,15 @@ static struct process *new_process(pid_t pid) {
   p->previous_write_bytes = ULLONG_MAX;
   p->io_perc = 0;
 #endif /* BUILD_IOSTATS */
+#ifdef __linux__
+  p->pss = 0;
+  p->uss = 0;
+  p->pss_time = 0;
+  p->session = 0;
+  p->cgroup = nullptr;
+  p->app_root = nullptr;
+  p->app_stamp = 0;
+#endif /* __linux__ */
   p->time_stamp = 0;
   p->counted = 1;
   p->changed = 0;
@@ -233,6 +267,9 @@ static void delete_process(struct process *p) {
 
   free_and_zero(p->name);
   free_and_zero(p->basename);
+#ifdef __linux__
+  free_and_zero(p->cgroup);
+#endif /* __linux__ */
   /* remove the process from the hash table */
   unhash_process(p);
   free(p);
@@ -308,6 +345,153 @@ static int compare_io(void *va, void *vb) {
 }
 #endif /* BUILD_IOSTATS */
 
+#ifdef __linux__
+/* PSS of a process, falling back to RSS until smaps_rollup was sampled */
+static unsigned long long process_pss(const struct process *p) {
+  return p->pss_time > 0 ? p->pss : p->rss;
+}
+
+/* PSS comparison function for prio queue */
+static int compare_pss(void *va, void *vb) {
+  auto *a = static_cast<struct process *>(va),
+       *b = static_cast<struct process *>(vb);
+
+  if (process_pss(b) > process_pss(a)) { return 1; }
+  if (process_pss(a) > process_pss(b)) { return -1; }
+  return 0;
+}
+
+/* A synthetic group entry borrowing the identity of p, counters zeroed */
+static struct process group_new(const struct process *p) {
+  struct process group = *p;
+
+  group.next = group.previous = nullptr;
+  group.amount = 0;
+  group.rss = group.vsize = 0;
+  group.total_cpu_time = 0;
+#ifdef BUILD_IOSTATS
+  group.read_bytes = group.write_bytes = 0;
+  group.io_perc = 0;
+#endif /* BUILD_IOSTATS */
+  group.pss = group.uss = 0;
+  group.pss_time = 1;
+  return group;
+}
+
+/* Add the counters of p to a synthetic group entry */
+static void group_add(struct process &group, const struct process *p) {
+  group.amount += p->amount;
+  group.rss += p->rss;
+  group.vsize += p->vsize;
+  group.total_cpu_time += p->total_cpu_time;
+#ifdef BUILD_IOSTATS
+  group.read_bytes += p->read_bytes;
+  group.write_bytes += p->write_bytes;
+  group.io_perc += p->io_perc;
+#endif /* BUILD_IOSTATS */
+  group.pss += process_pss(p);
+  group.uss += p->uss;
+}
+
+/* Sum PSS/USS (and the usual counters) of all processes sharing a basename
+ * into one synthetic entry each. The entries borrow name and basename from
+ * the member with the largest PSS, whose pid and uid they also report. */
+static void process_group_pss_apps() {
+  std::unordered_map<std::string_view, size_t> index;
+  std::vector<unsigned long long> leader_pss;
+
+  pss_apps.clear();
+  for (struct process *p = first_process; p != nullptr; p = p->next) {
+    if (p->basename == nullptr) { continue; }
+    auto [it, inserted] = index.try_emplace(p->basename, pss_apps.size());
+    if (inserted) {
+      pss_apps.push_back(group_new(p));
+      leader_pss.push_back(process_pss(p));
+    }
+    struct process &app = pss_apps[it->second];
+    if (process_pss(p) > leader_pss[it->second]) {
+      leader_pss[it->second] = process_pss(p);
+      app.pid = p->pid;
+      app.uid = p->uid;
+      app.name = p->name;
+    }
+    group_add(app, p);
+  }
+}
+
+enum app_group { APP_GROUP_TREE, APP_GROUP_CGROUP };
+
+template <>
+conky::lua_traits<app_group>::Map conky::lua_traits<app_group>::map = {
+    {"tree", APP_GROUP_TREE}, {"cgroup", APP_GROUP_CGROUP}};
+
+static conky::simple_config_setting<app_group> top_app_group(
+    "top_app_group", APP_GROUP_TREE, true);
+
+/* An application is the subtree rooted at a child of init or of a session
+ * leader (a login or terminal shell, a service started by systemd), so the
+ * helpers of a browser or the jobs of a build roll up into one entry while
+ * unrelated commands started from the same shell stay apart. Resolved once
+ * per process and update, reusing the parent's answer. */
+static struct process *process_app_root(struct process *p) {
+  if (p->app_stamp == g_time && p->app_root != nullptr) { return p->app_root; }
+
+  struct process *parent =
+      p->ppid > 2 && p->ppid != p->pid ? find_process(p->ppid) : nullptr;
+  if (parent == nullptr || parent->session == parent->pid) {
+    p->app_root = p;
+  } else {
+    p->app_root = process_app_root(parent);
+  }
+  p->app_stamp = g_time;
+  return p->app_root;
+}
+
+/* Sum the counters of each application into one synthetic entry. Subtrees
+ * report the root's name and pid; cgroups are named after their leaf, with
+ * the whole path as the verbose name, and report the pid and uid of their
+ * largest member by RSS. */
+static void process_group_apps() {
+  apps.clear();
+  if (top_app_group.get(*state) == APP_GROUP_TREE) {
+    std::unordered_map<struct process *, size_t> index;
+
+    for (struct process *p = first_process; p != nullptr; p = p->next) {
+      struct process *root = process_app_root(p);
+      auto [it, inserted] = index.try_emplace(root, apps.size());
+      if (inserted) { apps.push_back(group_new(root)); }
+      group_add(apps[it->second], p);
+    }
+    return;
+  }
+
+  std::unordered_map<std::string_view, size_t> index;
+  std::vector<unsigned long long> leader_rss;
+
+  update_process_cgroups();
+  for (struct process *p = first_process; p != nullptr; p = p->next) {
+    if (p->cgroup == nullptr) { continue; }
+    auto [it, inserted] = index.try_emplace(p->cgroup, apps.size());
+    if (inserted) {
+      const char *leaf = strrchr(p->cgroup, '/');
+      apps.push_back(group_new(p));
+      apps.back().name = p->cgroup;
+      apps.back().basename = leaf != nullptr && leaf[1] != 0
+                                 ? const_cast<char *>(leaf + 1)
+                                 : p->cgroup;
+      leader_rss.push_back(p->rss);
+    }
+    struct process &app = apps[it->second];
+    if (p->rss > leader_rss[it->second]) {
+      leader_rss[it->second] = p->rss;
+      app.pid = p->pid;
+      app.uid = p->uid;
+    }
+    group_add(app, p);
+  }
+}
+#endif /* __linux__ */
+
 /* ****************************************************************** *
  * Get a sorted list of the top cpu hogs and top mem hogs. * Results are stored
  * in the cpu,mem arrays in decreasing order[0-9]. *
@@ -319,10 +503,18 @@ static void process_find_top(struct process **cpu, struct process **mem,
                              ,
                              struct process **io
 #endif /* BUILD_IOSTATS */
+#ifdef __linux__
+                             ,
+                             struct process **pss, struct process **pss_app,
+                             struct process **threads, struct process **app
+#endif /* __linux__ */
 ) {
   prio_queue_t cpu_queue, mem_queue, time_queue;
 #ifdef BUILD_IOSTATS
   prio_queue_t io_queue;
+#endif
+#ifdef __linux__
+  prio_queue_t pss_queue, pss_app_queue, thread_queue, app_queue;
 #endif
   struct process *cur_proc = nullptr;
   int i;
@@ -331,6 +523,10 @@ static void process_find_top(struct process **cpu, struct process **mem,
 #ifdef BUILD_IOSTATS
       && (top_io == 0)
 #endif /* BUILD_IOSTATS */
+#ifdef __linux__
+      && (top_pss == 0) && (top_pss_app == 0) && (top_thread == 0)
+      && (top_app == 0)
+#endif /* __linux__ */
       && (top_running == 0)) {
     return;
   }
@@ -353,6 +549,24 @@ static void process_find_top(struct process **cpu, struct process **mem,
   pq_set_max_size(io_queue, MAX_SP);
 #endif
 
+#ifdef __linux__
+  pss_queue = init_prio_queue();
+  pq_set_compare(pss_queue, &compare_pss);
+  pq_set_max_size(pss_queue, MAX_SP);
+
+  pss_app_queue = init_prio_queue();
+  pq_set_compare(pss_app_queue, &compare_pss);
+  pq_set_max_size(pss_app_queue, MAX_SP);
+
+  thread_queue = init_prio_queue();
+  pq_set_compare(thread_queue, &compare_cpu);
+  pq_set_max_size(thread_queue, MAX_SP);
+
+  app_queue = init_prio_queue();
+  pq_set_compare(app_queue, &compare_cpu);
+  pq_set_max_size(app_queue, MAX_SP);
+#endif
+
   /* g_time is the time_stamp entry for process.  It is updated when the
    * process information is updated to indicate that the process is still
    * alive (and must not be removed from the process list in
@@ -373,9 +587,29 @@ static void process_find_top(struct process **cpu, struct process **mem,
 #ifdef BUILD_IOSTATS
     if (top_io != 0) { insert_prio_elem(io_queue, cur_proc); }
 #endif /* BUILD_IOSTATS */
+#ifdef __linux__
+    if (top_pss != 0) { insert_prio_elem(pss_queue, cur_proc); }
+#endif /* __linux__ */
     cur_proc = cur_proc->next;
   }
 
+#ifdef __linux__
+  if (top_pss_app != 0) {
+    process_group_pss_apps();
+    for (auto &app : pss_apps) { insert_prio_elem(pss_app_queue, &app); }
+  }
+  if (top_thread != 0) {
+    for (cur_proc = first_thread; cur_proc != nullptr;
+         cur_proc = cur_proc->next) {
+      insert_prio_elem(thread_queue, cur_proc);
+    }
+  }
+  if (top_app != 0) {
+    process_group_apps();
+    for (auto &a : apps) { insert_prio_elem(app_queue, &a); }
+  }
+#endif /* __linux__ */
+
   for (i = 0; i < MAX_SP; i++) {
     if (top_cpu != 0) {
       cpu[i] = static_cast<process *>(pop_prio_elem(cpu_queue));
@@ -391,6 +625,20 @@ static void process_find_top(struct process **cpu, struct process **mem,
       io[i] = static_cast<process *>(pop_prio_elem(io_queue));
     }
 #endif /* BUILD_IOSTATS */
+#ifdef __linux__
+    if (top_pss != 0) {
+      pss[i] = static_cast<process *>(pop_prio_elem(pss_queue));
+    }
+    if (top_pss_app != 0) {
+      pss_app[i] = static_cast<process *>(pop_prio_elem(pss_app_queue));
+    }
+    if (top_thread != 0) {
+      threads[i] = static_cast<process *>(pop_prio_elem(thread_queue));
+    }
+    if (top_app != 0) {
+      app[i] = static_cast<process *>(pop_prio_elem(app_queue));
+    }
+#endif /* __linux__ */
   }
   free_prio_queue(cpu_queue);
   free_prio_queue(mem_queue);
@@ -398,6 +646,12 @@ static void process_find_top(struct process **cpu, struct process **mem,
 #ifdef BUILD_IOSTATS
   free_prio_queue(io_queue);
 #endif /* BUILD_IOSTATS */
+#ifdef __linux__
+  free_prio_queue(pss_queue);
+  free_prio_queue(pss_app_queue);
+  free_prio_queue(thread_queue);
+  free_prio_queue(app_queue);
+#endif /* __linux__ */
 }
 
 int update_top() {
@@ -408,6 +662,10 @@ int update_top() {
 #ifdef BUILD_IOSTATS
                    ,
                    info.io
+#endif
+#ifdef __linux__
+                   ,
+                   info.pss, info.pss_app, info.thread, info.app
 #endif
   );
   info.first_process = get_first_process();
@@ -562,6 +820,22 @@ PRINT_TOP_HR_GENERATOR(write_bytes, write_bytes, active_update_interval())
 PRINT_TOP_GENERATOR(io_perc, (unsigned int)7, "%6.2f", io_perc)
 #endif /* BUILD_IOSTATS */
 
+#ifdef __linux__
+static void print_top_pss(struct text_object *obj, char *p,
+                          unsigned int p_max_size) {
+  auto *td = static_cast<struct top_data *>(obj->data.opaque);
+
+  if ((td == nullptr) || (td->list == nullptr) ||
+      (td->list[td->num] == nullptr)) {
+    return;
+  }
+
+  human_readable(process_pss(td->list[td->num]), p, p_max_size);
+}
+
+PRINT_TOP_HR_GENERATOR(uss, uss, 1)
+#endif /* __linux__ */
+
 static void free_top(struct text_object *obj) {
   auto *td = static_cast<struct top_data *>(obj->data.opaque);
 
@@ -598,12 +872,34 @@ int parse_top_args(const char *s, const char *arg, struct text_object *obj) {
     td->list = info.io;
     top_io = 1;
 #endif /* BUILD_IOSTATS */
+#ifdef __linux__
+  } else if (strcmp(&s[3], "_pss") == EQUAL) {
+    td->list = info.pss;
+    top_pss = 1;
+  } else if (strcmp(&s[3], "_pss_app") == EQUAL) {
+    td->list = info.pss_app;
+    top_pss_app = 1;
+  } else if (strcmp(&s[3], "_thread") == EQUAL) {
+    td->list = info.thread;
+    top_thread = 1;
+  } else if (strcmp(&s[3], "_app") == EQUAL) {
+    td->list = info.app;
+    top_app = 1;
+#endif /* __linux__ */
   } else {
-#ifdef BUILD_IOSTATS
+#if defined(BUILD_IOSTATS) && defined(__linux__)
+    LOG_ERROR(
+        "must be top, top_mem, top_time, top_io, top_pss, top_pss_app, "
+        "top_thread or top_app");
+#elif defined(__linux__)
+    LOG_ERROR(
+        "must be top, top_mem, top_time, top_pss, top_pss_app, top_thread or "
+        "top_app");
+#elif defined(BUILD_IOSTATS)
     LOG_ERROR("must be top, top_mem, top_time or top_io");
-#else  /* BUILD_IOSTATS */
+#else
     LOG_ERROR("must be top, top_mem or top_time");
-#endif /* BUILD_IOSTATS */
+#endif
     free_and_zero(obj->data.opaque);
     return 0;
   }
@@ -637,13 +933,23 @@ int parse_top_args(const char *s, const char *arg, struct text_object *obj) {
     } else if (strcmp(buf, "io_perc") == EQUAL) {
       obj->callbacks.print = &print_top_io_perc;
 #endif /* BUILD_IOSTATS */
+#ifdef __linux__
+    } else if (strcmp(buf, "pss") == EQUAL) {
+      obj->callbacks.print = &print_top_pss;
+    } else if (strcmp(buf, "uss") == EQUAL) {
+      obj->callbacks.print = &print_top_uss;
+#endif /* __linux__ */
     } else {
       LOG_ERROR("invalid type arg for top");
 #ifdef BUILD_IOSTATS
       LOG_ERROR(
           "must be one of: name, cpu, pid, mem, time, mem_res, mem_vsize, "
-          "io_read, io_write, io_perc");
-#else  /* BUILD_IOSTATS */
+          "io_read, io_write, io_perc, pss, uss");
+#elif defined(__linux__)
+      LOG_ERROR(
+          "must be one of: name, cpu, pid, mem, time, mem_res, mem_vsize, "
+          "pss, uss");
+#else
       LOG_ERROR(
           "must be one of: name, cpu, pid, mem, time, mem_res, mem_vsize");
 #endif /* BUILD_IOSTATS */
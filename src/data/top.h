@@ -88,6 +88,7 @@ struct process {
   struct process *previous;
 
   pid_t pid;
+  pid_t ppid;
   char *name;
   char *basename;
   uid_t uid;
@@ -109,6 +110,21 @@ struct process {
   unsigned long long previous_write_bytes;
   float io_perc;
 #endif
+#ifdef __linux__
+  // Proportional and unique set size from /proc/<pid>/smaps_rollup. Only
+  // refreshed for a few processes per update (see top_pss_budget), so these
+  // may be stale; pss_time is the get_time() of the last sample, 0 if never.
+  unsigned long long pss;
+  unsigned long long uss;
+  double pss_time;
+  // Session id, and the cgroup v2 path (read once, only for top_app when
+  // grouping by cgroup). app_root caches the top_app subtree root for the
+  // update whose g_time is app_stamp.
+  pid_t session;
+  char *cgroup;
+  struct process *app_root;
+  unsigned int app_stamp;
+#endif /* __linux__ */
   unsigned int time_stamp;
   unsigned int counted;
   unsigned int changed;
@@ -142,6 +158,32 @@ int update_top(void);
 
 void get_top_info(void);
 
+#ifdef __linux__
+/**
+ * @brief Refreshes the cached PSS/USS of the current RSS leaders and of a
+ *        rotating slice of the remaining processes, within top_pss_budget.
+ */
+void update_process_pss(void);
+
+/**
+ * @brief Reads /proc/<pid>/cgroup of the processes whose cgroup is not known
+ *        yet.
+ */
+void update_process_cgroups(void);
+
+/**
+ * @brief Rebuilds the thread list from /proc/<pid>/task of the processes
+ *        using the most CPU, see top_thread_processes.
+ *
+ * @param total jiffies elapsed on all CPUs since the previous update.
+ */
+void update_top_threads(unsigned long long total);
+void free_all_threads(void);
+
+/* threads listed by update_top_threads(), linked through next */
+extern struct process *first_thread;
+#endif /* __linux__ */
+
 extern struct process *first_process;
 extern unsigned long g_time;
 
@@ -0,0 +1,446 @@
+/*
+ *
+ * Conky, a system monitor, based on torsmo
+ *
+ * Any original torsmo code is licensed under the BSD license
+ *
+ * All code written since the fork of torsmo is licensed under the GPL
+ *
+ * Please see COPYING for details
+ *
+ * Copyright (c) 2005-2024 Brenden Matthews, Philip Kovacs, et. al.
+ *	(see AUTHORS)
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "zfs.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "../common.h"
+#include "../conky.h"
+#include "../content/text_object.h"
+#include "../logging.h"
+
+namespace {
+struct kstat_table {
+  std::vector<std::string> names;
+  std::vector<unsigned long long> values, previous;
+  std::unordered_map<std::string, size_t> index;
+  bool have_previous = false;
+};
+
+struct zfs_pool {
+  std::string name;
+  /* the objset-* kstats, or the pool-wide io kstat of older releases */
+  std::vector<std::string> files;
+  std::vector<int> fds;
+  bool io_kstat = false;
+  unsigned long long nread = 0, nwritten = 0;
+  double read_rate = 0, write_rate = 0;
+  bool have_sample = false;
+  bool seen = false;
+};
+
+std::string opened_root;
+int arcstats_fd = -1;
+/* arcstats is about 8k on current releases */
+constexpr size_t kstat_buffer_size = 16384;
+std::vector<char> buf;
+kstat_table arcstats;
+std::vector<zfs_pool> pools;
+/* pools and datasets come and go rarely, so their directories are only
+ * listed every so often, or when a kept-open kstat stops being readable */
+constexpr double rescan_interval = 30;
+double last_scan = -1;
+double last_sample = 0;
+double interval = 0;
+double last_tick = -1;
+}  // namespace
+
+/* calls f(name, value) for every row of a named kstat:
+ *
+ *   13 1 0x01 123 33456 12345678 987654321
+ *   name                            type data
+ *   hits                            4    123456
+ */
+template <typename F>
+static void for_each_named(const char *p, F f) {
+  /* skip the kstat header and the column names */
+  for (int skip = 0; skip < 2 && *p != '\0'; skip++) {
+    p = strchr(p, '\n');
+    if (p == nullptr) { return; }
+    p++;
+  }
+  while (*p != '\0') {
+    const char *name = p;
+    while (*p != '\0' && *p != ' ' && *p != '\t' && *p != '\n') { p++; }
+    std::string_view key(name, p - name);
+    char *end;
+    /* type, then data */
+    strtoul(p, &end, 10);
+    unsigned long long value = strtoull(end, &end, 10);
+    if (!key.empty()) { f(key, value); }
+    p = strchr(end, '\n');
+    if (p == nullptr) { return; }
+    p++;
+  }
+}
+
+static void sample_arcstats() {
+  if (arcstats_fd == -1 ||
+      pread_file(arcstats_fd, buf, kstat_buffer_size) <= 0) {
+    return;
+  }
+
+  size_t row = 0;
+  bool reindex = false;
+  arcstats.previous.swap(arcstats.values);
+  arcstats.values.clear();
+  for_each_named(buf.data(), [&](std::string_view name,
+                                 unsigned long long value) {
+    /* rows keep their order, so this is almost never taken */
+    if (row >= arcstats.names.size() || arcstats.names[row] != name) {
+      arcstats.names.resize(row + 1);
+      arcstats.names[row] = name;
+      reindex = true;
+    }
+    arcstats.values.push_back(value);
+    row++;
+  });
+  if (row != arcstats.names.size()) {
+    arcstats.names.resize(row);
+    reindex = true;
+  }
+  if (reindex) {
+    arcstats.index.clear();
+    for (size_t i = 0; i < arcstats.names.size(); i++) {
+      arcstats.index[arcstats.names[i]] = i;
+    }
+  }
+  arcstats.have_previous =
+      !reindex && arcstats.previous.size() == arcstats.values.size();
+}
+
+static void close_pool(zfs_pool &pool) {
+  for (int fd : pool.fds) { close(fd); }
+  pool.fds.clear();
+  pool.files.clear();
+}
+
+/* (re)opens the pool's kstats if the files below dir changed, returns
+ * whether it has any */
+static bool scan_pool(zfs_pool &pool, const std::string &dir) {
+  std::vector<std::string> files;
+  bool io_kstat = false;
+
+  if (DIR *d = opendir(dir.c_str())) {
+    while (struct dirent *entry = readdir(d)) {
+      if (strncmp(entry->d_name, "objset-", 7) == 0) {
+        files.emplace_back(entry->d_name);
+      }
+    }
+    closedir(d);
+  }
+  if (files.empty()) {
+    files.emplace_back("io");
+    io_kstat = true;
+  }
+  std::sort(files.begin(), files.end());
+  if (files == pool.files && !pool.fds.empty()) { return true; }
+
+  close_pool(pool);
+  for (const auto &file : files) {
+    int fd = open((dir + "/" + file).c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd != -1) { pool.fds.push_back(fd); }
+  }
+  pool.files = std::move(files);
+  pool.io_kstat = io_kstat;
+  /* the sums aren't comparable to the previous ones */
+  pool.have_sample = false;
+  return !pool.fds.empty();
+}
+
+static void scan_pools(const std::string &kstat_root) {
+  DIR *d = opendir(kstat_root.c_str());
+  if (d == nullptr) {
+    for (auto &pool : pools) { close_pool(pool); }
+    pools.clear();
+    return;
+  }
+
+  for (auto &pool : pools) { pool.seen = false; }
+  while (struct dirent *entry = readdir(d)) {
+    if (entry->d_name[0] == '.' || entry->d_type == DT_REG) { continue; }
+
+    auto it = std::find_if(pools.begin(), pools.end(), [&](const zfs_pool &p) {
+      return p.name == entry->d_name;
+    });
+    if (it == pools.end()) {
+      pools.emplace_back();
+      it = pools.end() - 1;
+      it->name = entry->d_name;
+    }
+    it->seen = scan_pool(*it, kstat_root + "/" + entry->d_name);
+  }
+  closedir(d);
+  for (auto &pool : pools) {
+    if (!pool.seen) { close_pool(pool); }
+  }
+  pools.erase(std::remove_if(pools.begin(), pools.end(),
+                             [](const zfs_pool &p) { return !p.seen; }),
+              pools.end());
+}
+
+/* "nread nwritten reads writes ..." over a line of values */
+static bool parse_io_kstat(unsigned long long *nread,
+                           unsigned long long *nwritten) {
+  const char *p = strchr(buf.data(), '\n');
+  if (p == nullptr) { return false; }
+  char names[2][16];
+  unsigned long long values[2];
+  if (sscanf(p, " %15s %15s", names[0], names[1]) != 2) { return false; }
+  p = strchr(p + 1, '\n');
+  if (p == nullptr || sscanf(p, " %llu %llu", &values[0], &values[1]) != 2) {
+    return false;
+  }
+  for (int i = 0; i < 2; i++) {
+    if (strcmp(names[i], "nread") == 0) { *nread = values[i]; }
+    if (strcmp(names[i], "nwritten") == 0) { *nwritten = values[i]; }
+  }
+  return true;
+}
+
+/* sums up nread/nwritten of all the pool's datasets */
+static bool sample_pool_io(const zfs_pool &pool, unsigned long long *nread,
+                           unsigned long long *nwritten) {
+  *nread = *nwritten = 0;
+  for (int fd : pool.fds) {
+    if (pread_file(fd, buf, kstat_buffer_size) <= 0) { return false; }
+    if (pool.io_kstat) { return parse_io_kstat(nread, nwritten); }
+    for_each_named(buf.data(), [&](std::string_view name,
+                                   unsigned long long value) {
+      if (name == "nread") {
+        *nread += value;
+      } else if (name == "nwritten") {
+        *nwritten += value;
+      }
+    });
+  }
+  return true;
+}
+
+static void sample_pools(const std::string &kstat_root, double now,
+                         double dt) {
+  if (last_scan < 0 || now - last_scan >= rescan_interval) {
+    scan_pools(kstat_root);
+    last_scan = now;
+  }
+
+  for (auto &pool : pools) {
+    unsigned long long nread, nwritten;
+
+    pool.read_rate = pool.write_rate = 0;
+    if (!sample_pool_io(pool, &nread, &nwritten)) {
+      /* a dataset or the pool went away */
+      pool.have_sample = false;
+      last_scan = -1;
+      continue;
+    }
+    if (pool.have_sample && dt > 0) {
+      if (nread >= pool.nread) { pool.read_rate = (nread - pool.nread) / dt; }
+      if (nwritten >= pool.nwritten) {
+        pool.write_rate = (nwritten - pool.nwritten) / dt;
+      }
+    }
+    pool.nread = nread;
+    pool.nwritten = nwritten;
+    pool.have_sample = true;
+  }
+}
+
+void sample_zfs(const std::string &kstat_root, double now) {
+  if (opened_root != kstat_root) {
+    clear_zfs();
+    opened_root = kstat_root;
+    arcstats_fd =
+        open((kstat_root + "/arcstats").c_str(), O_RDONLY | O_CLOEXEC);
+    if (arcstats_fd == -1) {
+      LOG_DEBUG("can't open {}/arcstats: {}", kstat_root, strerror(errno));
+    }
+  }
+
+  interval = last_sample > 0 ? now - last_sample : 0;
+  last_sample = now;
+  sample_arcstats();
+  sample_pools(kstat_root, now, interval);
+}
+
+int update_zfs(void) {
+  if (last_tick == current_update_time) { return 0; }
+  last_tick = current_update_time;
+  sample_zfs("/proc/spl/kstat/zfs", get_time());
+  return 0;
+}
+
+void clear_zfs(void) {
+  if (arcstats_fd != -1) { close(arcstats_fd); }
+  arcstats_fd = -1;
+  opened_root.clear();
+  buf = std::vector<char>();
+  arcstats = kstat_table();
+  for (auto &pool : pools) { close_pool(pool); }
+  pools.clear();
+  last_scan = -1;
+  last_sample = 0;
+  interval = 0;
+  last_tick = -1;
+}
+
+bool zfs_arc_stat(const std::string &name, unsigned long long *value,
+                  double *rate) {
+  auto it = arcstats.index.find(name);
+
+  if (it == arcstats.index.end() || it->second >= arcstats.values.size()) {
+    return false;
+  }
+  size_t i = it->second;
+  if (value != nullptr) { *value = arcstats.values[i]; }
+  if (rate != nullptr) {
+    *rate = 0;
+    if (arcstats.have_previous && interval > 0 &&
+        arcstats.values[i] >= arcstats.previous[i]) {
+      *rate = (arcstats.values[i] - arcstats.previous[i]) / interval;
+    }
+  }
+  return true;
+}
+
+double zfs_arc_hit_percentage(void) {
+  double hits, misses;
+
+  if (!zfs_arc_stat("hits", nullptr, &hits) ||
+      !zfs_arc_stat("misses", nullptr, &misses) || hits + misses <= 0) {
+    return 0;
+  }
+  return hits * 100 / (hits + misses);
+}
+
+bool zfs_pool_io(const std::string &pool, double *read, double *written) {
+  for (const auto &p : pools) {
+    if (p.name == pool) {
+      *read = p.read_rate;
+      *written = p.write_rate;
+      return true;
+    }
+  }
+  return false;
+}
+
+static void print_arc_bytes(const char *name, char *p,
+                            unsigned int p_max_size) {
+  unsigned long long value;
+
+  if (zfs_arc_stat(name, &value, nullptr)) {
+    human_readable(value, p, p_max_size);
+  }
+}
+
+static void print_arc_rate(const char *name, char *p,
+                           unsigned int p_max_size) {
+  double rate;
+
+  if (zfs_arc_stat(name, nullptr, &rate)) {
+    snprintf(p, p_max_size, "%.0f", rate);
+  }
+}
+
+void print_zfs_arc_size(struct text_object *obj, char *p,
+                        unsigned int p_max_size) {
+  (void)obj;
+  print_arc_bytes("size", p, p_max_size);
+}
+
+void print_zfs_arc_max(struct text_object *obj, char *p,
+                       unsigned int p_max_size) {
+  (void)obj;
+  print_arc_bytes("c_max", p, p_max_size);
+}
+
+void print_zfs_arc_hits(struct text_object *obj, char *p,
+                        unsigned int p_max_size) {
+  (void)obj;
+  print_arc_rate("hits", p, p_max_size);
+}
+
+void print_zfs_arc_misses(struct text_object *obj, char *p,
+                          unsigned int p_max_size) {
+  (void)obj;
+  print_arc_rate("misses", p, p_max_size);
+}
+
+uint8_t zfs_arc_hit_ratio(struct text_object *obj) {
+  (void)obj;
+  return round_to_positive_int(zfs_arc_hit_percentage());
+}
+
+double zfs_arc_barval(struct text_object *obj) {
+  unsigned long long size, max;
+
+  (void)obj;
+  if (!zfs_arc_stat("size", &size, nullptr) ||
+      !zfs_arc_stat("c_max", &max, nullptr) || max == 0) {
+    return 0;
+  }
+  return std::min(1.0, static_cast<double>(size) / max);
+}
+
+void print_zfs_arc_stat(struct text_object *obj, char *p,
+                        unsigned int p_max_size) {
+  unsigned long long value;
+
+  if (zfs_arc_stat(obj->data.s, &value, nullptr)) {
+    snprintf(p, p_max_size, "%llu", value);
+  }
+}
+
+void print_zfs_pool_read(struct text_object *obj, char *p,
+                         unsigned int p_max_size) {
+  double read, written;
+
+  if (zfs_pool_io(obj->data.s, &read, &written)) {
+    human_readable(static_cast<long long>(read), p, p_max_size);
+  }
+}
+
+void print_zfs_pool_write(struct text_object *obj, char *p,
+                          unsigned int p_max_size) {
+  double read, written;
+
+  if (zfs_pool_io(obj->data.s, &read, &written)) {
+    human_readable(static_cast<long long>(written), p, p_max_size);
+  }
+}
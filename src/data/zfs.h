@@ -0,0 +1,68 @@
+/*
+ *
+ * Conky, a system monitor, based on torsmo
+ *
+ * Any original torsmo code is licensed under the BSD license
+ *
+ * All code written since the fork of torsmo is licensed under the GPL
+ *
+ * Please see COPYING for details
+ *
+ * Copyright (c) 2005-2024 Brenden Matthews, Philip Kovacs, et. al.
+ *	(see AUTHORS)
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef _ZFS_H
+#define _ZFS_H
+
+#include "config.h"
+
+#include <cstdint>
+#include <string>
+
+struct text_object;
+
+/* ZFS ARC and pool statistics from the SPL kstat files, by default below
+ * /proc/spl/kstat/zfs. arcstats stays open; its name/type/data table is
+ * indexed once and only re-indexed when a name moves. The pools' kstats stay
+ * open too, and their directories are only listed again every 30 seconds or
+ * when one of them can't be read. */
+
+int update_zfs(void);
+/* samples the kstats below kstat_root as of `now` (seconds, monotonic) */
+void sample_zfs(const std::string &kstat_root, double now);
+void clear_zfs(void);
+
+/* an arcstats value, e.g. size or c_max, and its change per second */
+bool zfs_arc_stat(const std::string &name, unsigned long long *value,
+                  double *rate);
+/* percentage of ARC lookups during the last update that were hits */
+double zfs_arc_hit_percentage(void);
+/* bytes per second read from and written to a pool's datasets */
+bool zfs_pool_io(const std::string &pool, double *read, double *written);
+
+void print_zfs_arc_size(struct text_object *, char *, unsigned int);
+void print_zfs_arc_max(struct text_object *, char *, unsigned int);
+void print_zfs_arc_hits(struct text_object *, char *, unsigned int);
+void print_zfs_arc_misses(struct text_object *, char *, unsigned int);
+uint8_t zfs_arc_hit_ratio(struct text_object *);
+double zfs_arc_barval(struct text_object *);
+void print_zfs_arc_stat(struct text_object *, char *, unsigned int);
+void print_zfs_pool_read(struct text_object *, char *, unsigned int);
+void print_zfs_pool_write(struct text_object *, char *, unsigned int);
+
+#endif /* _ZFS_H */
@@ -0,0 +1,208 @@
+/*
+ *
+ * Conky, a system monitor, based on torsmo
+ *
+ * Any original torsmo code is licensed under the BSD license
+ *
+ * All code written since the fork of torsmo is licensed under the GPL
+ *
+ * Please see COPYING for details
+ *
+ * Copyright (c) 2005-2024 Brenden Matthews, Philip Kovacs, et. al.
+ *	(see AUTHORS)
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "chunk-cache.hh"
+
+extern "C" {
+#include <lauxlib.h>
+}
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include "../logging.h"
+
+namespace conky {
+namespace {
+/* bump when the header layout changes */
+const char chunk_magic[] = "conky-chunk 2";
+
+uint64_t fnv1a(const char *data, size_t len) {
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  for (size_t i = 0; i < len; ++i) {
+    hash ^= static_cast<unsigned char>(data[i]);
+    hash *= 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+/* the line between the header and the bytecode it guards */
+std::string payload_hash(const char *data, size_t len) {
+  return fmt::format("{:016x}\n", fnv1a(data, len));
+}
+
+/* reads and closes fp */
+bool read_stream(FILE *fp, std::string &out) {
+  char buf[BUFSIZ];
+  size_t len;
+  while ((len = fread(buf, 1, sizeof buf, fp)) > 0) { out.append(buf, len); }
+  bool ok = ferror(fp) == 0;
+  fclose(fp);
+  return ok;
+}
+
+bool read_whole_file(const char *path, std::string &out) {
+  FILE *fp = fopen(path, "re");
+  return fp != nullptr && read_stream(fp, out);
+}
+
+/* Bytecode is loaded without verification, so a cache anyone but the user
+ * could have written is never read. */
+bool read_cache(const std::filesystem::path &cache, std::string &out) {
+  int fd = open(cache.c_str(), O_RDONLY | O_CLOEXEC | O_NOFOLLOW);
+  if (fd < 0) { return false; }
+  struct stat st{};
+  if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_uid != getuid() ||
+      (st.st_mode & (S_IWGRP | S_IWOTH)) != 0) {
+    LOG_DEBUG("ignoring chunk cache '{}': not a private file of this user",
+              cache);
+    close(fd);
+    return false;
+  }
+  FILE *fp = fdopen(fd, "r");
+  if (fp == nullptr) {
+    close(fd);
+    return false;
+  }
+  return read_stream(fp, out);
+}
+
+int dump_writer(lua_State * /*L*/, const void *p, size_t size, void *ud) {
+  static_cast<std::string *>(ud)->append(static_cast<const char *>(p), size);
+  return 0;
+}
+
+/* written to a temporary file first so that a concurrent instance never
+ * reads half a chunk */
+void write_cache(const std::filesystem::path &cache, const std::string &data) {
+  std::error_code ec;
+  auto dir = cache.parent_path();
+  std::filesystem::create_directories(dir.parent_path(), ec);
+  if (ec || (mkdir(dir.c_str(), 0700) != 0 && errno != EEXIST)) {
+    LOG_DEBUG("can't create chunk cache directory '{}': {}", dir,
+              ec ? ec.message() : strerror(errno));
+    return;
+  }
+
+  std::string tmp = cache.string() + "." + std::to_string(getpid());
+  int fd = open(tmp.c_str(),
+                O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC | O_NOFOLLOW, 0600);
+  FILE *fp = fd < 0 ? nullptr : fdopen(fd, "w");
+  if (fp == nullptr) {
+    LOG_DEBUG("can't write chunk cache '{}': {}", tmp, strerror(errno));
+    if (fd >= 0) {
+      close(fd);
+      unlink(tmp.c_str());
+    }
+    return;
+  }
+  bool ok = fwrite(data.data(), 1, data.size(), fp) == data.size();
+  ok = fclose(fp) == 0 && ok;
+  if (!ok || rename(tmp.c_str(), cache.c_str()) != 0) {
+    LOG_DEBUG("can't write chunk cache '{}': {}", cache, strerror(errno));
+    unlink(tmp.c_str());
+  }
+}
+}  // namespace
+
+std::filesystem::path chunk_cache_path(const char *path) {
+  std::filesystem::path dir;
+  const char *xdg = getenv("XDG_CACHE_HOME");
+  const char *home = getenv("HOME");
+  if (xdg != nullptr && xdg[0] == '/') {
+    dir = xdg;
+  } else if (home != nullptr && home[0] == '/') {
+    dir = std::filesystem::path(home) / ".cache";
+  } else {
+    return {};
+  }
+
+  std::error_code ec;
+  std::string absolute = std::filesystem::absolute(path, ec).string();
+  char name[32];
+  snprintf(name, sizeof name, "%016" PRIx64 ".luac",
+           fnv1a(absolute.data(), absolute.size()));
+  return dir / "conky" / name;
+}
+
+int load_cached_chunk(lua_State *L, const char *path) {
+  struct stat st{};
+  std::string source;
+  auto cache = chunk_cache_path(path);
+  if (cache.empty() || stat(path, &st) != 0 ||
+      !read_whole_file(path, source)) {
+    return luaL_loadfile(L, path);
+  }
+
+  std::error_code ec;
+  std::string header = fmt::format(
+      "{}\n{}\n{} {} {:016x}\n", chunk_magic,
+      std::filesystem::absolute(path, ec).string(),
+      static_cast<long long>(st.st_mtime), static_cast<long long>(st.st_size),
+      fnv1a(source.data(), source.size()));
+  std::string chunkname = std::string("@") + path;
+
+  /* the header, the payload hash line (16 digits and a newline), then the
+   * bytecode */
+  const size_t payload = header.size() + 17;
+  std::string cached;
+  if (read_cache(cache, cached) && cached.size() > payload &&
+      cached.compare(0, header.size(), header) == 0) {
+    std::string hash =
+        payload_hash(cached.data() + payload, cached.size() - payload);
+    /* binary mode only, a corrupted cache can't pass for source */
+    if (cached.compare(header.size(), hash.size(), hash) != 0) {
+      LOG_DEBUG("ignoring chunk cache '{}': bytecode hash mismatch", cache);
+    } else if (luaL_loadbufferx(L, cached.data() + payload,
+                                cached.size() - payload, chunkname.c_str(),
+                                "b") == LUA_OK) {
+      return LUA_OK;
+    } else {
+      LOG_DEBUG("ignoring chunk cache '{}': {}", cache, lua_tostring(L, -1));
+      lua_pop(L, 1);
+    }
+  }
+
+  int rc = luaL_loadfile(L, path);
+  if (rc != LUA_OK) { return rc; }
+
+  std::string chunk;
+  if (lua_dump(L, &dump_writer, &chunk, 0) == 0) {
+    write_cache(cache,
+                header + payload_hash(chunk.data(), chunk.size()) + chunk);
+  }
+  return LUA_OK;
+}
+}  // namespace conky
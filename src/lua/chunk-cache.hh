@@ -0,0 +1,55 @@
+/*
+ *
+ * Conky, a system monitor, based on torsmo
+ *
+ * Any original torsmo code is licensed under the BSD license
+ *
+ * All code written since the fork of torsmo is licensed under the GPL
+ *
+ * Please see COPYING for details
+ *
+ * Copyright (c) 2005-2024 Brenden Matthews, Philip Kovacs, et. al.
+ *	(see AUTHORS)
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef _CHUNK_CACHE_HH
+#define _CHUNK_CACHE_HH
+
+extern "C" {
+#include <lua.h>
+}
+
+#include <filesystem>
+
+namespace conky {
+/**
+ * Where the compiled chunk of the script at path is cached, under
+ * $XDG_CACHE_HOME/conky (~/.cache/conky by default). Empty if neither
+ * variable is usable.
+ */
+std::filesystem::path chunk_cache_path(const char *path);
+
+/**
+ * Works like luaL_loadfile(). The chunk is loaded from the cache if the
+ * script's path, mtime, size and content hash still match the ones it was
+ * compiled from; otherwise it is compiled from source and the cache is
+ * refreshed. Any problem with the cache falls back to the source.
+ */
+int load_cached_chunk(lua_State *L, const char *path);
+}  // namespace conky
+
+#endif /* _CHUNK_CACHE_HH */
@@ -22,20 +22,36 @@
  */
 #include "config.h"
 
+#include <algorithm>
+#include <cmath>
 #include <cstring>
 #include <filesystem>
+#include <functional>
+#include <map>
 #include <sstream>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
 #if defined(BUILD_LUA_CAIRO) || defined(BUILD_WAYLAND)
 #include <cairo.h>
 #endif
 
+#include "../common.h"
 #include "../conky.h"
+#include "../data/exec.h"
 #include "../geometry.h"
 #include "../logging.h"
 #include "../output/display-output.hh"
+#include "../update-cb.hh"
 #include "build.h"
+#include "chunk-cache.hh"
 #include "llua.h"
 
+#ifdef BUILD_CURL
+#include "../data/network/ccurl_thread.h"
+#endif /* BUILD_CURL */
+
 #ifdef BUILD_GUI
 #include "../output/gui.h"
 
@@ -67,11 +83,22 @@ static int llua_block_notify = 0;
 // POSIX compliant
 #include <sys/stat.h>
 
-static void llua_load(const char *script);
+static void llua_async_clear();
 
 lua_State *lua_L = nullptr;
 
 namespace {
+/* per-function accounting, returned to scripts by conky_call_stats() */
+struct llua_call_stats {
+  unsigned long calls = 0;
+  unsigned long overruns = 0;
+  unsigned int consecutive_overruns = 0;
+  double total_time = 0;
+  double max_time = 0;
+  bool disabled = false;
+};
+std::unordered_map<std::string, llua_call_stats> llua_stats;
+
 class lua_load_setting : public conky::simple_config_setting<std::string> {
   using Base = conky::simple_config_setting<std::string>;
 
@@ -112,11 +139,7 @@ class lua_load_setting : public conky::simple_config_setting<std::string> {
   void cleanup(lua::state &l) override {
     lua::stack_sentry s(l, -1);
 
-#ifdef HAVE_SYS_INOTIFY_H
-    llua_rm_notifies();
-#endif /* HAVE_SYS_INOTIFY_H */
-    lua_close(lua_L);
-    lua_L = nullptr;
+    llua_close();
   }
 
  public:
@@ -138,8 +161,133 @@ conky::simple_config_setting<std::string> lua_draw_hook_post(
     "lua_draw_hook_post", std::string(), true);
 
 #endif
+
+/* milliseconds a single call into Lua may run, 0 for no limit */
+conky::range_config_setting<double> lua_call_budget("lua_call_budget", 0,
+                                                    3600000, 1000, true);
+/* consecutive overruns after which a function is no longer called */
+conky::range_config_setting<unsigned int> lua_call_overrun_limit(
+    "lua_call_overrun_limit", 0, std::numeric_limits<unsigned int>::max(), 3,
+    true);
+
+/* state of the outermost call in progress, nested calls share its budget */
+int llua_call_depth = 0;
+double llua_deadline = 0;
+bool llua_overran = false;
+
+/* VM instructions between two looks at the clock */
+constexpr int kBudgetCheckInterval = 10000;
+
+/* returned by llua_pcall() instead of calling a disabled function */
+constexpr int LLUA_DISABLED = -1;
 }  // namespace
 
+static void llua_budget_hook(lua_State *L, lua_Debug * /*ar*/) {
+  if (llua_deadline > 0 && get_time() > llua_deadline) {
+    llua_overran = true;
+    luaL_error(L, "exceeded lua_call_budget of %f ms",
+               lua_call_budget.get(*state));
+  }
+}
+
+/* lua_pcall() for user functions: enforces lua_call_budget on the outermost
+ * call and keeps per-function statistics. A function that overruns its budget
+ * lua_call_overrun_limit times in a row is disabled until its script is
+ * reloaded. The budget is only checked between Lua instructions, so a
+ * blocking C function (io.popen():read() and the like) can't be aborted. */
+static int llua_pcall(const char *func, int nargs, int nresults) {
+  auto &stats = llua_stats[func];
+  if (stats.disabled) {
+    lua_pop(lua_L, nargs + 1);
+    return LLUA_DISABLED;
+  }
+
+  const bool outermost = llua_call_depth++ == 0;
+  const double budget = lua_call_budget.get(*state) / 1000;
+  const double start = get_time();
+  if (outermost && budget > 0) {
+    llua_overran = false;
+    llua_deadline = start + budget;
+    lua_sethook(lua_L, &llua_budget_hook, LUA_MASKCOUNT, kBudgetCheckInterval);
+  }
+
+  int rc = lua_pcall(lua_L, nargs, nresults, 0);
+
+  const double elapsed = get_time() - start;
+  --llua_call_depth;
+  ++stats.calls;
+  stats.total_time += elapsed;
+  stats.max_time = std::max(stats.max_time, elapsed);
+  if (!outermost || budget <= 0) { return rc; }
+
+  lua_sethook(lua_L, nullptr, 0, 0);
+  llua_deadline = 0;
+  if (!llua_overran) {
+    stats.consecutive_overruns = 0;
+    return rc;
+  }
+  ++stats.overruns;
+  const unsigned int limit = lua_call_overrun_limit.get(*state);
+  if (limit > 0 && ++stats.consecutive_overruns >= limit) {
+    stats.disabled = true;
+    LOG_ERROR(
+        "lua function '{}' disabled after {} consecutive calls over "
+        "lua_call_budget",
+        func, stats.consecutive_overruns);
+  }
+  return rc;
+}
+
+/* Hooks belong to a single Lua thread, so coroutines get their own. It is
+ * installed for good since the coroutine may be resumed from any later call,
+ * and does nothing while no call is being budgeted. */
+static void llua_budget_thread(lua_State *co) {
+  if (co != nullptr) {
+    lua_sethook(co, &llua_budget_hook, LUA_MASKCOUNT, kBudgetCheckInterval);
+  }
+}
+
+/* coroutine.create, with the original as upvalue */
+static int llua_coroutine_create(lua_State *L) {
+  lua_pushvalue(L, lua_upvalueindex(1));
+  lua_insert(L, 1);
+  lua_call(L, lua_gettop(L) - 1, 1);
+  llua_budget_thread(lua_tothread(L, -1));
+  return 1;
+}
+
+/* coroutine.wrap, with the original as upvalue; the function it returns
+ * keeps the coroutine as its first upvalue */
+static int llua_coroutine_wrap(lua_State *L) {
+  lua_pushvalue(L, lua_upvalueindex(1));
+  lua_insert(L, 1);
+  lua_call(L, lua_gettop(L) - 1, 1);
+  if (lua_getupvalue(L, -1, 1) != nullptr) {
+    llua_budget_thread(lua_tothread(L, -1));
+    lua_pop(L, 1);
+  }
+  return 1;
+}
+
+static int llua_conky_call_stats(lua_State *L) {
+  lua_newtable(L);
+  for (const auto &[name, stats] : llua_stats) {
+    lua_newtable(L);
+    lua_pushinteger(L, stats.calls);
+    lua_setfield(L, -2, "calls");
+    lua_pushnumber(L, stats.total_time);
+    lua_setfield(L, -2, "time");
+    lua_pushnumber(L, stats.max_time);
+    lua_setfield(L, -2, "max_time");
+    lua_pushinteger(L, stats.overruns);
+    lua_setfield(L, -2, "overruns");
+    lua_pushboolean(L, stats.disabled);
+    lua_setfield(L, -2, "disabled");
+    lua_setfield(L, -2, name.c_str());
+  }
+  return 1;
+}
+
 static int llua_conky_parse(lua_State *L) {
   int n = lua_gettop(L); /* number of arguments */
   char *str;
@@ -194,6 +342,300 @@ static int llua_conky_surface(lua_State *L) {
   return 1;
 }
 
+/* conky_async: file reads, commands and local HTTP requests run by callback
+ * threads, so scripts don't block the update loop waiting for them */
+namespace {
+enum class lua_async_op { read_file, exec, http_get };
+
+struct lua_async_result {
+  bool done = false;
+  bool ok = false;
+  std::string value;
+};
+
+/* seconds a command or request may take */
+constexpr double kAsyncTimeout = 30.0;
+
+/* Keyed by the operation, its argument and a serial number. Serial 0 is a
+ * shared operation repeated every period, anything else runs only once. */
+class lua_async_cb : public conky::callback<lua_async_result, lua_async_op,
+                                            std::string, unsigned long> {
+  typedef conky::callback<lua_async_result, lua_async_op, std::string,
+                          unsigned long>
+      Base;
+
+  bool ran = false;
+
+ protected:
+  void work() override {
+    if (ran && get<2>() != 0) { return; }
+    ran = true;
+
+    lua_async_result r;
+    const std::string &arg = get<1>();
+    if (get<0>() == lua_async_op::exec) {
+      r.ok = run_command(arg.c_str(), kAsyncTimeout, r.value) ==
+             exec_status::ok;
+      if (!r.ok) { r.value = "command failed or timed out: " + arg; }
+    } else if (FILE *fp = fopen(arg.c_str(), "re")) {
+      char buf[4096];
+      size_t len;
+      while ((len = fread(buf, 1, sizeof buf, fp)) > 0) {
+        r.value.append(buf, len);
+      }
+      r.ok = ferror(fp) == 0;
+      if (!r.ok) { r.value = arg + ": read error"; }
+      fclose(fp);
+    } else {
+      r.value = arg + ": " + strerror(errno);
+    }
+    r.done = true;
+
+    std::lock_guard<std::mutex> l(result_mutex);
+    result = std::move(r);
+  }
+
+ public:
+  lua_async_cb(uint32_t period, const Tuple &tuple)
+      : Base(period, false, tuple) {}
+
+  conky::cost_class cost() const override {
+    return std::get<0>(tuple) == lua_async_op::exec
+               ? conky::cost_class::fork
+               : conky::cost_class::file_open;
+  }
+};
+
+#ifdef BUILD_CURL
+class lua_http_cb : public curl_callback<lua_async_result, unsigned long> {
+  typedef curl_callback<lua_async_result, unsigned long> Base;
+
+  bool ran = false;
+
+ protected:
+  void process_data() override {}
+
+  void work() override {
+    if (ran && std::get<1>(tuple) != 0) { return; }
+    ran = true;
+
+    long status = do_work();
+    std::lock_guard<std::mutex> l(result_mutex);
+    result.done = true;
+    /* not modified, keep the previous body */
+    if (status == 304) { return; }
+    result.ok = status == 200;
+    if (result.ok) {
+      result.value = std::move(data);
+    } else if (status == 0) {
+      result.value = "request failed: " + std::get<0>(tuple);
+    } else {
+      result.value = "HTTP status " + std::to_string(status);
+    }
+  }
+
+ public:
+  lua_http_cb(uint32_t period, const Tuple &tuple) : Base(period, tuple) {
+    /* only loopback URLs are fetched, a redirect mustn't leave them */
+    curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 0L);
+    curl_easy_setopt(curl, CURLOPT_TIMEOUT, static_cast<long>(kAsyncTimeout));
+  }
+};
+#endif /* BUILD_CURL */
+
+/* a coroutine started by conky_async.run() and what it is waiting for */
+struct lua_async_wait {
+  int ref = LUA_NOREF; /* keeps the coroutine from being collected */
+  double wake_at = 0;
+  std::function<lua_async_result()> poll;
+};
+std::unordered_map<lua_State *, lua_async_wait> lua_async_threads;
+unsigned long lua_async_serial = 0;
+
+/* operations requested outside of a coroutine, with the number of updates
+ * since a script last asked for them */
+typedef std::tuple<lua_async_op, std::string, uint32_t> lua_async_key;
+struct lua_async_cached {
+  std::function<lua_async_result()> poll;
+  uint32_t idle = 0;
+};
+std::map<lua_async_key, lua_async_cached> lua_async_cache;
+}  // namespace
+
+static void llua_async_clear() {
+  lua_async_threads.clear();
+  lua_async_cache.clear();
+}
+
+static std::function<lua_async_result()> llua_async_start(
+    lua_async_op op, const std::string &arg, uint32_t period,
+    unsigned long serial) {
+#ifdef BUILD_CURL
+  if (op == lua_async_op::http_get) {
+    auto cb = conky::register_cb<lua_http_cb>(period,
+                                              lua_http_cb::Tuple(arg, serial));
+    return [cb]() { return cb->get_result_copy(); };
+  }
+#endif /* BUILD_CURL */
+  auto cb = conky::register_cb<lua_async_cb>(
+      period, lua_async_cb::Tuple(op, arg, serial));
+  return [cb]() { return cb->get_result_copy(); };
+}
+
+/* pushes the result the way io functions do: the value, or nil and a
+ * message */
+static int llua_async_push(lua_State *L, const lua_async_result &r) {
+  if (r.done && r.ok) {
+    lua_pushlstring(L, r.value.data(), r.value.size());
+    return 1;
+  }
+  lua_pushnil(L);
+  lua_pushstring(L, r.done ? r.value.c_str() : "pending");
+  return 2;
+}
+
+static void llua_async_resume(lua_State *co, lua_State *from, int nargs) {
+  const bool outermost = llua_call_depth++ == 0;
+  const double budget = lua_call_budget.get(*state) / 1000;
+  const double start = get_time();
+  if (outermost && budget > 0) {
+    llua_deadline = start + budget;
+    lua_sethook(co, &llua_budget_hook, LUA_MASKCOUNT, kBudgetCheckInterval);
+  }
+
+  int nres;
+#if LUA_VERSION_NUM >= 504
+  int rc = lua_resume(co, from, nargs, &nres);
+#else
+  int rc = lua_resume(co, from, nargs);
+  nres = lua_gettop(co);
+#endif
+
+  --llua_call_depth;
+  if (outermost && budget > 0) {
+    lua_sethook(co, nullptr, 0, 0);
+    llua_deadline = 0;
+  }
+  auto &stats = llua_stats["conky_async.run"];
+  const double elapsed = get_time() - start;
+  ++stats.calls;
+  stats.total_time += elapsed;
+  stats.max_time = std::max(stats.max_time, elapsed);
+
+  if (rc == LUA_YIELD) {
+    lua_pop(co, nres);
+    return;
+  }
+  if (rc != LUA_OK) {
+    LOG_ERROR("lua coroutine started by conky_async.run failed: {}",
+              lua_tostring(co, -1));
+  }
+  auto i = lua_async_threads.find(co);
+  luaL_unref(lua_L, LUA_REGISTRYINDEX, i->second.ref);
+  lua_async_threads.erase(i);
+}
+
+/* Inside a coroutine started by conky_async.run() the operation is started
+ * and the coroutine resumes with its result once it completes. Anywhere
+ * else the result of the last run is returned, or nil until there is one,
+ * and the operation is repeated every interval seconds for as long as the
+ * script keeps asking. */
+static int llua_async_request(lua_State *L, lua_async_op op) {
+  std::string arg = luaL_checkstring(L, 1);
+
+  auto co = lua_async_threads.find(L);
+  if (co != lua_async_threads.end()) {
+    co->second.poll = llua_async_start(op, arg, 1, ++lua_async_serial);
+    return lua_yield(L, 0);
+  }
+
+  double interval = luaL_optnumber(L, 2, active_update_interval());
+  auto period = static_cast<uint32_t>(
+      std::max(lround(interval / active_update_interval()), 1l));
+  auto &cached = lua_async_cache[lua_async_key(op, arg, period)];
+  if (!cached.poll) { cached.poll = llua_async_start(op, arg, period, 0); }
+  cached.idle = 0;
+  return llua_async_push(L, cached.poll());
+}
+
+static int llua_async_read_file(lua_State *L) {
+  return llua_async_request(L, lua_async_op::read_file);
+}
+
+static int llua_async_exec(lua_State *L) {
+  return llua_async_request(L, lua_async_op::exec);
+}
+
+static int llua_async_http_get(lua_State *L) {
+#ifdef BUILD_CURL
+  if (!curl_url_is_loopback(luaL_checkstring(L, 1))) {
+    return luaL_argerror(L, 1, "not a loopback http(s) URL");
+  }
+  return llua_async_request(L, lua_async_op::http_get);
+#else
+  lua_pushnil(L);
+  lua_pushstring(L, "conky was built without curl support");
+  return 2;
+#endif /* BUILD_CURL */
+}
+
+static int llua_async_sleep(lua_State *L) {
+  double seconds = luaL_checknumber(L, 1);
+  auto co = lua_async_threads.find(L);
+  if (co == lua_async_threads.end()) {
+    return luaL_error(L, "conky_async.sleep called outside of conky_async.run");
+  }
+  co->second.wake_at = get_time() + seconds;
+  return lua_yield(L, 0);
+}
+
+/* conky_async.run(function, ...) runs function with the remaining arguments
+ * in a new coroutine and returns it */
+static int llua_async_run(lua_State *L) {
+  luaL_checktype(L, 1, LUA_TFUNCTION);
+  int nargs = lua_gettop(L) - 1;
+
+  lua_State *co = lua_newthread(L);
+  lua_insert(L, 1);
+  lua_xmove(L, co, nargs + 1);
+  lua_pushvalue(L, 1);
+  lua_async_threads[co].ref = luaL_ref(L, LUA_REGISTRYINDEX);
+
+  llua_async_resume(co, L, nargs);
+  return 1;
+}
+
+/* resumes coroutines whose operations completed, once per update */
+void llua_update_async() {
+  for (auto i = lua_async_cache.begin(); i != lua_async_cache.end();) {
+    /* let the callback go once scripts stop asking for it */
+    if (++i->second.idle > 2 * std::get<2>(i->first) + 1) {
+      i = lua_async_cache.erase(i);
+    } else {
+      ++i;
+    }
+  }
+
+  /* a coroutine that yielded on its own waits for the next update */
+  std::vector<lua_State *> ready;
+  const double now = get_time();
+  for (const auto &[co, wait] : lua_async_threads) {
+    if (wait.poll ? wait.poll().done : now >= wait.wake_at) {
+      ready.push_back(co);
+    }
+  }
+
+  for (lua_State *co : ready) {
+    auto i = lua_async_threads.find(co);
+    if (i == lua_async_threads.end()) { continue; }
+    int nargs = 0;
+    if (i->second.poll) { nargs = llua_async_push(co, i->second.poll()); }
+    i->second.poll = nullptr;
+    i->second.wake_at = 0;
+    llua_async_resume(co, lua_L, nargs);
+  }
+}
+
 void llua_init() {
   std::string libs(PACKAGE_LIBDIR "/lib?.so;");
   std::string old_path, new_path;
@@ -268,6 +710,29 @@ void llua_init() {
   lua_pushcfunction(lua_L, &llua_conky_surface);
   lua_setglobal(lua_L, "conky_surface");
 
+  lua_pushcfunction(lua_L, &llua_conky_call_stats);
+  lua_setglobal(lua_L, "conky_call_stats");
+
+  static const luaL_Reg async_functions[] = {
+      {"run", &llua_async_run},
+      {"read_file", &llua_async_read_file},
+      {"exec", &llua_async_exec},
+      {"http_get", &llua_async_http_get},
+      {"sleep", &llua_async_sleep},
+      {nullptr, nullptr}};
+  luaL_newlib(lua_L, async_functions);
+  lua_setglobal(lua_L, "conky_async");
+
+  /* keep lua_call_budget in force inside coroutines */
+  lua_getglobal(lua_L, "coroutine");
+  lua_getfield(lua_L, -1, "create");
+  lua_pushcclosure(lua_L, &llua_coroutine_create, 1);
+  lua_setfield(lua_L, -2, "create");
+  lua_getfield(lua_L, -1, "wrap");
+  lua_pushcclosure(lua_L, &llua_coroutine_wrap, 1);
+  lua_setfield(lua_L, -2, "wrap");
+  lua_pop(lua_L, 1);
+
   /* register tolua++ user types */
   tolua_open(lua_L);
   tolua_usertype(lua_L, "cairo_surface_t");
@@ -278,6 +743,16 @@ void llua_init() {
 #endif /* BUILD_X11 */
 }
 
+void llua_close() {
+#ifdef HAVE_SYS_INOTIFY_H
+  llua_rm_notifies();
+#endif /* HAVE_SYS_INOTIFY_H */
+  if (lua_L != nullptr) { lua_close(lua_L); }
+  lua_L = nullptr;
+  llua_stats.clear();
+  llua_async_clear();
+}
+
 inline bool file_exists(const char *path) {
   struct stat buffer;
   return (stat(path, &buffer) == 0);
@@ -343,15 +818,24 @@ void llua_load(const char *script) {
     }
   }
 
-  error = luaL_dofile(lua_L, path.c_str());
+  error = conky::load_cached_chunk(lua_L, path.c_str()) ||
+          lua_pcall(lua_L, 0, LUA_MULTRET, 0);
   if (error != 0) {
     LOG_ERROR("lua load error in '{}': {}", path, lua_tostring(lua_L, -1));
     lua_pop(lua_L, 1);
+    return;
+  }
+
+  /* the functions may have been fixed, give them another chance */
+  for (auto &[name, stats] : llua_stats) {
+    stats.disabled = false;
+    stats.consecutive_overruns = 0;
+  }
 #ifdef HAVE_SYS_INOTIFY_H
-  } else if (!llua_block_notify && inotify_fd != -1) {
+  if (!llua_block_notify && inotify_fd != -1) {
     llua_append_notify(path.c_str());
-#endif /* HAVE_SYS_INOTIFY_H */
   }
+#endif /* HAVE_SYS_INOTIFY_H */
 }
 
 /*
@@ -422,7 +906,9 @@ static char *llua_do_call(const char *string, int retc) {
     argc++;
   }
 
-  if (lua_pcall(lua_L, argc, retc, 0) != 0) {
+  int rc = llua_pcall(func, argc, retc);
+  if (rc == LLUA_DISABLED) { return nullptr; }
+  if (rc != 0) {
     LOG_ERROR("lua function '{}' execution failed: {}", func,
               lua_tostring(lua_L, -1));
     lua_pop(lua_L, -1);
@@ -616,6 +1102,15 @@ void llua_draw_post_hook() {
   llua_do_call(lua_draw_hook_post.get(*state).c_str(), 0);
 }
 
+std::vector<std::string> llua_draw_hooks() {
+  std::vector<std::string> hooks;
+  for (auto *hook : {&lua_draw_hook_pre, &lua_draw_hook_post}) {
+    std::string name = hook->get(*state);
+    if (!name.empty()) { hooks.push_back(std::move(name)); }
+  }
+  return hooks;
+}
+
 #ifdef BUILD_MOUSE_EVENTS
 template <typename EventT>
 bool llua_mouse_hook(const EventT &ev) {
@@ -655,7 +1150,10 @@ bool llua_mouse_hook(const EventT &ev) {
   ev.push_lua_table(lua_L);
 
   bool result = false;
-  if (lua_pcall(lua_L, 1, 1, 0) != LUA_OK) {
+  int rc = llua_pcall(hook_name.c_str(), 1, 1);
+  if (rc == LLUA_DISABLED) {
+    return false;
+  } else if (rc != LUA_OK) {
     LOG_ERROR("lua mouse hook '{}' execution failed: {}", hook_name,
               lua_tostring(lua_L, -1));
     lua_pop(lua_L, 1);
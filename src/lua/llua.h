@@ -31,6 +31,8 @@ extern "C" {
 }
 
 #include <config.h>
+#include <string>
+#include <vector>
 #include "../geometry.h"
 
 #ifdef BUILD_MOUSE_EVENTS
@@ -45,12 +47,18 @@ void llua_inotify_query(int wd, int mask);
 #endif /* HAVE_SYS_INOTIFY_H */
 
 void llua_init();
+/* runs a script in the state made by llua_init() */
+void llua_load(const char *script);
+/* closes the state, forgetting call statistics and pending conky_async work */
+void llua_close();
 void llua_startup_hook(void);
 void llua_shutdown_hook(void);
 
 #ifdef BUILD_GUI
 void llua_draw_pre_hook(void);
 void llua_draw_post_hook(void);
+/* the functions set as lua_draw_hook_pre and lua_draw_hook_post */
+std::vector<std::string> llua_draw_hooks(void);
 
 #ifdef BUILD_MOUSE_EVENTS
 /**
@@ -69,6 +77,7 @@ void llua_update_window_table(conky::vec2i window_size,
 
 void llua_setup_info(struct information *i, double u_interval);
 void llua_update_info(struct information *i, double u_interval);
+void llua_update_async(void);
 
 void print_lua(struct text_object *, char *, unsigned int);
 void print_lua_parse(struct text_object *, char *, unsigned int);
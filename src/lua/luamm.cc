@@ -352,8 +352,10 @@ bool state::lessthan(int index1, int index2) {
   return safe_compare(&safe_compare_trampoline<&lua_lessthan>, index1, index2);
 }
 
-void state::loadfile(const char *filename) {
-  switch (luaL_loadfile(cobj.get(), filename)) {
+void state::loadfile(const char *filename,
+                     int (*loader)(lua_State *, const char *)) {
+  switch (loader != nullptr ? loader(cobj.get(), filename)
+                            : luaL_loadfile(cobj.get(), filename)) {
     case 0:
       return;
     case LUA_ERRSYNTAX:
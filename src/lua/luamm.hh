@@ -298,7 +298,9 @@ class state : private std::mutex {
   void getglobal(const char *name);
   void gettable(int index);
   bool lessthan(int index1, int index2);
-  void loadfile(const char *filename);
+  // loader, if given, is used in place of luaL_loadfile()
+  void loadfile(const char *filename,
+                int (*loader)(lua_State *, const char *) = nullptr);
   void loadstring(const char *s);
   bool next(int index);
   // register is a reserved word :/
@@ -33,6 +33,7 @@
 #include "build.h"
 #include "config.h"
 #include "conky.h"
+#include "cost-report.h"
 #include "logging.h"
 #include "lua/lua-config.hh"
 #include "output/display-output.hh"
@@ -215,7 +216,7 @@ static void print_version() {
 #endif /* BUILD_MOUSE_EVENTS */
 #endif /* BUILD_WAYLAND */
 #if defined BUILD_AUDACIOUS || defined BUILD_CMUS || defined BUILD_MPD || \
-    defined BUILD_MOC || defined BUILD_XMMS2
+    defined BUILD_MOC || defined BUILD_XMMS2 || defined BUILD_MPRIS
             << _("\n Music detection:\n")
 #endif
 #ifdef BUILD_AUDACIOUS
@@ -230,6 +231,9 @@ static void print_version() {
 #ifdef BUILD_MOC
             << _("  * MOC\n")
 #endif /* BUILD_MOC */
+#ifdef BUILD_MPRIS
+            << _("  * MPRIS\n")
+#endif /* BUILD_MPRIS */
 #ifdef BUILD_XMMS2
             << _("  * XMMS2\n")
 #endif /* BUILD_XMMS2 */
@@ -268,6 +272,8 @@ static void print_help(const char *prog_name) {
          "create a new default config\n"
 #endif
          "   -d, --daemonize           daemonize, fork to background\n"
+         "   -R, --cost-report         estimate what the config costs per "
+         "update and quit\n"
          "   -h, --help                help\n"
 #ifdef BUILD_X11
          "   -a, --alignment=ALIGNMENT text alignment on screen, "
@@ -368,6 +374,9 @@ int main(int argc, char **argv) {
       case 'c':
         current_config = optarg;
         break;
+      case 'R':
+        conky::cost_report_requested = true;
+        break;
       case 'q':
         conky::log::set_quiet();
         if (freopen("/dev/null", "w", stderr) == nullptr) {
@@ -425,6 +434,9 @@ int main(int argc, char **argv) {
 
     initialisation(argc, argv);
 
+    /* initialisation() printed the estimate instead of starting outputs */
+    if (conky::cost_report_requested) { return EXIT_SUCCESS; }
+
     first_pass = 0; /* don't ever call fork() again */
 
     main_loop();
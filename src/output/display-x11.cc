@@ -200,10 +200,6 @@ static void X11_create_window() {
   } else {
     window.window_damage =
         XDamageCreate(display, window.window, XDamageReportNonEmpty);
-    window.damage_region =
-        XFixesCreateRegionFromWindow(display, window.window, 0);
-    window.damage_scratch =
-        XFixesCreateRegionFromWindow(display, window.window, 0);
   }
 #endif /* BUILD_XDAMAGE */
 
@@ -388,9 +384,11 @@ bool display_output_x11::main_loop_wait(double t) {
   process_surface_events(this, display);
 
 #ifdef BUILD_XDAMAGE
-  if (window.window_damage) {
-    XDamageSubtract(display, window.window_damage, window.damage_region, None);
-    XFixesSetRegion(display, window.damage_region, nullptr, 0);
+  /* All damage reported while draining the queue is acknowledged at once;
+   * XDamageReportNonEmpty won't notify again until it's been subtracted. */
+  if (window.window_damage && window.damage_pending) {
+    XDamageSubtract(display, window.window_damage, None, None);
+    window.damage_pending = false;
   }
 #endif /* BUILD_XDAMAGE */
 
@@ -408,6 +406,10 @@ bool display_output_x11::main_loop_wait(double t) {
                             .to_xrectangle();
       XUnionRectWithRegion(&rect, window.repaint_region, window.repaint_region);
     }
+    XRectangle clip;
+    XClipBox(window.repaint_region, &clip);
+    double draw_start = get_time();
+
     XSetRegion(display, window.gc, window.repaint_region);
 #ifdef BUILD_XFT
     if (use_xft.get(*state)) {
@@ -415,8 +417,17 @@ bool display_output_x11::main_loop_wait(double t) {
     }
 #endif
     draw_stuff();
+
+    /* full redraws (resize, background change) mustn't inherit this clip */
+    XSetClipMask(display, window.gc, None);
+#ifdef BUILD_XFT
+    if (use_xft.get(*state)) { XftDrawSetClip(window.xftdraw, nullptr); }
+#endif
     XDestroyRegion(window.repaint_region);
     window.repaint_region = XCreateRegion();
+
+    LOG_TRACE("redrew {}x{}+{}+{} in {:.3f}ms", clip.width, clip.height,
+              clip.x, clip.y, (get_time() - draw_start) * 1000.0);
   }
 
   // handled
@@ -726,6 +737,7 @@ bool handle_event(conky::display_output_x11 *surface, Display *display,
   if (ev.state == PropertyNewValue) {
     get_x11_desktop_info(ev.display, ev.atom);
   }
+  get_x11_active_window_info(ev.display, ev.window, ev.atom);
 
   if (ev.atom == 0) return false;
 
@@ -761,27 +773,31 @@ bool handle_event(conky::display_output_x11 *surface, Display *display,
       .width = static_cast<unsigned short>(ev.width),
       .height = static_cast<unsigned short>(ev.height),
   };
+  // Exposures are only merged here; the whole queue is drained before the
+  // accumulated region is redrawn once in `display_output_x11::main_loop_wait`.
   XUnionRectWithRegion(&r, window.repaint_region, window.repaint_region);
-  XSync(display, False);
   return true;
 }
 
 #ifdef BUILD_XDAMAGE
 bool handle_event(conky::display_output_x11 *surface, Display *display,
                   XDamageNotifyEvent ev, conky::x11::event *propagated) {
-  XFixesSetRegion(display, window.damage_scratch, &ev.area, 1);
-  XFixesUnionRegion(display, window.damage_region, window.damage_region,
-                    window.damage_scratch);
+  window.damage_pending = true;
   return true;
 }
 #endif /* BUILD_XDAMAGE */
 
+bool handle_event(conky::display_output_x11 *surface, Display *display,
+                  XkbIndicatorNotifyEvent ev, conky::x11::event *propagated) {
+  get_x11_keyboard_indicators(display, &ev);
+  return false;
+}
+
 /// Handles all events conky can receive.
 ///
 /// @return true if event should move input focus to conky
-inline bool process_event(conky::display_output_x11 *surface, Display *display,
-                          conky::x11::event &ev,
-                          conky::x11::event *propagated) {
+bool process_event(conky::display_output_x11 *surface, Display *display,
+                   conky::x11::event &ev, conky::x11::event *propagated) {
 #define HANDLE_EV(type)                                                       \
   if (auto it = ev.into_inner<type>()) {                                      \
     return handle_event(surface, display, std::move(it.value()), propagated); \
@@ -791,6 +807,7 @@ inline bool process_event(conky::display_output_x11 *surface, Display *display,
 
   HANDLE_EV(XPropertyEvent);
   HANDLE_EV(XExposeEvent);
+  HANDLE_EV(XkbIndicatorNotifyEvent);
 
 #ifdef OWN_WINDOW
   HANDLE_EV(xi_pointer_move);
@@ -841,7 +858,10 @@ static bool is_window_opaque_to_events() {
 void process_surface_events(conky::display_output_x11 *surface,
                             Display *display) {
   int pending = XPending(display);
-  if (pending == 0) return;
+  if (pending == 0) {
+    resolve_x11_properties(display, false);
+    return;
+  }
 
   LOG_TRACE("processing {} X11 events", pending);
 
@@ -860,6 +880,9 @@ void process_surface_events(conky::display_output_x11 *surface,
     }
   }
 
+  /* pick up replies to property requests made while handling events */
+  resolve_x11_properties(display, false);
+
   LOG_TRACE("done processing {} events", pending);
 }
 
@@ -869,8 +892,6 @@ void display_output_x11::sigterm_cleanup() {
 #ifdef BUILD_XDAMAGE
   if (window.window_damage) {
     XDamageDestroy(display, window.window_damage);
-    XFixesDestroyRegion(display, window.damage_region);
-    XFixesDestroyRegion(display, window.damage_scratch);
   }
 #endif /* BUILD_XDAMAGE */
 }
@@ -28,6 +28,7 @@
 #include <memory>
 
 #include "display-output.hh"
+#include "x11-event.h"
 
 namespace conky {
 
@@ -92,6 +93,13 @@ class display_output_x11 : public display_output_base {
 #endif /* BUILD_LUA_CAIRO_XLIB */
 };
 
+/// Hands a single event to its handler. Handlers only record what changed,
+/// the work is done once per loop iteration after the queue is drained.
+///
+/// @return true if event should move input focus to conky
+bool process_event(display_output_x11 *surface, Display *display,
+                   x11::event &ev, x11::event *propagated);
+
 }  // namespace conky
 
 #endif /* DISPLAY_X11_HH */
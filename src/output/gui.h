@@ -176,6 +176,7 @@ void print_monitor_number(struct text_object *, char *, unsigned int);
 void print_desktop(struct text_object *, char *, unsigned int);
 void print_desktop_number(struct text_object *, char *, unsigned int);
 void print_desktop_name(struct text_object *, char *, unsigned int);
+void print_active_window_title(struct text_object *, char *, unsigned int);
 
 /* Num lock, Scroll lock, Caps Lock */
 void print_key_num_lock(struct text_object *, char *, unsigned int);
@@ -96,4 +96,16 @@ __attribute__((weak)) void print_desktop_name(struct text_object *obj, char *p,
     strncpy(p, "NYI", p_max_size);
   }
 }
+
+__attribute__((weak)) void print_active_window_title(struct text_object *obj,
+                                                     char *p,
+                                                     unsigned int p_max_size) {
+  (void)obj;
+
+  if (!out_to_wayland.get(*state)) {
+    strncpy(p, NOT_IN_WAYLAND, p_max_size);
+  } else {
+    strncpy(p, "NYI", p_max_size);
+  }
+}
 #endif
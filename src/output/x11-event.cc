@@ -3,6 +3,7 @@
 
 extern "C" {
 #include <X11/X.h>
+#include <X11/XKBlib.h>
 #include <X11/Xlib.h>
 
 #ifdef BUILD_XDAMAGE
@@ -65,6 +66,16 @@ event::event(Display* display, XEvent ev) {
   }
 #endif /* BUILD_XDAMAGE */
 
+  if (window.xkb_event_base != 0 && ev.type == window.xkb_event_base) {
+    auto& xkb = reinterpret_cast<XkbEvent&>(ev);
+    if (xkb.any.xkb_type == XkbIndicatorStateNotify) {
+      inner = xkb.indicators;
+    } else {
+      inner = event_error::NOT_IMPLEMENTED;
+    }
+    return;
+  }
+
   bool has_cookie = ev.type == GenericEvent;
 
   if (has_cookie && ev.xgeneric.extension == window.xi_opcode) {
@@ -147,6 +158,9 @@ int event::raw_x11_type() const {
     result[event_variant_index_of_v<XDamageNotifyEvent>] = ResolveDynamically;
 #endif /* BUILD_XDAMAGE */
 
+    result[event_variant_index_of_v<XkbIndicatorNotifyEvent>] =
+        ResolveDynamically;
+
     result[event_variant_index_of_v<xi_pointer_move>] = GenericEvent;
     result[event_variant_index_of_v<xi_pointer_press>] = GenericEvent;
     result[event_variant_index_of_v<xi_pointer_release>] = GenericEvent;
@@ -166,6 +180,9 @@ int event::raw_x11_type() const {
     return window.xdamage_event_base + XDamageNotify;
   }
 #endif /* BUILD_XDAMAGE */
+  if (std::holds_alternative<XkbIndicatorNotifyEvent>(inner)) {
+    return window.xkb_event_base;
+  }
 
   // These are here for completeness. They will likely never be reached
   if (std::holds_alternative<XKeyEvent>(inner)) {
@@ -226,6 +243,7 @@ DIRECT_DOWNCAST(XMappingEvent)
 #ifdef BUILD_XDAMAGE
 DIRECT_DOWNCAST(XDamageNotifyEvent)
 #endif
+DIRECT_DOWNCAST(XkbIndicatorNotifyEvent)
 DIRECT_DOWNCAST(xi_pointer_move)
 DIRECT_DOWNCAST(xi_pointer_press)
 DIRECT_DOWNCAST(xi_pointer_release)
@@ -359,6 +377,10 @@ inline bool check_window(const event& on, Window window) {
     return false;
   }
 #endif /* BUILD_XDAMAGE */
+  if (on.downcast<XkbIndicatorNotifyEvent>()) {
+    // XKB notifications are about the keyboard device, not a window.
+    return false;
+  }
   if (auto xi_event = on.downcast<xi_pointer_event>()) {
     auto& event = xi_event->get();
     if (Traverse && event.child != None) {
@@ -9,6 +9,7 @@
 #include <variant>
 
 extern "C" {
+#include <X11/XKBlib.h>
 #include <X11/Xlib.h>
 
 #ifdef BUILD_XDAMAGE
@@ -51,6 +52,8 @@ struct event {
       XDamageNotifyEvent,
 #endif /* BUILD_XDAMAGE */
 
+      XkbIndicatorNotifyEvent,
+
       xi_pointer_move, xi_pointer_press, xi_pointer_release,
 
       xi_pointer_enter, xi_pointer_leave, xi_pointer_focus_in,
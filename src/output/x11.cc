@@ -55,6 +55,7 @@
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <deque>
 #include <numeric>
 #include <string>
 #include <vector>
@@ -95,6 +96,10 @@ extern "C" {
 #include <xcb/xcb.h>
 #include <xcb/xcb_errors.h>
 #endif
+#ifdef HAVE_XLIB_XCB
+#include <X11/Xlib-xcb.h>
+#include <xcb/xcbext.h>
+#endif
 #include <X11/Xresource.h>
 }
 
@@ -272,6 +277,10 @@ void init_x11() {
   info.x11.desktop.number = 1;
   info.x11.desktop.all_names.clear();
   info.x11.desktop.name.clear();
+  info.x11.keyboard.led_mask = 0;
+  info.x11.keyboard.tracked = false;
+  info.x11.active_window.window = None;
+  info.x11.active_window.title.clear();
 
   screen = DefaultScreen(display);
 
@@ -282,6 +291,10 @@ void init_x11() {
   update_x11_workarea();
 
   get_x11_desktop_info(display, 0);
+  get_x11_active_window_info(display, None, 0);
+  /* have the initial values in place before the first update */
+  resolve_x11_properties(display, true);
+  get_x11_keyboard_indicators(display, nullptr);
 
 #ifdef HAVE_XCB_ERRORS
   auto connection = xcb_connect(NULL, NULL);
@@ -296,6 +309,7 @@ void init_x11() {
 void deinit_x11() {
   if (display) {
     auto _scope = LOG_SCOPE("deinit_x11");
+    discard_x11_properties(display);
     XCloseDisplay(display);
     display = nullptr;
   }
@@ -988,69 +1002,117 @@ void create_gc() {
                         GCFunction | GCGraphicsExposures, &values);
 }
 
-// Get current desktop number
-static inline void get_x11_desktop_current(Display *current_display,
-                                           Window root, Atom atom) {
-  Atom actual_type;
-  int actual_format;
-  unsigned long nitems;
-  unsigned long bytes_after;
-  unsigned char *prop = nullptr;
-  struct information *current_info = &info;
+/* Window properties are requested without waiting for the reply when Xlib is
+ * backed by XCB. Replies are collected by resolve_x11_properties() once the
+ * event queue has been drained, so a burst of PropertyNotify events (e.g.
+ * quickly switching desktops or a terminal updating its title) doesn't cost a
+ * blocking round trip each. */
+struct x11_property {
+  Atom type = None;
+  int format = 0;
+  unsigned long nitems = 0;
+  unsigned long bytes_after = 0;
+  const unsigned char *data = nullptr;
+
+  /* Format 32 items are CARD32 on the wire, but Xlib hands them out as longs */
+  unsigned long item32(unsigned long i) const {
+#ifdef HAVE_XLIB_XCB
+    return reinterpret_cast<const uint32_t *>(data)[i];
+#else
+    return reinterpret_cast<const unsigned long *>(data)[i];
+#endif /* HAVE_XLIB_XCB */
+  }
+};
+using x11_property_handler = std::function<void(const x11_property &)>;
 
-  if (atom == None) { return; }
+/* Property values are read in chunks of this many 32-bit units */
+static const long X11_PROPERTY_CHUNK = 256;
+
+#ifdef HAVE_XLIB_XCB
+struct pending_x11_property {
+  xcb_get_property_cookie_t cookie;
+  x11_property_handler handler;
+};
+static std::deque<pending_x11_property> pending_x11_properties;
+#endif /* HAVE_XLIB_XCB */
+
+static void fetch_x11_property(Display *current_display, Window w,
+                               Atom property, Atom type, long offset,
+                               x11_property_handler handler) {
+#ifdef HAVE_XLIB_XCB
+  xcb_connection_t *connection = XGetXCBConnection(current_display);
+  pending_x11_properties.push_back(
+      {xcb_get_property(connection, 0, w, property, type, offset,
+                        X11_PROPERTY_CHUNK),
+       std::move(handler)});
+  xcb_flush(connection);
+#else  /* HAVE_XLIB_XCB */
+  x11_property result;
+  unsigned char *prop = nullptr;
 
-  if ((XGetWindowProperty(current_display, root, atom, 0, 1L, False,
-                          XA_CARDINAL, &actual_type, &actual_format, &nitems,
-                          &bytes_after, &prop) == 0) &&
-      (actual_type == XA_CARDINAL) && (nitems == 1L) && (actual_format == 32)) {
-    current_info->x11.desktop.current = prop[0] + 1;
+  if (XGetWindowProperty(current_display, w, property, offset,
+                         X11_PROPERTY_CHUNK, False, type, &result.type,
+                         &result.format, &result.nitems, &result.bytes_after,
+                         &prop) == Success) {
+    result.data = prop;
   }
+  handler(result);
   if (prop != nullptr) { XFree(prop); }
+#endif /* HAVE_XLIB_XCB */
 }
 
-// Get total number of available desktops
-static inline void get_x11_desktop_number(Display *current_display, Window root,
-                                          Atom atom) {
-  Atom actual_type;
-  int actual_format;
-  unsigned long nitems;
-  unsigned long bytes_after;
-  unsigned char *prop = nullptr;
-  struct information *current_info = &info;
-
-  if (atom == None) { return; }
+void resolve_x11_properties(Display *current_display, bool wait) {
+#ifdef HAVE_XLIB_XCB
+  xcb_connection_t *connection = XGetXCBConnection(current_display);
+
+  /* Replies arrive in request order, so stop at the first one missing */
+  while (!pending_x11_properties.empty()) {
+    xcb_get_property_reply_t *reply = nullptr;
+    xcb_generic_error_t *error = nullptr;
+    auto cookie = pending_x11_properties.front().cookie;
+
+    if (wait) {
+      reply = xcb_get_property_reply(connection, cookie, &error);
+    } else if (xcb_poll_for_reply(connection, cookie.sequence,
+                                  reinterpret_cast<void **>(&reply),
+                                  &error) == 0) {
+      break;
+    }
 
-  if ((XGetWindowProperty(current_display, root, atom, 0, 1L, False,
-                          XA_CARDINAL, &actual_type, &actual_format, &nitems,
-                          &bytes_after, &prop) == 0) &&
-      (actual_type == XA_CARDINAL) && (nitems == 1L) && (actual_format == 32)) {
-    current_info->x11.desktop.number = prop[0];
+    /* the handler may queue a follow-up request */
+    auto handler = std::move(pending_x11_properties.front().handler);
+    pending_x11_properties.pop_front();
+
+    x11_property result;
+    if (reply != nullptr) {
+      result.type = reply->type;
+      result.format = reply->format;
+      result.nitems = reply->value_len;
+      result.bytes_after = reply->bytes_after;
+      result.data = static_cast<const unsigned char *>(
+          xcb_get_property_value(reply));
+    }
+    handler(result);
+    free(reply);
+    free(error);
   }
-  if (prop != nullptr) { XFree(prop); }
+#else  /* HAVE_XLIB_XCB */
+  (void)current_display;
+  (void)wait;
+#endif /* HAVE_XLIB_XCB */
 }
 
-// Get all desktop names
-static inline void get_x11_desktop_names(Display *current_display, Window root,
-                                         Atom atom) {
-  Atom actual_type;
-  int actual_format;
-  unsigned long nitems;
-  unsigned long bytes_after;
-  unsigned char *prop = nullptr;
-  struct information *current_info = &info;
+void discard_x11_properties(Display *current_display) {
+#ifdef HAVE_XLIB_XCB
+  xcb_connection_t *connection = XGetXCBConnection(current_display);
 
-  if (atom == None) { return; }
-
-  if ((XGetWindowProperty(current_display, root, atom, 0, (~0L), False,
-                          ATOM(UTF8_STRING), &actual_type, &actual_format,
-                          &nitems, &bytes_after, &prop) == 0) &&
-      (actual_type == ATOM(UTF8_STRING)) && (nitems > 0L) &&
-      (actual_format == 8)) {
-    current_info->x11.desktop.all_names.assign(
-        reinterpret_cast<const char *>(prop), nitems);
+  for (const auto &pending : pending_x11_properties) {
+    xcb_discard_reply(connection, pending.cookie.sequence);
   }
-  if (prop != nullptr) { XFree(prop); }
+  pending_x11_properties.clear();
+#else  /* HAVE_XLIB_XCB */
+  (void)current_display;
+#endif /* HAVE_XLIB_XCB */
 }
 
 // Get current desktop name
@@ -1070,6 +1132,67 @@ static inline void get_x11_desktop_current_name(const std::string &names) {
   }
 }
 
+// Get current desktop number
+static inline void get_x11_desktop_current(Display *current_display,
+                                           Window root, Atom atom) {
+  if (atom == None) { return; }
+
+  fetch_x11_property(
+      current_display, root, atom, XA_CARDINAL, 0,
+      [](const x11_property &prop) {
+        struct information *current_info = &info;
+        if ((prop.type == XA_CARDINAL) && (prop.nitems == 1L) &&
+            (prop.format == 32)) {
+          current_info->x11.desktop.current = prop.item32(0) + 1;
+          get_x11_desktop_current_name(current_info->x11.desktop.all_names);
+        }
+      });
+}
+
+// Get total number of available desktops
+static inline void get_x11_desktop_number(Display *current_display, Window root,
+                                          Atom atom) {
+  if (atom == None) { return; }
+
+  fetch_x11_property(current_display, root, atom, XA_CARDINAL, 0,
+                     [](const x11_property &prop) {
+                       struct information *current_info = &info;
+                       if ((prop.type == XA_CARDINAL) && (prop.nitems == 1L) &&
+                           (prop.format == 32)) {
+                         current_info->x11.desktop.number = prop.item32(0);
+                       }
+                     });
+}
+
+// Get all desktop names, reading a chunk at a time
+static void get_x11_desktop_names(Display *current_display, Window root,
+                                  Atom atom, long offset = 0,
+                                  const std::string &names = std::string()) {
+  Atom utf8_string = ATOM(UTF8_STRING);
+
+  if (atom == None) { return; }
+
+  fetch_x11_property(
+      current_display, root, atom, utf8_string, offset,
+      [=](const x11_property &prop) {
+        struct information *current_info = &info;
+        if ((prop.type != utf8_string) || (prop.format != 8)) { return; }
+
+        std::string all_names(names);
+        all_names.append(reinterpret_cast<const char *>(prop.data),
+                         prop.nitems);
+        if (prop.bytes_after > 0 && prop.nitems > 0) {
+          get_x11_desktop_names(current_display, root, atom,
+                                offset + static_cast<long>(prop.nitems / 4),
+                                all_names);
+          return;
+        }
+        if (all_names.empty()) { return; }
+        current_info->x11.desktop.all_names = std::move(all_names);
+        get_x11_desktop_current_name(current_info->x11.desktop.all_names);
+      });
+}
+
 void get_x11_desktop_info(Display *current_display, Atom atom) {
   Window root;
   static Atom atom_current, atom_number, atom_names;
@@ -1086,7 +1209,6 @@ void get_x11_desktop_info(Display *current_display, Atom atom) {
     get_x11_desktop_current(current_display, root, atom_current);
     get_x11_desktop_number(current_display, root, atom_number);
     get_x11_desktop_names(current_display, root, atom_names);
-    get_x11_desktop_current_name(current_info->x11.desktop.all_names);
 
     /* Set the PropertyChangeMask on the root window, if not set */
     XGetWindowAttributes(display, root, &window_attributes);
@@ -1100,16 +1222,138 @@ void get_x11_desktop_info(Display *current_display, Atom atom) {
   } else {
     if (atom == atom_current) {
       get_x11_desktop_current(current_display, root, atom_current);
-      get_x11_desktop_current_name(current_info->x11.desktop.all_names);
     } else if (atom == atom_number) {
       get_x11_desktop_number(current_display, root, atom_number);
     } else if (atom == atom_names) {
       get_x11_desktop_names(current_display, root, atom_names);
-      get_x11_desktop_current_name(current_info->x11.desktop.all_names);
     }
   }
 }
 
+static bool is_conky_window(Window w) {
+  return w == window.window || w == window.root || w == window.desktop;
+}
+
+/* Replace the event mask of a foreign window. The window may be destroyed at
+ * any moment, so with XCB a BadWindow error is discarded instead of reaching
+ * the error handler. */
+static void select_x11_property_events(Display *current_display, Window w,
+                                       long mask) {
+#ifdef HAVE_XLIB_XCB
+  xcb_connection_t *connection = XGetXCBConnection(current_display);
+  uint32_t value = static_cast<uint32_t>(mask);
+  xcb_void_cookie_t cookie = xcb_change_window_attributes_checked(
+      connection, w, XCB_CW_EVENT_MASK, &value);
+  xcb_discard_reply(connection, cookie.sequence);
+#else  /* HAVE_XLIB_XCB */
+  XSelectInput(current_display, w, mask);
+#endif /* HAVE_XLIB_XCB */
+}
+
+// Get title of the active window, falling back to WM_NAME
+static void get_x11_active_window_title(Display *current_display, Window w,
+                                        Atom atom_name) {
+  Atom utf8_string = ATOM(UTF8_STRING);
+
+  fetch_x11_property(
+      current_display, w, atom_name, utf8_string, 0,
+      [=](const x11_property &prop) {
+        struct active_window_info *active = &info.x11.active_window;
+        /* stale reply for a window that has lost focus since */
+        if (active->window != w) { return; }
+        if ((prop.type == utf8_string) && (prop.format == 8)) {
+          active->title.assign(reinterpret_cast<const char *>(prop.data),
+                               prop.nitems);
+          return;
+        }
+        fetch_x11_property(
+            current_display, w, XA_WM_NAME, AnyPropertyType, 0,
+            [=](const x11_property &prop) {
+              struct active_window_info *active = &info.x11.active_window;
+              if (active->window != w) { return; }
+              if (prop.format == 8) {
+                active->title.assign(reinterpret_cast<const char *>(prop.data),
+                                     prop.nitems);
+              } else {
+                active->title.clear();
+              }
+            });
+      });
+}
+
+static void set_x11_active_window(Display *current_display, Window w,
+                                  Atom atom_name) {
+  struct active_window_info *active = &info.x11.active_window;
+
+  if (w == active->window) { return; }
+
+  /* Title changes are only followed for the window currently in focus */
+  if (active->window != None && !is_conky_window(active->window)) {
+    select_x11_property_events(current_display, active->window, NoEventMask);
+  }
+  active->window = w;
+  active->title.clear();
+  if (w == None) { return; }
+  if (!is_conky_window(w)) {
+    select_x11_property_events(current_display, w, PropertyChangeMask);
+  }
+  get_x11_active_window_title(current_display, w, atom_name);
+}
+
+void get_x11_active_window_info(Display *current_display, Window w,
+                                Atom atom) {
+  static Atom atom_active, atom_name;
+  Window root = RootWindow(current_display, info.x11.monitor.current);
+
+  /* Check if we initialise else retrieve changed property */
+  if (atom == 0) {
+    atom_active = XInternAtom(current_display, "_NET_ACTIVE_WINDOW", True);
+    atom_name = XInternAtom(current_display, "_NET_WM_NAME", False);
+  } else if (w == info.x11.active_window.window &&
+             (atom == atom_name || atom == XA_WM_NAME)) {
+    get_x11_active_window_title(current_display, w, atom_name);
+    return;
+  } else if (w != root || atom != atom_active) {
+    return;
+  }
+  if (atom_active == None) { return; }
+
+  fetch_x11_property(current_display, root, atom_active, XA_WINDOW, 0,
+                     [=](const x11_property &prop) {
+                       Window active = None;
+                       if ((prop.type == XA_WINDOW) && (prop.nitems == 1L) &&
+                           (prop.format == 32)) {
+                         active = prop.item32(0);
+                       }
+                       set_x11_active_window(current_display, active,
+                                             atom_name);
+                     });
+}
+
+void get_x11_keyboard_indicators(Display *current_display,
+                                 const XkbIndicatorNotifyEvent *ev) {
+  struct keyboard_info *keyboard = &info.x11.keyboard;
+
+  /* Check if we initialise else take the state from the notification */
+  if (ev == nullptr) {
+    int opcode, error_base, major = XkbMajorVersion, minor = XkbMinorVersion;
+    if (XkbQueryExtension(current_display, &opcode, &window.xkb_event_base,
+                          &error_base, &major, &minor) == 0) {
+      window.xkb_event_base = 0;
+      keyboard->tracked = false;
+      return;
+    }
+    XkbSelectEventDetails(current_display, XkbUseCoreKbd,
+                          XkbIndicatorStateNotify, XkbAllIndicatorsMask,
+                          XkbAllIndicatorsMask);
+    keyboard->tracked = XkbGetIndicatorState(current_display, XkbUseCoreKbd,
+                                             &keyboard->led_mask) == Success;
+  } else {
+    keyboard->led_mask = ev->state;
+    keyboard->tracked = true;
+  }
+}
+
 static const char NOT_IN_X[] = "Not running in X";
 
 void print_monitor(struct text_object *obj, char *p, unsigned int p_max_size) {
@@ -1165,6 +1409,17 @@ void print_desktop_name(struct text_object *obj, char *p,
   }
 }
 
+void print_active_window_title(struct text_object *obj, char *p,
+                               unsigned int p_max_size) {
+  (void)obj;
+
+  if (!out_to_x.get(*state)) {
+    strncpy(p, NOT_IN_X, p_max_size);
+  } else {
+    snprintf(p, p_max_size, "%s", info.x11.active_window.title.c_str());
+  }
+}
+
 #ifdef OWN_WINDOW
 namespace x11_strut {
 enum value : size_t {
@@ -1457,9 +1712,13 @@ void swap_x11_buffers() {
 }
 
 void print_kdb_led(const int keybit, char *p, unsigned int p_max_size) {
-  XKeyboardState x;
-  XGetKeyboardControl(display, &x);
-  snprintf(p, p_max_size, "%s", (x.led_mask & keybit ? "On" : "Off"));
+  unsigned long led_mask = info.x11.keyboard.led_mask;
+  if (!info.x11.keyboard.tracked) {
+    XKeyboardState x;
+    XGetKeyboardControl(display, &x);
+    led_mask = x.led_mask;
+  }
+  snprintf(p, p_max_size, "%s", (led_mask & keybit ? "On" : "Off"));
 }
 void print_key_caps_lock(struct text_object *obj, char *p,
                          unsigned int p_max_size) {
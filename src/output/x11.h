@@ -121,17 +121,17 @@ struct conky_x11_window {
   /// XDamage error base index; 0 if unavailable.
   int xdamage_error_base = 0;
 
+  /// XKB event base index; 0 if unavailable.
+  int xkb_event_base = 0;
+
   /// Client-side region accumulating areas needing repaint (from Expose
   /// events).
   Region repaint_region = 0;
 
   /// XDamage handle for conky's window; `None` if XDamage is unavailable.
   Damage window_damage = 0;
-  /// Server-side region accumulating damaged areas reported by XDamage.
-  XserverRegion damage_region = 0;
-  /// Server-side scratch region holding a single XDamageNotify area before it
-  /// is unioned into `damage_region`.
-  XserverRegion damage_scratch = 0;
+  /// Set when XDamageNotify was received since damage was last subtracted.
+  bool damage_pending = false;
 
   back_buffer_t back_buffer;
   XftDraw *xftdraw;
@@ -154,6 +154,28 @@ void destroy_window(void);
 void create_gc(void);
 void set_transparent_background(conky_x11_window *win);
 void get_x11_desktop_info(Display *current_display, Atom atom);
+/// @brief Tracks `_NET_ACTIVE_WINDOW` and the title of that window.
+///
+/// Called with atom `0` once at startup, then with every `PropertyNotify`.
+void get_x11_active_window_info(Display *current_display, Window w, Atom atom);
+/// @brief Dispatches replies to property requests issued by the functions
+/// above.
+///
+/// Returns without blocking unless `wait` is set; a no-op without XCB, where
+/// properties are read synchronously.
+void resolve_x11_properties(Display *current_display, bool wait);
+/// @brief Drops property requests still waiting for a reply, along with
+/// their handlers.
+///
+/// Must be called before `current_display` is closed, the sequence numbers
+/// mean nothing on another connection.
+void discard_x11_properties(Display *current_display);
+/// @brief Updates cached keyboard indicator state.
+///
+/// Called with `nullptr` once at startup to select `XkbIndicatorStateNotify`
+/// and read the initial state, then with each received notification.
+void get_x11_keyboard_indicators(Display *current_display,
+                                 const XkbIndicatorNotifyEvent *ev);
 /// @brief Sets reserved area atoms for the conky window to avoid other windows
 /// covering it.
 ///
@@ -157,4 +157,11 @@ void run_all_callbacks() {
 
   while (wait-- > 0) { sem_wait.wait(); }
 }
+
+/* Callbacks no one holds a handle to are included too, objects registering
+ * theirs on every print only keep them alive that way. */
+void for_each_callback(
+    const std::function<void(const priv::callback_base &)> &fn) {
+  for (const auto &cb : priv::callback_base::callbacks) { fn(*cb); }
+}
 }  // namespace conky
@@ -24,6 +24,7 @@
 #define UPDATE_CB_HH
 
 #include <cstdint>
+#include <functional>
 #include <memory>
 #include <thread>
 // the following probably requires a is-gcc-4.7.0 check
@@ -37,6 +38,10 @@
 #include "semaphore.hh"
 
 namespace conky {
+// what a single run of a callback, or a print of a text object, costs; used by
+// the --cost-report estimate
+enum class cost_class { syscall, file_open, fork, network, lua_call, reparse };
+
 // forward declarations
 template <typename Callback>
 class callback_handle;
@@ -44,6 +49,12 @@ void run_all_callbacks();
 template <typename Callback, typename... Params>
 callback_handle<Callback> register_cb(uint32_t period, Params &&...params);
 
+namespace priv {
+class callback_base;
+}
+void for_each_callback(
+    const std::function<void(const priv::callback_base &)> &fn);
+
 namespace priv {
 class callback_base {
   typedef callback_handle<callback_base> handle;
@@ -91,6 +102,8 @@ class callback_base {
                                                       Params &&...params);
 
   friend void conky::run_all_callbacks();
+  friend void conky::for_each_callback(
+      const std::function<void(const callback_base &)> &fn);
 
   template <typename Callback>
   friend class conky::callback_handle;
@@ -121,6 +134,12 @@ class callback_base {
   std::mutex result_mutex;
 
   virtual ~callback_base();
+
+  // what one run of work() costs, for --cost-report
+  virtual cost_class cost() const { return cost_class::syscall; }
+
+  // number of update intervals between two runs
+  uint32_t get_period() const { return period; }
 };
 
 }  // namespace priv
@@ -138,6 +157,8 @@ class callback_handle : private std::shared_ptr<Callback> {
   using Base::operator*;
 
   friend void conky::run_all_callbacks();
+  friend void conky::for_each_callback(
+      const std::function<void(const priv::callback_base &)> &fn);
   template <typename Callback_, typename... Params>
   friend callback_handle<Callback_> register_cb(uint32_t period,
                                                 Params &&...params);
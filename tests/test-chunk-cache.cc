@@ -0,0 +1,156 @@
+/*
+ *
+ * Conky, a system monitor, based on torsmo
+ *
+ * Any original torsmo code is licensed under the BSD license
+ *
+ * All code written since the fork of torsmo is licensed under the GPL
+ *
+ * Please see COPYING for details
+ *
+ * Copyright (c) 2005-2024 Brenden Matthews, Philip Kovacs, et. al.
+ *	(see AUTHORS)
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "catch2/catch.hpp"
+#include "test-fixtures.h"
+
+#include <sys/stat.h>
+#include <utime.h>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+
+#include <lua/chunk-cache.hh>
+
+extern "C" {
+#include <lauxlib.h>
+#include <lualib.h>
+}
+
+namespace {
+/* loads the script at path through the cache and returns what it returns */
+std::string run_script(lua_State *L, const std::string &path) {
+  REQUIRE(conky::load_cached_chunk(L, path.c_str()) == LUA_OK);
+  REQUIRE(lua_pcall(L, 0, 1, 0) == LUA_OK);
+  std::string result = lua_tostring(L, -1);
+  lua_pop(L, 1);
+  return result;
+}
+
+/* the header and payload hash lines of a cache file */
+std::string cache_header(const std::filesystem::path &cache) {
+  std::string header;
+  FILE *f = fopen(cache.c_str(), "r");
+  REQUIRE(f != nullptr);
+  char line[512];
+  for (int i = 0; i < 4 && fgets(line, sizeof line, f) != nullptr; ++i) {
+    header += line;
+  }
+  fclose(f);
+  return header;
+}
+
+int dump_writer(lua_State * /*L*/, const void *p, size_t size, void *ud) {
+  static_cast<std::string *>(ud)->append(static_cast<const char *>(p), size);
+  return 0;
+}
+}  // namespace
+
+TEST_CASE("load_cached_chunk caches compiled scripts", "[chunk_cache]") {
+  temp_dir tmp("chunk-cache");
+  const std::string &dir = tmp.path();
+  const char *old_cache_home = getenv("XDG_CACHE_HOME");
+  std::string saved = old_cache_home != nullptr ? old_cache_home : "";
+  setenv("XDG_CACHE_HOME", dir.c_str(), 1);
+
+  std::string script = dir + "/script.lua";
+  auto cache = conky::chunk_cache_path(script.c_str());
+  REQUIRE(cache.parent_path() == std::filesystem::path(dir) / "conky");
+
+  lua_State *L = luaL_newstate();
+  luaL_openlibs(L);
+  write_file(script, "#!/usr/bin/lua\nreturn 'first'\n");
+
+  SECTION("the first load writes the cache, the next one uses it") {
+    REQUIRE(run_script(L, script) == "first");
+    REQUIRE(std::filesystem::exists(cache));
+    REQUIRE(run_script(L, script) == "first");
+
+    struct stat st{};
+    REQUIRE(stat(cache.parent_path().c_str(), &st) == 0);
+    REQUIRE((st.st_mode & 0777) == 0700);
+    REQUIRE(stat(cache.c_str(), &st) == 0);
+    REQUIRE((st.st_mode & 0777) == 0600);
+  }
+
+  SECTION("an edit keeping size and mtime is caught by the content hash") {
+    struct stat st{};
+    REQUIRE(run_script(L, script) == "first");
+    REQUIRE(stat(script.c_str(), &st) == 0);
+
+    write_file(script, "#!/usr/bin/lua\nreturn 'other'\n");
+    struct utimbuf times{st.st_atime, st.st_mtime};
+    REQUIRE(utime(script.c_str(), &times) == 0);
+    REQUIRE(run_script(L, script) == "other");
+  }
+
+  SECTION("a corrupted cache falls back to the source") {
+    REQUIRE(run_script(L, script) == "first");
+    write_file(cache.string(), cache_header(cache) + "return 'injected'\n");
+    REQUIRE(run_script(L, script) == "first");
+  }
+
+  SECTION("bytecode not matching the hash in the header is ignored") {
+    REQUIRE(run_script(L, script) == "first");
+    std::string injected;
+    REQUIRE(luaL_loadstring(L, "return 'injected'") == LUA_OK);
+    REQUIRE(lua_dump(L, &dump_writer, &injected, 0) == 0);
+    lua_pop(L, 1);
+
+    write_file(cache.string(), cache_header(cache) + injected);
+    REQUIRE(run_script(L, script) == "first");
+  }
+
+  SECTION("a cache others could have written is ignored and replaced") {
+    REQUIRE(run_script(L, script) == "first");
+    REQUIRE(chmod(cache.c_str(), 0620) == 0);
+    REQUIRE(run_script(L, script) == "first");
+
+    struct stat st{};
+    REQUIRE(stat(cache.c_str(), &st) == 0);
+    REQUIRE((st.st_mode & 0777) == 0600);
+  }
+
+  SECTION("errors are reported like luaL_loadfile") {
+    std::string missing = dir + "/missing.lua";
+    REQUIRE(conky::load_cached_chunk(L, missing.c_str()) == LUA_ERRFILE);
+    lua_pop(L, 1);
+
+    write_file(script, "return (");
+    REQUIRE(conky::load_cached_chunk(L, script.c_str()) == LUA_ERRSYNTAX);
+    lua_pop(L, 1);
+  }
+
+  lua_close(L);
+  if (old_cache_home != nullptr) {
+    setenv("XDG_CACHE_HOME", saved.c_str(), 1);
+  } else {
+    unsetenv("XDG_CACHE_HOME");
+  }
+}
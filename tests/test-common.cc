@@ -30,9 +30,19 @@
                            // this in one cpp file
 
 #include "catch2/catch.hpp"
+#include "test-fixtures.h"
 
 #include <common.h>
 #include <conky.h>
+#include <content/text_object.h>
+#include <lua/lua-config.hh>
+
+#include <unistd.h>
+#include <cstdio>
+
+#ifdef HAVE_SYS_INOTIFY_H
+#include <sys/inotify.h>
+#endif /* HAVE_SYS_INOTIFY_H */
 
 using namespace Catch::Matchers;
 
@@ -251,3 +261,187 @@ TEST_CASE("swap_percentage and swap_barval return correct values") {
     REQUIRE_THAT(swap_barval(nullptr), WithinRel(0.25, 0.005));
   }
 }
+
+TEST_CASE("if_existing checks existence and file contents", "[if_existing]") {
+  temp_dir tmp("existing");
+  std::string file = tmp.path() + "/status";
+  struct text_object obj{};
+
+  SECTION("for a missing file") {
+    scan_existing_arg(&obj, file.c_str());
+    REQUIRE(if_existing_iftest(&obj) == 0);
+    free_existing(&obj);
+  }
+
+  SECTION("for text past the first 256 bytes") {
+    write_file(file, std::string(300, 'x') + "needle\n");
+
+    scan_existing_arg(&obj, (file + " needle").c_str());
+    REQUIRE(if_existing_iftest(&obj) == 1);
+    free_existing(&obj);
+
+    scan_existing_arg(&obj, (file + " haystack").c_str());
+    REQUIRE(if_existing_iftest(&obj) == 0);
+    free_existing(&obj);
+  }
+
+#ifdef HAVE_SYS_INOTIFY_H
+  SECTION("cached until the directory reports a change") {
+    inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    REQUIRE(inotify_fd != -1);
+
+    scan_existing_arg(&obj, file.c_str());
+    REQUIRE(if_existing_iftest(&obj) == 0);
+
+    write_file(file, "");
+    REQUIRE(if_existing_iftest(&obj) == 0);
+
+    char buf[4096];
+    ssize_t len = read(inotify_fd, buf, sizeof(buf));
+    REQUIRE(len > 0);
+    auto *ev = reinterpret_cast<struct inotify_event *>(buf);
+    existing_inotify_query(ev->wd, ev->mask);
+    REQUIRE(if_existing_iftest(&obj) == 1);
+
+    free_existing(&obj);
+    close(inotify_fd);
+    inotify_fd = -1;
+  }
+
+  SECTION("not woken by writes when only existence is checked") {
+    inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    REQUIRE(inotify_fd != -1);
+    write_file(file, "");
+
+    scan_existing_arg(&obj, file.c_str());
+    REQUIRE(if_existing_iftest(&obj) == 1);
+
+    write_file(file, "busy\n");
+    char buf[4096];
+    REQUIRE(read(inotify_fd, buf, sizeof(buf)) == -1);
+
+    free_existing(&obj);
+    close(inotify_fd);
+    inotify_fd = -1;
+  }
+
+  SECTION("forgotten when the event queue overflowed") {
+    inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    REQUIRE(inotify_fd != -1);
+
+    scan_existing_arg(&obj, file.c_str());
+    REQUIRE(if_existing_iftest(&obj) == 0);
+
+    write_file(file, "");
+    /* the events were lost, only the overflow is reported */
+    existing_inotify_query(-1, IN_Q_OVERFLOW);
+    REQUIRE(if_existing_iftest(&obj) == 1);
+
+    free_existing(&obj);
+    close(inotify_fd);
+    inotify_fd = -1;
+  }
+#endif /* HAVE_SYS_INOTIFY_H */
+}
+
+namespace {
+/* what the objects of test_chain() print, and how often they were asked */
+std::string test_output[3];
+int test_prints[3];
+
+template <int N>
+void print_test(struct text_object *, char *p, unsigned int p_max_size) {
+  ++test_prints[N];
+  snprintf(p, p_max_size, "%s", test_output[N].c_str());
+}
+
+/* a root followed by three objects printing test_output */
+struct test_chain {
+  struct text_object root{}, objs[3]{};
+
+  test_chain() {
+    objs[0].callbacks.print = &print_test<0>;
+    objs[1].callbacks.print = &print_test<1>;
+    objs[2].callbacks.print = &print_test<2>;
+    root.next = &objs[0];
+    objs[0].next = &objs[1];
+    objs[1].next = &objs[2];
+    for (int i = 0; i < 3; ++i) {
+      test_output[i].clear();
+      test_prints[i] = 0;
+    }
+  }
+};
+}  // namespace
+
+TEST_CASE("if_empty stops at the first object printing anything",
+          "[if_empty]") {
+  state = std::make_unique<lua::state>();
+  conky::export_symbols(*state);
+  test_chain chain;
+  struct text_object obj{};
+  obj.sub = &chain.root;
+
+  SECTION("all objects are printed when nothing is") {
+    REQUIRE(if_empty_iftest(&obj) == 1);
+    REQUIRE(test_prints[0] == 1);
+    REQUIRE(test_prints[1] == 1);
+    REQUIRE(test_prints[2] == 1);
+  }
+
+  SECTION("the rest is skipped after the first output") {
+    test_output[1] = "x";
+    REQUIRE(if_empty_iftest(&obj) == 0);
+    REQUIRE(test_prints[0] == 1);
+    REQUIRE(test_prints[1] == 1);
+    REQUIRE(test_prints[2] == 0);
+  }
+
+  SECTION("a false if block inside is skipped") {
+    /* objs[0] becomes ${if_existing missing}, jumping over objs[1] */
+    struct text_object cond{};
+    scan_existing_arg(&cond, "/nonexistent/conky-test");
+    chain.objs[0].data.opaque = cond.data.opaque;
+    chain.objs[0].callbacks.print = nullptr;
+    chain.objs[0].callbacks.iftest = &if_existing_iftest;
+    chain.objs[0].ifblock_next = &chain.objs[1];
+    test_output[1] = "skipped";
+
+    REQUIRE(if_empty_iftest(&obj) == 1);
+    REQUIRE(test_prints[1] == 0);
+    free_existing(&chain.objs[0]);
+  }
+}
+
+TEST_CASE("eval parses its first pass again only when it changed",
+          "[eval]") {
+  state = std::make_unique<lua::state>();
+  conky::export_symbols(*state);
+  test_chain chain;
+  chain.objs[0].next = nullptr;
+  struct text_object obj{};
+  char buf[64];
+
+  scan_evaluate_arg(&obj, "");
+  obj.sub->next = &chain.objs[0];
+
+  test_output[0] = "a$$b";
+  print_evaluate(&obj, buf, sizeof(buf));
+  REQUIRE(std::string(buf) == "a$b");
+  print_evaluate(&obj, buf, sizeof(buf));
+  REQUIRE(std::string(buf) == "a$b");
+
+  test_output[0] = "c$$d";
+  print_evaluate(&obj, buf, sizeof(buf));
+  REQUIRE(std::string(buf) == "c$d");
+
+  /* objects in the first pass output are evaluated too */
+  test_output[0] = "${if_existing /nonexistent/conky-test}x${else}y${endif}";
+  print_evaluate(&obj, buf, sizeof(buf));
+  REQUIRE(std::string(buf) == "y");
+  REQUIRE(test_prints[0] == 4);
+
+  obj.sub->next = nullptr;
+  free_evaluate(&obj);
+  free(obj.sub);
+}
@@ -28,7 +28,11 @@
 
 #include "catch2/catch.hpp"
 
+#include <string>
+#include <vector>
+
 #include <conky.h>
+#include <content/specials.h>
 #include <lua/lua-config.hh>
 
 TEST_CASE("Expressions can be evaluated", "[evaluate]") {
@@ -44,3 +48,52 @@ TEST_CASE("Expressions can be evaluated", "[evaluate]") {
     REQUIRE(strncmp(input, result, kMaxSize) == 0);
   }
 }
+
+TEST_CASE("Lines are laid out once with the width left after each segment",
+          "[layout]") {
+  /* cpu${alignc}load${offset}${alignr}42${color}% */
+  std::string line;
+  auto append_special = [&line](text_node_t type) {
+    char buf[2];
+    new_special(buf, type);
+    line += buf;
+  };
+  line += "cpu";
+  append_special(text_node_t::ALIGNC);
+  line += "load";
+  append_special(text_node_t::OFFSET);
+  append_special(text_node_t::ALIGNR);
+  line += "42";
+  append_special(text_node_t::FG);
+  line += "%";
+
+  line_layout layout;
+  layout_line(line.data(), specials, layout);
+
+  REQUIRE(layout.segments.size() == 8);
+  REQUIRE(layout.next_special == nullptr);
+  REQUIRE(layout.remaining.size() == layout.segments.size() + 1);
+
+  /* without a graphical output the width of the rest of the line used to be
+   * its strlen(), specials counting one char each */
+  std::vector<size_t> special_pos;
+  for (size_t i = 0; i < line.size(); i++) {
+    if (line[i] == SPECIAL_CHAR) { special_pos.push_back(i); }
+  }
+  REQUIRE(layout.remaining[0] == static_cast<int>(line.size()));
+  size_t n = 0;
+  for (size_t k = 0; k < layout.segments.size(); k++) {
+    if (layout.segments[k].special == nullptr) { continue; }
+    REQUIRE(layout.remaining[k + 1] ==
+            static_cast<int>(line.size() - special_pos[n] - 1));
+    n++;
+  }
+  REQUIRE(n == special_pos.size());
+
+  /* the ${alignr} is followed by "42", a special and a one-char tail */
+  REQUIRE(layout.segments[4].special->type == text_node_t::ALIGNR);
+  REQUIRE(layout.remaining[5] == 4);
+
+  free_specials(specials);
+  special_count = 0;
+}
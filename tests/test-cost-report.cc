@@ -0,0 +1,108 @@
+/*
+ *
+ * Conky, a system monitor, based on torsmo
+ *
+ * Any original torsmo code is licensed under the BSD license
+ *
+ * All code written since the fork of torsmo is licensed under the GPL
+ *
+ * Please see COPYING for details
+ *
+ * Copyright (c) 2005-2024 Brenden Matthews, Philip Kovacs, et. al.
+ *	(see AUTHORS)
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "catch2/catch.hpp"
+
+#include <conky.h>
+#include <content/text_object.h>
+#include <core.h>
+#include <cost-report.h>
+#include <lua/lua-config.hh>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+namespace {
+void ensure_lua_state() {
+  if (state) { return; }
+  state = std::make_unique<lua::state>();
+  conky::export_symbols(*state);
+}
+
+const conky::cost_entry *find_entry(const std::vector<conky::cost_entry> &v,
+                                    const std::string &source) {
+  auto i = std::find_if(v.begin(), v.end(), [&](const conky::cost_entry &e) {
+    return e.source == source;
+  });
+  return i != v.end() ? &*i : nullptr;
+}
+}  // namespace
+
+TEST_CASE("estimate_costs ranks objects by cost per update",
+          "[cost_report]") {
+  ensure_lua_state();
+  conky::cost_report_requested = true;
+
+  struct text_object root{};
+  char text[] =
+      "${cat /etc/hostname}\n"
+      "${exec true} ${exec true}\n"
+      "${lua_parse f}\n"
+      "${lowercase ${eval x}}";
+  extract_variable_text_internal(&root, text);
+  auto costs = conky::estimate_costs(&root);
+  conky::cost_report_requested = false;
+
+  REQUIRE_FALSE(costs.empty());
+  for (size_t i = 1; i < costs.size(); ++i) {
+    REQUIRE(costs[i - 1].score() >= costs[i].score());
+  }
+
+  SECTION("objects sharing a callback are charged once") {
+    auto *exec = find_entry(costs, "exec_cb for ${exec true}");
+    REQUIRE(exec != nullptr);
+    REQUIRE(exec->cls == conky::cost_class::fork);
+    REQUIRE(exec->count == 1);
+    REQUIRE(exec->runs_per_update == 1.0);
+    REQUIRE(exec->line == 1);
+    REQUIRE(costs.front().source == exec->source);
+  }
+
+  SECTION("an object can do more than one kind of work") {
+    auto *cat = find_entry(costs, "${cat /etc/hostname}");
+    REQUIRE(cat != nullptr);
+    REQUIRE(cat->cls == conky::cost_class::file_open);
+    REQUIRE(cat->line == 0);
+
+    int lua_parse = 0;
+    for (const auto &e : costs) {
+      if (e.source == "${lua_parse f}") { ++lua_parse; }
+    }
+    REQUIRE(lua_parse == 2);
+  }
+
+  SECTION("text parsed on every print isn't looked into") {
+    auto *lowercase = find_entry(costs, "${lowercase ${eval x}}");
+    REQUIRE(lowercase != nullptr);
+    REQUIRE(lowercase->cls == conky::cost_class::reparse);
+    REQUIRE(find_entry(costs, "${eval x}") == nullptr);
+  }
+
+  free_text_objects(&root);
+}
@@ -0,0 +1,73 @@
+/*
+ *
+ * Conky, a system monitor, based on torsmo
+ *
+ * Any original torsmo code is licensed under the BSD license
+ *
+ * All code written since the fork of torsmo is licensed under the GPL
+ *
+ * Please see COPYING for details
+ *
+ * Copyright (c) 2005-2024 Brenden Matthews, Philip Kovacs, et. al.
+ *	(see AUTHORS)
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "catch2/catch.hpp"
+
+#ifdef __x86_64__
+#include <common.h>
+#include <conky.h>
+#include <content/text_object.h>
+#include <data/hardware/cpu.h>
+
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+TEST_CASE("print_freq2 measures between updates without sleeping",
+          "[freq2]") {
+  struct text_object obj {};
+  char buf[64] = {};
+
+  scan_freq2_arg(&obj, nullptr);
+
+  current_update_time = get_time();
+  auto start = std::chrono::steady_clock::now();
+  print_freq2(&obj, buf, sizeof(buf));
+  auto elapsed = std::chrono::steady_clock::now() - start;
+
+  // no previous sample yet, so nothing to report
+  REQUIRE(buf[0] == '\0');
+  REQUIRE(elapsed < std::chrono::milliseconds(50));
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  current_update_time = get_time();
+  print_freq2(&obj, buf, sizeof(buf));
+
+  REQUIRE(std::strstr(buf, " MHz") != nullptr);
+  REQUIRE(std::strtoul(buf, nullptr, 10) > 0);
+
+  SECTION("repeated prints within one update reuse the sample") {
+    char again[64] = {};
+    print_freq2(&obj, again, sizeof(again));
+    REQUIRE(std::strcmp(buf, again) == 0);
+  }
+
+  free_freq2(&obj);
+  REQUIRE(obj.data.opaque == nullptr);
+}
+#endif /* __x86_64__ */
@@ -0,0 +1,97 @@
+/*
+ *
+ * Conky, a system monitor, based on torsmo
+ *
+ * Any original torsmo code is licensed under the BSD license
+ *
+ * All code written since the fork of torsmo is licensed under the GPL
+ *
+ * Please see COPYING for details
+ *
+ * Copyright (c) 2005-2024 Brenden Matthews, Philip Kovacs, et. al.
+ *	(see AUTHORS)
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "catch2/catch.hpp"
+#include "test-fixtures.h"
+
+#include <unistd.h>
+#include <cstdio>
+#include <string>
+
+#include <common.h>
+#include <data/exec.h>
+#include <update-cb.hh>
+
+TEST_CASE("run_command collects output and enforces its timeout", "[exec]") {
+  SECTION("output is returned without the trailing newline") {
+    std::string output;
+    REQUIRE(run_command("echo hello", 5.0, output) == exec_status::ok);
+    REQUIRE(output == "hello");
+  }
+
+  SECTION("output larger than a pipe buffer is read completely") {
+    std::string output;
+    REQUIRE(run_command("head -c 200000 /dev/zero | tr '\\0' x", 5.0,
+                        output) == exec_status::ok);
+    REQUIRE(output.size() == 200000);
+  }
+
+  SECTION("hung commands are killed along with their children") {
+    std::string output;
+    double start = get_time();
+    REQUIRE(run_command("echo partial; sleep 30 & sleep 30", 0.3, output) ==
+            exec_status::timed_out);
+    REQUIRE(get_time() - start < 5.0);
+    REQUIRE(output == "partial");
+  }
+}
+
+TEST_CASE("exec_cb keeps the last output while its command is stale",
+          "[exec]") {
+  temp_dir tmp("exec");
+  std::string hang = tmp.path() + "/hang";
+  std::string cmd = "if [ -e " + hang + " ]; then sleep 30; else echo fresh; fi";
+
+  {
+    auto cb = conky::register_cb<exec_cb>(1, true, cmd, 0.3);
+    conky::run_all_callbacks();
+    REQUIRE(cb->get_result_copy() == "fresh");
+    REQUIRE_FALSE(cb->is_stale());
+
+    write_file(hang, "");
+    conky::run_all_callbacks();
+    REQUIRE(cb->get_result_copy() == "fresh");
+    REQUIRE(cb->is_stale());
+
+    unlink(hang.c_str());
+    conky::run_all_callbacks();
+    REQUIRE_FALSE(cb->is_stale());
+  }
+
+  /* nobody owns the callback any more, it goes away after a few runs */
+  bool registered = true;
+  for (int i = 0; i < 10 && registered; ++i) {
+    conky::run_all_callbacks();
+    registered = false;
+    conky::for_each_callback(
+        [&registered](const conky::priv::callback_base &) {
+          registered = true;
+        });
+  }
+  REQUIRE_FALSE(registered);
+}
@@ -0,0 +1,72 @@
+/*
+ *
+ * Conky, a system monitor, based on torsmo
+ *
+ * Any original torsmo code is licensed under the BSD license
+ *
+ * All code written since the fork of torsmo is licensed under the GPL
+ *
+ * Please see COPYING for details
+ *
+ * Copyright (c) 2005-2024 Brenden Matthews, Philip Kovacs, et. al.
+ *	(see AUTHORS)
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/* Helpers shared by tests that feed collectors a fake /proc or /sys tree */
+
+#ifndef _TEST_FIXTURES_H
+#define _TEST_FIXTURES_H
+
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+
+#include "catch2/catch.hpp"
+
+/* writes contents to path, creating the directories leading to it */
+inline void write_file(const std::string &path, const std::string &contents) {
+  std::filesystem::create_directories(
+      std::filesystem::path(path).parent_path());
+  FILE *f = fopen(path.c_str(), "w");
+  REQUIRE(f != nullptr);
+  REQUIRE(fwrite(contents.data(), 1, contents.size(), f) == contents.size());
+  fclose(f);
+}
+
+/* a fresh /tmp/conky-<name>-XXXXXX, removed with everything in it when the
+ * test case or section that made it ends */
+class temp_dir {
+  std::string path_;
+
+ public:
+  explicit temp_dir(const std::string &name) {
+    std::string dir = "/tmp/conky-" + name + "-XXXXXX";
+    REQUIRE(mkdtemp(dir.data()) != nullptr);
+    path_ = dir;
+  }
+  ~temp_dir() { std::filesystem::remove_all(path_); }
+
+  temp_dir(const temp_dir &) = delete;
+  temp_dir &operator=(const temp_dir &) = delete;
+
+  const std::string &path() const { return path_; }
+};
+
+#endif /* _TEST_FIXTURES_H */
@@ -0,0 +1,87 @@
+/*
+ *
+ * Conky, a system monitor, based on torsmo
+ *
+ * Any original torsmo code is licensed under the BSD license
+ *
+ * All code written since the fork of torsmo is licensed under the GPL
+ *
+ * Please see COPYING for details
+ *
+ * Copyright (c) 2005-2024 Brenden Matthews, Philip Kovacs, et. al.
+ *	(see AUTHORS)
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "catch2/catch.hpp"
+
+#include <config.h>
+
+#ifdef BUILD_CURL
+#include <data/network/github.h>
+
+#include <string>
+
+TEST_CASE("github_parse_notifications counts unread threads",
+          "[github]") {
+  size_t unread = 99;
+  std::string message = "stale";
+
+  SECTION("empty list") {
+    REQUIRE(github_parse_notifications(" [ ] ", &unread, &message));
+    REQUIRE(unread == 0);
+    REQUIRE(message.empty());
+  }
+
+  SECTION("only unread:true counts, wherever it appears") {
+    const std::string json = R"([
+      {"id": "1", "unread": true, "subject": {"title": "unread: true"}},
+      {"id": "2", "unread": false, "reason": "mention"},
+      {"subject": {"unread": true}, "unread": true, "n": -1.5e3},
+      {"id": "4", "unread": "true", "repository": null}
+    ])";
+    REQUIRE(github_parse_notifications(json, &unread, &message));
+    REQUIRE(unread == 2);
+    REQUIRE(message.empty());
+  }
+
+  SECTION("error objects carry a message") {
+    REQUIRE(github_parse_notifications(
+        R"({"message": "Bad credentials – \"token\"",)"
+        R"( "documentation_url": "https://docs.github.com/rest"})",
+        &unread, &message));
+    REQUIRE(unread == 0);
+    REQUIRE(message == "Bad credentials \xe2\x80\x93 \"token\"");
+  }
+}
+
+TEST_CASE("github_parse_notifications rejects malformed JSON", "[github]") {
+  size_t unread;
+  std::string message;
+
+  REQUIRE_FALSE(github_parse_notifications("", &unread, &message));
+  REQUIRE_FALSE(github_parse_notifications("[", &unread, &message));
+  REQUIRE_FALSE(
+      github_parse_notifications(R"([{"unread": true},])", &unread, &message));
+  REQUIRE_FALSE(
+      github_parse_notifications(R"([{"unread": tru}])", &unread, &message));
+  REQUIRE_FALSE(
+      github_parse_notifications(R"({"message": "a\qb"})", &unread, &message));
+  REQUIRE_FALSE(github_parse_notifications("[] []", &unread, &message));
+  REQUIRE_FALSE(github_parse_notifications(std::string(100, '['), &unread,
+                                           &message));
+}
+#endif /* BUILD_CURL */
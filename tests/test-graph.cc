@@ -262,6 +262,34 @@ TEST_CASE("graph slot reuse across draw cycles") {
     obj2.callbacks.free(&obj2);
     free_specials_list();
   }
+
+  SECTION("graphs bound to a series draw its history") {
+    struct text_object obj1 = {}, obj2 = {};
+    graph_series series;
+    scan_graph(&obj1, "2,10", 0.0, FALSE);
+    scan_graph(&obj2, "2,20", 0.0, FALSE);
+    bind_graph_series(&obj1, &series);
+    for (double v : {1.0, 2.0, 3.0}) { series.push(v); }
+
+    char buf[64];
+
+    special_count = 0;
+    new_graph(&obj1, buf, sizeof(buf), 0.0);
+    REQUIRE(specials->graph_data[0] == 3.0);
+    REQUIRE(specials->graph_data[1] == 2.0);
+
+    /* a graph bound later backfills from the same series */
+    bind_graph_series(&obj2, &series);
+    special_count = 0;
+    new_graph(&obj2, buf, sizeof(buf), 0.0);
+    REQUIRE(specials->graph_data[0] == 3.0);
+    REQUIRE(specials->graph_data[2] == 1.0);
+    REQUIRE(specials->graph_data[3] == 0.0);
+
+    obj1.callbacks.free(&obj1);
+    obj2.callbacks.free(&obj2);
+    free_specials_list();
+  }
 }
 
 TEST_CASE("scan_command correctly parses input strings") {
@@ -289,3 +317,31 @@ TEST_CASE("scan_command correctly parses input strings") {
 }
 
 #endif /* BUILD_GUI */
+
+TEST_CASE("graph_series keeps the newest samples") {
+  graph_series series;
+
+  SECTION("without capacity nothing is kept") {
+    series.push(1.0);
+    REQUIRE(series.size() == 0);
+  }
+
+  SECTION("wraps around when full") {
+    series.reserve(3);
+    for (double v : {1.0, 2.0, 3.0, 4.0}) { series.push(v); }
+    REQUIRE(series.size() == 3);
+    REQUIRE(series.at(0) == 4.0);
+    REQUIRE(series.at(2) == 2.0);
+  }
+
+  SECTION("growing keeps history in order") {
+    series.reserve(2);
+    for (double v : {1.0, 2.0, 3.0}) { series.push(v); }
+    series.reserve(4);
+    series.push(5.0);
+    REQUIRE(series.size() == 3);
+    REQUIRE(series.at(0) == 5.0);
+    REQUIRE(series.at(1) == 3.0);
+    REQUIRE(series.at(2) == 2.0);
+  }
+}
@@ -0,0 +1,179 @@
+/*
+ *
+ * Conky, a system monitor, based on torsmo
+ *
+ * Any original torsmo code is licensed under the BSD license
+ *
+ * All code written since the fork of torsmo is licensed under the GPL
+ *
+ * Please see COPYING for details
+ *
+ * Copyright (c) 2005-2024 Brenden Matthews, Philip Kovacs, et. al.
+ *	(see AUTHORS)
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "catch2/catch.hpp"
+
+#include <config.h>
+
+#ifdef BUILD_IRC
+#include <arpa/inet.h>
+#include <content/text_object.h>
+#include <data/network/irc.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+/* A tiny scripted ircd: accepts one client, welcomes it once it registered,
+ * and after the JOIN plays the given channel messages. */
+class scripted_ircd {
+ public:
+  explicit scripted_ircd(std::vector<std::string> script)
+      : script(std::move(script)) {
+    listener = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0;
+    bind(listener, reinterpret_cast<sockaddr *>(&addr), sizeof(addr));
+    socklen_t len = sizeof(addr);
+    getsockname(listener, reinterpret_cast<sockaddr *>(&addr), &len);
+    port = ntohs(addr.sin_port);
+    listen(listener, 1);
+    server = std::thread([this]() { run(); });
+  }
+
+  ~scripted_ircd() {
+    server.join();
+    close(listener);
+  }
+
+  unsigned short port;
+
+ private:
+  bool wait_readable(int fd) {
+    pollfd pfd{fd, POLLIN, 0};
+    return poll(&pfd, 1, 5000) == 1;
+  }
+
+  void send_line(int fd, const std::string &line) {
+    std::string out = line + "\r\n";
+    (void)!write(fd, out.data(), out.size());
+  }
+
+  void run() {
+    if (!wait_readable(listener)) { return; }
+    int client = accept(listener, nullptr, nullptr);
+    std::string received;
+    char buf[512];
+    bool welcomed = false;
+
+    while (wait_readable(client)) {
+      ssize_t n = read(client, buf, sizeof(buf));
+      if (n <= 0) { break; }
+      received.append(buf, n);
+      if (!welcomed && received.find("USER ") != std::string::npos) {
+        send_line(client, ":ircd.test 001 conky :Welcome");
+        welcomed = true;
+      }
+      if (received.find("JOIN #conky") != std::string::npos) {
+        for (const auto &line : script) { send_line(client, line); }
+        script.clear();
+      }
+    }
+    close(client);
+  }
+
+  int listener;
+  std::vector<std::string> script;
+  std::thread server;
+};
+
+std::string poll_irc(struct text_object *obj, size_t want_lines) {
+  char buf[4096];
+  std::string out;
+
+  for (int i = 0; i < 250; i++) {
+    buf[0] = 0;
+    print_irc(obj, buf, sizeof(buf));
+    out = buf;
+    if (!out.empty() &&
+        static_cast<size_t>(std::count(out.begin(), out.end(), '\n')) + 1 >=
+            want_lines) {
+      break;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  }
+  return out;
+}
+}  // namespace
+
+TEST_CASE("irc_backlog keeps the newest lines in order", "[irc]") {
+  irc_backlog backlog(3);
+  char buf[256];
+
+  SECTION("empty backlog renders nothing") {
+    REQUIRE(backlog.render(buf, sizeof(buf), false) == 0);
+    REQUIRE(buf[0] == '\0');
+  }
+
+  SECTION("overflow drops the oldest lines") {
+    backlog.push("a", "one");
+    backlog.push("b", "two");
+    backlog.push("c", "three");
+    backlog.push("d", "four");
+
+    REQUIRE(backlog.render(buf, sizeof(buf), false) == 3);
+    REQUIRE(std::string(buf) == "b: two\nc: three\nd: four");
+    // history is kept when not consuming
+    REQUIRE(backlog.render(buf, sizeof(buf), true) == 3);
+    REQUIRE(backlog.render(buf, sizeof(buf), false) == 0);
+  }
+
+  SECTION("output is truncated to the buffer size") {
+    backlog.push("nick", "a rather long message");
+    REQUIRE(backlog.render(buf, 8, false) == 1);
+    REQUIRE(std::string(buf) == "nick: a");
+  }
+}
+
+TEST_CASE("irc object shows channel messages from a server", "[irc]") {
+  scripted_ircd ircd({
+      ":alice!a@test PRIVMSG #conky :first",
+      ":bob!b@test PRIVMSG #conky :second",
+      ":carol!c@test PRIVMSG #conky :third",
+  });
+  struct text_object obj {};
+  std::string arg = "127.0.0.1:" + std::to_string(ircd.port) + " #conky 2";
+
+  parse_irc_args(&obj, arg.c_str());
+  std::string out = poll_irc(&obj, 2);
+  REQUIRE(out == "bob: second\ncarol: third");
+  // with max_msg_lines the history stays visible
+  REQUIRE(poll_irc(&obj, 2) == out);
+  free_irc(&obj);
+}
+#endif /* BUILD_IRC */
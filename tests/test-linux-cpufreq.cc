@@ -0,0 +1,135 @@
+/*
+ *
+ * Conky, a system monitor, based on torsmo
+ *
+ * Any original torsmo code is licensed under the BSD license
+ *
+ * All code written since the fork of torsmo is licensed under the GPL
+ *
+ * Please see COPYING for details
+ *
+ * Copyright (c) 2005-2024 Brenden Matthews, Philip Kovacs, et. al.
+ *	(see AUTHORS)
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "catch2/catch.hpp"
+#include "test-fixtures.h"
+
+#ifdef __linux__
+#include <content/text_object.h>
+#include <data/hardware/cpufreq.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+
+using namespace Catch::Matchers;
+
+/* open descriptors on files under root */
+static int open_under(const std::string &root) {
+  int count = 0;
+  for (const auto &fd : std::filesystem::directory_iterator("/proc/self/fd")) {
+    std::error_code ec;
+    auto target = std::filesystem::read_symlink(fd.path(), ec);
+    if (!ec && target.string().rfind(root, 0) == 0) { count++; }
+  }
+  return count;
+}
+
+TEST_CASE("cpufreq reads frequency, idle residency and core types",
+          "[cpufreq]") {
+  temp_dir tmp("sysfs");
+  const std::string &root = tmp.path();
+  std::string cpu = root + "/devices/system/cpu";
+
+  for (int n = 0; n < 2; n++) {
+    std::string core = cpu + "/cpu" + std::to_string(n);
+    write_file(core + "/cpufreq/scaling_cur_freq", "800000\n");
+    write_file(core + "/cpuidle/state0/name", "POLL\n");
+    write_file(core + "/cpuidle/state0/time", "0\n");
+    write_file(core + "/cpuidle/state1/name", "C6\n");
+    write_file(core + "/cpuidle/state1/time", "1000000\n");
+  }
+  /* not a cpu */
+  std::filesystem::create_directories(cpu + "/cpufreq");
+
+  SECTION("from kept-open files") {
+    write_file(cpu + "/cpu0/cpu_capacity", "1024\n");
+    write_file(cpu + "/cpu1/cpu_capacity", "512\n");
+
+    REQUIRE(init_cpufreq(root) == 2);
+    sample_cpufreq(1.0);
+
+    unsigned long long khz = 0;
+    REQUIRE(cpufreq_khz(0, &khz));
+    REQUIRE(khz == 800000);
+    REQUIRE_FALSE(cpufreq_khz(2, &khz));
+
+    /* only the frequencies without a ${cpuidle} */
+    REQUIRE(open_under(root) == 2);
+    struct text_object obj{};
+    scan_cpuidle_arg(&obj, "0");
+    sample_cpufreq(2.0);
+    REQUIRE(open_under(root) == 6);
+
+    /* rewritten in place, as sysfs does */
+    write_file(cpu + "/cpu0/cpufreq/scaling_cur_freq", "3400000\n");
+    write_file(cpu + "/cpu0/cpuidle/state0/time", "100000\n");
+    write_file(cpu + "/cpu0/cpuidle/state1/time", "1500000\n");
+    sample_cpufreq(4.0);
+
+    REQUIRE(cpufreq_khz(0, &khz));
+    REQUIRE(khz == 3400000);
+    REQUIRE(cpufreq_khz(1, &khz));
+    REQUIRE(khz == 800000);
+    /* 0.5s of C6 and 0.1s of POLL over 2s */
+    REQUIRE_THAT(cpuidle_residency(0, "C6"), WithinAbs(25.0, 0.001));
+    REQUIRE_THAT(cpuidle_residency(0, "c6"), WithinAbs(25.0, 0.001));
+    REQUIRE_THAT(cpuidle_residency(0, "POLL"), WithinAbs(5.0, 0.001));
+    REQUIRE_THAT(cpuidle_residency(0, ""), WithinAbs(30.0, 0.001));
+    REQUIRE(cpuidle_residency(1, "") == 0);
+    REQUIRE(cpuidle_residency(0, "C10") == 0);
+
+    free_cpuidle(&obj);
+    sample_cpufreq(5.0);
+    REQUIRE(open_under(root) == 2);
+    REQUIRE(cpuidle_residency(0, "") == 0);
+
+    REQUIRE(cpu_core_type(0) == "P");
+    REQUIRE(cpu_core_type(1) == "E");
+  }
+
+  SECTION("preferring the hybrid PMU cpu lists") {
+    write_file(root + "/devices/cpu_core/cpus", "1\n");
+    write_file(root + "/devices/cpu_atom/cpus", "0\n");
+
+    REQUIRE(init_cpufreq(root) == 2);
+    REQUIRE(cpu_core_type(0) == "E");
+    REQUIRE(cpu_core_type(1) == "P");
+  }
+
+  SECTION("without anything to tell cores apart") {
+    REQUIRE(init_cpufreq(root) == 2);
+    REQUIRE(cpu_core_type(0).empty());
+  }
+
+  clear_cpufreq();
+}
+#endif /* __linux__ */
@@ -0,0 +1,140 @@
+/*
+ *
+ * Conky, a system monitor, based on torsmo
+ *
+ * Any original torsmo code is licensed under the BSD license
+ *
+ * All code written since the fork of torsmo is licensed under the GPL
+ *
+ * Please see COPYING for details
+ *
+ * Copyright (c) 2005-2024 Brenden Matthews, Philip Kovacs, et. al.
+ *	(see AUTHORS)
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "catch2/catch.hpp"
+#include "test-fixtures.h"
+
+#ifdef __linux__
+#include <data/interrupts.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+
+using namespace Catch::Matchers;
+
+namespace {
+const char *interrupts_before = R"(           CPU0       CPU1       CPU3       
+  0:         36          0          0  IR-IO-APIC    2-edge      timer
+  8:          0          0          0  IR-IO-APIC    8-edge      rtc0
+  9:        120         30          0  IR-IO-APIC    9-fasteoi   acpi
+ 16:       1000       2000          0  IR-IO-APIC   16-fasteoi   ehci_hcd:usb1, i801_smbus
+124:     500000          0     100000  IR-PCI-MSI 524288-edge      nvme0q1
+NMI:         10         10         10   Non-maskable interrupts
+LOC:    1000000    1000000    1000000   Local timer interrupts
+ERR:          0
+MIS:          0
+)";
+
+const char *interrupts_after = R"(           CPU0       CPU1       CPU3       
+  0:         36          0          0  IR-IO-APIC    2-edge      timer
+  8:          0          0          0  IR-IO-APIC    8-edge      rtc0
+  9:        120         30          0  IR-IO-APIC    9-fasteoi   acpi
+ 16:       1000       2200          0  IR-IO-APIC   16-fasteoi   ehci_hcd:usb1, i801_smbus
+125:         40          0          0  IR-PCI-MSI 1048576-edge      eth0-rx-0
+124:     520000          0     104000  IR-PCI-MSI 524288-edge      nvme0q1
+NMI:         10         10         10   Non-maskable interrupts
+LOC:    1001000    1000500    1000000   Local timer interrupts
+ERR:          2
+MIS:          0
+)";
+
+const char *softirqs_before = R"(                    CPU0       CPU1       CPU3       
+          HI:          1          0          0
+       TIMER:     100000      90000      80000
+      NET_TX:         10          5          0
+      NET_RX:       5000        100          0
+       BLOCK:       2000       1000        500
+)";
+
+const char *softirqs_after = R"(                    CPU0       CPU1       CPU3       
+          HI:          1          0          0
+       TIMER:     100100      90050      80000
+      NET_TX:         10          5          0
+      NET_RX:       9000        140          0
+       BLOCK:       2000       1000        500
+)";
+}  // namespace
+
+TEST_CASE("interrupt and softirq rates come from per-update deltas",
+          "[interrupts]") {
+  temp_dir tmp("proc");
+  const std::string &root = tmp.path();
+
+  write_file(root + "/interrupts", interrupts_before);
+  write_file(root + "/softirqs", softirqs_before);
+  sample_irqs(root, 1.0);
+
+  SECTION("nothing is reported before the second sample") {
+    REQUIRE(irq_rate("124", 0) == 0);
+    REQUIRE(softirq_rate("NET_RX", 0) == 0);
+    REQUIRE_FALSE(irq_top_entry(0, nullptr, nullptr, nullptr));
+  }
+
+  SECTION("after rows were added and counters went up") {
+    write_file(root + "/interrupts", interrupts_after);
+    write_file(root + "/softirqs", softirqs_after);
+    sample_irqs(root, 3.0);
+
+    REQUIRE_THAT(irq_rate("124", 0), WithinAbs(12000.0, 0.001));
+    REQUIRE_THAT(irq_rate("124", 1), WithinAbs(10000.0, 0.001));
+    /* columns are matched by cpu number, cpu2 is offline */
+    REQUIRE(irq_rate("124", 3) == 0);
+    REQUIRE_THAT(irq_rate("124", 4), WithinAbs(2000.0, 0.001));
+    REQUIRE_THAT(irq_rate("ERR", 0), WithinAbs(1.0, 0.001));
+    /* new since the last sample */
+    REQUIRE(irq_rate("125", 0) == 0);
+    REQUIRE(irq_rate("999", 0) == 0);
+
+    REQUIRE_THAT(softirq_rate("NET_RX", 0), WithinAbs(2020.0, 0.001));
+    REQUIRE_THAT(softirq_rate("NET_RX", 2), WithinAbs(20.0, 0.001));
+    REQUIRE_THAT(softirq_rate("TIMER", 1), WithinAbs(50.0, 0.001));
+
+    std::string irq, name;
+    double rate;
+    REQUIRE(irq_top_entry(0, &irq, &name, &rate));
+    REQUIRE(irq == "124");
+    REQUIRE(name == "nvme0q1");
+    REQUIRE_THAT(rate, WithinAbs(12000.0, 0.001));
+    REQUIRE(irq_top_entry(1, &irq, &name, nullptr));
+    REQUIRE(irq == "LOC");
+    REQUIRE(name == "Local timer interrupts");
+    REQUIRE(irq_top_entry(2, &irq, &name, nullptr));
+    REQUIRE(irq == "16");
+    REQUIRE(name == "ehci_hcd:usb1, i801_smbus");
+    REQUIRE(irq_top_entry(3, &irq, nullptr, nullptr));
+    REQUIRE(irq == "ERR");
+    /* idle interrupts aren't ranked */
+    REQUIRE_FALSE(irq_top_entry(4, nullptr, nullptr, nullptr));
+  }
+
+  clear_interrupts();
+}
+#endif /* __linux__ */
@@ -0,0 +1,139 @@
+/*
+ *
+ * Conky, a system monitor, based on torsmo
+ *
+ * Any original torsmo code is licensed under the BSD license
+ *
+ * All code written since the fork of torsmo is licensed under the GPL
+ *
+ * Please see COPYING for details
+ *
+ * Copyright (c) 2005-2024 Brenden Matthews, Philip Kovacs, et. al.
+ *	(see AUTHORS)
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "catch2/catch.hpp"
+#include "test-fixtures.h"
+
+#ifdef __linux__
+#include <conky.h>
+#include <data/memtopo.h>
+#include <lua/lua-config.hh>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+
+namespace {
+const char *node1_meminfo = R"(Node 1 MemTotal:       16000000 kB
+Node 1 MemFree:         4000000 kB
+Node 1 MemUsed:        12000000 kB
+Node 1 Active:          6000000 kB
+Node 1 FilePages:       3000000 kB
+Node 1 Shmem:            500000 kB
+Node 1 KReclaimable:     600000 kB
+Node 1 SReclaimable:     500000 kB
+Node 1 SUnreclaim:       100000 kB
+Node 1 HugePages_Total:    64
+Node 1 HugePages_Free:     16
+Node 1 HugePages_Surp:      0
+)";
+
+const char *proc_meminfo = R"(MemTotal:       32000000 kB
+MemFree:         8000000 kB
+SwapCached:            0 kB
+Zswap:            250000 kB
+Zswapped:        1000000 kB
+HugePages_Total:     128
+HugePages_Free:       96
+HugePages_Rsvd:        0
+Hugepagesize:       2048 kB
+)";
+}  // namespace
+
+TEST_CASE("memtopo reads nodes, zram, zswap and hugepages", "[memtopo]") {
+  if (!state) {
+    state = std::make_unique<lua::state>();
+    conky::export_symbols(*state);
+  }
+
+  temp_dir tmp("memtopo");
+  const std::string &root = tmp.path();
+
+  write_file(root + "/sys/devices/system/node/node0/meminfo",
+             "Node 0 MemTotal: 16000000 kB\nNode 0 MemFree: 16000000 kB\n");
+  write_file(root + "/sys/devices/system/node/node1/meminfo", node1_meminfo);
+  std::filesystem::create_directories(root + "/sys/devices/system/node/power");
+  write_file(root + "/sys/block/zram0/mm_stat",
+             "400000000 100000000 110000000 0 120000000 10 0 0 0\n");
+  write_file(root + "/sys/block/zram1/mm_stat",
+             "100000000 50000000 60000000 0 60000000 0 0 0 0\n");
+  write_file(root + "/sys/block/sda/stat", "0\n");
+  write_file(root + "/proc/meminfo", proc_meminfo);
+
+  REQUIRE(init_memtopo(root + "/sys", root + "/proc") == 2);
+  sample_memtopo();
+
+  unsigned long long total, free, used;
+  REQUIRE(node_meminfo(1, &total, &free, &used));
+  REQUIRE(total == 16000000);
+  REQUIRE(free == 4000000);
+  /* minus file pages that aren't shmem and reclaimable slab */
+  REQUIRE(used == 16000000 - 4000000 - 2500000 - 500000);
+  REQUIRE(node_meminfo(0, nullptr, nullptr, &used));
+  REQUIRE(used == 0);
+  REQUIRE_FALSE(node_meminfo(2, nullptr, nullptr, nullptr));
+
+  REQUIRE(hugepages_info(1, &total, &free));
+  REQUIRE(total == 64);
+  REQUIRE(free == 16);
+  REQUIRE(hugepages_info(-1, &total, &free));
+  REQUIRE(total == 128);
+  REQUIRE(free == 96);
+
+  unsigned long long orig, compr;
+  REQUIRE(zram_info("zram0", &orig, &compr, &used));
+  REQUIRE(orig == 400000000);
+  REQUIRE(compr == 100000000);
+  REQUIRE(used == 110000000);
+  REQUIRE(zram_info("", &orig, &compr, &used));
+  REQUIRE(orig == 500000000);
+  REQUIRE(compr == 150000000);
+  REQUIRE_FALSE(zram_info("zram2", &orig, &compr, &used));
+
+  unsigned long long pool, stored;
+  REQUIRE(zswap_info(&pool, &stored));
+  REQUIRE(pool == 250000);
+  REQUIRE(stored == 1000000);
+
+  SECTION("re-reading the open files on the next update") {
+    write_file(root + "/sys/devices/system/node/node0/meminfo",
+               "Node 0 MemTotal: 16000000 kB\nNode 0 MemFree: 1000000 kB\n");
+    write_file(root + "/proc/meminfo", "MemTotal: 32000000 kB\n");
+    sample_memtopo();
+
+    REQUIRE(node_meminfo(0, nullptr, &free, &used));
+    REQUIRE(free == 1000000);
+    REQUIRE(used == 15000000);
+    REQUIRE_FALSE(zswap_info(&pool, &stored));
+  }
+
+  clear_memtopo();
+}
+#endif /* __linux__ */
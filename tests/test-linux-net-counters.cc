@@ -0,0 +1,114 @@
+/*
+ *
+ * Conky, a system monitor, based on torsmo
+ *
+ * Any original torsmo code is licensed under the BSD license
+ *
+ * All code written since the fork of torsmo is licensed under the GPL
+ *
+ * Please see COPYING for details
+ *
+ * Copyright (c) 2005-2024 Brenden Matthews, Philip Kovacs, et. al.
+ *	(see AUTHORS)
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "catch2/catch.hpp"
+#include "test-fixtures.h"
+
+#ifdef __linux__
+#include <data/network/net_counters.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+
+using namespace Catch::Matchers;
+
+namespace {
+std::string snmp(long long out_segs, long long retrans, long long in_errors) {
+  return "Ip: Forwarding DefaultTTL InReceives\n"
+         "Ip: 1 64 123456\n"
+         "Tcp: RtoAlgorithm RtoMin RtoMax MaxConn ActiveOpens CurrEstab "
+         "OutSegs RetransSegs OutRsts\n"
+         "Tcp: 1 200 120000 -1 500 12 " +
+         std::to_string(out_segs) + " " + std::to_string(retrans) +
+         " 42\n"
+         "Udp: InDatagrams NoPorts InErrors OutDatagrams RcvbufErrors\n"
+         "Udp: 1000 3 " +
+         std::to_string(in_errors) + " 900 0\n";
+}
+
+const char *netstat_before = R"(TcpExt: SyncookiesSent ListenOverflows ListenDrops
+TcpExt: 0 10 10
+IpExt: InNoRoutes InOctets
+IpExt: 0 987654321
+)";
+
+/* as if a newer kernel had added a field in the middle */
+const char *netstat_after = R"(TcpExt: SyncookiesSent SyncookiesRecv ListenOverflows ListenDrops
+TcpExt: 0 0 30 30
+IpExt: InNoRoutes InOctets
+IpExt: 0 987654321
+)";
+}  // namespace
+
+TEST_CASE("net counters come from snmp and netstat", "[net_counters]") {
+  temp_dir tmp("netproc");
+  const std::string &root = tmp.path();
+
+  write_file(root + "/net/snmp", snmp(10000, 100, 5));
+  write_file(root + "/net/netstat", netstat_before);
+  write_file(root + "/sys/net/netfilter/nf_conntrack_count", "1024\n");
+  write_file(root + "/sys/net/netfilter/nf_conntrack_max", "4096\n");
+  sample_net_counters(root, 1.0);
+
+  long long value;
+  double rate;
+  REQUIRE(net_counter("Tcp", "MaxConn", &value, &rate));
+  REQUIRE(value == -1);
+  REQUIRE(rate == 0);
+  REQUIRE(net_counter("Tcp", "CurrEstab", &value, nullptr));
+  REQUIRE(value == 12);
+  REQUIRE_FALSE(net_counter("Tcp", "Nope", &value, &rate));
+  REQUIRE_FALSE(net_counter("Sctp", "OutSegs", &value, &rate));
+
+  unsigned long long count, max;
+  REQUIRE(conntrack_usage(&count, &max));
+  REQUIRE(count == 1024);
+  REQUIRE(max == 4096);
+
+  write_file(root + "/net/snmp", snmp(12000, 150, 9));
+  write_file(root + "/net/netstat", netstat_after);
+  sample_net_counters(root, 3.0);
+
+  REQUIRE(net_counter("Tcp", "RetransSegs", &value, &rate));
+  REQUIRE(value == 150);
+  REQUIRE_THAT(rate, WithinAbs(25.0, 0.001));
+  REQUIRE(net_counter("Udp", "InErrors", nullptr, &rate));
+  REQUIRE_THAT(rate, WithinAbs(2.0, 0.001));
+  REQUIRE_THAT(tcp_retrans_percentage(), WithinAbs(2.5, 0.001));
+
+  /* the header changed, so there's nothing to compare against yet */
+  REQUIRE(net_counter("TcpExt", "ListenDrops", &value, &rate));
+  REQUIRE(value == 30);
+  REQUIRE(rate == 0);
+
+  clear_net_counters();
+}
+#endif /* __linux__ */
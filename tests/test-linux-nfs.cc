@@ -0,0 +1,133 @@
+/*
+ *
+ * Conky, a system monitor, based on torsmo
+ *
+ * Any original torsmo code is licensed under the BSD license
+ *
+ * All code written since the fork of torsmo is licensed under the GPL
+ *
+ * Please see COPYING for details
+ *
+ * Copyright (c) 2005-2024 Brenden Matthews, Philip Kovacs, et. al.
+ *	(see AUTHORS)
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "catch2/catch.hpp"
+#include "test-fixtures.h"
+
+#ifdef __linux__
+#include <data/nfs.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+using namespace Catch::Matchers;
+
+namespace {
+std::string mountstats(unsigned long long read_ops,
+                       unsigned long long read_exec,
+                       unsigned long long getattr_trans,
+                       unsigned long long sends, unsigned long long recvs,
+                       unsigned long long backlog) {
+  char nfs[2048];
+
+  snprintf(nfs, sizeof(nfs),
+           "device nas:/export/home mounted on /home with fstype nfs4 "
+           "statvers=1.1\n"
+           "\topts:\trw,vers=4.2,rsize=1048576,wsize=1048576,hard,proto=tcp\n"
+           "\tage:\t86400\n"
+           "\tevents:\t1 2 3 4 5 6 7 8 9 10 11 12 13 14 15 16 17 18 19 20\n"
+           "\tbytes:\t1000 2000 0 0 500 600 0 0\n"
+           "\tRPC iostats version: 1.1  p/v: 100003/4 (nfs)\n"
+           "\txprt:\ttcp 875 1 1 0 0 %llu %llu 0 %llu %llu 2 0 0\n"
+           "\tper-op statistics\n"
+           "\t        NULL: 1 1 0 44 24 0 0 0 0\n"
+           "\t        READ: %llu %llu 0 165572 155223088 39 %llu %llu 0\n"
+           "\t       WRITE: 10 10 0 40960 1440 5 50 60 0\n"
+           "\t     GETATTR: 100 %llu 0 17000 24000 10 200 300 0\n"
+           "\n",
+           sends, recvs, sends, backlog, read_ops, read_ops, read_exec / 2,
+           read_exec, getattr_trans);
+  return std::string(
+             "device proc mounted on /proc with fstype proc\n"
+             "device /dev/sda1 mounted on / with fstype ext4\n") +
+         nfs;
+}
+}  // namespace
+
+TEST_CASE("nfs stats come from mountstats deltas", "[nfs]") {
+  temp_dir tmp("mountstats");
+  std::string file = tmp.path() + "/mountstats";
+
+  write_file(file, mountstats(1000, 2000, 100, 5000, 5000, 100));
+  sample_nfs_stats(file, 10.0);
+
+  nfs_op_stats stats;
+  REQUIRE(get_nfs_op_stats("/home", "READ", &stats));
+  REQUIRE(stats.ops == 0);
+  REQUIRE_FALSE(get_nfs_op_stats("/", "", &stats));
+  REQUIRE_FALSE(nfs_unhealthy("/home", 1000));
+
+  SECTION("for a healthy mount") {
+    write_file(file, mountstats(1100, 2500, 100, 5100, 5100, 300));
+    sample_nfs_stats(file, 12.0);
+
+    REQUIRE(get_nfs_op_stats("/home", "read", &stats));
+    REQUIRE_THAT(stats.ops, WithinAbs(50.0, 0.001));
+    REQUIRE_THAT(stats.exec, WithinAbs(5.0, 0.001));
+    REQUIRE_THAT(stats.rtt, WithinAbs(2.5, 0.001));
+    REQUIRE(stats.retrans == 0);
+    REQUIRE(get_nfs_op_stats("/home", "", &stats));
+    REQUIRE_THAT(stats.ops, WithinAbs(50.0, 0.001));
+    REQUIRE_FALSE(get_nfs_op_stats("/home", "COMMIT", &stats));
+
+    double backlog;
+    REQUIRE(get_nfs_backlog("/home", &backlog));
+    REQUIRE_THAT(backlog, WithinAbs(2.0, 0.001));
+    REQUIRE_FALSE(nfs_unhealthy("/home", 1000));
+    /* 5ms per READ */
+    REQUIRE(nfs_unhealthy("/home", 4));
+  }
+
+  SECTION("with retransmissions") {
+    write_file(file, mountstats(1000, 2000, 103, 5003, 5003, 100));
+    sample_nfs_stats(file, 12.0);
+
+    REQUIRE(get_nfs_op_stats("/home", "GETATTR", &stats));
+    REQUIRE_THAT(stats.retrans, WithinAbs(1.5, 0.001));
+    REQUIRE(nfs_unhealthy("/home", 1000));
+  }
+
+  SECTION("with requests that get no replies") {
+    write_file(file, mountstats(1000, 2000, 100, 5020, 5000, 100));
+    sample_nfs_stats(file, 12.0);
+
+    REQUIRE(nfs_unhealthy("/home", 1000));
+  }
+
+  SECTION("once the mount is gone") {
+    write_file(file, "device proc mounted on /proc with fstype proc\n");
+    sample_nfs_stats(file, 12.0);
+
+    REQUIRE_FALSE(get_nfs_op_stats("/home", "", &stats));
+  }
+
+  clear_nfs_stats();
+}
+#endif /* __linux__ */
@@ -32,6 +32,7 @@
 #include <conky.h>
 #include <content/text_object.h>
 #include <data/proc.h>
+#include <data/top.h>
 #include <sys/prctl.h>
 #include <sys/wait.h>
 #include <unistd.h>
@@ -375,4 +376,129 @@ TEST_CASE("pid_vm values map to correct status entries", "[proc][pid_vm]") {
   print_pid_vmexe(&obj, buf, sizeof(buf));
   REQUIRE(std::string(buf) == vmexe);
 }
+
+TEST_CASE("update_process_pss samples smaps_rollup of the RSS leaders",
+          "[proc][top_pss]") {
+  ensure_lua_state();
+
+  struct process *self = get_process(getpid());
+  self->time_stamp = g_time;
+  self->rss = 1;
+  self->pss_time = 0;
+
+  update_process_pss();
+
+  REQUIRE(self->pss_time > 0);
+  if (access("/proc/self/smaps_rollup", R_OK) == 0) {
+    REQUIRE(self->pss > 0);
+    REQUIRE(self->uss > 0);
+    REQUIRE(self->uss <= self->pss);
+  } else {
+    REQUIRE(self->pss == self->rss);
+  }
+}
+
+TEST_CASE("update_top_threads lists the threads of busy processes",
+          "[proc][top_thread]") {
+  ensure_lua_state();
+
+  std::atomic<bool> named{false}, done{false};
+  std::thread worker([&]() {
+    prctl(PR_SET_NAME, "conky-worker");
+    named = true;
+    while (!done) { std::this_thread::sleep_for(std::chrono::milliseconds(1)); }
+  });
+  while (!named) { std::this_thread::yield(); }
+
+  struct process *self = get_process(getpid());
+  self->time_stamp = g_time;
+  self->amount = 1000;
+
+  update_top_threads(100);
+
+  bool found = false;
+  int count = 0;
+  for (struct process *t = first_thread; t != nullptr; t = t->next, ++count) {
+    if (std::string(t->basename) == "conky-worker") {
+      found = true;
+      REQUIRE(t->uid == self->uid);
+      REQUIRE(std::string(t->name).find("/conky-worker") != std::string::npos);
+    }
+  }
+  REQUIRE(found);
+  REQUIRE(count >= 2);
+
+  done = true;
+  worker.join();
+
+  ++g_time;
+  self->time_stamp = g_time;
+  update_top_threads(100);
+  for (struct process *t = first_thread; t != nullptr; t = t->next) {
+    REQUIRE(std::string(t->basename) != "conky-worker");
+  }
+  free_all_threads();
+  REQUIRE(first_thread == nullptr);
+}
+
+TEST_CASE("top_app rolls children up into their subtree root",
+          "[proc][top_app]") {
+  ensure_lua_state();
+
+  pid_t child = spawn_stopped_child();
+  REQUIRE(child > 0);
+  int status = 0;
+  REQUIRE(waitpid(child, &status, WUNTRACED) == child);
+
+  child_guard guard;
+  guard.pid = child;
+
+  top_app = 1;
+  update_top();
+  top_app = 0;
+
+  struct process *self = get_process(getpid());
+  struct process *kid = get_process(child);
+  REQUIRE(kid->ppid == getpid());
+  REQUIRE(self->session == getsid(0));
+  if (self->session == self->pid) {
+    REQUIRE(kid->app_root == kid);
+  } else {
+    REQUIRE(kid->app_root == self->app_root);
+  }
+  REQUIRE(info.app[0] != nullptr);
+}
+TEST_CASE("top_app names cgroups after their leaf", "[proc][top_app]") {
+  ensure_lua_state();
+  const char *path = "/user.slice/app.slice/conky-test.scope";
+
+  struct process *self = get_process(getpid());
+  self->time_stamp = g_time;
+  free(self->cgroup);
+  self->cgroup = strdup(path);
+  state->loadstring("conky.config.top_app_group = 'cgroup'");
+  state->call(0, 0);
+  top_app = 1;
+  update_top();
+  top_app = 0;
+  state->loadstring("conky.config.top_app_group = nil");
+  state->call(0, 0);
+
+  int n = 0;
+  while (n < 10 && info.app[n] != nullptr &&
+         strcmp(info.app[n]->name, path) != 0) {
+    n++;
+  }
+  REQUIRE(n < 10);
+  REQUIRE(info.app[n] != nullptr);
+  REQUIRE(std::string(info.app[n]->basename) == "conky-test.scope");
+
+  struct text_object obj{};
+  std::string arg = "name " + std::to_string(n + 1);
+  REQUIRE(parse_top_args("top_app", arg.c_str(), &obj));
+  char buf[64] = {};
+  obj.callbacks.print(&obj, buf, sizeof(buf));
+  REQUIRE(std::string(buf).rfind("conky-test.scope", 0) == 0);
+  obj.callbacks.free(&obj);
+}
 #endif
@@ -0,0 +1,156 @@
+/*
+ *
+ * Conky, a system monitor, based on torsmo
+ *
+ * Any original torsmo code is licensed under the BSD license
+ *
+ * All code written since the fork of torsmo is licensed under the GPL
+ *
+ * Please see COPYING for details
+ *
+ * Copyright (c) 2005-2024 Brenden Matthews, Philip Kovacs, et. al.
+ *	(see AUTHORS)
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "catch2/catch.hpp"
+#include "test-fixtures.h"
+
+#ifdef __linux__
+#include <data/zfs.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+
+using namespace Catch::Matchers;
+
+namespace {
+std::string arcstats(unsigned long long hits, unsigned long long misses,
+                     unsigned long long size) {
+  return "13 1 0x01 147 39984 7358431720 1523684190322588\n"
+         "name                            type data\n"
+         "hits                            4    " +
+         std::to_string(hits) +
+         "\n"
+         "misses                          4    " +
+         std::to_string(misses) +
+         "\n"
+         "demand_data_hits                4    81237123\n"
+         "c                               4    8589934592\n"
+         "c_min                           4    1073741824\n"
+         "c_max                           4    17179869184\n"
+         "size                            4    " +
+         std::to_string(size) + "\n";
+}
+
+std::string objset(const char *dataset, unsigned long long nread,
+                   unsigned long long nwritten) {
+  return "52 1 0x01 7 2160 7358453218 1523684190443717\n"
+         "name                            type data\n"
+         "dataset_name                    7    " +
+         std::string(dataset) +
+         "\n"
+         "writes                          4    1234\n"
+         "nwritten                        4    " +
+         std::to_string(nwritten) +
+         "\n"
+         "reads                           4    5678\n"
+         "nread                           4    " +
+         std::to_string(nread) +
+         "\n"
+         "nunlinks                        4    12\n"
+         "nunlinked                       4    12\n";
+}
+}  // namespace
+
+TEST_CASE("zfs reads arcstats and pool io kstats", "[zfs]") {
+  temp_dir tmp("kstat");
+  const std::string &root = tmp.path();
+
+  write_file(root + "/arcstats", arcstats(9000, 1000, 4294967296));
+  write_file(root + "/tank/objset-0x36", objset("tank", 1000, 2000));
+  write_file(root + "/tank/objset-0x104", objset("tank/home", 500, 0));
+  write_file(root + "/tank/state", "ONLINE\n");
+  write_file(root + "/legacy/io",
+             "12 3 0x00 1 80 7358453218 1523684190443717\n"
+             "nread    nwritten reads    writes   wtime    wlentime\n"
+             "4096     8192     1        2        0        0\n");
+  write_file(root + "/dbufstats", "15 1 0x01 0 0 0 0\n");
+  sample_zfs(root, 1.0);
+
+  unsigned long long value;
+  REQUIRE(zfs_arc_stat("size", &value, nullptr));
+  REQUIRE(value == 4294967296);
+  REQUIRE(zfs_arc_stat("c_max", &value, nullptr));
+  REQUIRE(value == 17179869184ULL);
+  REQUIRE_FALSE(zfs_arc_stat("l2_hits", &value, nullptr));
+  REQUIRE(zfs_arc_hit_percentage() == 0);
+
+  write_file(root + "/arcstats", arcstats(9900, 1100, 4395630592));
+  write_file(root + "/tank/objset-0x36", objset("tank", 3000, 2000));
+  write_file(root + "/tank/objset-0x104", objset("tank/home", 1500, 4000));
+  write_file(root + "/legacy/io",
+             "12 3 0x00 1 80 7358453218 1523684190443717\n"
+             "nread    nwritten reads    writes   wtime    wlentime\n"
+             "8192     8192     2        2        0        0\n");
+  sample_zfs(root, 3.0);
+
+  double rate;
+  REQUIRE(zfs_arc_stat("hits", &value, &rate));
+  REQUIRE(value == 9900);
+  REQUIRE_THAT(rate, WithinAbs(450.0, 0.001));
+  REQUIRE_THAT(zfs_arc_hit_percentage(), WithinAbs(90.0, 0.001));
+
+  double read, written;
+  REQUIRE(zfs_pool_io("tank", &read, &written));
+  REQUIRE_THAT(read, WithinAbs(1500.0, 0.001));
+  REQUIRE_THAT(written, WithinAbs(2000.0, 0.001));
+  REQUIRE(zfs_pool_io("legacy", &read, &written));
+  REQUIRE_THAT(read, WithinAbs(2048.0, 0.001));
+  REQUIRE(written == 0);
+  REQUIRE_FALSE(zfs_pool_io("dbufstats", &read, &written));
+
+  SECTION("pools and datasets are picked up by a later scan") {
+    write_file(root + "/tank/objset-0x200", objset("tank/new", 100, 100));
+    write_file(root + "/pool2/objset-0x36", objset("pool2", 0, 0));
+    write_file(root + "/tank/objset-0x36", objset("tank", 4000, 2000));
+    sample_zfs(root, 4.0);
+
+    /* the same datasets as before */
+    REQUIRE(zfs_pool_io("tank", &read, &written));
+    REQUIRE_THAT(read, WithinAbs(1000.0, 0.001));
+    REQUIRE_FALSE(zfs_pool_io("pool2", &read, &written));
+
+    std::filesystem::remove_all(root + "/legacy");
+    sample_zfs(root, 31.0);
+    REQUIRE(zfs_pool_io("pool2", &read, &written));
+    REQUIRE_FALSE(zfs_pool_io("legacy", &read, &written));
+    /* the sums changed along with the datasets */
+    REQUIRE(zfs_pool_io("tank", &read, &written));
+    REQUIRE(read == 0);
+
+    write_file(root + "/tank/objset-0x200", objset("tank/new", 1100, 100));
+    sample_zfs(root, 32.0);
+    REQUIRE(zfs_pool_io("tank", &read, &written));
+    REQUIRE_THAT(read, WithinAbs(1000.0, 0.001));
+  }
+
+  clear_zfs();
+}
+#endif /* __linux__ */
@@ -0,0 +1,280 @@
+/*
+ *
+ * Conky, a system monitor, based on torsmo
+ *
+ * Any original torsmo code is licensed under the BSD license
+ *
+ * All code written since the fork of torsmo is licensed under the GPL
+ *
+ * Please see COPYING for details
+ *
+ * Copyright (c) 2005-2024 Brenden Matthews, Philip Kovacs, et. al.
+ *	(see AUTHORS)
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "catch2/catch.hpp"
+#include "test-fixtures.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include <unistd.h>
+
+#include <common.h>
+#include <conky.h>
+#include <content/text_object.h>
+#include <lua/llua.h>
+#include <lua/lua-config.hh>
+#include <update-cb.hh>
+
+namespace {
+/* sets up a Lua state with script loaded, closed again on destruction */
+class lua_fixture {
+  temp_dir tmp{"llua"};
+
+ public:
+  explicit lua_fixture(const std::string &script,
+                       const std::string &config = "") {
+    state = std::make_unique<lua::state>();
+    conky::export_symbols(*state);
+    if (!config.empty()) {
+      state->loadstring(config.c_str());
+      state->call(0, 0);
+    }
+    /* keep compiled chunks out of the real cache */
+    setenv("XDG_CACHE_HOME", tmp.path().c_str(), 1);
+
+    std::string path = tmp.path() + "/script.lua";
+    write_file(path, script);
+    llua_init();
+    llua_load(path.c_str());
+  }
+  ~lua_fixture() {
+    llua_close();
+    unsetenv("XDG_CACHE_HOME");
+  }
+
+  void reload() { llua_load((tmp.path() + "/script.lua").c_str()); }
+};
+
+/* ${lua call}, or an empty string when nothing was returned */
+std::string call_lua(const char *call) {
+  struct text_object obj{};
+  char buf[256]{};
+
+  obj.data.s = strdup(call);
+  print_lua(&obj, buf, sizeof(buf));
+  free(obj.data.s);
+  return buf;
+}
+
+/* callbacks registered with conky, owned by anyone or not */
+size_t registered_callbacks() {
+  size_t n = 0;
+  conky::for_each_callback([&n](const conky::priv::callback_base &) { ++n; });
+  return n;
+}
+
+/* runs updates until call returns something other than "nil" */
+std::string wait_for_lua(const char *call) {
+  std::string result = call_lua(call);
+  for (double start = get_time(); result == "nil" && get_time() - start < 5;
+       result = call_lua(call)) {
+    conky::run_all_callbacks();
+    usleep(10000);
+    llua_update_async();
+  }
+  return result;
+}
+}  // namespace
+
+TEST_CASE("lua_call_budget aborts and disables runaway functions", "[lua]") {
+  lua_fixture lua_state(R"(
+function conky_busy() while true do end end
+function conky_quick() return "ok" end
+function conky_stat(name, field)
+  local s = conky_call_stats()[name]
+  return tostring(s and s[field])
+end
+)",
+                        "conky.config.lua_call_budget = 20\n"
+                        "conky.config.lua_call_overrun_limit = 2\n");
+
+  SECTION("a call over budget is aborted and counted") {
+    double start = get_time();
+    REQUIRE(call_lua("busy").empty());
+    REQUIRE(get_time() - start < 5);
+    REQUIRE(call_lua("stat conky_busy calls") == "1");
+    REQUIRE(call_lua("stat conky_busy overruns") == "1");
+    REQUIRE(call_lua("stat conky_busy disabled") == "false");
+
+    REQUIRE(call_lua("quick") == "ok");
+    REQUIRE(call_lua("stat conky_quick overruns") == "0");
+  }
+
+  SECTION("a function is disabled after lua_call_overrun_limit overruns") {
+    call_lua("busy");
+    call_lua("busy");
+    REQUIRE(call_lua("stat conky_busy disabled") == "true");
+
+    /* not even called any more */
+    REQUIRE(call_lua("busy").empty());
+    REQUIRE(call_lua("stat conky_busy calls") == "2");
+
+    lua_state.reload();
+    REQUIRE(call_lua("stat conky_busy disabled") == "false");
+  }
+}
+
+TEST_CASE("lua_call_budget covers coroutines made outside a call", "[lua]") {
+  lua_fixture lua_state(R"(
+local spin = function() while true do end end
+local co = coroutine.create(spin)
+local wrapped = coroutine.wrap(spin)
+function conky_resume() return tostring(coroutine.resume(co)) end
+function conky_wrapped() return tostring(pcall(wrapped)) end
+)",
+                        "conky.config.lua_call_budget = 20\n");
+
+  double start = get_time();
+  REQUIRE(call_lua("resume") == "false");
+  REQUIRE(call_lua("wrapped") == "false");
+  REQUIRE(get_time() - start < 5);
+}
+
+TEST_CASE("conky_async.run resumes coroutines once their reads complete",
+          "[lua][async]") {
+  temp_dir tmp("llua-async");
+  std::string path = tmp.path() + "/data";
+  write_file(path, "contents");
+
+  lua_fixture lua_state(R"(
+local result
+function conky_start(path)
+  result = nil
+  conky_async.run(function(p)
+    local data, err = conky_async.read_file(p)
+    result = data or err
+  end, path)
+  return ""
+end
+function conky_result() return tostring(result) end
+function conky_sleep(seconds)
+  result = nil
+  conky_async.run(function()
+    conky_async.sleep(tonumber(seconds))
+    result = "awake"
+  end)
+  return ""
+end
+function conky_sleep_outside() return tostring(pcall(conky_async.sleep, 1)) end
+)");
+
+  SECTION("a read yields until its callback has run") {
+    call_lua(("start " + path).c_str());
+    REQUIRE(call_lua("result") == "nil");
+    llua_update_async();
+    REQUIRE(call_lua("result") == "nil");
+
+    REQUIRE(wait_for_lua("result") == "contents");
+  }
+
+  SECTION("a failed read resumes with its error") {
+    call_lua(("start " + tmp.path() + "/missing").c_str());
+    REQUIRE(wait_for_lua("result") ==
+            tmp.path() + "/missing: No such file or directory");
+  }
+
+  SECTION("sleep resumes only once its time is up") {
+    call_lua("sleep 0.2");
+    llua_update_async();
+    REQUIRE(call_lua("result") == "nil");
+
+    usleep(250000);
+    llua_update_async();
+    REQUIRE(call_lua("result") == "awake");
+  }
+
+  SECTION("sleep is refused outside of conky_async.run") {
+    REQUIRE(call_lua("sleep_outside") == "false");
+  }
+}
+
+TEST_CASE("conky_async reads outside of run are cached while asked for",
+          "[lua][async]") {
+  temp_dir tmp("llua-async");
+  std::string path = tmp.path() + "/data";
+  write_file(path, "contents");
+  std::string call = "cached " + path;
+
+  lua_fixture lua_state(R"(
+function conky_cached(path) return tostring(conky_async.read_file(path)) end
+)");
+
+  /* let callbacks nobody owns from earlier tests go first */
+  for (int i = 0; i < 10; ++i) { conky::run_all_callbacks(); }
+  size_t before = registered_callbacks();
+  REQUIRE(wait_for_lua(call.c_str()) == "contents");
+  REQUIRE(registered_callbacks() == before + 1);
+
+  /* still asked for every update, the callback is kept */
+  for (int i = 0; i < 10; ++i) {
+    llua_update_async();
+    conky::run_all_callbacks();
+    REQUIRE(call_lua(call.c_str()) == "contents");
+  }
+  REQUIRE(registered_callbacks() == before + 1);
+
+  /* dropped from the cache after 2 * period + 1 updates without a request,
+   * then by conky once no one owns it */
+  for (int i = 0; i < 3; ++i) {
+    llua_update_async();
+    conky::run_all_callbacks();
+  }
+  REQUIRE(registered_callbacks() == before + 1);
+  for (int i = 0; i < 10; ++i) {
+    llua_update_async();
+    conky::run_all_callbacks();
+  }
+  REQUIRE(registered_callbacks() == before);
+}
+
+TEST_CASE("conky_async.http_get only fetches loopback URLs", "[lua][async]") {
+  lua_fixture lua_state(R"(
+function conky_get(url) return tostring(pcall(conky_async.http_get, url)) end
+)");
+
+#ifdef BUILD_CURL
+  for (const char *url :
+       {"http://127.0.0.1:8080/status", "http://127.1.2.3/", "https://[::1]/",
+        "http://localhost/", "http://LOCALHOST:80/x"}) {
+    INFO(url);
+    REQUIRE(call_lua((std::string("get ") + url).c_str()) == "true");
+  }
+  for (const char *url :
+       {"http://example.com/", "http://128.0.0.1/", "http://[::2]/",
+        "http://localhost@example.com/", "http://user@127.0.0.1/",
+        "ftp://127.0.0.1/", "file:///etc/passwd", "127.0.0.1"}) {
+    INFO(url);
+    REQUIRE(call_lua((std::string("get ") + url).c_str()) == "false");
+  }
+#else
+  /* no error, just nothing to fetch with */
+  REQUIRE(call_lua("get http://127.0.0.1/") == "true");
+#endif /* BUILD_CURL */
+}
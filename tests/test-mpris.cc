@@ -0,0 +1,340 @@
+/*
+ *
+ * Conky, a system monitor, based on torsmo
+ *
+ * Any original torsmo code is licensed under the BSD license
+ *
+ * All code written since the fork of torsmo is licensed under the GPL
+ *
+ * Please see COPYING for details
+ *
+ * Copyright (c) 2005-2024 Brenden Matthews, Philip Kovacs, et. al.
+ *	(see AUTHORS)
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "catch2/catch.hpp"
+
+#include <config.h>
+
+#ifdef BUILD_MPRIS
+#include <conky.h>
+#include <content/text_object.h>
+#include <data/audio/mpris.h>
+#include <lua/lua-config.hh>
+#include <dbus/dbus.h>
+#include <signal.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <thread>
+
+namespace {
+// Mirrors the layout of `struct bar` in specials.cc so the parsed dimensions
+// can be read back out of obj.special_data.
+struct bar {
+  char flags;
+  int width, height;
+  double scale;
+};
+
+/* a dbus-daemon of our own, so the tests never touch the user's bus */
+struct private_bus {
+  pid_t pid = 0;
+  std::string address;
+
+  private_bus() {
+    FILE *out = popen(
+        "dbus-daemon --session --fork --print-address=1 --print-pid=1 "
+        "2>/dev/null",
+        "r");
+    char line[512];
+
+    if (out == nullptr) { return; }
+    if (fgets(line, sizeof(line), out) != nullptr) {
+      address = line;
+      address.erase(address.find_last_not_of('\n') + 1);
+    }
+    if (fgets(line, sizeof(line), out) != nullptr) { pid = atoi(line); }
+    pclose(out);
+    if (!address.empty()) {
+      setenv("DBUS_SESSION_BUS_ADDRESS", address.c_str(), 1);
+    }
+  }
+
+  ~private_bus() {
+    if (pid > 0) { kill(pid, SIGTERM); }
+  }
+
+  bool running() const { return pid > 0 && !address.empty(); }
+};
+
+void append_variant(DBusMessageIter *dict, const char *key, int type,
+                    const void *value) {
+  DBusMessageIter entry, variant;
+  const char sig[2] = {static_cast<char>(type), 0};
+
+  dbus_message_iter_open_container(dict, DBUS_TYPE_DICT_ENTRY, nullptr,
+                                   &entry);
+  dbus_message_iter_append_basic(&entry, DBUS_TYPE_STRING, &key);
+  dbus_message_iter_open_container(&entry, DBUS_TYPE_VARIANT, sig, &variant);
+  dbus_message_iter_append_basic(&variant, type, value);
+  dbus_message_iter_close_container(&entry, &variant);
+  dbus_message_iter_close_container(dict, &entry);
+}
+
+void append_metadata(DBusMessageIter *dict, const char *title) {
+  DBusMessageIter entry, variant, meta, inner, artists, list;
+  const char *key = "Metadata";
+  const char *artist_key = "xesam:artist";
+  const char *artist_names[] = {"Alice", "Bob"};
+  const char *trackid = "/org/conky/track/1";
+  dbus_int64_t length = 180000000;
+
+  dbus_message_iter_open_container(dict, DBUS_TYPE_DICT_ENTRY, nullptr,
+                                   &entry);
+  dbus_message_iter_append_basic(&entry, DBUS_TYPE_STRING, &key);
+  dbus_message_iter_open_container(&entry, DBUS_TYPE_VARIANT, "a{sv}",
+                                   &variant);
+  dbus_message_iter_open_container(&variant, DBUS_TYPE_ARRAY, "{sv}", &meta);
+  append_variant(&meta, "xesam:title", DBUS_TYPE_STRING, &title);
+  append_variant(&meta, "mpris:trackid", DBUS_TYPE_OBJECT_PATH, &trackid);
+  append_variant(&meta, "mpris:length", DBUS_TYPE_INT64, &length);
+  dbus_message_iter_open_container(&meta, DBUS_TYPE_DICT_ENTRY, nullptr,
+                                   &inner);
+  dbus_message_iter_append_basic(&inner, DBUS_TYPE_STRING, &artist_key);
+  dbus_message_iter_open_container(&inner, DBUS_TYPE_VARIANT, "as", &artists);
+  dbus_message_iter_open_container(&artists, DBUS_TYPE_ARRAY, "s", &list);
+  for (const char *name : artist_names) {
+    dbus_message_iter_append_basic(&list, DBUS_TYPE_STRING, &name);
+  }
+  dbus_message_iter_close_container(&artists, &list);
+  dbus_message_iter_close_container(&inner, &artists);
+  dbus_message_iter_close_container(&meta, &inner);
+  dbus_message_iter_close_container(&variant, &meta);
+  dbus_message_iter_close_container(&entry, &variant);
+  dbus_message_iter_close_container(dict, &entry);
+}
+
+/* A mock player answering Properties.GetAll from its own thread. */
+class mock_player {
+ public:
+  mock_player() {
+    connection = dbus_bus_get_private(DBUS_BUS_SESSION, nullptr);
+    dbus_connection_set_exit_on_disconnect(connection, FALSE);
+    dbus_bus_request_name(connection, MPRIS_BUS_PREFIX "mock",
+                          DBUS_NAME_FLAG_DO_NOT_QUEUE, nullptr);
+    server = std::thread([this]() { serve(); });
+  }
+
+  ~mock_player() { quit(); }
+
+  void quit() {
+    if (!running) { return; }
+    running = false;
+    server.join();
+    dbus_connection_close(connection);
+    dbus_connection_unref(connection);
+  }
+
+  void emit_status(const char *status) {
+    emit([status](DBusMessageIter *dict) {
+      append_variant(dict, "PlaybackStatus", DBUS_TYPE_STRING, &status);
+    });
+  }
+
+  void emit_seeked(dbus_int64_t position) {
+    DBusMessage *msg = dbus_message_new_signal(
+        "/org/mpris/MediaPlayer2", "org.mpris.MediaPlayer2.Player", "Seeked");
+    dbus_message_append_args(msg, DBUS_TYPE_INT64, &position,
+                             DBUS_TYPE_INVALID);
+    send(msg);
+  }
+
+ private:
+  DBusConnection *connection;
+  std::atomic<bool> running{true};
+  std::thread server;
+
+  void send(DBusMessage *msg) {
+    dbus_connection_send(connection, msg, nullptr);
+    dbus_connection_flush(connection);
+    dbus_message_unref(msg);
+  }
+
+  void emit(const std::function<void(DBusMessageIter *)> &fill) {
+    DBusMessage *msg =
+        dbus_message_new_signal("/org/mpris/MediaPlayer2",
+                                "org.freedesktop.DBus.Properties",
+                                "PropertiesChanged");
+    DBusMessageIter it, dict, invalidated;
+    const char *iface = "org.mpris.MediaPlayer2.Player";
+
+    dbus_message_iter_init_append(msg, &it);
+    dbus_message_iter_append_basic(&it, DBUS_TYPE_STRING, &iface);
+    dbus_message_iter_open_container(&it, DBUS_TYPE_ARRAY, "{sv}", &dict);
+    fill(&dict);
+    dbus_message_iter_close_container(&it, &dict);
+    dbus_message_iter_open_container(&it, DBUS_TYPE_ARRAY, "s", &invalidated);
+    dbus_message_iter_close_container(&it, &invalidated);
+    send(msg);
+  }
+
+  void serve() {
+    while (running) {
+      dbus_connection_read_write(connection, 20);
+      while (DBusMessage *msg = dbus_connection_pop_message(connection)) {
+        if (dbus_message_is_method_call(msg, "org.freedesktop.DBus.Properties",
+                                        "GetAll")) {
+          DBusMessage *reply = dbus_message_new_method_return(msg);
+          DBusMessageIter it, dict;
+          const char *status = "Playing";
+          double rate = 1.0, volume = 0.5;
+          dbus_int64_t position = 5000000;
+
+          dbus_message_iter_init_append(reply, &it);
+          dbus_message_iter_open_container(&it, DBUS_TYPE_ARRAY, "{sv}",
+                                           &dict);
+          append_variant(&dict, "PlaybackStatus", DBUS_TYPE_STRING, &status);
+          append_variant(&dict, "Rate", DBUS_TYPE_DOUBLE, &rate);
+          append_variant(&dict, "Volume", DBUS_TYPE_DOUBLE, &volume);
+          append_variant(&dict, "Position", DBUS_TYPE_INT64, &position);
+          append_metadata(&dict, "Mock Song");
+          dbus_message_iter_close_container(&it, &dict);
+          send(reply);
+        }
+        dbus_message_unref(msg);
+      }
+    }
+  }
+};
+
+bool dispatch_until(mpris_client &client, double now,
+                    const std::function<bool()> &done) {
+  for (int i = 0; i < 200; i++) {
+    client.dispatch(now);
+    if (done()) { return true; }
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  return false;
+}
+}  // namespace
+
+TEST_CASE("mpris_player extrapolates the position while playing",
+          "[mpris]") {
+  mpris_player player;
+  player.status = "Playing";
+  player.position = 1000000;
+  player.position_time = 10.0;
+  player.length = 4000000;
+
+  REQUIRE(player.position_at(11.5) == 2500000);
+  // clamped to the track length
+  REQUIRE(player.position_at(20.0) == 4000000);
+
+  player.rate = 2.0;
+  REQUIRE(player.position_at(11.0) == 3000000);
+
+  player.status = "Paused";
+  REQUIRE(player.position_at(11.0) == 1000000);
+}
+
+TEST_CASE("mpris_select_player picks the requested or a playing player",
+          "[mpris]") {
+  std::vector<mpris_player> players(3);
+  players[0].bus_name = MPRIS_BUS_PREFIX "spotify";
+  players[0].status = "Paused";
+  players[1].bus_name = MPRIS_BUS_PREFIX "vlc.instance42";
+  players[1].status = "Playing";
+  players[2].bus_name = MPRIS_BUS_PREFIX "vlcfake";
+
+  REQUIRE(mpris_select_player(players, nullptr) == &players[1]);
+  REQUIRE(mpris_select_player(players, "") == &players[1]);
+  REQUIRE(mpris_select_player(players, "spotify") == &players[0]);
+  REQUIRE(mpris_select_player(players, "vlc") == &players[1]);
+  REQUIRE(mpris_select_player(players, "mpd") == nullptr);
+  REQUIRE(mpris_select_player({}, nullptr) == nullptr);
+}
+
+TEST_CASE("scan_mpris_bar takes an optional player before the size",
+          "[mpris]") {
+  state = std::make_unique<lua::state>();
+  conky::export_symbols(*state);
+
+  auto scan = [](const char *arg, std::string &player) {
+    struct text_object obj{};
+    scan_mpris_bar(&obj, arg);
+    auto *b = static_cast<struct bar *>(obj.special_data);
+    std::pair<int, int> dims{b->height, b->width};
+    player = obj.data.s != nullptr ? obj.data.s : "";
+    free(obj.special_data);
+    gen_free_opaque(&obj);
+    return dims;
+  };
+  std::string player;
+
+  REQUIRE(scan("spotify 3,120", player) == std::make_pair(3, 120));
+  REQUIRE(player == "spotify");
+  REQUIRE(scan("5,80", player) == std::make_pair(5, 80));
+  REQUIRE(player.empty());
+  scan("vlc", player);
+  REQUIRE(player == "vlc");
+  scan(nullptr, player);
+  REQUIRE(player.empty());
+}
+
+TEST_CASE("mpris_client follows a player through signals", "[mpris]") {
+  private_bus bus;
+  if (!bus.running()) { SKIP("dbus-daemon is not available"); }
+
+  mock_player mock;
+  mpris_client client;
+
+  REQUIRE(client.connect(100.0));
+  REQUIRE(client.get_players().size() == 1);
+  {
+    const mpris_player &player = client.get_players().front();
+    REQUIRE(player.bus_name == MPRIS_BUS_PREFIX "mock");
+    REQUIRE(player.status == "Playing");
+    REQUIRE(player.title == "Mock Song");
+    REQUIRE(player.artist == "Alice, Bob");
+    REQUIRE(player.length == 180000000);
+    REQUIRE(player.volume == 0.5);
+    REQUIRE(player.position_at(102.0) == 7000000);
+  }
+
+  mock.emit_status("Paused");
+  REQUIRE(dispatch_until(client, 103.0, [&client]() {
+    return client.get_players().front().status == "Paused";
+  }));
+  // the position is frozen where playback was paused
+  REQUIRE(client.get_players().front().position_at(110.0) == 8000000);
+
+  mock.emit_seeked(60000000);
+  REQUIRE(dispatch_until(client, 111.0, [&client]() {
+    return client.get_players().front().position == 60000000;
+  }));
+
+  mock.quit();
+  REQUIRE(dispatch_until(
+      client, 112.0, [&client]() { return client.get_players().empty(); }));
+}
+#endif /* BUILD_MPRIS */
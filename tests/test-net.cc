@@ -27,14 +27,18 @@
  */
 
 #include "catch2/catch.hpp"
+#include "test-fixtures.h"
 
+#include <unistd.h>
 #include <cstdlib>
+#include <filesystem>
 #include <utility>
 
 #include <conky.h>
 #include <content/specials.h>
 #include <content/text_object.h>
 #include <data/exec.h>
+#include <data/network/net_accounting.h>
 #include <data/network/net_stat.h>
 #include <lua/lua-config.hh>
 
@@ -100,3 +104,64 @@ TEST_CASE("get_barnum returns 0.0 silently for empty or null input", "[exec]") {
 
   SECTION("value at 0 returns 0") { REQUIRE(get_barnum("0") == 0.0); }
 }
+
+TEST_CASE("net accounting integrates totals into buckets", "[net]") {
+  state = std::make_unique<lua::state>();
+  conky::export_symbols(*state);
+
+  temp_dir tmp("netacct");
+  setenv("XDG_STATE_HOME", tmp.path().c_str(), 1);
+  std::string file = tmp.path() + "/conky/net_accounting";
+
+  struct text_object obj{};
+  parse_net_total_arg(&obj, "acct0 rx", NET_PERIOD_DAY);
+  struct net_stat *ns = get_net_stat("acct0", nullptr, nullptr);
+  time_t now = time(nullptr);
+
+  /* never read: the first totals are since boot and must not count */
+  ns->recv = 1000000;
+  update_net_accounting(now);
+  REQUIRE(net_accounting_total("acct0", NET_PERIOD_DAY, true, true) == 0);
+
+  ns->last_read_recv = ns->last_read_trans = 0;
+  update_net_accounting(now);
+  ns->recv += 300;
+  ns->trans += 20;
+  update_net_accounting(now);
+  REQUIRE(net_accounting_total("acct0", NET_PERIOD_HOUR, true, true) == 320);
+  REQUIRE(net_accounting_total("acct0", NET_PERIOD_MONTH, false, true) == 20);
+
+  SECTION("a reset counter isn't counted as traffic") {
+    ns->recv = 5;
+    update_net_accounting(now);
+    ns->recv = 105;
+    update_net_accounting(now);
+    REQUIRE(net_accounting_total("acct0", NET_PERIOD_DAY, true, false) ==
+            400);
+  }
+
+  SECTION("periods roll over with updates, not while printing") {
+    char buf[32];
+    for (int i = 0; i < 3; ++i) { print_net_total(&obj, buf, sizeof(buf)); }
+    REQUIRE(net_accounting_total("acct0", NET_PERIOD_HOUR, true, true) == 320);
+
+    update_net_accounting(now + 3600);
+    REQUIRE(net_accounting_total("acct0", NET_PERIOD_HOUR, true, true) == 0);
+  }
+
+  SECTION("buckets survive a restart") {
+    free_net_total(&obj);
+    clear_net_accounting();
+    REQUIRE(std::filesystem::exists(file));
+    REQUIRE(net_accounting_total("acct0", NET_PERIOD_DAY, true, true) == 0);
+
+    parse_net_total_arg(&obj, "acct0", NET_PERIOD_DAY);
+    update_net_accounting(now);
+    REQUIRE(net_accounting_total("acct0", NET_PERIOD_DAY, true, true) == 320);
+  }
+
+  free_net_total(&obj);
+  clear_net_accounting();
+  clear_net_stats();
+  unsetenv("XDG_STATE_HOME");
+}
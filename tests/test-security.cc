@@ -11,7 +11,9 @@
 #include <data/network/rss.h>
 #endif
 #ifdef BUILD_CURL
-#include <common.h>
+#include <conky.h>
+#include <data/network/github.h>
+#include <lua/lua-config.hh>
 #endif
 
 #ifdef BUILD_HTTP
@@ -37,8 +39,23 @@ TEST_CASE("rss_safe_append truncates without overflowing", "[security][rss]") {
 #ifdef BUILD_CURL
 TEST_CASE("github_notifications uses auth header instead of query params",
           "[security][github]") {
-  REQUIRE(github_notifications_url() == "https://api.github.com/notifications");
+  state = std::make_unique<lua::state>();
+  conky::export_symbols(*state);
+
+  REQUIRE(github_notifications_url.get(*state) ==
+          "https://api.github.com/notifications");
   REQUIRE(github_authorization_header("secret-token") ==
           "Authorization: Bearer secret-token");
 }
+
+TEST_CASE("github_notifications only sends the token over https",
+          "[security][github]") {
+  REQUIRE(github_url_allowed("https://api.github.com/notifications"));
+  REQUIRE(github_url_allowed("https://ghe.example.com/api/v3/notifications"));
+  REQUIRE(github_url_allowed("http://127.0.0.1:8080/notifications"));
+  REQUIRE(github_url_allowed("http://localhost/notifications"));
+  REQUIRE_FALSE(github_url_allowed("http://api.github.com/notifications"));
+  REQUIRE_FALSE(github_url_allowed("http://localhost@evil.example/"));
+  REQUIRE_FALSE(github_url_allowed("ftp://127.0.0.1/notifications"));
+}
 #endif
@@ -0,0 +1,132 @@
+/*
+ *
+ * Conky, a system monitor, based on torsmo
+ *
+ * Any original torsmo code is licensed under the BSD license
+ *
+ * All code written since the fork of torsmo is licensed under the GPL
+ *
+ * Please see COPYING for details
+ *
+ * Copyright (c) 2005-2024 Brenden Matthews, Philip Kovacs, et. al.
+ *	(see AUTHORS)
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "catch2/catch.hpp"
+
+#include <config.h>
+
+#ifdef BUILD_X11
+#include <conky.h>
+#include <content/text_object.h>
+#include <output/display-x11.hh>
+#include <output/gui.h>
+#include <output/x11-event.h>
+#include <output/x11.h>
+
+#include <string>
+
+TEST_CASE("key LED objects print the state from XKB notifications",
+          "[x11]") {
+  struct text_object obj{};
+  char buf[8];
+  auto print = [&obj, &buf](void (*fn)(struct text_object *, char *,
+                                       unsigned int)) {
+    fn(&obj, buf, sizeof(buf));
+    return std::string(buf);
+  };
+
+  /* without a display any round trip would crash, the cache must do */
+  Display *saved = display;
+  display = nullptr;
+  window.xkb_event_base = 85;
+
+  XkbIndicatorNotifyEvent ev{};
+  ev.xkb_type = XkbIndicatorStateNotify;
+  ev.state = 1 | 4;
+  conky::x11::event event(ev);
+  REQUIRE(event.raw_x11_type() == window.xkb_event_base);
+  auto notify = event.downcast<XkbIndicatorNotifyEvent>();
+  REQUIRE(notify);
+  get_x11_keyboard_indicators(nullptr, &notify->get());
+
+  REQUIRE(info.x11.keyboard.tracked);
+  REQUIRE(print(&print_key_caps_lock) == "On");
+  REQUIRE(print(&print_key_num_lock) == "Off");
+  REQUIRE(print(&print_key_scroll_lock) == "On");
+
+  ev.state = 2;
+  get_x11_keyboard_indicators(nullptr, &ev);
+  REQUIRE(print(&print_key_caps_lock) == "Off");
+  REQUIRE(print(&print_key_num_lock) == "On");
+
+  info.x11.keyboard = {};
+  window.xkb_event_base = 0;
+  display = saved;
+}
+
+TEST_CASE("a burst of exposures is merged into one repaint region",
+          "[x11]") {
+  /* without a display any XSync would crash, merging must be local */
+  Display *saved = display;
+  display = nullptr;
+  window.repaint_region = XCreateRegion();
+
+  /* a window uncovered in 10x10 pieces */
+  for (int i = 0; i < 100; ++i) {
+    XExposeEvent expose{};
+    expose.type = Expose;
+    expose.x = (i % 10) * 10;
+    expose.y = (i / 10) * 10 + 20;
+    expose.width = expose.height = 10;
+    expose.count = 99 - i;
+    conky::x11::event ev(expose);
+    REQUIRE(conky::process_event(nullptr, nullptr, ev, nullptr));
+  }
+
+  XRectangle clip;
+  XClipBox(window.repaint_region, &clip);
+  REQUIRE(clip.x == 0);
+  REQUIRE(clip.y == 20);
+  REQUIRE(clip.width == 100);
+  REQUIRE(clip.height == 100);
+  REQUIRE(XRectInRegion(window.repaint_region, 0, 20, 100, 100) ==
+          RectangleIn);
+  /* only the exposed area is redrawn, not the whole window */
+  REQUIRE(XRectInRegion(window.repaint_region, 0, 0, 100, 20) == RectangleOut);
+
+#ifdef BUILD_XDAMAGE
+  /* damage is conky's own drawing, acknowledged once but never redrawn */
+  XDestroyRegion(window.repaint_region);
+  window.repaint_region = XCreateRegion();
+  window.damage_pending = false;
+  for (int i = 0; i < 10; ++i) {
+    XDamageNotifyEvent damage{};
+    damage.area = {0, 0, 50, 50};
+    conky::x11::event ev(damage);
+    REQUIRE(conky::process_event(nullptr, nullptr, ev, nullptr));
+  }
+  REQUIRE(window.damage_pending);
+  REQUIRE(XEmptyRegion(window.repaint_region));
+  window.damage_pending = false;
+#endif /* BUILD_XDAMAGE */
+
+  XDestroyRegion(window.repaint_region);
+  window.repaint_region = nullptr;
+  display = saved;
+}
+#endif /* BUILD_X11 */